@@ -0,0 +1,548 @@
+/* ----------------------------------------------------------------
+  ApiServer.cpp
+  - Wi-Fi 経由で電源状態・スケジュール・ログの参照と電源の切り替えを
+    行う HTTP API を提供し、状態の変化を Server-Sent Events で通知する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "ApiServer.h"
+
+// ===============================================================
+// ApiServer クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+ApiServer::ApiServer(const LogStore& logStore)
+  : _server(_PORT) {
+  this->_logStore = &logStore;
+}
+
+// ---------------------------------------------------------------
+// サーバーを開始する
+// ---------------------------------------------------------------
+void ApiServer::begin() {
+  this->_server.begin();
+  this->_server.setNoDelay(true);
+  this->_started = true;
+}
+
+// ---------------------------------------------------------------
+// スケジュールをセット
+// ---------------------------------------------------------------
+void ApiServer::setSchedule(const char* timerTime, uint32_t timerInterval, const char* ntpTime) {
+  this->_timerTime = timerTime;
+  this->_timerInterval = timerInterval;
+  this->_ntpTime = ntpTime;
+}
+
+// ---------------------------------------------------------------
+// 電源状態をセット (変化があれば通知する)
+// ---------------------------------------------------------------
+void ApiServer::setPowerStatus(bool status) {
+  if (this->_powerKnown && this->_powerStatus == status) {
+    return;
+  }
+  this->_powerKnown = true;
+  this->_powerStatus = status;
+
+  this->_broadcast("power", status ? "{\"power\":true}" : "{\"power\":false}");
+}
+
+// ---------------------------------------------------------------
+// ログの追加を通知する
+// ---------------------------------------------------------------
+void ApiServer::notifyLog(const LogRecord& rec) {
+  char line[LOG_LINE_LEN];
+  LogStore::formatRecord(rec, line, sizeof(line));
+
+  char data[LOG_LINE_LEN + 32];
+  snprintf(data, sizeof(data), "{\"line\":\"%s\",\"err\":%s}", line, rec.err ? "true" : "false");
+  this->_broadcast("log", data);
+}
+
+// ---------------------------------------------------------------
+// 設定の変更とファームウェアの更新に必要なトークンをセット
+// ---------------------------------------------------------------
+void ApiServer::setToken(const char* token) {
+  this->_token = token;
+}
+
+// ---------------------------------------------------------------
+// 電源の切り替え要求を受け付けるかどうかをセット
+// ---------------------------------------------------------------
+void ApiServer::setToggleAllowed(bool allowed) {
+  this->_toggleAllowed = allowed;
+}
+
+// ---------------------------------------------------------------
+// 電源の切り替え要求を取り出す
+// ---------------------------------------------------------------
+bool ApiServer::takeToggleRequest() {
+  bool req = this->_toggleRequested;
+  this->_toggleRequested = false;
+  return req;
+}
+
+// ---------------------------------------------------------------
+// 設定の反映要求を取り出す
+// ---------------------------------------------------------------
+bool ApiServer::takeConfigRequest(const char*& text, size_t& len) {
+  if (this->_configRequested == false) {
+    return false;
+  }
+  this->_configRequested = false;
+  text = this->_config;
+  len = this->_configLen;
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 設定の反映結果を通知する
+// ---------------------------------------------------------------
+void ApiServer::notifyConfig(bool ok, const char* error) {
+  char data[64];
+  snprintf(data, sizeof(data), "{\"ok\":%s,\"error\":\"%s\"}", ok ? "true" : "false", error);
+  this->_broadcast("config", data);
+}
+
+// ---------------------------------------------------------------
+// ファームウェアの更新要求を取り出す
+// ---------------------------------------------------------------
+bool ApiServer::takeOtaRequest(const char*& url, const char*& sha256) {
+  if (this->_otaRequested == false) {
+    return false;
+  }
+  this->_otaRequested = false;
+  url = this->_otaUrl;
+  sha256 = this->_otaSha256;
+  return true;
+}
+
+// ---------------------------------------------------------------
+// ファームウェアの更新結果を通知する
+// ---------------------------------------------------------------
+void ApiServer::notifyOta(bool ok, const char* error) {
+  char data[64];
+  snprintf(data, sizeof(data), "{\"ok\":%s,\"error\":\"%s\"}", ok ? "true" : "false", error);
+  this->_broadcast("ota", data);
+}
+
+// ---------------------------------------------------------------
+// 受信したリクエストを処理する
+// - 受信中の接続がなければ次の接続を受け付け、届いている分だけ読む
+// - ヘッダー (またはボディ) が揃うまでは、続きを次の呼び出しで読む
+// ---------------------------------------------------------------
+void ApiServer::handle() {
+  if (this->_started == false || WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+
+  if (this->_recvState == _RECV_IDLE) {
+    this->_client = this->_server.available();
+    if (!this->_client) {
+      return;
+    }
+    this->_reqLen = 0;
+    this->_req[0] = '\0';
+    this->_tail = 0;
+    this->_overflow = false;
+    this->_recvStart = millis();
+    this->_recvState = _RECV_HEADER;
+  }
+
+  if (this->_recvState == _RECV_HEADER) {
+    // ヘッダーが途中で途切れたら 408 を返す
+    if (!this->_receiveHeader()) {
+      if (this->_recvExpired()) {
+        if (this->_client.connected()) {
+          this->_sendError(this->_client, 408, "Request Timeout");
+        }
+        this->_closeClient();
+      }
+      return;
+    }
+    // ヘッダーがバッファに収まらなければ 431 を返す
+    if (this->_overflow) {
+      this->_sendError(this->_client, 431, "Request Header Fields Too Large");
+      this->_closeClient();
+      return;
+    }
+    this->_handleRequest();
+  }
+
+  if (this->_recvState == _RECV_BODY) {
+    // ボディが Content-Length に満たないまま途切れたら 400 を返す
+    if (!this->_receiveBody()) {
+      if (this->_recvExpired()) {
+        this->_sendError(this->_client, 400, "Bad Request");
+        this->_closeClient();
+      }
+      return;
+    }
+    this->_handleBody();
+  }
+}
+
+// 届いている分だけヘッダーを受信する
+// - バッファに収まらない部分は読み捨てて _overflow を true にする
+// - ヘッダーの終わりは直近の 4 バイトで判定する (読み捨てた部分にあっても分かる)
+bool ApiServer::_receiveHeader() {
+  while (this->_client.available() > 0) {
+    int c = this->_client.read();
+    if (c < 0) {
+      break;
+    }
+    if (this->_reqLen < sizeof(this->_req) - 1) {
+      this->_req[this->_reqLen++] = (char)c;
+      this->_req[this->_reqLen] = '\0';
+    } else {
+      this->_overflow = true;
+    }
+    this->_tail = (this->_tail << 8) | (uint8_t)c;
+    if (this->_tail == 0x0d0a0d0a) {  // "\r\n\r\n"
+      return true;
+    }
+  }
+  return false;
+}
+
+// 届いている分だけボディを受信する
+bool ApiServer::_receiveBody() {
+  while (this->_bodyPos < this->_bodyLen && this->_client.available() > 0) {
+    int c = this->_client.read();
+    if (c < 0) {
+      break;
+    }
+    this->_body[this->_bodyPos++] = (char)c;
+  }
+  return this->_bodyPos == this->_bodyLen;
+}
+
+// 受信を待てなくなったかどうか
+bool ApiServer::_recvExpired() {
+  return millis() - this->_recvStart >= this->_RECV_TIMEOUT || !this->_client.connected();
+}
+
+// 受信したヘッダーを解析して処理する
+void ApiServer::_handleRequest() {
+  // ボディの長さとトークン (ヘッダーの大文字・小文字は問わない)
+  this->_contentLength = 0;
+  this->_bearer = "";
+  this->_bearerLen = 0;
+  for (char* p = strchr(this->_req, '\n'); p != nullptr; p = strchr(p + 1, '\n')) {
+    if (strncasecmp(p + 1, "Content-Length:", 15) == 0) {
+      this->_contentLength = strtoul(p + 16, nullptr, 10);
+    } else if (strncasecmp(p + 1, "Authorization:", 14) == 0) {
+      const char* v = p + 15;
+      while (*v == ' ') {
+        v++;
+      }
+      if (strncasecmp(v, "Bearer ", 7) == 0) {
+        this->_bearer = v + 7;
+        this->_bearerLen = strcspn(this->_bearer, "\r\n");
+      }
+    }
+  }
+
+  // リクエスト行 ("METHOD /path?query HTTP/1.1") を分解する
+  char* method = this->_req;
+  char* path = strchr(method, ' ');
+  if (path == nullptr) {
+    this->_sendError(this->_client, 400, "Bad Request");
+    this->_closeClient();
+    return;
+  }
+  *path++ = '\0';
+
+  char* end = strchr(path, ' ');
+  if (end != nullptr) {
+    *end = '\0';
+  }
+
+  const char* query = "";
+  char* q = strchr(path, '?');
+  if (q != nullptr) {
+    *q = '\0';
+    query = q + 1;
+  }
+
+  this->_dispatch(this->_client, method, path, query);
+
+  // ボディを受け取らないリクエストはここで終わり
+  if (this->_recvState == _RECV_HEADER) {
+    this->_closeClient();
+  }
+}
+
+// ボディの受信を開始する
+void ApiServer::_beginBody(uint8_t target, char* buf, size_t len) {
+  this->_bodyTarget = target;
+  this->_body = buf;
+  this->_bodyLen = len;
+  this->_bodyPos = 0;
+  this->_recvStart = millis();
+  this->_recvState = _RECV_BODY;
+}
+
+// 受信したボディを処理してレスポンスを返す
+void ApiServer::_handleBody() {
+  if (this->_bodyTarget == _BODY_CONFIG) {
+    this->_configLen = this->_bodyLen;
+    this->_configRequested = true;
+  } else {
+    this->_otaUrl[this->_bodyLen] = '\0';
+    if (!this->_splitOtaRequest()) {
+      this->_sendError(this->_client, 400, "Bad Request");
+      this->_closeClient();
+      return;
+    }
+    this->_otaRequested = true;
+  }
+  int len = snprintf(this->_res, sizeof(this->_res), "{\"accepted\":true}");
+  this->_sendJson(this->_client, 202, "Accepted", len);
+  this->_closeClient();
+}
+
+// 受信中の接続を閉じる
+void ApiServer::_closeClient() {
+  this->_client.stop();
+  this->_releaseClient();
+}
+
+// 受信中の接続を手放す (閉じない)
+void ApiServer::_releaseClient() {
+  this->_client = WiFiClient();
+  this->_recvState = _RECV_IDLE;
+}
+
+// クエリー文字列から key の値を取得する
+const char* ApiServer::_queryValue(const char* query, const char* key) {
+  size_t keyLen = strlen(key);
+  const char* p = query;
+  while (*p != '\0') {
+    size_t len = strcspn(p, "&");
+    if (len > keyLen && strncmp(p, key, keyLen) == 0 && p[keyLen] == '=') {
+      return p + keyLen + 1;
+    }
+    p += len;
+    if (*p == '&') {
+      p++;
+    }
+  }
+  return nullptr;
+}
+
+// リクエストを処理してレスポンスを返す
+void ApiServer::_dispatch(WiFiClient& client, const char* method, const char* path, const char* query) {
+  bool isGet = (strcmp(method, "GET") == 0);
+  bool isPost = (strcmp(method, "POST") == 0);
+
+  if (isGet && strcmp(path, "/status") == 0) {
+    const char* power = "null";
+    if (this->_powerKnown) {
+      power = this->_powerStatus ? "true" : "false";
+    }
+    int len = snprintf(this->_res, sizeof(this->_res), "{\"power\":%s,\"uptime\":%u}",
+                       power, (unsigned)(millis() / 1000));
+    this->_sendJson(client, 200, "OK", len);
+    client.stop();
+
+  } else if (isGet && strcmp(path, "/schedule") == 0) {
+    int len = snprintf(this->_res, sizeof(this->_res), "{\"timer\":\"%s\",\"interval\":%u,\"ntp\":\"%s\"}",
+                       this->_timerTime, (unsigned)this->_timerInterval, this->_ntpTime);
+    this->_sendJson(client, 200, "OK", len);
+    client.stop();
+
+  } else if (isGet && strcmp(path, "/logs") == 0) {
+    // 件数の指定 ("n=件数")
+    size_t n = 10;
+    const char* np = _queryValue(query, "n");
+    if (np != nullptr) {
+      n = strtoul(np, nullptr, 10);
+    }
+    if (n > _LOGS_MAX) {
+      n = _LOGS_MAX;
+    }
+
+    // 新しい順に並べる
+    size_t len = snprintf(this->_res, sizeof(this->_res), "[");
+    char line[LOG_LINE_LEN];
+    for (size_t i = 0; i < n; i++) {
+      // バッファに収まらなくなったら打ち切る
+      if (len + LOG_LINE_LEN + 32 >= sizeof(this->_res)) {
+        break;
+      }
+      LogRecord rec;
+      if (!this->_logStore->get(i, rec)) {
+        break;
+      }
+      LogStore::formatRecord(rec, line, sizeof(line));
+      len += snprintf(this->_res + len, sizeof(this->_res) - len, "%s{\"line\":\"%s\",\"err\":%s}",
+                      (i == 0) ? "" : ",", line, rec.err ? "true" : "false");
+    }
+    len += snprintf(this->_res + len, sizeof(this->_res) - len, "]");
+    this->_sendJson(client, 200, "OK", len);
+    client.stop();
+
+  } else if (isPost && strcmp(path, "/toggle") == 0) {
+    // 本体の操作中 (確認・処理中・ログ表示など) は受け付けない
+    if (!this->_toggleAllowed) {
+      this->_sendError(client, 409, "Conflict");
+      client.stop();
+      return;
+    }
+    // BLE 通信は loop() で行う (結果は power イベントで通知される)
+    this->_toggleRequested = true;
+    int len = snprintf(this->_res, sizeof(this->_res), "{\"accepted\":true}");
+    this->_sendJson(client, 202, "Accepted", len);
+    client.stop();
+
+  } else if (isPost && strcmp(path, "/config") == 0) {
+    // ボディは "key=value" の行の並び (空なら SD カードの設定ファイルを読み直す)
+    // - 検証と反映は loop() で行う (結果は config イベントで通知される)
+    if (!this->_authorize(client)) {
+      client.stop();
+      return;
+    }
+    if (this->_contentLength > sizeof(this->_config)) {
+      this->_sendError(client, 413, "Payload Too Large");
+      client.stop();
+      return;
+    }
+    this->_beginBody(_BODY_CONFIG, this->_config, this->_contentLength);
+
+  } else if (isPost && strcmp(path, "/ota") == 0) {
+    // ボディはファームウェア (差分形式または通常のイメージ) の URL と、
+    // 書き込み後のイメージの SHA-256 (16 進数) を改行で区切ったもの
+    // - 更新は loop() で行う (成功すると再起動し、失敗したら ota イベントで通知される)
+    if (!this->_authorize(client)) {
+      client.stop();
+      return;
+    }
+    if (this->_contentLength == 0 || this->_contentLength >= sizeof(this->_otaUrl)) {
+      this->_sendError(client, 400, "Bad Request");
+      client.stop();
+      return;
+    }
+    this->_beginBody(_BODY_OTA, this->_otaUrl, this->_contentLength);
+
+  } else if (isGet && strcmp(path, "/events") == 0) {
+    // 接続を保持して以降のイベントを送信する (受信中の接続からは手放す)
+    this->_addSseClient(client);
+    this->_releaseClient();
+
+  } else {
+    this->_sendError(client, 404, "Not Found");
+    client.stop();
+  }
+}
+
+// POST /ota の本体を URL と SHA-256 に分ける
+// - 末尾の改行と CR は取り除く。SHA-256 が 64 文字でなければ false
+bool ApiServer::_splitOtaRequest() {
+  char* sep = strchr(this->_otaUrl, '\n');
+  if (sep == nullptr || sep == this->_otaUrl) {
+    return false;
+  }
+  *sep = '\0';
+  if (sep[-1] == '\r') {
+    sep[-1] = '\0';
+  }
+  char* hash = sep + 1;
+  size_t len = strcspn(hash, "\r\n");
+  hash[len] = '\0';
+  if (len != 64 || strspn(hash, "0123456789abcdefABCDEF") != len) {
+    return false;
+  }
+  this->_otaSha256 = hash;
+  return true;
+}
+
+// リクエストのトークンを確認する
+// - 比較にかかる時間が一致した長さで変わらないように、最後まで比べる
+bool ApiServer::_authorize(WiFiClient& client) {
+  size_t len = strlen(this->_token);
+  if (len == 0) {
+    this->_sendError(client, 403, "Forbidden");
+    return false;
+  }
+
+  uint8_t diff = (this->_bearerLen != len) ? 1 : 0;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t c = (i < this->_bearerLen) ? this->_bearer[i] : 0;
+    diff |= c ^ (uint8_t)this->_token[i];
+  }
+  if (diff != 0) {
+    this->_sendError(client, 401, "Unauthorized");
+    return false;
+  }
+  return true;
+}
+
+// JSON のレスポンスを返す
+void ApiServer::_sendJson(WiFiClient& client, uint16_t code, const char* status, size_t len) {
+  if (len >= sizeof(this->_res)) {
+    len = sizeof(this->_res) - 1;
+  }
+  char header[128];
+  int hlen = snprintf(header, sizeof(header),
+                      "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                      code, status, (unsigned)len);
+  client.write((const uint8_t*)header, hlen);
+  client.write((const uint8_t*)this->_res, len);
+}
+
+// エラーのレスポンスを返す
+void ApiServer::_sendError(WiFiClient& client, uint16_t code, const char* status) {
+  int len = snprintf(this->_res, sizeof(this->_res), "{\"error\":\"%s\"}", status);
+  this->_sendJson(client, code, status, len);
+}
+
+// SSE 接続を登録する
+void ApiServer::_addSseClient(WiFiClient& client) {
+  for (size_t i = 0; i < _SSE_MAX; i++) {
+    if (!this->_sseClients[i].connected()) {
+      this->_sseClients[i].stop();
+      this->_sseClients[i] = client;
+
+      const char* header = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\n\r\n";
+      this->_sseClients[i].write((const uint8_t*)header, strlen(header));
+
+      // 現在の電源状態を最初に送る
+      if (this->_powerKnown) {
+        char msg[48];
+        int len = snprintf(msg, sizeof(msg), "event: power\ndata: {\"power\":%s}\n\n", this->_powerStatus ? "true" : "false");
+        this->_sseClients[i].write((const uint8_t*)msg, len);
+      }
+      return;
+    }
+  }
+
+  this->_sendError(client, 503, "Service Unavailable");
+  client.stop();
+}
+
+// すべての SSE 接続にイベントを送信する
+void ApiServer::_broadcast(const char* event, const char* data) {
+  if (this->_started == false) {
+    return;
+  }
+
+  char msg[160];
+  int len = snprintf(msg, sizeof(msg), "event: %s\ndata: %s\n\n", event, data);
+  if (len >= (int)sizeof(msg)) {
+    len = sizeof(msg) - 1;
+  }
+
+  for (size_t i = 0; i < _SSE_MAX; i++) {
+    if (this->_sseClients[i].connected()) {
+      this->_sseClients[i].write((const uint8_t*)msg, len);
+    }
+  }
+}
@@ -0,0 +1,218 @@
+/* ----------------------------------------------------------------
+  ApiServer.h
+  - Wi-Fi 経由で電源状態・スケジュール・ログの参照と電源の切り替えを
+    行う HTTP API を提供し、状態の変化を Server-Sent Events で通知する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef ApiServer_h
+#define ApiServer_h
+#include <Arduino.h>
+#include <WiFi.h>
+#include "LogStore.h"
+
+// ---------------------------------------------------------------
+// ApiServer クラス
+// ---------------------------------------------------------------
+class ApiServer {
+private:
+  // 待ち受けポート
+  const uint16_t _PORT = 80;
+
+  // リクエストの受信を待つ最大時間 (ミリ秒, ヘッダーとボディでそれぞれ)
+  const uint32_t _RECV_TIMEOUT = 200;
+
+  // 受信中の接続の状態
+  static const uint8_t _RECV_IDLE = 0;    // 受信中の接続はない
+  static const uint8_t _RECV_HEADER = 1;  // ヘッダーを受信中
+  static const uint8_t _RECV_BODY = 2;    // ボディを受信中
+
+  // 受信したボディの送り先
+  static const uint8_t _BODY_CONFIG = 0;  // POST /config
+  static const uint8_t _BODY_OTA = 1;     // POST /ota
+
+  // /logs で返す最大件数
+  static const size_t _LOGS_MAX = 30;
+
+  // イベント通知 (/events) の同時接続数
+  static const size_t _SSE_MAX = 2;
+
+  WiFiServer _server;
+  WiFiClient _sseClients[_SSE_MAX];
+
+  // 受信中の接続 (1 接続ずつ受信し、handle() のたびに届いている分だけ読む)
+  WiFiClient _client;
+  uint8_t _recvState = _RECV_IDLE;
+  uint32_t _recvStart = 0;
+
+  // ヘッダーの受信の状態 (受信した長さ、直近の 4 バイト、バッファに収まらなかったかどうか)
+  size_t _reqLen = 0;
+  uint32_t _tail = 0;
+  bool _overflow = false;
+
+  // ボディの受信の状態 (送り先、受信するバッファ、長さ、受信した長さ)
+  uint8_t _bodyTarget = _BODY_CONFIG;
+  char* _body = nullptr;
+  size_t _bodyLen = 0;
+  size_t _bodyPos = 0;
+
+  // 事前に確保したリクエスト・レスポンス用のバッファ
+  char _req[512];
+  char _res[2048];
+
+  // POST /config で受信した設定テキスト
+  char _config[512];
+  size_t _configLen = 0;
+
+  // POST /ota で受信したファームウェアの URL と SHA-256 (16 進数)
+  // - 本体は "URL\nSHA-256" で、改行の位置で 2 つの文字列に分ける
+  char _otaUrl[256 + 66];
+  const char* _otaSha256 = "";
+
+  // リクエストの Content-Length
+  size_t _contentLength = 0;
+
+  // リクエストの Authorization ヘッダーの Bearer トークン (_req の中を指す, なければ長さ 0)
+  const char* _bearer = "";
+  size_t _bearerLen = 0;
+
+  // 設定の変更とファームウェアの更新に必要なトークン (空なら受け付けない)
+  const char* _token = "";
+
+  // 参照するログ
+  const LogStore* _logStore;
+
+  // スケジュール
+  const char* _timerTime = "";
+  uint32_t _timerInterval = 0;
+  const char* _ntpTime = "";
+
+  // 電源状態 (不明なら _powerKnown が false)
+  bool _powerKnown = false;
+  bool _powerStatus = false;
+
+  // 電源の切り替え要求があるかどうか
+  bool _toggleRequested = false;
+
+  // 電源の切り替え要求を受け付けるかどうか
+  bool _toggleAllowed = false;
+
+  // 設定の反映要求があるかどうか
+  bool _configRequested = false;
+
+  // ファームウェアの更新要求があるかどうか
+  bool _otaRequested = false;
+
+  bool _started = false;
+
+private:
+  // 届いている分だけヘッダーを受信する (ヘッダーの終わりまで受信できたら true)
+  bool _receiveHeader();
+
+  // 届いている分だけボディを受信する (Content-Length 分を受信できたら true)
+  bool _receiveBody();
+
+  // 受信を待てなくなったかどうか (受信待ちの上限を過ぎたか、接続が閉じられた)
+  bool _recvExpired();
+
+  // 受信したヘッダーを解析して処理する
+  void _handleRequest();
+
+  // リクエストを処理してレスポンスを返す
+  // - ボディを受け取るリクエストは、ボディの受信を開始して戻る
+  void _dispatch(WiFiClient& client, const char* method, const char* path, const char* query);
+
+  // ボディの受信を開始する
+  void _beginBody(uint8_t target, char* buf, size_t len);
+
+  // 受信したボディを処理してレスポンスを返す
+  void _handleBody();
+
+  // 受信中の接続を閉じる
+  void _closeClient();
+
+  // 受信中の接続を手放す (SSE 接続として引き継いだ場合)
+  void _releaseClient();
+
+  // クエリー文字列 ("a=1&b=2") から key の値を取得する (キー全体で比べる)
+  // - なければ nullptr を返す。値は次の '&' または文字列の終わりまで
+  static const char* _queryValue(const char* query, const char* key);
+
+  // リクエストのトークンを確認し、一致しなければエラーのレスポンスを返す
+  // - トークンが設定されていなければ 403、一致しなければ 401
+  bool _authorize(WiFiClient& client);
+
+  // POST /ota の本体を URL と SHA-256 に分ける (不正なら false)
+  bool _splitOtaRequest();
+
+  // JSON のレスポンスを返す
+  void _sendJson(WiFiClient& client, uint16_t code, const char* status, size_t len);
+
+  // エラーのレスポンスを返す
+  void _sendError(WiFiClient& client, uint16_t code, const char* status);
+
+  // SSE 接続を登録する
+  void _addSseClient(WiFiClient& client);
+
+  // すべての SSE 接続にイベントを送信する
+  void _broadcast(const char* event, const char* data);
+
+public:
+  // コンストラクタ
+  ApiServer(const LogStore& logStore);
+
+  // サーバーを開始する (Wi-Fi 接続後に呼ぶ)
+  void begin();
+
+  // スケジュールをセット
+  void setSchedule(const char* timerTime, uint32_t timerInterval, const char* ntpTime);
+
+  // 電源状態をセット (変化があれば通知する)
+  void setPowerStatus(bool status);
+
+  // ログの追加を通知する
+  void notifyLog(const LogRecord& rec);
+
+  // 受信したリクエストを処理する (loop() から呼ぶ)
+  // - 1 回の呼び出しで処理するのは 1 リクエストのみ
+  // - 受信を待たない (届いている分だけ読み、続きは次の呼び出しで読む)
+  // - リクエストがなければヒープ確保は発生しない
+  // - ESP32 の WiFiClient は受け付けた接続ごとにソケットと受信バッファを
+  //   shared_ptr で確保する (接続を閉じると解放される)。リクエストの処理自体は
+  //   事前に確保したバッファだけを使う
+  void handle();
+
+  // 設定の変更 (POST /config) とファームウェアの更新 (POST /ota) に必要なトークンをセット
+  // - token が指すバッファは以降も有効であること (内容は変わってよい)
+  // - リクエストの "Authorization: Bearer <トークン>" ヘッダーと比べる
+  void setToken(const char* token);
+
+  // 電源の切り替え要求を受け付けるかどうかをセット
+  // - 受け付けない間の POST /toggle には 409 を返す
+  void setToggleAllowed(bool allowed);
+
+  // 電源の切り替え要求を取り出す
+  bool takeToggleRequest();
+
+  // 設定の反映要求を取り出す
+  // - text が指すバッファは次に handle() を呼ぶまで有効
+  // - len が 0 なら SD カードの設定ファイルの読み直しの要求
+  bool takeConfigRequest(const char*& text, size_t& len);
+
+  // 設定の反映結果を通知する
+  void notifyConfig(bool ok, const char* error);
+
+  // ファームウェアの更新要求を取り出す
+  // - sha256 は書き込み後のイメージの SHA-256 (16 進数 64 文字)
+  // - url と sha256 が指すバッファは次に handle() を呼ぶまで有効
+  bool takeOtaRequest(const char*& url, const char*& sha256);
+
+  // ファームウェアの更新結果を通知する
+  void notifyOta(bool ok, const char* error);
+};
+
+#endif
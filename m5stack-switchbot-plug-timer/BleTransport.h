@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------
+  BleTransport.h
+  - BLE のスキャン・接続・書き込み・NOTIFY 受信を抽象化する
+  - 実装はビルド時に選択する (Bluedroid、NimBLE または模擬)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef BleTransport_h
+#define BleTransport_h
+#include <Arduino.h>
+#include "ErrorCode.h"
+
+// ================================================================
+// BLE スタックの選択
+// - NimBLE を使う場合は有効にする (NimBLE-Arduino ライブラリが必要)
+// - 無効の場合は ESP32 Arduino 標準の Bluedroid を使う
+// - USE_FAKE_BLE を有効にすると、BLE を使わずにプラグを模擬する
+//   (ホストでのテスト用, FakeBleTransport.h を参照)
+// ----------------------------------------------------------------
+//#define USE_NIMBLE
+//#define USE_FAKE_BLE
+// ================================================================
+
+// BLE アドレスの文字列のバッファサイズ (終端文字を含む)
+const size_t BLE_ADDR_STR_LEN = 18;  // "xx:xx:xx:xx:xx:xx"
+
+// 接続時に要求する MTU (バイト)
+const uint16_t BLE_PREFERRED_MTU = 185;
+
+// アドバタイズの情報の構造体
+// - ポインタはコールバックの中でのみ有効
+struct BleAdvInfo {
+  char address[BLE_ADDR_STR_LEN];  // BLE アドレス (小文字)
+  uint8_t addressType;             // アドレスの種類 (public / random)
+  const uint8_t* mfrData;          // Manufacturer Data
+  size_t mfrLen;
+  const uint8_t* svcData;          // Service Data
+  size_t svcLen;
+  int rssi;                        // 受信信号強度 (dBm)
+};
+
+// スキャンのパラメータの構造体
+// - window / interval がスキャンのデューティ比 (100% なら常に受信)
+struct BleScanParams {
+  uint8_t durationSec;  // スキャンの時間 (秒)
+  uint16_t intervalMs;  // スキャン間隔 (ミリ秒)
+  uint16_t windowMs;    // 1 回の受信時間 (ミリ秒, intervalMs 以下)
+};
+
+// スキャンで見つかったデバイスごとに呼ばれるコールバック
+// - true を返すと以降のデバイスは処理しない
+typedef bool (*BleAdvCallback)(const BleAdvInfo& info, void* ctx);
+
+// NOTIFY を受信したときに呼ばれるコールバック
+typedef void (*BleNotifyCallback)(const uint8_t* data, size_t len);
+
+// ---------------------------------------------------------------
+// BleTransport クラス (インターフェース)
+// ---------------------------------------------------------------
+class BleTransport {
+public:
+  virtual ~BleTransport() {}
+
+  // BLE スタックの名前
+  virtual const char* name() const = 0;
+
+  // BLE スタックの初期化 (起動時に 1 回だけ呼ぶ)
+  virtual void init() = 0;
+
+  // スキャンして見つかったデバイスごとに cb を呼ぶ
+  virtual bool scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) = 0;
+
+  // 接続する
+  virtual bool connect(const char* address, uint8_t addressType) = 0;
+
+  // Service と Characteristics を準備して NOTIFY を購読する
+  virtual bool subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                         BleNotifyCallback cb, ErrorCode& err) = 0;
+
+  // データ送信用の Characteristic に書き込む
+  virtual bool write(const uint8_t* data, size_t len) = 0;
+
+  // 接続中の受信信号強度 (dBm, 取得できなければ 0)
+  virtual int getRssi() = 0;
+
+  // 接続パラメータの更新を要求する
+  // - interval は 1.25ms 単位、timeout (supervision timeout) は 10ms 単位
+  virtual bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) = 0;
+
+  // MTU の拡大を要求して、合意した MTU を返す
+  virtual uint16_t requestMtu(uint16_t mtu) = 0;
+
+  // 接続中かどうか
+  virtual bool isConnected() = 0;
+
+  // 切断する
+  virtual void disconnect() = 0;
+};
+
+// ビルド時に選択された BleTransport の実装を生成する
+BleTransport* createBleTransport();
+
+#endif
@@ -0,0 +1,232 @@
+/* ----------------------------------------------------------------
+  BluedroidTransport.cpp
+  - ESP32 Arduino 標準の Bluedroid による BleTransport の実装
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "BluedroidTransport.h"
+
+#if !defined(USE_NIMBLE) && !defined(USE_FAKE_BLE)
+
+// NOTIFY の転送先
+static BleNotifyCallback _notifyTarget = nullptr;
+
+static void bluedroidNotifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
+  if (_notifyTarget != nullptr) {
+    _notifyTarget(pData, length);
+  }
+}
+
+// MTU の交換で合意した MTU (未受信なら 0)
+static volatile uint16_t _negotiatedMtu = 0;
+
+// GATT クライアントのイベントから MTU の交換の結果を受け取る
+// - BLEClient::getMTU() は要求した値を返すことがあるので、イベントの値を使う
+static void bluedroidGattcHandler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t* param) {
+  if (event == ESP_GATTC_CFG_MTU_EVT && param->cfg_mtu.status == ESP_GATT_OK) {
+    _negotiatedMtu = param->cfg_mtu.mtu;
+  }
+}
+
+// ---------------------------------------------------------------
+// ビルド時に選択された BleTransport の実装を生成する
+// ---------------------------------------------------------------
+BleTransport* createBleTransport() {
+  static BluedroidTransport transport;
+  return &transport;
+}
+
+// ===============================================================
+// BluedroidTransport クラス
+// ===============================================================
+
+const char* BluedroidTransport::name() const {
+  return "Bluedroid";
+}
+
+// ---------------------------------------------------------------
+// BLE スタックの初期化
+// ---------------------------------------------------------------
+void BluedroidTransport::init() {
+  if (this->_pClient != nullptr) {
+    return;
+  }
+  BLEDevice::init("");
+  // 接続時の MTU の交換で要求する値
+  BLEDevice::setMTU(BLE_PREFERRED_MTU);
+  BLEDevice::setCustomGattcHandler(bluedroidGattcHandler);
+  this->_pClient = BLEDevice::createClient();
+}
+
+// ---------------------------------------------------------------
+// スキャンして見つかったデバイスごとに cb を呼ぶ
+// ---------------------------------------------------------------
+bool BluedroidTransport::scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) {
+  BLEScan* pBLEScan = BLEDevice::getScan();
+  pBLEScan->setActiveScan(true);
+  pBLEScan->setInterval(params.intervalMs);
+  pBLEScan->setWindow(params.windowMs);
+
+  BLEScanResults foundDevices = pBLEScan->start(params.durationSec, false);
+  int count = foundDevices.getCount();
+
+  for (int i = 0; i < count; i++) {
+    BLEAdvertisedDevice device = foundDevices.getDevice(i);
+
+    std::string mdata;
+    std::string sdata;
+    if (device.haveManufacturerData()) {
+      mdata = device.getManufacturerData();
+    }
+    if (device.haveServiceData()) {
+      sdata = device.getServiceData();
+    }
+
+    BleAdvInfo info;
+    strncpy(info.address, device.getAddress().toString().c_str(), sizeof(info.address) - 1);
+    info.address[sizeof(info.address) - 1] = '\0';
+    info.addressType = 0;
+    info.mfrData = (const uint8_t*)mdata.data();
+    info.mfrLen = mdata.length();
+    info.svcData = (const uint8_t*)sdata.data();
+    info.svcLen = sdata.length();
+    info.rssi = device.getRSSI();
+
+    if (cb(info, ctx)) {
+      break;
+    }
+  }
+
+  pBLEScan->clearResults();
+  return count > 0;
+}
+
+// ---------------------------------------------------------------
+// 接続する
+// ---------------------------------------------------------------
+bool BluedroidTransport::connect(const char* address, uint8_t addressType) {
+  BLEAddress bleAddress(address);
+  _negotiatedMtu = 0;
+  this->_pClient->connect(bleAddress);
+  return this->_pClient->isConnected();
+}
+
+// ---------------------------------------------------------------
+// Service と Characteristics を準備して NOTIFY を購読する
+// ---------------------------------------------------------------
+bool BluedroidTransport::subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                                   BleNotifyCallback cb, ErrorCode& err) {
+  // Service を取得
+  BLERemoteService* pService = this->_pClient->getService(serviceUuid);
+  if (pService == nullptr) {
+    err = ERR_SERVICE_NOT_FOUND;
+    return false;
+  }
+
+  // データ受信用の Characteristic を取得
+  this->_pCharRx = pService->getCharacteristic(rxUuid);
+  if (this->_pCharRx == nullptr) {
+    err = ERR_CHAR_RX_NOT_FOUND;
+    return false;
+  }
+
+  // データ送信用の Characteristic を取得
+  this->_pCharTx = pService->getCharacteristic(txUuid);
+  if (this->_pCharTx == nullptr) {
+    err = ERR_CHAR_TX_NOT_FOUND;
+    return false;
+  }
+
+  // データ送信用の Characteristic が NOTIFY をサポートしているかをチェック
+  if (this->_pCharTx->canNotify() == false) {
+    err = ERR_CHAR_TX_NOT_SUPPORT_NOTIFY;
+    return false;
+  }
+
+  // NOTIFY のコールバックをセット
+  _notifyTarget = cb;
+  this->_pCharTx->registerForNotify(bluedroidNotifyCallback);
+
+  return true;
+}
+
+// ---------------------------------------------------------------
+// データ送信用の Characteristic に書き込む
+// ---------------------------------------------------------------
+bool BluedroidTransport::write(const uint8_t* data, size_t len) {
+  if (this->_pCharRx == nullptr) {
+    return false;
+  }
+  this->_pCharRx->writeValue((uint8_t*)data, len, false);
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 接続中の受信信号強度
+// ---------------------------------------------------------------
+int BluedroidTransport::getRssi() {
+  if (!this->isConnected()) {
+    return 0;
+  }
+  return this->_pClient->getRssi();
+}
+
+// ---------------------------------------------------------------
+// 接続パラメータの更新を要求する
+// ---------------------------------------------------------------
+bool BluedroidTransport::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+  if (!this->isConnected()) {
+    return false;
+  }
+  esp_ble_conn_update_params_t params;
+  memcpy(params.bda, *this->_pClient->getPeerAddress().getNative(), sizeof(esp_bd_addr_t));
+  params.min_int = minInterval;
+  params.max_int = maxInterval;
+  params.latency = latency;
+  params.timeout = timeout;
+  return esp_ble_gap_update_conn_params(&params) == ESP_OK;
+}
+
+// ---------------------------------------------------------------
+// MTU の拡大を要求して、合意した MTU を返す
+// - 接続時の交換の結果を待ち、届かなければ改めて要求して待つ
+// - 結果が届かなければ交換前の MTU (23) を返す
+// ---------------------------------------------------------------
+uint16_t BluedroidTransport::requestMtu(uint16_t mtu) {
+  if (!this->isConnected()) {
+    return 0;
+  }
+  BLEDevice::setMTU(mtu);
+  for (uint8_t i = 0; i < 2 && _negotiatedMtu == 0; i++) {
+    if (i > 0) {
+      this->_pClient->setMTU(mtu);
+    }
+    uint32_t stime = millis();
+    while (_negotiatedMtu == 0 && millis() - stime < this->_MTU_TIMEOUT) {
+      delay(10);
+    }
+  }
+  return (_negotiatedMtu != 0) ? _negotiatedMtu : ESP_GATT_DEF_BLE_MTU_SIZE;
+}
+
+// ---------------------------------------------------------------
+// 接続中かどうか
+// ---------------------------------------------------------------
+bool BluedroidTransport::isConnected() {
+  return this->_pClient != nullptr && this->_pClient->isConnected();
+}
+
+// ---------------------------------------------------------------
+// 切断する
+// ---------------------------------------------------------------
+void BluedroidTransport::disconnect() {
+  this->_pClient->disconnect();
+  this->_pCharRx = nullptr;
+  this->_pCharTx = nullptr;
+}
+
+#endif
@@ -0,0 +1,50 @@
+/* ----------------------------------------------------------------
+  BluedroidTransport.h
+  - ESP32 Arduino 標準の Bluedroid による BleTransport の実装
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef BluedroidTransport_h
+#define BluedroidTransport_h
+#include "BleTransport.h"
+
+#if !defined(USE_NIMBLE) && !defined(USE_FAKE_BLE)
+#include <BLEDevice.h>
+#include <BLEUtils.h>
+#include <BLEScan.h>
+#include <BLEAdvertisedDevice.h>
+#include <esp_gap_ble_api.h>
+
+// ---------------------------------------------------------------
+// BluedroidTransport クラス
+// ---------------------------------------------------------------
+class BluedroidTransport : public BleTransport {
+private:
+  // MTU の交換の結果を待つ時間 (ミリ秒)
+  const uint32_t _MTU_TIMEOUT = 500;
+
+  BLEClient* _pClient = nullptr;
+  BLERemoteCharacteristic* _pCharRx = nullptr;
+  BLERemoteCharacteristic* _pCharTx = nullptr;
+
+public:
+  const char* name() const override;
+  void init() override;
+  bool scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) override;
+  bool connect(const char* address, uint8_t addressType) override;
+  bool subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                 BleNotifyCallback cb, ErrorCode& err) override;
+  bool write(const uint8_t* data, size_t len) override;
+  int getRssi() override;
+  bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) override;
+  uint16_t requestMtu(uint16_t mtu) override;
+  bool isConnected() override;
+  void disconnect() override;
+};
+
+#endif
+#endif
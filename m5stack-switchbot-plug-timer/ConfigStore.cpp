@@ -0,0 +1,487 @@
+/* ----------------------------------------------------------------
+  ConfigStore.cpp
+  - ユーザー設定を SD カードまたは NVS から読み込み、検証して保持する
+  - 実行中の設定の差し替え (ホットリロード) は検証に成功した場合のみ
+    まとめて反映する (一部の項目だけが変わることはない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "ConfigStore.h"
+#include <errno.h>
+#include <SD.h>
+#include <Preferences.h>
+#include "DailySchedule.h"
+
+// NVS に保存する形式 (バージョン + 設定の構造体)
+struct ConfigBlob {
+  uint8_t version;
+  Config config;
+};
+
+// ===============================================================
+// ConfigStore クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+ConfigStore::ConfigStore(const char* address, const char* ssid, const char* pass,
+                         const char* timerTime, uint16_t timerInterval, const char* ntpTime, uint32_t sleepTime) {
+  memset(&this->_config, 0, sizeof(this->_config));
+  this->_config.timerTime = DailySchedule::SECONDS_PER_DAY;
+  this->_config.ntpTime = DailySchedule::SECONDS_PER_DAY;
+
+  char num[12];
+  bool ok = true;
+  ok &= _set(this->_config, "mac", address);
+  ok &= _set(this->_config, "ssid", ssid);
+  ok &= _set(this->_config, "pass", pass);
+  ok &= _set(this->_config, "timer", timerTime);
+  snprintf(num, sizeof(num), "%u", timerInterval);
+  ok &= _set(this->_config, "interval", num);
+  ok &= _set(this->_config, "ntp", ntpTime);
+  snprintf(num, sizeof(num), "%u", (unsigned)sleepTime);
+  ok &= _set(this->_config, "sleep", num);
+  _format(this->_config);
+
+  if (!ok) {
+    this->_error = ERR_CONFIG_INVALID;
+  }
+}
+
+// ---------------------------------------------------------------
+// エラーコードを取得
+// ---------------------------------------------------------------
+ErrorCode ConfigStore::getError() {
+  return this->_error;
+}
+
+// ---------------------------------------------------------------
+// 現在の設定を取得
+// ---------------------------------------------------------------
+const Config& ConfigStore::get() const {
+  return this->_config;
+}
+
+// ---------------------------------------------------------------
+// 読み込み元を取得
+// ---------------------------------------------------------------
+ConfigSource ConfigStore::getSource() const {
+  return this->_source;
+}
+
+// ---------------------------------------------------------------
+// 直近の反映で変わった項目
+// ---------------------------------------------------------------
+uint8_t ConfigStore::getChanged() const {
+  return this->_changed;
+}
+
+// ---------------------------------------------------------------
+// 起動時の読み込み (SD カード -> NVS -> 初期値 の順)
+// ---------------------------------------------------------------
+bool ConfigStore::load() {
+  this->_error = ERR_NONE;
+  Config cfg = this->_config;
+
+  // SD カードの設定ファイル
+  size_t len = 0;
+  if (!this->_readSd(len)) {
+    // 読み込めない設定ファイルは使わずに NVS の設定を試す
+    this->_error = ERR_CONFIG_INVALID;
+  } else if (len > 0) {
+    if (_parse(cfg, this->_text, len)) {
+      this->_saveNvs(cfg);
+      this->_commit(cfg);
+      this->_source = CONFIG_SOURCE_SD;
+      return true;
+    }
+    // 不正な設定ファイルは使わずに NVS の設定を試す
+    this->_error = ERR_CONFIG_INVALID;
+    cfg = this->_config;
+  }
+
+  // NVS に保存された設定
+  if (this->_loadNvs(cfg)) {
+    this->_commit(cfg);
+    this->_source = CONFIG_SOURCE_NVS;
+    return this->_error == ERR_NONE;
+  }
+
+  // スケッチに書かれた初期値
+  this->_source = CONFIG_SOURCE_DEFAULT;
+  this->_changed = 0;
+  return this->_error == ERR_NONE;
+}
+
+// ---------------------------------------------------------------
+// 設定テキストを検証して反映する
+// ---------------------------------------------------------------
+bool ConfigStore::apply(const char* text, size_t len) {
+  this->_error = ERR_NONE;
+  this->_changed = 0;
+
+  // テキストの指定がなければ SD カードの設定ファイルを読み直す
+  ConfigSource source = CONFIG_SOURCE_NVS;
+  if (len == 0) {
+    if (!this->_readSd(len)) {
+      this->_error = ERR_CONFIG_INVALID;
+      return false;
+    }
+    if (len == 0) {
+      this->_error = ERR_CONFIG_NOT_FOUND;
+      return false;
+    }
+    text = this->_text;
+    source = CONFIG_SOURCE_SD;
+  }
+
+  // 現在の設定の複製に適用して検証する (失敗したら何も変えない)
+  Config cfg = this->_config;
+  if (!_parse(cfg, text, len)) {
+    this->_error = ERR_CONFIG_INVALID;
+    return false;
+  }
+
+  // SD カードの設定ファイルから読んだのでなければ書き戻す
+  if (source != CONFIG_SOURCE_SD && !this->_writeSd(cfg)) {
+    this->_error = ERR_CONFIG_SAVE_FAILED;
+    return false;
+  }
+
+  if (!this->_saveNvs(cfg)) {
+    this->_error = ERR_CONFIG_SAVE_FAILED;
+    return false;
+  }
+
+  this->_commit(cfg);
+  this->_source = source;
+  return true;
+}
+
+// 検証済みの設定を反映する
+// - 文字列のバッファのアドレスを変えないように、構造体ごと上書きする
+void ConfigStore::_commit(const Config& cfg) {
+  uint8_t changed = 0;
+  if (memcmp(cfg.mac, this->_config.mac, sizeof(cfg.mac)) != 0) {
+    changed |= CONFIG_CHANGED_ADDRESS;
+  }
+  if (strcmp(cfg.ssid, this->_config.ssid) != 0 || strcmp(cfg.pass, this->_config.pass) != 0) {
+    changed |= CONFIG_CHANGED_WIFI;
+  }
+  if (cfg.timerTime != this->_config.timerTime || cfg.timerInterval != this->_config.timerInterval) {
+    changed |= CONFIG_CHANGED_TIMER;
+  }
+  if (cfg.ntpTime != this->_config.ntpTime) {
+    changed |= CONFIG_CHANGED_NTP;
+  }
+  if (cfg.sleepTime != this->_config.sleepTime) {
+    changed |= CONFIG_CHANGED_SLEEP;
+  }
+  if (strcmp(cfg.token, this->_config.token) != 0) {
+    changed |= CONFIG_CHANGED_TOKEN;
+  }
+
+  this->_config = cfg;
+  _format(this->_config);
+  this->_changed = changed;
+}
+
+// 設定テキスト ("key=value" の行の並び) を cfg に適用する
+// - 空行と "#" で始まる行は無視する
+// - 1 つでも不正な行があれば false を返す (cfg は途中まで書き換わる)
+bool ConfigStore::_parse(Config& cfg, const char* text, size_t len) {
+  char line[96];
+  size_t pos = 0;
+
+  while (pos < len) {
+    // 1 行を取り出す
+    size_t n = 0;
+    while (pos < len && text[pos] != '\n') {
+      if (n >= sizeof(line) - 1) {
+        return false;
+      }
+      line[n++] = text[pos++];
+    }
+    pos++;
+
+    // 行末の CR を取り除く
+    if (n > 0 && line[n - 1] == '\r') {
+      n--;
+    }
+    line[n] = '\0';
+
+    if (n == 0 || line[0] == '#') {
+      continue;
+    }
+
+    char* eq = strchr(line, '=');
+    if (eq == nullptr) {
+      return false;
+    }
+    *eq = '\0';
+
+    if (!_set(cfg, line, eq + 1)) {
+      return false;
+    }
+  }
+
+  return _validate(cfg);
+}
+
+// 1 つの設定値を cfg に適用する
+bool ConfigStore::_set(Config& cfg, const char* key, const char* value) {
+  if (strcmp(key, "mac") == 0) {
+    return parseMac(value, cfg.mac);
+
+  } else if (strcmp(key, "ssid") == 0) {
+    size_t len = strlen(value);
+    if (len == 0 || len >= sizeof(cfg.ssid)) {
+      return false;
+    }
+    memcpy(cfg.ssid, value, len + 1);
+    return true;
+
+  } else if (strcmp(key, "pass") == 0) {
+    size_t len = strlen(value);
+    if (len >= sizeof(cfg.pass)) {
+      return false;
+    }
+    memcpy(cfg.pass, value, len + 1);
+    return true;
+
+  } else if (strcmp(key, "token") == 0) {
+    // 空文字列なら HTTP API で設定の変更と更新を受け付けない
+    size_t len = strlen(value);
+    if (len >= sizeof(cfg.token)) {
+      return false;
+    }
+    memcpy(cfg.token, value, len + 1);
+    return true;
+
+  } else if (strcmp(key, "timer") == 0 || strcmp(key, "ntp") == 0) {
+    // 空文字列なら無効
+    uint32_t sec = DailySchedule::SECONDS_PER_DAY;
+    if (value[0] != '\0' && !DailySchedule::parseTime(value, sec)) {
+      return false;
+    }
+    if (key[0] == 't') {
+      cfg.timerTime = sec;
+    } else {
+      cfg.ntpTime = sec;
+    }
+    return true;
+
+  } else if (strcmp(key, "interval") == 0 || strcmp(key, "sleep") == 0) {
+    if (value[0] < '0' || value[0] > '9') {
+      return false;
+    }
+    // 範囲外の値は上限に丸めずに不正とする
+    char* end;
+    errno = 0;
+    unsigned long v = strtoul(value, &end, 10);
+    if (*end != '\0' || errno == ERANGE || v > UINT32_MAX) {
+      return false;
+    }
+    if (key[0] == 'i') {
+      if (v > 0xffff) {
+        return false;
+      }
+      cfg.timerInterval = v;
+    } else {
+      cfg.sleepTime = v;
+    }
+    return true;
+  }
+
+  // 未知のキー
+  return false;
+}
+
+// 表示用の文字列を生成する
+void ConfigStore::_format(Config& cfg) {
+  snprintf(cfg.address, sizeof(cfg.address), "%02x:%02x:%02x:%02x:%02x:%02x",
+           cfg.mac[0], cfg.mac[1], cfg.mac[2], cfg.mac[3], cfg.mac[4], cfg.mac[5]);
+
+  cfg.timerStr[0] = '\0';
+  if (cfg.timerTime < DailySchedule::SECONDS_PER_DAY) {
+    snprintf(cfg.timerStr, sizeof(cfg.timerStr), "%02u:%02u:%02u",
+             (unsigned)(cfg.timerTime / 3600), (unsigned)(cfg.timerTime / 60 % 60), (unsigned)(cfg.timerTime % 60));
+  }
+
+  cfg.ntpStr[0] = '\0';
+  if (cfg.ntpTime < DailySchedule::SECONDS_PER_DAY) {
+    snprintf(cfg.ntpStr, sizeof(cfg.ntpStr), "%02u:%02u:%02u",
+             (unsigned)(cfg.ntpTime / 3600), (unsigned)(cfg.ntpTime / 60 % 60), (unsigned)(cfg.ntpTime % 60));
+  }
+}
+
+// 設定の内容が妥当かどうか
+bool ConfigStore::_validate(const Config& cfg) {
+  // 文字列が終端されていること
+  if (memchr(cfg.ssid, '\0', sizeof(cfg.ssid)) == nullptr || cfg.ssid[0] == '\0') {
+    return false;
+  }
+  if (memchr(cfg.pass, '\0', sizeof(cfg.pass)) == nullptr) {
+    return false;
+  }
+  if (memchr(cfg.token, '\0', sizeof(cfg.token)) == nullptr) {
+    return false;
+  }
+
+  // 時刻は 0 時からの秒数、または無効を表す値
+  if (cfg.timerTime > DailySchedule::SECONDS_PER_DAY || cfg.ntpTime > DailySchedule::SECONDS_PER_DAY) {
+    return false;
+  }
+
+  return true;
+}
+
+// SD カードの設定ファイルを読み込む
+bool ConfigStore::_readSd(size_t& len) {
+  len = 0;
+  this->_text[0] = '\0';
+  File file = SD.open(this->_SD_PATH, FILE_READ);
+  if (!file) {
+    return true;
+  }
+
+  // バッファに収まらないファイルは不正とみなす (一部だけを使うことはしない)
+  if (file.size() > CONFIG_TEXT_MAX) {
+    file.close();
+    return false;
+  }
+
+  len = file.read((uint8_t*)this->_text, CONFIG_TEXT_MAX);
+  this->_text[len] = '\0';
+  file.close();
+  return true;
+}
+
+// SD カードの設定ファイルに書き戻す
+// - 一時ファイルに書き終えてから置き換える (書き込み中に電源が切れても元のファイルが残る)
+// - 設定ファイルのコメントは残らない
+bool ConfigStore::_writeSd(const Config& cfg) {
+  if (!SD.exists(this->_SD_PATH)) {
+    return true;
+  }
+
+  Config c = cfg;
+  _format(c);
+  int len = snprintf(this->_text, sizeof(this->_text),
+                     "# HTTP API または USB シリアルで変更された設定を書き戻したもの\n"
+                     "mac=%s\nssid=%s\npass=%s\ntimer=%s\ninterval=%u\nntp=%s\nsleep=%u\ntoken=%s\n",
+                     c.address, c.ssid, c.pass, c.timerStr, (unsigned)c.timerInterval, c.ntpStr,
+                     (unsigned)c.sleepTime, c.token);
+  if (len < 0 || (size_t)len > CONFIG_TEXT_MAX) {
+    return false;
+  }
+
+  File file = SD.open(this->_SD_TMP_PATH, FILE_WRITE);
+  if (!file) {
+    return false;
+  }
+  bool ok = (file.write((const uint8_t*)this->_text, len) == (size_t)len);
+  file.close();
+
+  if (!ok) {
+    SD.remove(this->_SD_TMP_PATH);
+    return false;
+  }
+  return SD.remove(this->_SD_PATH) && SD.rename(this->_SD_TMP_PATH, this->_SD_PATH);
+}
+
+// NVS から読み込む
+bool ConfigStore::_loadNvs(Config& cfg) {
+  Preferences prefs;
+  if (!prefs.begin(this->_NVS_NAMESPACE, true)) {
+    return false;
+  }
+
+  ConfigBlob blob;
+  bool ok = (prefs.getBytesLength(this->_NVS_KEY) == sizeof(blob)
+             && prefs.getBytes(this->_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob));
+  prefs.end();
+
+  // 形式が変わっていたり壊れていたりしたら使わない
+  if (!ok || blob.version != _NVS_VERSION || !_validate(blob.config)) {
+    return false;
+  }
+
+  cfg = blob.config;
+  return true;
+}
+
+// NVS に保存する
+// - 起動のたびに SD カードの設定ファイルから保存するので、同じ内容なら書き込まない
+//   (フラッシュの書き込み回数を減らす)
+bool ConfigStore::_saveNvs(const Config& cfg) {
+  Preferences prefs;
+  if (!prefs.begin(this->_NVS_NAMESPACE, false)) {
+    return false;
+  }
+
+  // 比較できるように、文字列の終端より後ろと表示用の文字列は 0 にする
+  // (cfg の文字列は検証済みで、バッファの中で終端されている)
+  ConfigBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = _NVS_VERSION;
+  memcpy(blob.config.mac, cfg.mac, sizeof(cfg.mac));
+  memcpy(blob.config.ssid, cfg.ssid, strlen(cfg.ssid));
+  memcpy(blob.config.pass, cfg.pass, strlen(cfg.pass));
+  memcpy(blob.config.token, cfg.token, strlen(cfg.token));
+  blob.config.timerTime = cfg.timerTime;
+  blob.config.timerInterval = cfg.timerInterval;
+  blob.config.ntpTime = cfg.ntpTime;
+  blob.config.sleepTime = cfg.sleepTime;
+
+  ConfigBlob stored;
+  if (prefs.getBytesLength(this->_NVS_KEY) == sizeof(stored)
+      && prefs.getBytes(this->_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored)
+      && memcmp(&stored, &blob, sizeof(blob)) == 0) {
+    prefs.end();
+    return true;
+  }
+
+  bool ok = (prefs.putBytes(this->_NVS_KEY, &blob, sizeof(blob)) == sizeof(blob));
+  prefs.end();
+  return ok;
+}
+
+// ---------------------------------------------------------------
+// "xx:xx:xx:xx:xx:xx" を 6 バイトに変換
+// ---------------------------------------------------------------
+bool ConfigStore::parseMac(const char* str, uint8_t mac[6]) {
+  if (strlen(str) != BLE_ADDR_STR_LEN - 1) {
+    return false;
+  }
+
+  uint8_t v[6];
+  for (uint8_t i = 0; i < 6; i++) {
+    if (i < 5 && str[i * 3 + 2] != ':') {
+      return false;
+    }
+    uint8_t b = 0;
+    for (uint8_t j = 0; j < 2; j++) {
+      char c = str[i * 3 + j];
+      b <<= 4;
+      if (c >= '0' && c <= '9') {
+        b |= c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        b |= c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        b |= c - 'A' + 10;
+      } else {
+        return false;
+      }
+    }
+    v[i] = b;
+  }
+
+  memcpy(mac, v, sizeof(v));
+  return true;
+}
@@ -0,0 +1,158 @@
+/* ----------------------------------------------------------------
+  ConfigStore.h
+  - ユーザー設定を SD カードまたは NVS から読み込み、検証して保持する
+  - 実行中の設定の差し替え (ホットリロード) は検証に成功した場合のみ
+    まとめて反映する (一部の項目だけが変わることはない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef ConfigStore_h
+#define ConfigStore_h
+#include <Arduino.h>
+#include "ErrorCode.h"
+#include "BleTransport.h"
+#include "TimeManager.h"
+
+// Wi-Fi の SSID とパスワードのバッファサイズ (終端文字を含む)
+const size_t CONFIG_SSID_LEN = 33;
+const size_t CONFIG_PASS_LEN = 65;
+
+// HTTP API のトークンのバッファサイズ (終端文字を含む)
+const size_t CONFIG_TOKEN_LEN = 65;
+
+// 設定テキストの最大長 (バイト)
+const size_t CONFIG_TEXT_MAX = 512;
+
+// 設定が変わった項目 (ConfigStore::getChanged() のビット)
+const uint8_t CONFIG_CHANGED_ADDRESS = 0x01;  // BLE MAC アドレス
+const uint8_t CONFIG_CHANGED_WIFI = 0x02;     // Wi-Fi の SSID とパスワード
+const uint8_t CONFIG_CHANGED_TIMER = 0x04;    // OFF/ON タイマーの時刻と待ち時間
+const uint8_t CONFIG_CHANGED_NTP = 0x08;      // NTP 時刻同期の時刻
+const uint8_t CONFIG_CHANGED_SLEEP = 0x10;    // LCD がスリープするまでの時間
+const uint8_t CONFIG_CHANGED_TOKEN = 0x20;    // HTTP API のトークン
+
+// 設定の読み込み元
+enum ConfigSource : uint8_t {
+  CONFIG_SOURCE_DEFAULT = 0,  // スケッチに書かれた初期値
+  CONFIG_SOURCE_SD,           // SD カードの設定ファイル
+  CONFIG_SOURCE_NVS,          // NVS に保存された設定
+};
+
+// 設定の構造体
+// - 文字列の設定値は読み込み時に整数に変換しておく
+// - 表示用の文字列は整数から生成したもの
+struct Config {
+  uint8_t mac[6];                   // BLE MAC アドレス
+  char ssid[CONFIG_SSID_LEN];       // Wi-Fi の SSID
+  char pass[CONFIG_PASS_LEN];       // Wi-Fi のパスワード
+  uint32_t timerTime;               // OFF/ON タイマーの時刻 (0 時からの秒数, 86400 なら無効)
+  uint16_t timerInterval;           // OFF から ON までの待ち時間 (ミリ秒)
+  uint32_t ntpTime;                 // NTP 時刻同期の時刻 (0 時からの秒数, 86400 なら無効)
+  uint32_t sleepTime;               // LCD がスリープするまでの時間 (ミリ秒, 0 なら無効)
+  char token[CONFIG_TOKEN_LEN];     // HTTP API で設定の変更と更新に必要なトークン (空なら受け付けない)
+
+  // 表示用の文字列
+  char address[BLE_ADDR_STR_LEN];   // "xx:xx:xx:xx:xx:xx"
+  char timerStr[TIME_STR_LEN];      // "hh:mm:ss" (無効なら空文字列)
+  char ntpStr[TIME_STR_LEN];        // "hh:mm:ss" (無効なら空文字列)
+};
+
+// ---------------------------------------------------------------
+// ConfigStore クラス
+// ---------------------------------------------------------------
+class ConfigStore {
+private:
+  // SD カードの設定ファイルのパスと、書き戻すときの一時ファイルのパス
+  const char* _SD_PATH = "/switchbot-plug-timer.cfg";
+  const char* _SD_TMP_PATH = "/switchbot-plug-timer.tmp";
+
+  // NVS の名前空間とキー
+  const char* _NVS_NAMESPACE = "plugtimer";
+  const char* _NVS_KEY = "config";
+
+  // NVS に保存する設定の形式のバージョン (Config の構造を変えたら上げる)
+  static const uint8_t _NVS_VERSION = 2;
+
+  // 現在の設定
+  Config _config;
+
+  // 読み込み元
+  ConfigSource _source = CONFIG_SOURCE_DEFAULT;
+
+  // 直近の反映で変わった項目
+  uint8_t _changed = 0;
+
+  ErrorCode _error = ERR_NONE;
+
+  // 設定ファイルの読み込み用のバッファ
+  char _text[CONFIG_TEXT_MAX + 1];
+
+private:
+  // 設定テキスト ("key=value" の行の並び) を cfg に適用する
+  static bool _parse(Config& cfg, const char* text, size_t len);
+
+  // 1 つの設定値を cfg に適用する
+  static bool _set(Config& cfg, const char* key, const char* value);
+
+  // 表示用の文字列を生成する
+  static void _format(Config& cfg);
+
+  // 設定の内容が妥当かどうか (NVS から読んだ値の検証用)
+  static bool _validate(const Config& cfg);
+
+  // 検証済みの設定を反映する
+  void _commit(const Config& cfg);
+
+  // SD カードの設定ファイルを読み込む
+  // - ファイルがなければ len を 0 にして true を返す
+  // - バッファに収まらないなど読み込めなければ false を返す
+  bool _readSd(size_t& len);
+
+  // SD カードの設定ファイルに書き戻す (ファイルがなければ何もしない)
+  bool _writeSd(const Config& cfg);
+
+  // NVS から読み込む
+  bool _loadNvs(Config& cfg);
+
+  // NVS に保存する (保存されている内容と同じなら書き込まない)
+  bool _saveNvs(const Config& cfg);
+
+public:
+  // コンストラクタ (スケッチに書かれた初期値)
+  ConfigStore(const char* address, const char* ssid, const char* pass,
+              const char* timerTime, uint16_t timerInterval, const char* ntpTime, uint32_t sleepTime);
+
+  // エラーコードを取得
+  ErrorCode getError();
+
+  // 起動時の読み込み (SD カード -> NVS -> 初期値 の順)
+  // - SD カードの設定ファイルが妥当なら NVS にも保存する
+  // - 設定ファイルが不正 (大きすぎる場合を含む) なら ERR_CONFIG_INVALID にして NVS の設定を使う
+  bool load();
+
+  // 設定テキストを検証して反映する
+  // - 指定されていない項目は現在の値のまま
+  // - text が空なら SD カードの設定ファイルを読み直す
+  // - SD カードに設定ファイルがあれば反映した設定を書き戻す
+  //   (起動時は SD カードの設定ファイルが優先されるので、書き戻さないと元に戻る)
+  bool apply(const char* text, size_t len);
+
+  // 現在の設定を取得
+  // - 文字列のバッファのアドレスは変わらないので、ポインタを保持してよい
+  const Config& get() const;
+
+  // 読み込み元を取得
+  ConfigSource getSource() const;
+
+  // 直近の反映で変わった項目 (CONFIG_CHANGED_* のビット和)
+  uint8_t getChanged() const;
+
+  // "xx:xx:xx:xx:xx:xx" を 6 バイトに変換 (不正なら false)
+  static bool parseMac(const char* str, uint8_t mac[6]);
+};
+
+#endif
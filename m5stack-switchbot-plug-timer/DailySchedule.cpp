@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------
+  DailySchedule.cpp
+  - 1 日 1 回、指定時刻に実施する処理の実施判定を行う
+  - 日付と時刻は呼び出し側から渡す (RTC などのハードウェアに依存しない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "DailySchedule.h"
+
+// ===============================================================
+// DailySchedule クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// 実施する時刻をセット ("hh:mm:ss")
+// ---------------------------------------------------------------
+bool DailySchedule::setTime(const char* hhmmss) {
+  uint32_t sec;
+  if (hhmmss == nullptr || hhmmss[0] == '\0' || !parseTime(hhmmss, sec)) {
+    this->_time = SECONDS_PER_DAY;
+    return (hhmmss != nullptr && hhmmss[0] == '\0');
+  }
+  this->_time = sec;
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 実施する時刻をセット (0 時からの秒数)
+// ---------------------------------------------------------------
+void DailySchedule::setTime(uint32_t secOfDay) {
+  this->_time = (secOfDay < SECONDS_PER_DAY) ? secOfDay : SECONDS_PER_DAY;
+}
+
+// ---------------------------------------------------------------
+// 有効かどうか
+// ---------------------------------------------------------------
+bool DailySchedule::isEnabled() const {
+  return this->_time < SECONDS_PER_DAY;
+}
+
+// ---------------------------------------------------------------
+// 実施すべきかどうか
+// ---------------------------------------------------------------
+bool DailySchedule::isDue(uint32_t date, uint32_t secOfDay) const {
+  if (!this->isEnabled() || date == this->_lastDate) {
+    return false;
+  }
+
+  // 指定時刻から猶予の間だけ実施する
+  // - 猶予が日付をまたぐ場合 (23:59:30 など) は 23:59:59 までとする
+  return secOfDay >= this->_time && secOfDay < this->_time + this->_GRACE;
+}
+
+// ---------------------------------------------------------------
+// 実施したことを記録する
+// ---------------------------------------------------------------
+void DailySchedule::markDone(uint32_t date) {
+  this->_lastDate = date;
+}
+
+// ---------------------------------------------------------------
+// "hh:mm:ss" を 0 時からの秒数に変換
+// ---------------------------------------------------------------
+bool DailySchedule::parseTime(const char* hhmmss, uint32_t& secOfDay) {
+  if (strlen(hhmmss) != 8 || hhmmss[2] != ':' || hhmmss[5] != ':') {
+    return false;
+  }
+
+  uint8_t v[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    char c1 = hhmmss[i * 3];
+    char c2 = hhmmss[i * 3 + 1];
+    if (c1 < '0' || c1 > '9' || c2 < '0' || c2 > '9') {
+      return false;
+    }
+    v[i] = (c1 - '0') * 10 + (c2 - '0');
+  }
+
+  if (v[0] > 23 || v[1] > 59 || v[2] > 59) {
+    return false;
+  }
+
+  secOfDay = (uint32_t)v[0] * 3600 + (uint32_t)v[1] * 60 + v[2];
+  return true;
+}
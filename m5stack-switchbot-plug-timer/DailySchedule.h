@@ -0,0 +1,58 @@
+/* ----------------------------------------------------------------
+  DailySchedule.h
+  - 1 日 1 回、指定時刻に実施する処理の実施判定を行う
+  - 日付と時刻は呼び出し側から渡す (RTC などのハードウェアに依存しない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef DailySchedule_h
+#define DailySchedule_h
+#include <Arduino.h>
+
+// ---------------------------------------------------------------
+// DailySchedule クラス
+// ---------------------------------------------------------------
+class DailySchedule {
+public:
+  // 1 日の秒数
+  static const uint32_t SECONDS_PER_DAY = 86400;
+
+private:
+  // 指定時刻を過ぎてから実施できる猶予 (秒)
+  // - BLE 通信や NTP 時刻同期で loop() がブロックして指定時刻ちょうどの
+  //   1 秒を逃しても、この猶予の間なら実施する
+  const uint32_t _GRACE = 60;
+
+  // 実施する時刻 (0 時からの秒数, SECONDS_PER_DAY なら無効)
+  uint32_t _time = SECONDS_PER_DAY;
+
+  // 最後に実施した日付 (YYYYMMDD, 未実施なら 0)
+  uint32_t _lastDate = 0;
+
+public:
+  // 実施する時刻をセット ("hh:mm:ss", 空文字列なら無効)
+  // - 書式が不正なら false を返して無効にする
+  bool setTime(const char* hhmmss);
+
+  // 実施する時刻をセット (0 時からの秒数, SECONDS_PER_DAY 以上なら無効)
+  void setTime(uint32_t secOfDay);
+
+  // 有効かどうか
+  bool isEnabled() const;
+
+  // 実施すべきかどうか
+  // - date は YYYYMMDD 形式の整数, secOfDay は 0 時からの秒数
+  bool isDue(uint32_t date, uint32_t secOfDay) const;
+
+  // 実施したことを記録する
+  void markDone(uint32_t date);
+
+  // "hh:mm:ss" を 0 時からの秒数に変換 (不正なら false)
+  static bool parseTime(const char* hhmmss, uint32_t& secOfDay);
+};
+
+#endif
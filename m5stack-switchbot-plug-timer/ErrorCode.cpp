@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------
+  ErrorCode.cpp
+  - エラーコードを定義する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "ErrorCode.h"
+
+// ---------------------------------------------------------------
+// エラーコードに対応する文字列を取得
+// ---------------------------------------------------------------
+const char* errorCodeToString(ErrorCode code) {
+  switch (code) {
+    case ERR_NONE: return "";
+    case ERR_DEVICE_NOT_FOUND: return "DEVICE_NOT_FOUND";
+    case ERR_CONNECT_FAILED: return "CONNECT_FAILED";
+    case ERR_SERVICE_NOT_FOUND: return "SERVICE_NOT_FOUND";
+    case ERR_CHAR_RX_NOT_FOUND: return "CHAR_RX_NOT_FOUND";
+    case ERR_CHAR_TX_NOT_FOUND: return "CHAR_TX_NOT_FOUND";
+    case ERR_CHAR_TX_NOT_SUPPORT_NOTIFY: return "CHAR_TX_NOT_SUPPORT_NOTIFY";
+    case ERR_INVALID_RESPONSE: return "INVALID_RESPONSE";
+    case ERR_OPERATION_FAILED: return "OPERATION_FAILED";
+    case ERR_WIFI_TIMEOUT: return "WIFI_TIMEOUT";
+    case ERR_NTP_TIMEOUT: return "NTP_TIMEOUT";
+    case ERR_CONFIG_NOT_FOUND: return "CONFIG_NOT_FOUND";
+    case ERR_CONFIG_INVALID: return "CONFIG_INVALID";
+    case ERR_CONFIG_SAVE_FAILED: return "CONFIG_SAVE_FAILED";
+    case ERR_OTA_DOWNLOAD_FAILED: return "OTA_DOWNLOAD_FAILED";
+    case ERR_OTA_BAD_FORMAT: return "OTA_BAD_FORMAT";
+    case ERR_OTA_SOURCE_MISMATCH: return "OTA_SOURCE_MISMATCH";
+    case ERR_OTA_HASH_MISMATCH: return "OTA_HASH_MISMATCH";
+    case ERR_OTA_WRITE_FAILED: return "OTA_WRITE_FAILED";
+    case ERR_RESPONSE_TIMEOUT: return "RESPONSE_TIMEOUT";
+    case ERR_TIMER_REJECTED: return "TIMER_REJECTED";
+    case ERR_TIMER_NOT_EXECUTED: return "TIMER_NOT_EXECUTED";
+    case ERR_OTA_HASH_REQUIRED: return "OTA_HASH_REQUIRED";
+    case ERR_OTA_TRANSFER_ENCODING: return "OTA_TRANSFER_ENCODING";
+    case ERR_TIMER_NOT_CLEARED: return "TIMER_NOT_CLEARED";
+    case ERR_TIMER_MISMATCH: return "TIMER_MISMATCH";
+    case ERR_OTA_VERIFY_FAILED: return "OTA_VERIFY_FAILED";
+  }
+  return "UNKNOWN_ERROR";
+}
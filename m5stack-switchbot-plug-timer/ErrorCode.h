@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------
+  ErrorCode.h
+  - エラーコードを定義する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef ErrorCode_h
+#define ErrorCode_h
+#include <Arduino.h>
+
+// ---------------------------------------------------------------
+// エラーコード
+// - 値は USB シリアル制御のステータス (SERIAL_STATUS_*) やログの記録としてそのまま使うので、
+//   既存の値は変えずに、新しいコードは末尾に追加する
+// ---------------------------------------------------------------
+enum ErrorCode : uint8_t {
+  ERR_NONE = 0,
+
+  // SwitchBotPlugMini (接続と電源のコマンド)
+  ERR_DEVICE_NOT_FOUND,
+  ERR_CONNECT_FAILED,
+  ERR_SERVICE_NOT_FOUND,
+  ERR_CHAR_RX_NOT_FOUND,
+  ERR_CHAR_TX_NOT_FOUND,
+  ERR_CHAR_TX_NOT_SUPPORT_NOTIFY,
+  ERR_INVALID_RESPONSE,
+  ERR_OPERATION_FAILED,
+
+  // TimeManager
+  ERR_WIFI_TIMEOUT,
+  ERR_NTP_TIMEOUT,
+
+  // ConfigStore
+  ERR_CONFIG_NOT_FOUND,
+  ERR_CONFIG_INVALID,
+  ERR_CONFIG_SAVE_FAILED,
+
+  // OtaUpdater (ダウンロードと書き込み)
+  ERR_OTA_DOWNLOAD_FAILED,
+  ERR_OTA_BAD_FORMAT,
+  ERR_OTA_SOURCE_MISMATCH,
+  ERR_OTA_HASH_MISMATCH,
+  ERR_OTA_WRITE_FAILED,
+
+  // SwitchBotPlugMini (応答の待ち時間とタイマーのコマンド)
+  ERR_RESPONSE_TIMEOUT,
+  ERR_TIMER_REJECTED,
+
+  // TimerOffload (実施の確認)
+  ERR_TIMER_NOT_EXECUTED,
+
+  // OtaUpdater (イメージのハッシュと転送の形式)
+  ERR_OTA_HASH_REQUIRED,
+  ERR_OTA_TRANSFER_ENCODING,
+
+  // TimerOffload (タイマーの消去と書き込みの確認)
+  ERR_TIMER_NOT_CLEARED,
+  ERR_TIMER_MISMATCH,
+
+  // OtaUpdater (更新後の起動時の動作確認)
+  ERR_OTA_VERIFY_FAILED,
+};
+
+// エラーコードに対応する文字列を取得
+// - 戻り値は静的な文字列なので解放や複製は不要
+const char* errorCodeToString(ErrorCode code);
+
+#endif
@@ -0,0 +1,383 @@
+/* ----------------------------------------------------------------
+  FakeBleTransport.cpp
+  - BLE を使わずに SwitchBot Plug Mini を模擬する BleTransport の実装
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "FakeBleTransport.h"
+
+#ifdef USE_FAKE_BLE
+#include <math.h>
+
+// プラグのアドバタイズの間隔 (ミリ秒)
+static const uint32_t _ADV_INTERVAL = 100;
+
+// MTU を交換する前の ATT の MTU (バイト)
+static const uint16_t _DEFAULT_MTU = 23;
+
+// 距離による減衰で、送受信が半分失われる RSSI (dBm) と、失われ方の傾き (dB)
+static const float _LOSS_MID_RSSI = -88.0f;
+static const float _LOSS_SLOPE_DB = 3.0f;
+
+// ---------------------------------------------------------------
+// ビルド時に選択された BleTransport の実装を生成する
+// ---------------------------------------------------------------
+BleTransport* createBleTransport() {
+  static FakeBleTransport transport;
+  return &transport;
+}
+
+// ===============================================================
+// FakeBleTransport クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+FakeBleTransport::FakeBleTransport() {
+  this->_config = defaultConfig();
+}
+
+// ---------------------------------------------------------------
+// 既定の条件を取得
+// ---------------------------------------------------------------
+FakePlugConfig FakeBleTransport::defaultConfig() {
+  FakePlugConfig config;
+  config.address = "00:00:00:00:00:00";
+  config.rssi = -55;
+  config.lossPercent = 0;
+  config.mtu = 247;
+  config.connectMs = 300;
+  config.failMs = 3000;
+  config.responseMs = 50;
+  config.timerSupported = true;
+  config.responsePadding = 0;
+  config.timerCapacity = FAKE_TIMER_SLOTS;
+  config.timerWriteIgnored = false;
+  config.dropFromWrite = 0;
+  config.dropWrites = 0;
+  config.distanceM = 0;
+  config.pathLossExp = 2.0f;
+  config.shadowDb = 4.0f;
+  return config;
+}
+
+// ---------------------------------------------------------------
+// 模擬する条件をセットする
+// ---------------------------------------------------------------
+void FakeBleTransport::configure(const FakePlugConfig& config, uint32_t seed) {
+  this->_config = config;
+  this->_state = {};
+  this->_connected = false;
+  this->_mtu = _DEFAULT_MTU;
+  this->_rand = (seed == 0) ? 1 : seed;
+  this->_rssi = config.rssi;
+  this->_clockMs = 0;
+  this->_ranUntil = 0;
+}
+
+// ---------------------------------------------------------------
+// 模擬しているプラグの状態を取得
+// ---------------------------------------------------------------
+FakePlugState& FakeBleTransport::getState() {
+  this->_runTimers();
+  return this->_state;
+}
+
+// ---------------------------------------------------------------
+// 模擬している条件を取得
+// ---------------------------------------------------------------
+FakePlugConfig& FakeBleTransport::getConfig() {
+  return this->_config;
+}
+
+// 前回から今までに時刻になったタイマーを実行する
+// - プラグの時刻は合わせた時計に millis() の経過を足したもの
+// - 複数のタイマーの時刻を過ぎていたら、最後の時刻のものの電源状態になる
+void FakeBleTransport::_runTimers() {
+  FakePlugState& s = this->_state;
+  if (s.clock == 0) {
+    return;
+  }
+  uint32_t now = s.clock + (millis() - this->_clockMs) / 1000;
+  uint32_t latest = this->_ranUntil;
+  for (uint8_t i = 0; i < s.timerCount && i < FAKE_TIMER_SLOTS; i++) {
+    uint32_t at = (uint32_t)s.timers[i].hour * 3600 + s.timers[i].minute * 60;
+    uint32_t last = now - (now % 86400 + 86400 - at) % 86400;
+    if (last > latest) {
+      latest = last;
+      s.power = s.timers[i].power;
+    }
+  }
+  this->_ranUntil = now;
+}
+
+// 次の乱数 (xorshift32)
+uint32_t FakeBleTransport::_next() {
+  this->_rand ^= this->_rand << 13;
+  this->_rand ^= this->_rand >> 17;
+  this->_rand ^= this->_rand << 5;
+  return this->_rand;
+}
+
+// 確率 percent (%) で true を返す
+bool FakeBleTransport::_chance(uint32_t percent) {
+  return (this->_next() % 100) < percent;
+}
+
+// 1 回の送受信の RSSI を求める
+// - 揺らぎは Box-Muller 法で作る正規分布
+int FakeBleTransport::_sampleRssi() {
+  const FakePlugConfig& c = this->_config;
+  if (c.distanceM <= 0) {
+    this->_rssi = c.rssi;
+    return this->_rssi;
+  }
+  float u1 = (this->_next() % 10000 + 1) / 10001.0f;
+  float u2 = (this->_next() % 10000) / 10000.0f;
+  float gauss = sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+  float rssi = c.rssi - 10.0f * c.pathLossExp * log10f(c.distanceM) + gauss * c.shadowDb;
+  this->_rssi = (rssi < -127) ? -127 : (int)lroundf(rssi);
+  return this->_rssi;
+}
+
+// RSSI が rssi の送受信が失われる確率 (%)
+// - 距離を指定しない場合は lossPercent
+// - 指定した場合は受信感度の付近で急に増える (ロジスティック曲線)
+uint32_t FakeBleTransport::_lossAt(int rssi) {
+  if (this->_config.distanceM <= 0) {
+    return this->_config.lossPercent;
+  }
+  float p = 100.0f / (1.0f + expf((rssi - _LOSS_MID_RSSI) / _LOSS_SLOPE_DB));
+  return (uint32_t)lroundf(p);
+}
+
+const char* FakeBleTransport::name() const {
+  return "Fake";
+}
+
+// ---------------------------------------------------------------
+// BLE スタックの初期化 (何もしない)
+// ---------------------------------------------------------------
+void FakeBleTransport::init() {
+}
+
+// ---------------------------------------------------------------
+// スキャンして見つかったデバイスごとに cb を呼ぶ
+// - スキャンの時間中のアドバタイズのうち、受信できたものがあれば見つかる
+// ---------------------------------------------------------------
+bool FakeBleTransport::scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) {
+  this->_state.scans++;
+  delay((uint32_t)params.durationSec * 1000);
+
+  // 受信している割合 (window / interval) と損失の確率から、1 回のアドバタイズを受信できる確率
+  uint32_t advs = (uint32_t)params.durationSec * 1000 / _ADV_INTERVAL;
+  bool found = false;
+  int rssi = 0;
+  for (uint32_t i = 0; i < advs && !found; i++) {
+    rssi = this->_sampleRssi();
+    uint32_t percent = (100 - this->_lossAt(rssi)) * params.windowMs / params.intervalMs;
+    found = this->_chance(percent);
+  }
+  if (!found) {
+    return false;
+  }
+
+  // SwitchBot プラグミニ（JP）のアドバタイズ (Company ID 0x0969, Service Data は 'j' から)
+  static const uint8_t mfr[14] = { 0x69, 0x09 };
+  static const uint8_t svc[3] = { 'j', 0x00, 0x00 };
+  BleAdvInfo info;
+  strncpy(info.address, this->_config.address, sizeof(info.address) - 1);
+  info.address[sizeof(info.address) - 1] = '\0';
+  info.addressType = 0;
+  info.mfrData = mfr;
+  info.mfrLen = sizeof(mfr);
+  info.svcData = svc;
+  info.svcLen = sizeof(svc);
+  info.rssi = rssi;
+  cb(info, ctx);
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 接続する
+// ---------------------------------------------------------------
+bool FakeBleTransport::connect(const char* address, uint8_t addressType) {
+  this->_state.connects++;
+  if (strcasecmp(address, this->_config.address) != 0 || this->_chance(this->_lossAt(this->_sampleRssi()))) {
+    delay(this->_config.failMs);
+    return false;
+  }
+  delay(this->_config.connectMs);
+  this->_connected = true;
+  this->_mtu = _DEFAULT_MTU;
+  return true;
+}
+
+// ---------------------------------------------------------------
+// Service と Characteristics を準備して NOTIFY を購読する
+// ---------------------------------------------------------------
+bool FakeBleTransport::subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                                 BleNotifyCallback cb, ErrorCode& err) {
+  if (!this->_connected) {
+    err = ERR_SERVICE_NOT_FOUND;
+    return false;
+  }
+  this->_notify = cb;
+  return true;
+}
+
+// ---------------------------------------------------------------
+// データ送信用の Characteristic に書き込む
+// - 応答は MTU に収まる長さで NOTIFY する (失われた場合は NOTIFY しない)
+// - 応答の長さは、BLE スタックが 1 回の NOTIFY で渡す最大の MTU - 3 バイトまで
+// ---------------------------------------------------------------
+bool FakeBleTransport::write(const uint8_t* data, size_t len) {
+  if (!this->_connected) {
+    return false;
+  }
+  this->_state.writes++;
+  this->_runTimers();
+
+  // 指定した範囲の書き込みは、プラグに届く前に失われる
+  const FakePlugConfig& c = this->_config;
+  if (c.dropFromWrite > 0 && this->_state.writes >= c.dropFromWrite
+      && this->_state.writes - c.dropFromWrite < c.dropWrites) {
+    return true;
+  }
+
+  static uint8_t res[512];
+  size_t rlen = this->_respond(data, len, res);
+  if (this->_chance(this->_lossAt(this->_sampleRssi()))) {
+    return true;
+  }
+  delay(this->_config.responseMs);
+  if (rlen > (size_t)(this->_mtu - 3)) {
+    rlen = this->_mtu - 3;
+  }
+  if (this->_notify != nullptr) {
+    this->_notify(res, rlen);
+  }
+  return true;
+}
+
+// リクエストに対するプラグのレスポンスを作る
+// - バイト列は SwitchBotPlugMini.cpp のコメントを参照
+size_t FakeBleTransport::_respond(const uint8_t* req, size_t len, uint8_t* res) {
+  FakePlugState& s = this->_state;
+  res[0] = 0x01;
+
+  if (len >= 4 && req[0] == 0x57 && req[1] == 0x0f && req[3] == 0x01) {
+    // 電源状態の取得・セット・反転
+    if (req[2] == 0x50 && len >= 6 && req[4] == 0x01) {
+      s.power = (req[5] == 0x80);
+    } else if (req[2] == 0x50 && len >= 6 && req[4] == 0x02) {
+      s.power = !s.power;
+    } else if (req[2] != 0x51) {
+      res[0] = 0x05;
+      return 1;
+    }
+    res[1] = s.power ? 0x80 : 0x00;
+    return 2;
+  }
+
+  if (!this->_config.timerSupported) {
+    res[0] = 0x05;
+    return 1;
+  }
+
+  if (len == 11 && req[0] == 0x57 && req[1] == 0x09 && req[2] == 0x01) {
+    // 時計合わせ (UNIX 時間 8 バイト BE)
+    uint64_t t = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+      t = (t << 8) | req[3 + i];
+    }
+    s.clock = (uint32_t)t;
+    this->_clockMs = millis();
+    this->_ranUntil = s.clock;
+    return 1;
+  }
+
+  uint8_t index = req[2] >> 4;
+  if (len >= 3 && (req[2] & 0x0f) == 0x03 && index < FAKE_TIMER_SLOTS) {
+    if (req[0] == 0x57 && req[1] == 0x08 && len == 3) {
+      // タイマーの読み出し
+      const PlugTimer& t = s.timers[index];
+      res[1] = s.timerCount;
+      if (s.timerCount == 0) {
+        return 2;
+      }
+      res[2] = 0x7f;
+      res[3] = t.hour;
+      res[4] = t.minute;
+      res[5] = 0x00;
+      res[6] = t.power ? 0x01 : 0x02;
+      memset(res + 7, 0, this->_config.responsePadding);
+      return 7 + this->_config.responsePadding;
+    }
+    if (req[0] == 0x57 && req[1] == 0x09 && len == 12) {
+      // タイマーの書き込み (件数 0 なら全件無効)
+      if (req[3] > this->_config.timerCapacity) {
+        res[0] = 0x05;
+        return 1;
+      }
+      if (this->_config.timerWriteIgnored) {
+        return 1;
+      }
+      s.timerCount = (req[3] > FAKE_TIMER_SLOTS) ? FAKE_TIMER_SLOTS : req[3];
+      s.timers[index] = { req[5], req[6], req[8] == 0x01 };
+      return 1;
+    }
+  }
+
+  res[0] = 0x05;
+  return 1;
+}
+
+// ---------------------------------------------------------------
+// 接続中の受信信号強度
+// ---------------------------------------------------------------
+int FakeBleTransport::getRssi() {
+  return this->_connected ? this->_rssi : 0;
+}
+
+// ---------------------------------------------------------------
+// 接続パラメータの更新を要求する
+// ---------------------------------------------------------------
+bool FakeBleTransport::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+  return this->_connected;
+}
+
+// ---------------------------------------------------------------
+// MTU の拡大を要求して、合意した MTU を返す
+// - 要求値とプラグの最大値の小さい方で合意する
+// ---------------------------------------------------------------
+uint16_t FakeBleTransport::requestMtu(uint16_t mtu) {
+  if (!this->_connected) {
+    return 0;
+  }
+  this->_state.requestedMtu = mtu;
+  this->_mtu = (mtu < this->_config.mtu) ? mtu : this->_config.mtu;
+  return this->_mtu;
+}
+
+// ---------------------------------------------------------------
+// 接続中かどうか
+// ---------------------------------------------------------------
+bool FakeBleTransport::isConnected() {
+  return this->_connected;
+}
+
+// ---------------------------------------------------------------
+// 切断する
+// ---------------------------------------------------------------
+void FakeBleTransport::disconnect() {
+  this->_connected = false;
+  this->_notify = nullptr;
+}
+
+#endif
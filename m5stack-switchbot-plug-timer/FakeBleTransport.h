@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------
+  FakeBleTransport.h
+  - BLE を使わずに SwitchBot Plug Mini を模擬する BleTransport の実装
+  - ホストでのテストで SwitchBotPlugMini と TimerOffload を動かすためのもの
+  - 接続・応答の時間は delay() で待つ (ホストの仮想時間ならすぐに終わる)
+  - 時計を合わせたプラグは、millis() で進む時計でタイマーを実行する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef FakeBleTransport_h
+#define FakeBleTransport_h
+#include "BleTransport.h"
+
+#ifdef USE_FAKE_BLE
+#include "SwitchBotPlugMini.h"
+
+// 模擬するプラグのタイマーの件数
+const uint8_t FAKE_TIMER_SLOTS = 4;
+
+// 模擬するプラグと電波の条件の構造体
+struct FakePlugConfig {
+  const char* address;   // BLE アドレス
+  int rssi;              // 受信信号強度 (dBm, distanceM を指定したら 1m での値)
+  uint8_t lossPercent;   // 接続・アドバタイズ・応答が失われる確率 (%)
+  uint16_t mtu;          // プラグが受け付ける最大の MTU (バイト)
+  uint32_t connectMs;    // 接続にかかる時間 (ミリ秒)
+  uint32_t failMs;       // 接続に失敗するまでの時間 (ミリ秒)
+  uint32_t responseMs;   // 書き込みから NOTIFY までの時間 (ミリ秒)
+  bool timerSupported;   // タイマーのコマンドを受け付けるかどうか
+  uint8_t responsePadding;  // タイマーの読み出しの応答の末尾に足すバイト数 (長い NOTIFY の模擬)
+  uint8_t timerCapacity;    // 登録できるタイマーの件数 (超える件数の書き込みは受け付けない)
+  bool timerWriteIgnored;   // タイマーの書き込みを受け付けるが反映しない (コマンドの解釈が違うプラグの模擬)
+  uint32_t dropFromWrite;   // この回数目の書き込みから応答を失う (1 から数える, 0 なら失わない)
+  uint32_t dropWrites;      // dropFromWrite から応答を失う書き込みの回数
+
+  // 距離による電波の減衰 (distanceM が 0 なら rssi と lossPercent をそのまま使う)
+  // - RSSI = rssi (1m) - 10 * pathLossExp * log10(distanceM) + 正規分布 (標準偏差 shadowDb)
+  // - 送受信ごとに RSSI を求め、その RSSI から失われる確率を決める
+  float distanceM;       // プラグまでの距離 (m)
+  float pathLossExp;     // 減衰の指数 (見通しで 2, 屋内で 2.5 - 4)
+  float shadowDb;        // RSSI の揺らぎの標準偏差 (dB)
+};
+
+// 模擬するプラグの状態の構造体 (テストから読み書きする)
+struct FakePlugState {
+  bool power;                          // 電源状態
+  uint32_t clock;                      // 合わせた時計 (現地時刻の UNIX 時間, 未設定なら 0)
+  uint8_t timerCount;                  // 登録されているタイマーの件数
+  PlugTimer timers[FAKE_TIMER_SLOTS];  // タイマー
+  uint32_t scans;                      // スキャンの回数
+  uint32_t connects;                   // 接続の試行回数
+  uint32_t writes;                     // 書き込みの回数
+  uint16_t requestedMtu;               // 直近に要求された MTU
+};
+
+// ---------------------------------------------------------------
+// FakeBleTransport クラス
+// ---------------------------------------------------------------
+class FakeBleTransport : public BleTransport {
+private:
+  FakePlugConfig _config;
+  FakePlugState _state = {};
+
+  bool _connected = false;
+  uint16_t _mtu = 23;
+  BleNotifyCallback _notify = nullptr;
+
+  // 乱数の状態 (xorshift32, 同じ seed なら同じ結果になる)
+  uint32_t _rand = 1;
+
+  // 直近の送受信の RSSI (dBm)
+  int _rssi = 0;
+
+  // 時計を合わせたときの millis() と、タイマーを実行し終えたプラグの時刻
+  uint32_t _clockMs = 0;
+  uint32_t _ranUntil = 0;
+
+private:
+  // 次の乱数
+  uint32_t _next();
+
+  // 確率 percent (%) で true を返す
+  bool _chance(uint32_t percent);
+
+  // 1 回の送受信の RSSI を求める
+  int _sampleRssi();
+
+  // RSSI が rssi の送受信が失われる確率 (%)
+  uint32_t _lossAt(int rssi);
+
+  // 前回から今までに時刻になったタイマーを実行する (最後のものだけが残る)
+  void _runTimers();
+
+  // リクエストに対するプラグのレスポンスを作る (戻り値は長さ)
+  size_t _respond(const uint8_t* req, size_t len, uint8_t* res);
+
+public:
+  // コンストラクタ (既定の条件は電波が強く、失敗しない)
+  FakeBleTransport();
+
+  // 模擬する条件をセットする (状態は初期化する)
+  void configure(const FakePlugConfig& config, uint32_t seed = 1);
+
+  // 既定の条件を取得
+  static FakePlugConfig defaultConfig();
+
+  // 模擬しているプラグの状態を取得 (時刻になったタイマーは実行しておく)
+  FakePlugState& getState();
+
+  // 模擬している条件を取得 (テストから書き換えると、状態はそのままで条件を変えられる)
+  FakePlugConfig& getConfig();
+
+  const char* name() const override;
+  void init() override;
+  bool scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) override;
+  bool connect(const char* address, uint8_t addressType) override;
+  bool subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                 BleNotifyCallback cb, ErrorCode& err) override;
+  bool write(const uint8_t* data, size_t len) override;
+  int getRssi() override;
+  bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) override;
+  uint16_t requestMtu(uint16_t mtu) override;
+  bool isConnected() override;
+  void disconnect() override;
+};
+
+#endif
+#endif
@@ -0,0 +1,53 @@
+/* ----------------------------------------------------------------
+  HeapMonitor.cpp
+  - ヒープの空き容量と断片化の状況を監視する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "HeapMonitor.h"
+
+// ===============================================================
+// HeapMonitor クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// 統計情報を更新する
+// ---------------------------------------------------------------
+bool HeapMonitor::sample() {
+  uint32_t now = millis();
+  if (this->_lastSample != 0 && now - this->_lastSample < this->_SAMPLE_INTERVAL) {
+    return false;
+  }
+  this->_lastSample = now;
+
+  uint32_t freeSize = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+
+  this->_stats.freeSize = freeSize;
+  this->_stats.minFreeSize = ESP.getMinFreeHeap();
+  this->_stats.largestBlock = largest;
+
+  if (this->_stats.minLargestBlock == 0 || largest < this->_stats.minLargestBlock) {
+    this->_stats.minLargestBlock = largest;
+  }
+
+  // 空き容量に対して確保可能な最大ブロックが小さいほど断片化している
+  if (freeSize > 0) {
+    this->_stats.fragmentation = 100 - (uint8_t)((uint64_t)largest * 100 / freeSize);
+  } else {
+    this->_stats.fragmentation = 0;
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 最新の統計情報を取得
+// ---------------------------------------------------------------
+const HeapStats& HeapMonitor::getStats() const {
+  return this->_stats;
+}
@@ -0,0 +1,48 @@
+/* ----------------------------------------------------------------
+  HeapMonitor.h
+  - ヒープの空き容量と断片化の状況を監視する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef HeapMonitor_h
+#define HeapMonitor_h
+#include <Arduino.h>
+
+// ヒープの統計情報の構造体
+struct HeapStats {
+  uint32_t freeSize;        // 現在の空き容量 (バイト)
+  uint32_t minFreeSize;     // 起動後の空き容量の最小値 (バイト)
+  uint32_t largestBlock;    // 現在確保可能な最大ブロック (バイト)
+  uint32_t minLargestBlock; // 起動後の最大ブロックの最小値 (バイト)
+  uint8_t fragmentation;    // 断片化率 (%)
+};
+
+// ---------------------------------------------------------------
+// HeapMonitor クラス
+// ---------------------------------------------------------------
+class HeapMonitor {
+private:
+  // サンプリング間隔 (ミリ秒)
+  const uint32_t _SAMPLE_INTERVAL = 1000;
+
+  // 最後にサンプリングした時刻 (ミリ秒)
+  uint32_t _lastSample = 0;
+
+  // 最新の統計情報
+  HeapStats _stats = {};
+
+public:
+  // 統計情報を更新する
+  // - 所定のサンプリング間隔が経過していなければ何もしない
+  // - 更新した場合は true を返す
+  bool sample();
+
+  // 最新の統計情報を取得
+  const HeapStats& getStats() const;
+};
+
+#endif
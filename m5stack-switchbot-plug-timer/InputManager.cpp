@@ -0,0 +1,113 @@
+/* ----------------------------------------------------------------
+  InputManager.cpp
+  - タッチボタンとタッチパネルの入力を専用タスクで取り込み、
+    タイムスタンプ付きのイベントキューとして提供する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "InputManager.h"
+
+InputManager* InputManager::_instance = nullptr;
+
+// ===============================================================
+// InputManager クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// 入力取り込みタスクを開始する
+// ---------------------------------------------------------------
+bool InputManager::begin() {
+  if (this->_task != nullptr) {
+    return true;
+  }
+
+  _instance = this;
+  this->_lastActivity = millis();
+
+  this->_queue = xQueueCreate(this->_QUEUE_LEN, sizeof(InputEvent));
+  if (this->_queue == nullptr) {
+    return false;
+  }
+
+  // タッチした瞬間 (wasPressed() 相当) のイベントのみを取り込む
+  M5.Buttons.addHandler(_onEvent, E_TOUCH);
+
+  // loop() と同じコアで、loop() より高い優先度で動かす
+  // - BLE や Wi-Fi の処理で loop() がブロックしていても入力を取りこぼさない
+  BaseType_t res = xTaskCreatePinnedToCore(_taskMain, "input", 4096, this, 2, &this->_task, 1);
+  return (res == pdPASS);
+}
+
+// 入力取り込みタスク
+void InputManager::_taskMain(void* arg) {
+  InputManager* self = (InputManager*)arg;
+  for (;;) {
+    // タッチパネルを読み取り、イベントがあれば _onEvent() が呼ばれる
+    M5.update();
+    vTaskDelay(pdMS_TO_TICKS(self->_POLL_INTERVAL));
+  }
+}
+
+// M5Core2 のボタンイベントのハンドラー (入力取り込みタスクから呼ばれる)
+void InputManager::_onEvent(Event& e) {
+  InputManager* self = _instance;
+  if (self == nullptr) {
+    return;
+  }
+
+  InputEvent ev;
+  ev.button = e.button;
+  ev.type = e.type;
+  ev.time = millis();
+
+  self->_lastActivity = ev.time;
+
+  if (xQueueSend(self->_queue, &ev, 0) != pdTRUE) {
+    self->_dropped++;
+  }
+}
+
+// ---------------------------------------------------------------
+// イベントをキューから取り出す
+// ---------------------------------------------------------------
+bool InputManager::receive(InputEvent& ev, uint32_t timeout) {
+  if (this->_queue == nullptr) {
+    delay(timeout);
+    return false;
+  }
+  return xQueueReceive(this->_queue, &ev, pdMS_TO_TICKS(timeout)) == pdTRUE;
+}
+
+// ---------------------------------------------------------------
+// イベントの処理を開始したことを記録する (遅延の計測)
+// ---------------------------------------------------------------
+void InputManager::markHandled(const InputEvent& ev) {
+  uint32_t latency = millis() - ev.time;
+
+  this->_stats.count++;
+  this->_stats.last = latency;
+  if (latency > this->_stats.max) {
+    this->_stats.max = latency;
+  }
+  this->_latencySum += latency;
+  this->_stats.avg = (uint32_t)(this->_latencySum / this->_stats.count);
+}
+
+// ---------------------------------------------------------------
+// 最後に入力があった時刻 (ミリ秒)
+// ---------------------------------------------------------------
+uint32_t InputManager::getLastActivity() const {
+  return this->_lastActivity;
+}
+
+// ---------------------------------------------------------------
+// 遅延の統計情報を取得
+// ---------------------------------------------------------------
+const InputStats& InputManager::getStats() {
+  this->_stats.dropped = this->_dropped;
+  return this->_stats;
+}
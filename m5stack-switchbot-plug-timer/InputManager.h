@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------
+  InputManager.h
+  - タッチボタンとタッチパネルの入力を専用タスクで取り込み、
+    タイムスタンプ付きのイベントキューとして提供する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef InputManager_h
+#define InputManager_h
+#include <Arduino.h>
+#include <M5Core2.h>
+
+// 入力イベントの構造体
+struct InputEvent {
+  Button* button;  // 操作されたボタン (画面上のどのボタンでもなければ &M5.background)
+  uint16_t type;   // イベントの種類 (E_TOUCH など)
+  uint32_t time;   // 取り込んだ時刻 (ミリ秒)
+};
+
+// 入力から処理までの遅延の統計情報の構造体
+struct InputStats {
+  uint32_t count;    // 処理したイベント数
+  uint32_t dropped;  // キューが一杯で捨てたイベント数
+  uint32_t last;     // 直近の遅延 (ミリ秒)
+  uint32_t max;      // 最大の遅延 (ミリ秒)
+  uint32_t avg;      // 平均の遅延 (ミリ秒)
+};
+
+// ---------------------------------------------------------------
+// InputManager クラス
+// ---------------------------------------------------------------
+class InputManager {
+private:
+  // 入力を取り込む間隔 (ミリ秒)
+  const uint32_t _POLL_INTERVAL = 10;
+
+  // キューに貯められるイベント数
+  const uint8_t _QUEUE_LEN = 16;
+
+  // イベントハンドラーから参照するインスタンス
+  static InputManager* _instance;
+
+  QueueHandle_t _queue = nullptr;
+  TaskHandle_t _task = nullptr;
+
+  // 最後に入力があった時刻 (ミリ秒)
+  volatile uint32_t _lastActivity = 0;
+
+  // 遅延の統計情報
+  volatile uint32_t _dropped = 0;
+  InputStats _stats = {};
+  uint64_t _latencySum = 0;
+
+private:
+  // 入力取り込みタスク
+  static void _taskMain(void* arg);
+
+  // M5Core2 のボタンイベントのハンドラー (入力取り込みタスクから呼ばれる)
+  static void _onEvent(Event& e);
+
+public:
+  // 入力取り込みタスクを開始する
+  bool begin();
+
+  // イベントをキューから取り出す
+  // - イベントがなければ最大 timeout ミリ秒待つ
+  bool receive(InputEvent& ev, uint32_t timeout);
+
+  // イベントの処理を開始したことを記録する (遅延の計測)
+  void markHandled(const InputEvent& ev);
+
+  // 最後に入力があった時刻 (ミリ秒)
+  uint32_t getLastActivity() const;
+
+  // 遅延の統計情報を取得
+  const InputStats& getStats();
+};
+
+#endif
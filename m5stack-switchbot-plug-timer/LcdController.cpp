@@ -17,7 +17,7 @@
 // ---------------------------------------------------------------
 // コンストラクタ
 // ---------------------------------------------------------------
-LcdController::LcdController(char* address, char* name, char* time) {
+LcdController::LcdController(const char* address, const char* name, const char* time) {
   this->_address = address;
   this->_name = name;
   this->_time = time;
@@ -29,7 +29,7 @@ LcdController::LcdController(char* address, char* name, char* time) {
 void LcdController::init() {
   M5.Lcd.begin();
   M5.Lcd.clear();
-  M5.Lcd.setBrightness(150);
+  M5.Lcd.setBrightness(this->_BRIGHTNESS);
   M5.Lcd.setTextWrap(false, false);
 
   // タイトルを表示
@@ -39,7 +39,7 @@ void LcdController::init() {
   this->showPowerStatus(false);
 
   // OFF/ON タイマー時刻を表示
-  if (String(this->_time) != String("")) {
+  if (this->_time[0] != '\0') {
     this->_showTimerTime();
   }
 
@@ -61,6 +61,27 @@ void LcdController::_showTitle() {
   M5.Lcd.printf(this->_address);
 }
 
+// ---------------------------------------------------------------
+// タイトルの BLE MAC アドレスを描き直す (設定の変更時)
+// - 表示名は変わらないので、アドレスの行だけを消して描き直す
+// ---------------------------------------------------------------
+void LcdController::updateTitle() {
+  M5.Lcd.fillRect(0, 28, M5.Lcd.width(), 16, BLACK);
+  this->_showTitle();
+}
+
+// ---------------------------------------------------------------
+// OFF/ON タイマー時刻を描き直す (設定の変更時)
+// - 電源状態の円に掛からない範囲だけを消す
+// ---------------------------------------------------------------
+void LcdController::updateTimerTime() {
+  M5.Lcd.fillRect(10, 126, 72, 36, BLACK);
+  M5.Lcd.fillRect(10, 166, 96, 16, BLACK);
+  if (this->_time[0] != '\0') {
+    this->_showTimerTime();
+  }
+}
+
 // テキストをセンタリングした際の x 座標の値を取得
 int16_t LcdController::_getXaxisForTextCentering(const char* text) {
   int16_t dwidth = M5.Lcd.width();
@@ -76,7 +97,7 @@ void LcdController::showPowerStatus(bool status) {
   int16_t w = M5.Lcd.width();
   int16_t h = M5.Lcd.height();
   uint32_t color = LIGHTGREY;
-  String text = "OFF";
+  const char* text = "OFF";
 
   if (status == true) {
     color = GREEN;
@@ -92,9 +113,9 @@ void LcdController::showPowerStatus(bool status) {
   M5.Lcd.setTextSize(3);
   M5.Lcd.setTextColor(DARKGREY, WHITE);
 
-  int16_t x = this->_getXaxisForTextCentering(text.c_str());
+  int16_t x = this->_getXaxisForTextCentering(text);
   M5.Lcd.setCursor(x, cy - 8);
-  M5.Lcd.printf(text.c_str());
+  M5.Lcd.print(text);
 }
 
 // ---------------------------------------------------------------
@@ -110,13 +131,19 @@ void LcdController::showButtonMenu(uint8_t mode) {
   if (mode == 0) {
     M5.Lcd.printf("                          ");
   } else if (mode == 1) {
-    M5.Lcd.printf("   LOG    ON/OFF          ");
+    M5.Lcd.printf("   LOG    ON/OFF   INFO   ");
   } else if (mode == 2) {
     M5.Lcd.printf(" CANCEL              OK   ");
   } else if (mode == 3) {
     M5.Lcd.printf("       PROCESSING...      ");
   } else if (mode == 4) {
-    M5.Lcd.printf("  BACK                    ");
+    M5.Lcd.printf("  BACK   FILTER   OLDER   ");
+  } else if (mode == 5) {
+    M5.Lcd.printf("  BACK            POWER   ");
+  } else if (mode == 6) {
+    M5.Lcd.printf("  BACK            LINK    ");
+  } else if (mode == 7) {
+    M5.Lcd.printf("  BACK            INFO    ");
   } else {
     M5.Lcd.printf("                          ");
   }
@@ -126,25 +153,25 @@ void LcdController::showButtonMenu(uint8_t mode) {
 // ---------------------------------------------------------------
 // メッセージ表示
 // ---------------------------------------------------------------
-void LcdController::showMessage(String msg) {
+void LcdController::showMessage(const char* msg) {
   this->clearMessage();
   M5.Lcd.setTextSize(2);
   M5.Lcd.setTextColor(WHITE, BLACK);
-  int16_t x = this->_getXaxisForTextCentering(msg.c_str());
+  int16_t x = this->_getXaxisForTextCentering(msg);
   M5.Lcd.setCursor(x, 194);
-  M5.Lcd.printf(msg.c_str());
+  M5.Lcd.print(msg);
 }
 
 // ---------------------------------------------------------------
 // エラー表示
 // ---------------------------------------------------------------
-void LcdController::showError(String msg) {
+void LcdController::showError(const char* msg) {
   this->clearMessage();
   M5.Lcd.setTextSize(2);
   M5.Lcd.setTextColor(RED, BLACK);
-  int16_t x = this->_getXaxisForTextCentering(msg.c_str());
+  int16_t x = this->_getXaxisForTextCentering(msg);
   M5.Lcd.setCursor(x, 194);
-  M5.Lcd.printf(msg.c_str());
+  M5.Lcd.print(msg);
 }
 
 // ---------------------------------------------------------------
@@ -161,7 +188,7 @@ void LcdController::clearMessage() {
 // ---------------------------------------------------------------
 // 現在時刻を表示
 // ---------------------------------------------------------------
-void LcdController::showCurrentTime(String time) {
+void LcdController::showCurrentTime(const char* time) {
   M5.Lcd.setTextSize(2);
   M5.Lcd.setTextColor(WHITE, BLACK);
 
@@ -172,7 +199,7 @@ void LcdController::showCurrentTime(String time) {
   M5.Lcd.printf("Time");
 
   M5.Lcd.setCursor(218, 166);
-  M5.Lcd.printf(time.c_str());
+  M5.Lcd.print(time);
 }
 
 
@@ -203,30 +230,278 @@ void LcdController::sleep() {
 // ---------------------------------------------------------------
 void LcdController::wakeup() {
   M5.Lcd.wakeup();
+  M5.Lcd.setBrightness(this->_BRIGHTNESS);
+}
+
+// ---------------------------------------------------------------
+// 画面を減光する
+// ---------------------------------------------------------------
+void LcdController::dim() {
+  M5.Lcd.setBrightness(this->_DIM_BRIGHTNESS);
+}
+
+// ---------------------------------------------------------------
+// 画面の明るさを通常に戻す
+// ---------------------------------------------------------------
+void LcdController::brighten() {
+  M5.Lcd.setBrightness(this->_BRIGHTNESS);
 }
 
 // ---------------------------------------------------------------
 // ログ表示
 // ---------------------------------------------------------------
-void LcdController::showLogs(vector<LogRecord> const& logs) {
-  M5.Lcd.clear();
-  this->showButtonMenu(4);
+void LcdController::showLogs(const LogStore& store, size_t top) {
   M5.Lcd.setTextSize(1);
 
-  int16_t y = 3;
+  // ヘッダー (絞り込み条件と表示範囲)
+  const LogFilter& filter = store.getFilter();
+  const char* fname = "ALL";
+  if (filter.date != 0) {
+    fname = "TODAY";
+  } else if (filter.type == LOG_TYPE_ERROR) {
+    fname = "ERROR";
+  } else if (filter.type == LOG_TYPE_EVENT) {
+    fname = "EVENT";
+  }
+
+  size_t total = store.filteredSize();
+  size_t first = (total == 0) ? 0 : top + 1;
+  size_t last = (top + LOG_ROWS < total) ? top + LOG_ROWS : total;
+
+  M5.Lcd.setTextColor(CYAN, BLACK);
+  M5.Lcd.setCursor(10, 3);
+  M5.Lcd.printf("[%-5s] %u-%u / %u          ", fname, (unsigned)first, (unsigned)last, (unsigned)total);
 
-  for (LogRecord log : logs) {
-    if (log.err) {
-      M5.Lcd.setTextColor(RED, BLACK);
+  // 表示範囲のレコードのみを描画
+  // - 行末まで空白で埋めて前回の表示を上書きする
+  char line[LOG_LINE_LEN];
+  int16_t y = 18;
 
+  for (size_t i = 0; i < LOG_ROWS; i++) {
+    LogRecord rec;
+    if (store.getFiltered(top + i, rec)) {
+      LogStore::formatRecord(rec, line, sizeof(line));
+      M5.Lcd.setTextColor(rec.err ? RED : WHITE, BLACK);
     } else {
-      M5.Lcd.setTextColor(WHITE, BLACK);
+      line[0] = '\0';
     }
 
     M5.Lcd.setCursor(10, y);
-    String line = String(log.timestamp + " " + log.text);
-    M5.Lcd.printf(line.c_str());
+    M5.Lcd.printf("%-50s", line);
 
     y = y + 15;
   }
 }
+
+// ---------------------------------------------------------------
+// 診断情報ページを表示
+// ---------------------------------------------------------------
+void LcdController::showInfoPage() {
+  M5.Lcd.clear();
+  this->showButtonMenu(5);
+}
+
+// ---------------------------------------------------------------
+// ヒープの統計情報を表示
+// ---------------------------------------------------------------
+void LcdController::showHeapInfo(const HeapStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 3);
+  M5.Lcd.printf("HEAP");
+
+  M5.Lcd.setCursor(10, 18);
+  M5.Lcd.printf("Free          : %7u bytes   ", stats.freeSize);
+  M5.Lcd.setCursor(10, 30);
+  M5.Lcd.printf("Min free      : %7u bytes   ", stats.minFreeSize);
+  M5.Lcd.setCursor(10, 42);
+  M5.Lcd.printf("Largest block : %7u bytes   ", stats.largestBlock);
+  M5.Lcd.setCursor(10, 54);
+  M5.Lcd.printf("Min largest   : %7u bytes   ", stats.minLargestBlock);
+
+  // 断片化率が高い場合は赤で表示
+  if (stats.fragmentation >= 50) {
+    M5.Lcd.setTextColor(RED, BLACK);
+  }
+  M5.Lcd.setCursor(10, 66);
+  M5.Lcd.printf("Fragmentation : %7u %%       ", stats.fragmentation);
+}
+
+// ---------------------------------------------------------------
+// 入力遅延の統計情報を表示
+// ---------------------------------------------------------------
+void LcdController::showInputInfo(const InputStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 84);
+  M5.Lcd.printf("INPUT (press to action)");
+
+  M5.Lcd.setCursor(10, 99);
+  M5.Lcd.printf("Events        : %7u (dropped %u)   ", stats.count, stats.dropped);
+  M5.Lcd.setCursor(10, 111);
+  M5.Lcd.printf("Latency       : last %u / avg %u / max %u ms   ", stats.last, stats.avg, stats.max);
+}
+
+// ---------------------------------------------------------------
+// BLE 通信の統計情報を表示
+// ---------------------------------------------------------------
+void LcdController::showBleInfo(const BleStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 126);
+  M5.Lcd.printf("BLE (%s)", stats.backend);
+
+  M5.Lcd.setCursor(10, 141);
+  M5.Lcd.printf("Stack heap    : %7u bytes (+%u conn)   ", stats.initHeap, stats.connectHeap);
+  M5.Lcd.setCursor(10, 153);
+  M5.Lcd.printf("Connect       : avg %u / max %u ms (ok %u, ng %u)   ",
+                stats.avgConnectMs, stats.maxConnectMs, stats.connects, stats.failures);
+}
+
+// ---------------------------------------------------------------
+// 直近のファームウェア更新の統計情報を表示
+// ---------------------------------------------------------------
+void LcdController::showOtaInfo(const OtaStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 171);
+  M5.Lcd.print("OTA");
+
+  M5.Lcd.setCursor(10, 186);
+  if (stats.imageBytes == 0) {
+    M5.Lcd.print("Last update   : none");
+    return;
+  }
+  M5.Lcd.printf("Last update   : %s, %u / %u bytes, %u ms   ",
+                stats.delta ? "delta" : "full", stats.transferBytes, stats.imageBytes, stats.applyMs);
+}
+
+// ---------------------------------------------------------------
+// 電源情報ページを表示
+// ---------------------------------------------------------------
+void LcdController::showPowerPage() {
+  M5.Lcd.clear();
+  this->showButtonMenu(6);
+}
+
+// ---------------------------------------------------------------
+// 電源の計測値と状態ごとの消費電流を表示
+// - 消費電流は VBUS 電流からバッテリーの充電電流を引いた本体の消費分
+// ---------------------------------------------------------------
+void LcdController::showPowerInfo(const PowerStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 3);
+  M5.Lcd.print("Power");
+
+  M5.Lcd.setCursor(10, 18);
+  M5.Lcd.printf("Battery       : %4.2f V  %7.1f mA   ", stats.batVoltage, stats.batCurrent);
+  M5.Lcd.setCursor(10, 30);
+  M5.Lcd.printf("VBUS          : %4.2f V  %7.1f mA   ", stats.vbusVoltage, stats.vbusCurrent);
+  M5.Lcd.setCursor(10, 42);
+  M5.Lcd.printf("Load          : %7.1f mA   ", stats.loadCurrent);
+  M5.Lcd.setCursor(10, 54);
+  M5.Lcd.printf("CPU           : %3u MHz (%s)   ", stats.cpuMhz, powerModeToString(stats.mode));
+
+  M5.Lcd.setCursor(10, 75);
+  M5.Lcd.print("Mode       avg mA   min mA   max mA  samples");
+  for (uint8_t i = 0; i < POWER_MODE_NUM; i++) {
+    const PowerModeStats& m = stats.modes[i];
+    M5.Lcd.setCursor(10, 90 + i * 12);
+    if (m.samples == 0) {
+      M5.Lcd.printf("%-8s        -        -        -        0   ", powerModeToString((PowerMode)i));
+    } else {
+      M5.Lcd.printf("%-8s %8.1f %8.1f %8.1f %8u   ",
+                    powerModeToString((PowerMode)i), m.avgMa, m.minMa, m.maxMa, m.samples);
+    }
+  }
+}
+
+// ---------------------------------------------------------------
+// 電波の強さ (アンテナ表示と RSSI) を表示
+// - 電源状態の円に掛からない右上の領域に描画する
+// - RSSI が未取得なら棒はすべて灰色で "--" と表示する
+// ---------------------------------------------------------------
+void LcdController::showLinkQuality(const LinkStats& stats) {
+  const int16_t x = 270;
+  const int16_t bottom = 74;
+  uint32_t color = (stats.bars >= 2) ? GREEN : (stats.bars == 1) ? YELLOW : RED;
+
+  M5.Lcd.fillRect(x, bottom - 16, 40, 28, BLACK);
+  for (uint8_t i = 0; i < 4; i++) {
+    int16_t bh = (i + 1) * 4;
+    M5.Lcd.fillRect(x + i * 9, bottom - bh, 6, bh, (i < stats.bars) ? color : DARKGREY);
+  }
+
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+  M5.Lcd.setCursor(x, bottom + 4);
+  if (stats.avgRssi == 0) {
+    M5.Lcd.print("--");
+  } else {
+    M5.Lcd.printf("%ddBm", stats.avgRssi);
+  }
+}
+
+// ---------------------------------------------------------------
+// リンク品質ページを表示
+// ---------------------------------------------------------------
+void LcdController::showLinkPage() {
+  M5.Lcd.clear();
+  this->showButtonMenu(7);
+}
+
+// ---------------------------------------------------------------
+// リンク品質の統計情報と RSSI の区分ごとのコマンドの成功率・応答時間を表示
+// - 応答時間は接続開始から応答受信まで (接続の再試行を含む)
+// ---------------------------------------------------------------
+void LcdController::showLinkInfo(const LinkStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 3);
+  M5.Lcd.printf("Link (%s)", this->_address);
+
+  M5.Lcd.setCursor(10, 18);
+  M5.Lcd.printf("RSSI          : adv %d / conn %d / avg %d dBm   ", stats.advRssi, stats.connRssi, stats.avgRssi);
+  M5.Lcd.setCursor(10, 30);
+  M5.Lcd.printf("MTU           : %u bytes (max notify %u)   ", stats.mtu, stats.maxNotifyLen);
+  M5.Lcd.setCursor(10, 42);
+  M5.Lcd.printf("Scan          : %u s   ", stats.scanSec);
+  M5.Lcd.setCursor(10, 54);
+  M5.Lcd.printf("Retries       : %u   ", stats.retries);
+
+  M5.Lcd.setCursor(10, 75);
+  M5.Lcd.print("RSSI       cmds    ok %   avg ms   max ms");
+  for (uint8_t i = 0; i < LINK_RSSI_BUCKETS; i++) {
+    const LinkBucket& b = stats.buckets[i];
+    M5.Lcd.setCursor(10, 90 + i * 12);
+    if (b.commands == 0) {
+      M5.Lcd.printf("%-8s %6u        -        -        -   ", linkBucketToString(i), 0);
+    } else {
+      M5.Lcd.printf("%-8s %6u %8.1f %8u %8u   ",
+                    linkBucketToString(i), b.commands, 100.0f * b.successes / b.commands, b.avgMs, b.maxMs);
+    }
+  }
+}
+
+// ---------------------------------------------------------------
+// OFF/ON タイマーの委任の状態を表示
+// ---------------------------------------------------------------
+void LcdController::showOffloadInfo(const OffloadStats& stats) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+
+  M5.Lcd.setCursor(10, 150);
+  M5.Lcd.print("Timer offload");
+
+  M5.Lcd.setCursor(10, 165);
+  M5.Lcd.printf("State         : %s (syncs %u, writes %u)   ", offloadStateToString(stats.state), stats.syncs, stats.writes);
+  M5.Lcd.setCursor(10, 177);
+  M5.Lcd.printf("Verified      : %u (fallback %u)   ", stats.verified, stats.fallbacks);
+}
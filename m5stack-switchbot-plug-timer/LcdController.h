@@ -12,23 +12,25 @@
 #define LcdController_h
 #include <Arduino.h>
 #include <M5Core2.h>
-#include <vector>
-using std::vector;
-
-// ログのレコードの構造体
-struct LogRecord {
-  String timestamp;  // タイムスタンプ (YYYY-MM-DD hh:mm:ss)
-  String text;       // ログの内容
-  bool err;          // エラーかどうか
-};
+#include "HeapMonitor.h"
+#include "LogStore.h"
+#include "InputManager.h"
+#include "SwitchBotPlugMini.h"
+#include "OtaUpdater.h"
+#include "PowerManager.h"
+#include "TimerOffload.h"
 
 // ---------------------------------------------------------------
 // LcdController クラス
 // ---------------------------------------------------------------
 class LcdController {
+public:
+  // ログ表示で 1 画面に表示する行数
+  static const size_t LOG_ROWS = 13;
+
 private:
   // SwitchBot Plug Mini の BLE MAC アドレス
-  char* _address;
+  const char* _address;
 
   // SwitchBot Plug Mini の表示名
   const char* _name;
@@ -36,6 +38,10 @@ private:
   // OFF/ON タイマーの時刻
   const char* _time;
 
+  // 画面の明るさ (通常・減光)
+  const uint8_t _BRIGHTNESS = 150;
+  const uint8_t _DIM_BRIGHTNESS = 20;
+
 private:
   // タイトルを表示
   void _showTitle();
@@ -49,11 +55,17 @@ private:
 
 public:
   // コンストラクタ
-  LcdController(char* address, char* name, char* time);
+  LcdController(const char* address, const char* name, const char* time);
 
   // 初期化
   void init();
 
+  // タイトルの BLE MAC アドレスを描き直す (設定の変更時)
+  void updateTitle();
+
+  // OFF/ON タイマー時刻を描き直す (設定の変更時)
+  void updateTimerTime();
+
   // 電源状態表示
   void showPowerStatus(bool status);
 
@@ -61,25 +73,66 @@ public:
   void showButtonMenu(uint8_t mode);
 
   // メッセージ表示
-  void showMessage(String msg);
+  void showMessage(const char* msg);
 
   // エラー表示
-  void showError(String msg);
+  void showError(const char* msg);
 
   // メッセージ消去
   void clearMessage();
 
   // 現在時刻を表示
-  void showCurrentTime(String time);
+  void showCurrentTime(const char* time);
 
   // LCD 省電力モードへ移行
   void sleep();
 
-  // LCD 省電力モードから復帰
+  // LCD 省電力モードから復帰 (明るさも通常に戻す)
   void wakeup();
 
+  // 画面を減光する
+  void dim();
+
+  // 画面の明るさを通常に戻す
+  void brighten();
+
   // ログ表示
-  void showLogs(vector<LogRecord> const& logs);
+  // - 絞り込み後のログのうち新しい順に top 番目から LOG_ROWS 行分だけを描画する
+  // - 画面全体の消去は行わないので、スクロール時にも描画コストは一定
+  void showLogs(const LogStore& store, size_t top);
+
+  // 診断情報ページを表示
+  void showInfoPage();
+
+  // ヒープの統計情報を表示
+  void showHeapInfo(const HeapStats& stats);
+
+  // 入力遅延の統計情報を表示
+  void showInputInfo(const InputStats& stats);
+
+  // BLE 通信の統計情報を表示
+  void showBleInfo(const BleStats& stats);
+
+  // 直近のファームウェア更新の統計情報を表示
+  void showOtaInfo(const OtaStats& stats);
+
+  // 電源情報ページを表示
+  void showPowerPage();
+
+  // 電源の計測値と状態ごとの消費電流を表示
+  void showPowerInfo(const PowerStats& stats);
+
+  // 電波の強さ (アンテナ表示と RSSI) を表示 (メイン画面の右上)
+  void showLinkQuality(const LinkStats& stats);
+
+  // リンク品質ページを表示
+  void showLinkPage();
+
+  // リンク品質の統計情報と RSSI の区分ごとのコマンドの成功率・応答時間を表示
+  void showLinkInfo(const LinkStats& stats);
+
+  // OFF/ON タイマーの委任の状態を表示 (リンク品質ページの下部)
+  void showOffloadInfo(const OffloadStats& stats);
 };
 
 #endif
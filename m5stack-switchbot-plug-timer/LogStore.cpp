@@ -0,0 +1,259 @@
+/* ----------------------------------------------------------------
+  LogStore.cpp
+  - ログを固定長レコードのリングバッファに保存し、絞り込み表示用の
+    インデックスを管理する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "LogStore.h"
+
+// ---------------------------------------------------------------
+// イベントコードに対応する文字列を取得
+// ---------------------------------------------------------------
+const char* logEventToString(LogEvent event) {
+  switch (event) {
+    case LOG_SYSTEM_STARTED_UP: return "SYSTEM_STARTED_UP";
+    case LOG_TIMER_TURNED_OFF: return "TIMER_TURNED_OFF";
+    case LOG_TIMER_TURNED_ON: return "TIMER_TURNED_ON";
+    case LOG_NTP_TIME_SYNCHRONIZED: return "NTP_TIME_SYNCHRONIZED";
+    case LOG_CONFIG_RELOADED: return "CONFIG_RELOADED";
+    case LOG_OTA_UPDATED: return "OTA_UPDATED";
+    case LOG_OTA_CONFIRMED: return "OTA_CONFIRMED";
+    case LOG_OTA_ROLLED_BACK: return "OTA_ROLLED_BACK";
+    case LOG_TIMER_OFFLOADED: return "TIMER_OFFLOADED";
+    case LOG_TIMER_VERIFIED: return "TIMER_VERIFIED";
+    case LOG_TIMER_OFFLOAD_DISABLED: return "TIMER_OFFLOAD_DISABLED";
+    case LOG_TIMER_OFF_VERIFIED: return "TIMER_OFF_VERIFIED";
+  }
+  return "UNKNOWN_EVENT";
+}
+
+// ===============================================================
+// LogStore クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+LogStore::LogStore(size_t capacity) {
+  this->_capacity = capacity;
+}
+
+// ---------------------------------------------------------------
+// デストラクタ
+// ---------------------------------------------------------------
+LogStore::~LogStore() {
+  free(this->_records);
+  free(this->_index);
+}
+
+// ---------------------------------------------------------------
+// 初期化 (バッファの確保)
+// ---------------------------------------------------------------
+bool LogStore::init() {
+  if (this->_records != nullptr) {
+    return true;
+  }
+
+  size_t rsize = sizeof(LogRecord) * this->_capacity;
+  size_t isize = sizeof(uint32_t) * this->_capacity;
+
+  // PSRAM を優先し、なければ内部 RAM に確保する
+  this->_records = (LogRecord*)ps_malloc(rsize);
+  if (this->_records == nullptr) {
+    this->_records = (LogRecord*)malloc(rsize);
+  }
+
+  this->_index = (uint32_t*)ps_malloc(isize);
+  if (this->_index == nullptr) {
+    this->_index = (uint32_t*)malloc(isize);
+  }
+
+  if (this->_records == nullptr || this->_index == nullptr) {
+    free(this->_records);
+    free(this->_index);
+    this->_records = nullptr;
+    this->_index = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+// 保存されている最も古いレコードの連番
+uint32_t LogStore::_oldestSeq() const {
+  if (this->_total > this->_capacity) {
+    return this->_total - this->_capacity;
+  }
+  return 0;
+}
+
+// レコードが絞り込み条件に合致するかどうか
+bool LogStore::_match(const LogRecord& rec) const {
+  if (this->_filter.type == LOG_TYPE_ERROR && rec.err == false) {
+    return false;
+  }
+  if (this->_filter.type == LOG_TYPE_EVENT && rec.err == true) {
+    return false;
+  }
+  if (this->_filter.date != 0 && stampToDate(rec.stamp) != this->_filter.date) {
+    return false;
+  }
+  return true;
+}
+
+// 上書きされて無効になったレコードをインデックスから取り除く
+// - 連番は単調増加なので、無効なものは常にインデックスの先頭側にある
+void LogStore::_pruneIndex() {
+  uint32_t oldest = this->_oldestSeq();
+  while (this->_idxStart < this->_idxEnd && this->_index[this->_idxStart % this->_capacity] < oldest) {
+    this->_idxStart++;
+  }
+}
+
+// ---------------------------------------------------------------
+// ログを追加
+// ---------------------------------------------------------------
+void LogStore::push(uint32_t stamp, bool err, uint8_t code) {
+  if (this->_records == nullptr) {
+    return;
+  }
+
+  uint32_t seq = this->_total++;
+  LogRecord& rec = this->_records[seq % this->_capacity];
+  rec.stamp = stamp;
+  rec.err = err;
+  rec.code = code;
+  rec.reserved = 0;
+
+  // 上書きしたレコードを先にインデックスから取り除いてから追加する
+  this->_pruneIndex();
+
+  if (this->_match(rec)) {
+    this->_index[this->_idxEnd % this->_capacity] = seq;
+    this->_idxEnd++;
+  }
+}
+
+// ---------------------------------------------------------------
+// 保存されているレコード数
+// ---------------------------------------------------------------
+size_t LogStore::size() const {
+  return this->_total - this->_oldestSeq();
+}
+
+// ---------------------------------------------------------------
+// 絞り込み条件によらず、レコードを新しい順に pos 番目から取得
+// ---------------------------------------------------------------
+bool LogStore::get(size_t pos, LogRecord& rec) const {
+  if (pos >= this->size()) {
+    return false;
+  }
+  rec = this->_records[(this->_total - 1 - pos) % this->_capacity];
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 絞り込み条件をセット (インデックスを再構築する)
+// ---------------------------------------------------------------
+void LogStore::setFilter(const LogFilter& filter) {
+  this->_filter = filter;
+  this->_idxStart = 0;
+  this->_idxEnd = 0;
+
+  if (this->_records == nullptr) {
+    return;
+  }
+
+  for (uint32_t seq = this->_oldestSeq(); seq < this->_total; seq++) {
+    if (this->_match(this->_records[seq % this->_capacity])) {
+      this->_index[this->_idxEnd % this->_capacity] = seq;
+      this->_idxEnd++;
+    }
+  }
+}
+
+// ---------------------------------------------------------------
+// 現在の絞り込み条件を取得
+// ---------------------------------------------------------------
+const LogFilter& LogStore::getFilter() const {
+  return this->_filter;
+}
+
+// ---------------------------------------------------------------
+// 絞り込み条件に合致するレコード数
+// ---------------------------------------------------------------
+size_t LogStore::filteredSize() const {
+  return this->_idxEnd - this->_idxStart;
+}
+
+// ---------------------------------------------------------------
+// 絞り込み条件に合致するレコードを新しい順に pos 番目から取得
+// ---------------------------------------------------------------
+bool LogStore::getFiltered(size_t pos, LogRecord& rec) const {
+  if (pos >= this->filteredSize()) {
+    return false;
+  }
+  uint32_t seq = this->_index[(this->_idxEnd - 1 - pos) % this->_capacity];
+  rec = this->_records[seq % this->_capacity];
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 古い方へ 1 ページ送ったときのページの先頭
+// ---------------------------------------------------------------
+size_t LogStore::olderPage(size_t top, size_t rows) const {
+  return (top + rows < this->filteredSize()) ? top + rows : 0;
+}
+
+// ---------------------------------------------------------------
+// 新しい方へ 1 ページ戻ったときのページの先頭
+// ---------------------------------------------------------------
+size_t LogStore::newerPage(size_t top, size_t rows) const {
+  // 絞り込み条件に合致するレコードが上書きされて減ったら、最後のページを表示する
+  size_t total = this->filteredSize();
+  size_t last = (total == 0) ? 0 : (total - 1) / rows * rows;
+  if (top > last) {
+    return last;
+  }
+  return (top > rows) ? top - rows : 0;
+}
+
+// ---------------------------------------------------------------
+// 日付と時刻をタイムスタンプにパック
+// - 上位ビットから 年-2000 (6), 月 (4), 日 (5), 時 (5), 分 (6), 秒 (6)
+// - 大小比較がそのまま日時の前後関係になる
+// ---------------------------------------------------------------
+uint32_t LogStore::packStamp(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec) {
+  uint32_t y = (year >= 2000) ? (year - 2000) : 0;
+  return ((y & 0x3f) << 26) | ((uint32_t)(month & 0x0f) << 22) | ((uint32_t)(day & 0x1f) << 17)
+         | ((uint32_t)(hour & 0x1f) << 12) | ((uint32_t)(min & 0x3f) << 6) | (sec & 0x3f);
+}
+
+// ---------------------------------------------------------------
+// タイムスタンプから日付部分を取り出す
+// ---------------------------------------------------------------
+uint16_t LogStore::stampToDate(uint32_t stamp) {
+  return (uint16_t)(stamp >> 17);
+}
+
+// ---------------------------------------------------------------
+// レコードを "YYYY/MM/DD hh:mm:ss TEXT" 形式のテキストにする
+// ---------------------------------------------------------------
+void LogStore::formatRecord(const LogRecord& rec, char* buf, size_t len) {
+  const char* text;
+  if (rec.err) {
+    text = errorCodeToString((ErrorCode)rec.code);
+  } else {
+    text = logEventToString((LogEvent)rec.code);
+  }
+
+  uint32_t s = rec.stamp;
+  snprintf(buf, len, "%04u/%02u/%02u %02u:%02u:%02u %s",
+           (unsigned)(2000 + ((s >> 26) & 0x3f)), (unsigned)((s >> 22) & 0x0f), (unsigned)((s >> 17) & 0x1f),
+           (unsigned)((s >> 12) & 0x1f), (unsigned)((s >> 6) & 0x3f), (unsigned)(s & 0x3f), text);
+}
@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------
+  LogStore.h
+  - ログを固定長レコードのリングバッファに保存し、絞り込み表示用の
+    インデックスを管理する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef LogStore_h
+#define LogStore_h
+#include <Arduino.h>
+#include "ErrorCode.h"
+
+// ログのイベントコード (エラーでないログ)
+enum LogEvent : uint8_t {
+  LOG_SYSTEM_STARTED_UP = 0,
+  LOG_TIMER_TURNED_OFF,
+  LOG_TIMER_TURNED_ON,
+  LOG_NTP_TIME_SYNCHRONIZED,
+  LOG_CONFIG_RELOADED,
+  LOG_OTA_UPDATED,
+  LOG_OTA_CONFIRMED,
+  LOG_OTA_ROLLED_BACK,
+  LOG_TIMER_OFFLOADED,
+  LOG_TIMER_VERIFIED,
+  LOG_TIMER_OFFLOAD_DISABLED,
+  LOG_TIMER_OFF_VERIFIED,
+};
+
+// イベントコードに対応する文字列を取得
+const char* logEventToString(LogEvent event);
+
+// ログのレコードの構造体 (8 バイト)
+struct LogRecord {
+  uint32_t stamp;  // タイムスタンプ (LogStore::packStamp() でパックした値)
+  bool err;        // エラーかどうか
+  uint8_t code;    // err が true なら ErrorCode, false なら LogEvent
+  uint16_t reserved;
+};
+
+// ログの種類による絞り込み
+enum LogType : uint8_t {
+  LOG_TYPE_ALL = 0,  // すべて
+  LOG_TYPE_ERROR,    // エラーのみ
+  LOG_TYPE_EVENT,    // イベントのみ
+};
+
+// ログの絞り込み条件
+struct LogFilter {
+  LogType type;  // 種類
+  uint16_t date; // 日付 (LogStore::stampToDate() の値, 0 なら絞り込まない)
+};
+
+// ログをテキスト化した際のバッファサイズ (終端文字を含む)
+const size_t LOG_LINE_LEN = 56;
+
+// ---------------------------------------------------------------
+// LogStore クラス
+// ---------------------------------------------------------------
+class LogStore {
+private:
+  // 保存できるレコード数
+  size_t _capacity;
+
+  // レコードのリングバッファ
+  // - 通算の連番 seq のレコードは _records[seq % _capacity] に格納される
+  LogRecord* _records = nullptr;
+
+  // これまでに追加されたレコードの総数 (次に追加されるレコードの連番)
+  uint32_t _total = 0;
+
+  // 絞り込み条件に合致するレコードの連番のリングバッファ (インデックス)
+  // - 古い順に _index[_idxStart % _capacity] から _index[(_idxEnd - 1) % _capacity] まで
+  uint32_t* _index = nullptr;
+  uint32_t _idxStart = 0;
+  uint32_t _idxEnd = 0;
+
+  // 現在の絞り込み条件
+  LogFilter _filter = { LOG_TYPE_ALL, 0 };
+
+private:
+  // 保存されている最も古いレコードの連番
+  uint32_t _oldestSeq() const;
+
+  // レコードが絞り込み条件に合致するかどうか
+  bool _match(const LogRecord& rec) const;
+
+  // 上書きされて無効になったレコードをインデックスから取り除く
+  void _pruneIndex();
+
+public:
+  // コンストラクタ
+  LogStore(size_t capacity);
+
+  // デストラクタ (バッファの解放)
+  ~LogStore();
+
+  // 初期化 (バッファの確保)
+  // - PSRAM があれば PSRAM に確保する
+  bool init();
+
+  // ログを追加
+  void push(uint32_t stamp, bool err, uint8_t code);
+
+  // 保存されているレコード数
+  size_t size() const;
+
+  // 絞り込み条件によらず、レコードを新しい順に pos 番目から取得
+  bool get(size_t pos, LogRecord& rec) const;
+
+  // 絞り込み条件をセット (インデックスを再構築する)
+  void setFilter(const LogFilter& filter);
+
+  // 現在の絞り込み条件を取得
+  const LogFilter& getFilter() const;
+
+  // 絞り込み条件に合致するレコード数
+  size_t filteredSize() const;
+
+  // 絞り込み条件に合致するレコードを新しい順に pos 番目から取得
+  bool getFiltered(size_t pos, LogRecord& rec) const;
+
+  // 絞り込み条件に合致するレコードを rows 件ずつ表示するときの、古い方と新しい方のページの先頭
+  // - 古い方は、最後のページからなら最初のページ (0) に戻る
+  // - 新しい方は、上書きで件数が減って top が範囲外になっていれば最後のページ
+  size_t olderPage(size_t top, size_t rows) const;
+  size_t newerPage(size_t top, size_t rows) const;
+
+  // 日付と時刻をタイムスタンプにパック
+  static uint32_t packStamp(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec);
+
+  // タイムスタンプから日付部分を取り出す
+  static uint16_t stampToDate(uint32_t stamp);
+
+  // レコードを "YYYY/MM/DD hh:mm:ss TEXT" 形式のテキストにする
+  // - buf には LOG_LINE_LEN バイト以上の領域を渡す
+  static void formatRecord(const LogRecord& rec, char* buf, size_t len);
+};
+
+#endif
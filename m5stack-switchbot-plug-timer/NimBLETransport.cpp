@@ -0,0 +1,212 @@
+/* ----------------------------------------------------------------
+  NimBLETransport.cpp
+  - NimBLE-Arduino による BleTransport の実装
+  - Bluedroid より RAM の使用量が少なく、接続の確立も速い
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "NimBLETransport.h"
+
+#if defined(USE_NIMBLE) && !defined(USE_FAKE_BLE)
+
+// NOTIFY の転送先
+static BleNotifyCallback _notifyTarget = nullptr;
+
+static void nimbleNotifyCallback(NimBLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
+  if (_notifyTarget != nullptr) {
+    _notifyTarget(pData, length);
+  }
+}
+
+// ---------------------------------------------------------------
+// ビルド時に選択された BleTransport の実装を生成する
+// ---------------------------------------------------------------
+BleTransport* createBleTransport() {
+  static NimBLETransport transport;
+  return &transport;
+}
+
+// ===============================================================
+// NimBLETransport クラス
+// ===============================================================
+
+const char* NimBLETransport::name() const {
+  return "NimBLE";
+}
+
+// ---------------------------------------------------------------
+// BLE スタックの初期化
+// ---------------------------------------------------------------
+void NimBLETransport::init() {
+  if (this->_pClient != nullptr) {
+    return;
+  }
+  NimBLEDevice::init("");
+  // 接続時の MTU の交換で要求する値
+  NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
+  this->_pClient = NimBLEDevice::createClient();
+}
+
+// ---------------------------------------------------------------
+// スキャンして見つかったデバイスごとに cb を呼ぶ
+// ---------------------------------------------------------------
+bool NimBLETransport::scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) {
+  NimBLEScan* pScan = NimBLEDevice::getScan();
+  pScan->setActiveScan(true);
+  pScan->setInterval(params.intervalMs);
+  pScan->setWindow(params.windowMs);
+
+  NimBLEScanResults results = pScan->start(params.durationSec, false);
+  int count = results.getCount();
+
+  for (int i = 0; i < count; i++) {
+    NimBLEAdvertisedDevice device = results.getDevice(i);
+
+    std::string mdata;
+    std::string sdata;
+    if (device.haveManufacturerData()) {
+      mdata = device.getManufacturerData();
+    }
+    if (device.haveServiceData()) {
+      sdata = device.getServiceData();
+    }
+
+    NimBLEAddress addr = device.getAddress();
+
+    BleAdvInfo info;
+    strncpy(info.address, addr.toString().c_str(), sizeof(info.address) - 1);
+    info.address[sizeof(info.address) - 1] = '\0';
+    info.addressType = addr.getType();
+    info.mfrData = (const uint8_t*)mdata.data();
+    info.mfrLen = mdata.length();
+    info.svcData = (const uint8_t*)sdata.data();
+    info.svcLen = sdata.length();
+    info.rssi = device.getRSSI();
+
+    if (cb(info, ctx)) {
+      break;
+    }
+  }
+
+  pScan->clearResults();
+  return count > 0;
+}
+
+// ---------------------------------------------------------------
+// 接続する
+// - スキャンで得たアドレスの種類で接続する
+// ---------------------------------------------------------------
+bool NimBLETransport::connect(const char* address, uint8_t addressType) {
+  NimBLEAddress bleAddress(std::string(address), addressType);
+  this->_pClient->connect(bleAddress);
+  return this->_pClient->isConnected();
+}
+
+// ---------------------------------------------------------------
+// Service と Characteristics を準備して NOTIFY を購読する
+// ---------------------------------------------------------------
+bool NimBLETransport::subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                                BleNotifyCallback cb, ErrorCode& err) {
+  // Service を取得
+  NimBLERemoteService* pService = this->_pClient->getService(serviceUuid);
+  if (pService == nullptr) {
+    err = ERR_SERVICE_NOT_FOUND;
+    return false;
+  }
+
+  // データ受信用の Characteristic を取得
+  this->_pCharRx = pService->getCharacteristic(rxUuid);
+  if (this->_pCharRx == nullptr) {
+    err = ERR_CHAR_RX_NOT_FOUND;
+    return false;
+  }
+
+  // データ送信用の Characteristic を取得
+  this->_pCharTx = pService->getCharacteristic(txUuid);
+  if (this->_pCharTx == nullptr) {
+    err = ERR_CHAR_TX_NOT_FOUND;
+    return false;
+  }
+
+  // データ送信用の Characteristic が NOTIFY をサポートしているかをチェック
+  if (this->_pCharTx->canNotify() == false) {
+    err = ERR_CHAR_TX_NOT_SUPPORT_NOTIFY;
+    return false;
+  }
+
+  // NOTIFY を購読
+  _notifyTarget = cb;
+  if (!this->_pCharTx->subscribe(true, nimbleNotifyCallback)) {
+    err = ERR_CHAR_TX_NOT_SUPPORT_NOTIFY;
+    return false;
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------
+// データ送信用の Characteristic に書き込む
+// ---------------------------------------------------------------
+bool NimBLETransport::write(const uint8_t* data, size_t len) {
+  if (this->_pCharRx == nullptr) {
+    return false;
+  }
+  return this->_pCharRx->writeValue(data, len, false);
+}
+
+// ---------------------------------------------------------------
+// 接続中の受信信号強度
+// ---------------------------------------------------------------
+int NimBLETransport::getRssi() {
+  if (!this->isConnected()) {
+    return 0;
+  }
+  return this->_pClient->getRssi();
+}
+
+// ---------------------------------------------------------------
+// 接続パラメータの更新を要求する
+// ---------------------------------------------------------------
+bool NimBLETransport::updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+  if (!this->isConnected()) {
+    return false;
+  }
+  this->_pClient->updateConnParams(minInterval, maxInterval, latency, timeout);
+  return true;
+}
+
+// ---------------------------------------------------------------
+// MTU の拡大を要求して、合意した MTU を返す
+// - NimBLE は接続時に NimBLEDevice::setMTU() の値で MTU の交換を行う
+//   (交換は 1 回の接続で 1 回だけなので、要求値は次の接続から使われる)
+// - getMTU() は交換で合意した値 (交換前なら 23) を返す
+// ---------------------------------------------------------------
+uint16_t NimBLETransport::requestMtu(uint16_t mtu) {
+  if (!this->isConnected()) {
+    return 0;
+  }
+  NimBLEDevice::setMTU(mtu);
+  return this->_pClient->getMTU();
+}
+
+// ---------------------------------------------------------------
+// 接続中かどうか
+// ---------------------------------------------------------------
+bool NimBLETransport::isConnected() {
+  return this->_pClient != nullptr && this->_pClient->isConnected();
+}
+
+// ---------------------------------------------------------------
+// 切断する
+// ---------------------------------------------------------------
+void NimBLETransport::disconnect() {
+  this->_pClient->disconnect();
+  this->_pCharRx = nullptr;
+  this->_pCharTx = nullptr;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------
+  NimBLETransport.h
+  - NimBLE-Arduino による BleTransport の実装
+  - Bluedroid より RAM の使用量が少なく、接続の確立も速い
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef NimBLETransport_h
+#define NimBLETransport_h
+#include "BleTransport.h"
+
+#if defined(USE_NIMBLE) && !defined(USE_FAKE_BLE)
+#include <NimBLEDevice.h>
+
+// ---------------------------------------------------------------
+// NimBLETransport クラス
+// ---------------------------------------------------------------
+class NimBLETransport : public BleTransport {
+private:
+  NimBLEClient* _pClient = nullptr;
+  NimBLERemoteCharacteristic* _pCharRx = nullptr;
+  NimBLERemoteCharacteristic* _pCharTx = nullptr;
+
+public:
+  const char* name() const override;
+  void init() override;
+  bool scan(const BleScanParams& params, BleAdvCallback cb, void* ctx) override;
+  bool connect(const char* address, uint8_t addressType) override;
+  bool subscribe(const char* serviceUuid, const char* rxUuid, const char* txUuid,
+                 BleNotifyCallback cb, ErrorCode& err) override;
+  bool write(const uint8_t* data, size_t len) override;
+  int getRssi() override;
+  bool updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) override;
+  uint16_t requestMtu(uint16_t mtu) override;
+  bool isConnected() override;
+  void disconnect() override;
+};
+
+#endif
+#endif
@@ -0,0 +1,504 @@
+/* ----------------------------------------------------------------
+  OtaUpdater.cpp
+  - HTTP でダウンロードしたファームウェアを未使用の OTA パーティションに
+    書き込み、次回起動時にそのパーティションから起動するようにする
+  - 差分形式 (実行中のイメージからのコピーと挿入の命令列)、それを zlib で
+    圧縮したもの、通常のイメージに対応する
+  - 要求した側が指定した SHA-256 (ピン留め) と書き込んだイメージが一致した
+    場合だけ起動パーティションを切り替える
+  - 更新後の最初の起動ではイメージを仮の状態とし、動作確認に失敗したら
+    更新前のパーティションに戻す (ロールバック)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "OtaUpdater.h"
+#include <Preferences.h>
+
+// ---------------------------------------------------------------
+// 起動直後にイメージを確定しないようにする
+// - ESP32 Arduino はこの関数が true を返すと、動作確認待ちのイメージを
+//   自動では確定しない (OtaUpdater::confirm() で確定する)
+// ---------------------------------------------------------------
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// ===============================================================
+// OtaUpdater クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// エラーコードを取得
+// ---------------------------------------------------------------
+ErrorCode OtaUpdater::getError() {
+  return this->_error;
+}
+
+// ---------------------------------------------------------------
+// 起動時の処理
+// ---------------------------------------------------------------
+void OtaUpdater::init() {
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, true)) {
+    if (prefs.getBytesLength(this->_NVS_KEY) == sizeof(this->_stats)) {
+      prefs.getBytes(this->_NVS_KEY, &this->_stats, sizeof(this->_stats));
+    }
+    prefs.end();
+  }
+}
+
+// ---------------------------------------------------------------
+// 直近の更新の統計情報を取得
+// ---------------------------------------------------------------
+const OtaStats& OtaUpdater::getStats() const {
+  return this->_stats;
+}
+
+// ---------------------------------------------------------------
+// 更新する
+// ---------------------------------------------------------------
+bool OtaUpdater::update(const char* url, const char* sha256) {
+  this->_error = ERR_NONE;
+  uint32_t stime = millis();
+
+  // 書き込み後のイメージの SHA-256 が指定されていなければダウンロードしない
+  uint8_t pinned[32];
+  if (sha256 == nullptr || !_parseHash(sha256, pinned)) {
+    this->_error = ERR_OTA_HASH_REQUIRED;
+    return false;
+  }
+
+  // ダウンロード開始
+  HTTPClient http;
+  const char* headers[] = { this->_TE_HEADER };
+  http.collectHeaders(headers, 1);
+  if (!http.begin(url) || http.GET() != HTTP_CODE_OK) {
+    http.end();
+    this->_error = ERR_OTA_DOWNLOAD_FAILED;
+    return false;
+  }
+
+  // 転送エンコーディングがあるとストリームにその区切りが混ざるので受け付けない
+  if (http.header(this->_TE_HEADER).length() > 0) {
+    http.end();
+    this->_error = ERR_OTA_TRANSFER_ENCODING;
+    return false;
+  }
+
+  this->_stream = http.getStreamPtr();
+  this->_stream->setTimeout(this->_READ_TIMEOUT);
+  this->_size = http.getSize();
+  this->_transferred = 0;
+  this->_written = 0;
+  bool delta = false;
+
+  // 書き込み先は実行中でない方のパーティション
+  this->_running = esp_ota_get_running_partition();
+  const esp_partition_t* target = esp_ota_get_next_update_partition(nullptr);
+  if (target == nullptr || esp_ota_begin(target, OTA_SIZE_UNKNOWN, &this->_handle) != ESP_OK) {
+    http.end();
+    this->_error = ERR_OTA_WRITE_FAILED;
+    return false;
+  }
+
+  mbedtls_sha256_init(&this->_sha);
+  mbedtls_sha256_starts(&this->_sha, 0);
+
+  // 先頭のマジックナンバーで形式を判定する
+  // - 圧縮した差分形式なら展開した先頭に差分形式のマジックナンバーがある
+  uint8_t head[4];
+  bool ok = this->_readRaw(head, sizeof(head));
+  if (ok && memcmp(head, this->_DELTA_Z_MAGIC, sizeof(head)) == 0) {
+    ok = this->_beginInflate() && this->_read(head, sizeof(head));
+    if (ok && memcmp(head, this->_DELTA_MAGIC, sizeof(head)) != 0) {
+      this->_error = ERR_OTA_BAD_FORMAT;
+      ok = false;
+    }
+  }
+
+  if (ok && memcmp(head, this->_DELTA_MAGIC, sizeof(head)) == 0) {
+    delta = true;
+    ok = this->_applyDelta(pinned);
+  } else if (ok) {
+    ok = this->_applyFull(head, sizeof(head), this->_size);
+  }
+
+  this->_endInflate();
+  http.end();
+  this->_stream = nullptr;
+
+  uint8_t actual[32];
+  mbedtls_sha256_finish(&this->_sha, actual);
+  mbedtls_sha256_free(&this->_sha);
+
+  if (!ok) {
+    esp_ota_abort(this->_handle);
+    return false;
+  }
+
+  // 書き込んだイメージの SHA-256 を指定された値と比べる
+  if (memcmp(pinned, actual, sizeof(actual)) != 0) {
+    esp_ota_abort(this->_handle);
+    this->_error = ERR_OTA_HASH_MISMATCH;
+    return false;
+  }
+
+  // イメージの検証 (ESP-IDF によるヘッダーとチェックサムの確認) と起動パーティションの切り替え
+  if (esp_ota_end(this->_handle) != ESP_OK || esp_ota_set_boot_partition(target) != ESP_OK) {
+    this->_error = ERR_OTA_WRITE_FAILED;
+    return false;
+  }
+
+  this->_stats.delta = delta;
+  this->_stats.transferBytes = this->_transferred;
+  this->_stats.imageBytes = this->_written;
+  this->_stats.applyMs = millis() - stime;
+
+  // 再起動後も参照できるように統計情報を保存する
+  // - 新しいイメージのロールバックを報告できるように、報告済みの記録を消す
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, false)) {
+    prefs.putBytes(this->_NVS_KEY, &this->_stats, sizeof(this->_stats));
+    prefs.remove(this->_NVS_KEY_ROLLBACK);
+    prefs.end();
+  }
+
+  return true;
+}
+
+// ストリームから len バイト読む
+bool OtaUpdater::_read(uint8_t* buf, size_t len) {
+  if (this->_inflator == nullptr) {
+    return this->_readRaw(buf, len);
+  }
+  while (len > 0) {
+    if (this->_outPos == this->_outEnd && !this->_inflate()) {
+      return false;
+    }
+    size_t n = this->_outEnd - this->_outPos;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(buf, this->_dict + this->_outPos, n);
+    this->_outPos += n;
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+// ストリームから展開前のデータを len バイト読む
+bool OtaUpdater::_readRaw(uint8_t* buf, size_t len) {
+  size_t n = this->_stream->readBytes(buf, len);
+  this->_transferred += n;
+  if (n != len) {
+    this->_error = ERR_OTA_DOWNLOAD_FAILED;
+    return false;
+  }
+  return true;
+}
+
+// ストリームから 32 ビット値 (LE) を読む
+bool OtaUpdater::_readU32(uint32_t& v) {
+  uint8_t b[4];
+  if (!this->_read(b, sizeof(b))) {
+    return false;
+  }
+  v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+  return true;
+}
+
+// 展開を開始する
+bool OtaUpdater::_beginInflate() {
+  this->_inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  this->_dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  if (this->_inflator == nullptr || this->_dict == nullptr) {
+    this->_endInflate();
+    this->_error = ERR_OTA_WRITE_FAILED;
+    return false;
+  }
+  tinfl_init(this->_inflator);
+  this->_dictOfs = 0;
+  this->_outPos = 0;
+  this->_outEnd = 0;
+  this->_inPos = 0;
+  this->_inLen = 0;
+  this->_inflateDone = false;
+  return true;
+}
+
+// 展開を終了する
+void OtaUpdater::_endInflate() {
+  free(this->_inflator);
+  free(this->_dict);
+  this->_inflator = nullptr;
+  this->_dict = nullptr;
+}
+
+// 次のデータを展開する
+// - 展開したデータは _dict の [_outPos, _outEnd) に置かれる
+// - 辞書の末尾まで使ったら先頭に戻る (読み終わったデータだけを上書きする)
+bool OtaUpdater::_inflate() {
+  if (this->_dictOfs == TINFL_LZ_DICT_SIZE) {
+    this->_dictOfs = 0;
+  }
+
+  while (!this->_inflateDone) {
+    if (this->_inPos == this->_inLen) {
+      // 末尾でタイムアウトまで待たないように、Content-Length が分かっていれば
+      // 残りだけ、分からなければ受信済みの分だけ読む
+      size_t n = sizeof(this->_in);
+      if (this->_size >= 0 && n > (uint32_t)this->_size - this->_transferred) {
+        n = (uint32_t)this->_size - this->_transferred;
+      } else if (this->_size < 0) {
+        int available = this->_stream->available();
+        n = (available <= 0) ? 1 : ((size_t)available < n ? (size_t)available : n);
+      }
+      if (n == 0 || !this->_readRaw(this->_in, n)) {
+        this->_error = ERR_OTA_DOWNLOAD_FAILED;
+        return false;
+      }
+      this->_inPos = 0;
+      this->_inLen = n;
+    }
+
+    size_t inBytes = this->_inLen - this->_inPos;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - this->_dictOfs;
+    tinfl_status status = tinfl_decompress(this->_inflator, this->_in + this->_inPos, &inBytes,
+                                           this->_dict, this->_dict + this->_dictOfs, &outBytes,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+    this->_inPos += inBytes;
+    if (status < TINFL_STATUS_DONE) {
+      this->_error = ERR_OTA_BAD_FORMAT;
+      return false;
+    }
+    this->_inflateDone = (status == TINFL_STATUS_DONE);
+
+    if (outBytes > 0) {
+      this->_outPos = this->_dictOfs;
+      this->_outEnd = this->_dictOfs + outBytes;
+      this->_dictOfs += outBytes;
+      return true;
+    }
+  }
+
+  // 差分形式の終わりより前で圧縮データが終わった
+  this->_error = ERR_OTA_BAD_FORMAT;
+  return false;
+}
+
+// パーティションに書き込んで SHA-256 を更新する
+bool OtaUpdater::_write(const uint8_t* data, size_t len) {
+  if (esp_ota_write(this->_handle, data, len) != ESP_OK) {
+    this->_error = ERR_OTA_WRITE_FAILED;
+    return false;
+  }
+  mbedtls_sha256_update(&this->_sha, data, len);
+  this->_written += len;
+  return true;
+}
+
+// 差分形式を適用する
+bool OtaUpdater::_applyDelta(const uint8_t pinned[32]) {
+  // ヘッダー
+  uint32_t targetSize;
+  uint8_t source[32];
+  uint8_t hash[32];
+  if (!this->_readU32(targetSize) || !this->_read(source, sizeof(source)) || !this->_read(hash, sizeof(hash))) {
+    return false;
+  }
+
+  // 指定されたイメージへの差分でなければ書き込まない
+  if (memcmp(hash, pinned, sizeof(hash)) != 0) {
+    this->_error = ERR_OTA_HASH_MISMATCH;
+    return false;
+  }
+
+  // 差分の元になったイメージと実行中のイメージが同じかを確認する
+  uint8_t running[32];
+  if (esp_partition_get_sha256(this->_running, running) != ESP_OK || memcmp(source, running, sizeof(running)) != 0) {
+    this->_error = ERR_OTA_SOURCE_MISMATCH;
+    return false;
+  }
+
+  // 命令を順に実行する
+  while (true) {
+    uint8_t op;
+    uint32_t len;
+    if (!this->_read(&op, 1)) {
+      return false;
+    }
+    if (op == _OP_END) {
+      break;
+    }
+    if (!this->_readU32(len) || len > targetSize - this->_written) {
+      if (this->_error == ERR_NONE) {
+        this->_error = ERR_OTA_BAD_FORMAT;
+      }
+      return false;
+    }
+
+    if (op == _OP_COPY) {
+      uint32_t offset;
+      if (!this->_readU32(offset)) {
+        return false;
+      }
+      if (offset > this->_running->size || len > this->_running->size - offset) {
+        this->_error = ERR_OTA_BAD_FORMAT;
+        return false;
+      }
+      while (len > 0) {
+        size_t n = (len < sizeof(this->_buf)) ? len : sizeof(this->_buf);
+        if (esp_partition_read(this->_running, offset, this->_buf, n) != ESP_OK) {
+          this->_error = ERR_OTA_WRITE_FAILED;
+          return false;
+        }
+        if (!this->_write(this->_buf, n)) {
+          return false;
+        }
+        offset += n;
+        len -= n;
+      }
+
+    } else if (op == _OP_INSERT) {
+      while (len > 0) {
+        size_t n = (len < sizeof(this->_buf)) ? len : sizeof(this->_buf);
+        if (!this->_read(this->_buf, n) || !this->_write(this->_buf, n)) {
+          return false;
+        }
+        len -= n;
+      }
+
+    } else {
+      this->_error = ERR_OTA_BAD_FORMAT;
+      return false;
+    }
+  }
+
+  if (this->_written != targetSize) {
+    this->_error = ERR_OTA_BAD_FORMAT;
+    return false;
+  }
+  return true;
+}
+
+// 通常のイメージを書き込む
+// - サイズが分かっていればその分だけ、分からなければ接続が閉じられるまで読む
+bool OtaUpdater::_applyFull(const uint8_t* head, size_t headLen, int size) {
+  if (!this->_write(head, headLen)) {
+    return false;
+  }
+
+  while (size < 0 || this->_written < (uint32_t)size) {
+    size_t n = sizeof(this->_buf);
+    if (size >= 0 && n > (uint32_t)size - this->_written) {
+      n = (uint32_t)size - this->_written;
+    }
+    n = this->_stream->readBytes(this->_buf, n);
+    if (n == 0) {
+      break;
+    }
+    this->_transferred += n;
+    if (!this->_write(this->_buf, n)) {
+      return false;
+    }
+  }
+
+  // 途中で途切れた
+  if (size >= 0 && this->_written != (uint32_t)size) {
+    this->_error = ERR_OTA_DOWNLOAD_FAILED;
+    return false;
+  }
+  return true;
+}
+
+// 16 進数の文字列を 32 バイトに変換
+bool OtaUpdater::_parseHash(const char* hex, uint8_t hash[32]) {
+  if (strlen(hex) != 64) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 64; i++) {
+    char c = hex[i];
+    uint8_t v;
+    if (c >= '0' && c <= '9') {
+      v = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      v = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      v = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    hash[i / 2] = (i % 2 == 0) ? (v << 4) : (hash[i / 2] | v);
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 実行中のイメージが動作確認待ちかどうか
+// ---------------------------------------------------------------
+bool OtaUpdater::isPendingVerify() {
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK) {
+    return false;
+  }
+  return state == ESP_OTA_IMG_PENDING_VERIFY;
+}
+
+// ---------------------------------------------------------------
+// ロールバックされたかどうか
+// - 無効になったパーティションは次に書き込むまで残るので、報告したアドレスを記録する
+// ---------------------------------------------------------------
+bool OtaUpdater::wasRolledBack() {
+  const esp_partition_t* invalid = esp_ota_get_last_invalid_partition();
+  if (invalid == nullptr) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(this->_NVS_NAMESPACE, false)) {
+    return false;
+  }
+  uint32_t reported = 0;
+  bool known = prefs.getBytesLength(this->_NVS_KEY_ROLLBACK) == sizeof(reported)
+               && prefs.getBytes(this->_NVS_KEY_ROLLBACK, &reported, sizeof(reported)) == sizeof(reported)
+               && reported == invalid->address;
+  if (!known) {
+    reported = invalid->address;
+    prefs.putBytes(this->_NVS_KEY_ROLLBACK, &reported, sizeof(reported));
+  }
+  prefs.end();
+  return !known;
+}
+
+// ---------------------------------------------------------------
+// 動作確認の結果を反映する
+// ---------------------------------------------------------------
+bool OtaUpdater::confirm(bool ok) {
+  this->_error = ERR_NONE;
+  if (!this->isPendingVerify()) {
+    return false;
+  }
+  if (!ok) {
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+    return false;
+  }
+  if (esp_ota_mark_app_valid_cancel_rollback() != ESP_OK) {
+    this->_error = ERR_OTA_WRITE_FAILED;
+    return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------
+// 動作確認待ちのまま所定の時間が過ぎていたらロールバックして再起動する
+// ---------------------------------------------------------------
+void OtaUpdater::checkVerifyTimeout() {
+  if (millis() > this->_VERIFY_TIMEOUT && this->isPendingVerify()) {
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+}
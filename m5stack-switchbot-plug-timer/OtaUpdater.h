@@ -0,0 +1,180 @@
+/* ----------------------------------------------------------------
+  OtaUpdater.h
+  - HTTP でダウンロードしたファームウェアを未使用の OTA パーティションに
+    書き込み、次回起動時にそのパーティションから起動するようにする
+  - 差分形式 (実行中のイメージからのコピーと挿入の命令列)、それを zlib で
+    圧縮したもの、通常のイメージに対応する
+  - 要求した側が指定した SHA-256 (ピン留め) と書き込んだイメージが一致した
+    場合だけ起動パーティションを切り替える (ダウンロード元が返すハッシュは使わない)
+  - 更新後の最初の起動ではイメージを仮の状態とし、動作確認に失敗したら
+    更新前のパーティションに戻す (ロールバック)
+  - 更新中は HTTPClient が URL やレスポンスヘッダーを String で保持するため
+    ヒープ確保が発生する。圧縮した差分形式では展開用の作業領域と辞書
+    (約 43KB) も確保する (更新は要求されたときだけなので定常状態には含めない。
+    成功すると再起動し、失敗しても update() から戻る前に解放される)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef OtaUpdater_h
+#define OtaUpdater_h
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <rom/miniz.h>
+#include "ErrorCode.h"
+
+// 直近の更新の統計情報の構造体
+struct OtaStats {
+  bool delta;              // 差分形式で更新したかどうか
+  uint32_t transferBytes;  // ダウンロードしたバイト数
+  uint32_t imageBytes;     // 書き込んだイメージのバイト数
+  uint32_t applyMs;        // ダウンロード開始から書き込み完了までの時間 (ミリ秒)
+};
+
+// ---------------------------------------------------------------
+// OtaUpdater クラス
+// ---------------------------------------------------------------
+class OtaUpdater {
+private:
+  // 差分形式のファイルの先頭のマジックナンバー
+  // - 続いて書き込み後のイメージのサイズ (4 バイト LE)、更新前のイメージの
+  //   SHA-256 (32 バイト)、書き込み後のイメージの SHA-256 (32 バイト)
+  // - その後に命令 ([種類 1][長さ 4 LE][...]) が並ぶ
+  const char* _DELTA_MAGIC = "SBD1";
+
+  // 圧縮した差分形式のファイルの先頭のマジックナンバー
+  // - 続く zlib 形式のデータを展開すると差分形式のファイル ("SBD1" から) になる
+  const char* _DELTA_Z_MAGIC = "SBZ1";
+
+  // 差分形式の命令
+  static const uint8_t _OP_END = 0x00;     // 終わり
+  static const uint8_t _OP_COPY = 0x01;    // 実行中のイメージからコピー (続いてコピー元の位置 4 バイト LE)
+  static const uint8_t _OP_INSERT = 0x02;  // 続くデータをそのまま書き込む
+
+  // レスポンスの転送エンコーディングのヘッダー
+  // - ストリームをそのまま読むので、chunked などの転送エンコーディングは受け付けない
+  const char* _TE_HEADER = "Transfer-Encoding";
+
+  // ダウンロードの受信待ちのタイムアウト (ミリ秒)
+  const uint32_t _READ_TIMEOUT = 10000;
+
+  // 更新後の起動時の動作確認を待つ最大時間 (ミリ秒)
+  // - 時刻同期や SwitchBot Plug Mini の発見で起動処理が進まないまま
+  //   この時間が過ぎたらロールバックする
+  const uint32_t _VERIFY_TIMEOUT = 600000;
+
+  // NVS の名前空間とキー (統計情報, ロールバックを報告したパーティションのアドレス)
+  const char* _NVS_NAMESPACE = "plugtimer";
+  const char* _NVS_KEY = "ota";
+  const char* _NVS_KEY_ROLLBACK = "otarollback";
+
+  // 読み書き用のバッファ (イメージ全体をメモリに置かない)
+  uint8_t _buf[1024];
+
+  // ダウンロード中のストリーム
+  WiFiClient* _stream = nullptr;
+
+  // レスポンスの Content-Length (不明なら負の値)
+  int _size = -1;
+
+  // 圧縮した差分形式の展開の状態 (展開しないときは nullptr)
+  // - _dict は展開した出力を置く TINFL_LZ_DICT_SIZE バイトの輪状のバッファで、辞書を兼ねる
+  tinfl_decompressor* _inflator = nullptr;
+  uint8_t* _dict = nullptr;
+  size_t _dictOfs = 0;  // 次に展開する位置
+  size_t _outPos = 0;   // 展開済みで未読のデータの先頭
+  size_t _outEnd = 0;   // 展開済みで未読のデータの末尾
+  uint8_t _in[512];     // 展開前のデータ
+  size_t _inPos = 0;
+  size_t _inLen = 0;
+  bool _inflateDone = false;
+
+  // 書き込み中のパーティション
+  esp_ota_handle_t _handle = 0;
+  const esp_partition_t* _running = nullptr;
+
+  // 書き込んだイメージの SHA-256
+  mbedtls_sha256_context _sha;
+
+  // ダウンロードしたバイト数と書き込んだバイト数 (更新中)
+  uint32_t _transferred = 0;
+  uint32_t _written = 0;
+
+  // 直近の更新の統計情報
+  OtaStats _stats = {};
+
+  ErrorCode _error = ERR_NONE;
+
+private:
+  // ストリームから len バイト読む (圧縮した差分形式なら展開したデータを読む)
+  bool _read(uint8_t* buf, size_t len);
+
+  // ストリームから展開前のデータを len バイト読む
+  bool _readRaw(uint8_t* buf, size_t len);
+
+  // 展開を開始する (作業領域を確保する)
+  bool _beginInflate();
+
+  // 展開を終了する (作業領域を解放する)
+  void _endInflate();
+
+  // 次のデータを展開する
+  bool _inflate();
+
+  // ストリームから 32 ビット値 (LE) を読む
+  bool _readU32(uint32_t& v);
+
+  // パーティションに書き込んで SHA-256 を更新する
+  bool _write(const uint8_t* data, size_t len);
+
+  // 差分形式を適用する (マジックナンバーは読み込み済み)
+  // - 書き込み後のイメージの SHA-256 が pinned と異なれば書き込まずに失敗する
+  bool _applyDelta(const uint8_t pinned[32]);
+
+  // 通常のイメージを書き込む (先頭の head バイトは読み込み済み)
+  // - size はイメージ全体のサイズ (不明なら負の値)
+  bool _applyFull(const uint8_t* head, size_t headLen, int size);
+
+  // 16 進数の文字列を 32 バイトに変換 (不正なら false)
+  static bool _parseHash(const char* hex, uint8_t hash[32]);
+
+public:
+  // エラーコードを取得
+  ErrorCode getError();
+
+  // 起動時の処理 (前回の更新の統計情報を読み込む)
+  void init();
+
+  // 更新する (Wi-Fi 接続済みで呼ぶ)
+  // - sha256 は書き込み後のイメージの SHA-256 (16 進数 64 文字)。
+  //   なければ何もダウンロードせずに失敗する
+  // - 成功したら次回起動時に新しいイメージから起動する (再起動は呼び出し側で行う)
+  bool update(const char* url, const char* sha256);
+
+  // 直近の更新の統計情報を取得
+  const OtaStats& getStats() const;
+
+  // 実行中のイメージが動作確認待ちかどうか
+  bool isPendingVerify();
+
+  // ロールバックされたかどうか
+  // - ロールバックされたパーティションごとに 1 回だけ true を返す (NVS に記録する)
+  // - 次に更新すると記録を消す (同じパーティションへの更新が再びロールバックされても報告する)
+  bool wasRolledBack();
+
+  // 動作確認の結果を反映する
+  // - ok なら実行中のイメージを確定して true を返す (確定できなければ false)
+  // - ok でなければロールバックして再起動する (戻らない)
+  // - 動作確認待ちでなければ何もせずに false を返す
+  bool confirm(bool ok);
+
+  // 動作確認待ちのまま所定の時間が過ぎていたらロールバックして再起動する
+  void checkVerifyTimeout();
+};
+
+#endif
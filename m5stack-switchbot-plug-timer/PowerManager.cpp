@@ -0,0 +1,207 @@
+/* ----------------------------------------------------------------
+  PowerManager.cpp
+  - AXP192 からバッテリーと VBUS (USB 給電) の電圧・電流を計測する
+  - 画面の状態 (通常・減光・消灯) と BLE/Wi-Fi 通信中かどうかに応じて
+    CPU の動作周波数を切り替え、状態ごとの消費電流を集計する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "PowerManager.h"
+
+// ---------------------------------------------------------------
+// 電源の状態の名前を取得
+// ---------------------------------------------------------------
+const char* powerModeToString(PowerMode mode) {
+  switch (mode) {
+    case POWER_ACTIVE: return "ACTIVE";
+    case POWER_DIM: return "DIM";
+    case POWER_OFF: return "OFF";
+    case POWER_BUSY: return "BUSY";
+    case POWER_MODE_NUM: break;
+  }
+  return "UNKNOWN";
+}
+
+// ===============================================================
+// PowerManager クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// 開始する
+// ---------------------------------------------------------------
+void PowerManager::begin() {
+  this->_started = true;
+  this->_applyCpuFrequency();
+
+  // loop() と同じコアで、loop() と同じ優先度で動かす
+  // - 通信中は loop() が BLE や Wi-Fi の応答を待っているので、その間に計測できる
+  if (this->_task == nullptr) {
+    xTaskCreatePinnedToCore(_taskMain, "power", 4096, this, 1, &this->_task, 1);
+  }
+}
+
+// ---------------------------------------------------------------
+// 画面の状態をセット
+// ---------------------------------------------------------------
+void PowerManager::setScreenMode(PowerMode mode) {
+  this->_screenMode = mode;
+}
+
+// ---------------------------------------------------------------
+// 画面の状態を取得
+// ---------------------------------------------------------------
+PowerMode PowerManager::getScreenMode() const {
+  return this->_screenMode;
+}
+
+// ---------------------------------------------------------------
+// BLE/Wi-Fi 通信の開始
+// ---------------------------------------------------------------
+void PowerManager::beginBusy() {
+  this->_busy++;
+  if (this->_busy == 1) {
+    this->_applyCpuFrequency();
+    if (this->_started) {
+      this->_measure();
+      if (this->_task != nullptr) {
+        this->_busyTicker.attach_ms(this->_SAMPLE_INTERVAL, _onBusyTick, this);
+      }
+    }
+  }
+}
+
+// ---------------------------------------------------------------
+// BLE/Wi-Fi 通信の終了
+// ---------------------------------------------------------------
+void PowerManager::endBusy() {
+  if (this->_busy == 0) {
+    return;
+  }
+  if (this->_busy == 1) {
+    this->_busyTicker.detach();
+  }
+  this->_busy--;
+  if (this->_busy == 0) {
+    this->_applyCpuFrequency();
+  }
+}
+
+// 通信中のサンプリング間隔ごとに呼ばれる
+// - 計測は計測のタスクに任せる
+void PowerManager::_onBusyTick(PowerManager* pm) {
+  xTaskNotifyGive(pm->_task);
+}
+
+// 通信中の計測のタスク
+// - 通知を待っている間に通信が終わっていれば計測しない
+void PowerManager::_taskMain(void* arg) {
+  PowerManager* self = (PowerManager*)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (self->_busy > 0) {
+      self->_measure(true);
+    }
+  }
+}
+
+// 現在の状態に応じて CPU の動作周波数を切り替える
+// - 開始前 (起動処理中) は最高速のまま
+void PowerManager::_applyCpuFrequency() {
+  uint32_t mhz = (this->_busy > 0 || !this->_started) ? this->_CPU_MHZ_BUSY : this->_CPU_MHZ_IDLE;
+  if (getCpuFrequencyMhz() != mhz) {
+    setCpuFrequencyMhz(mhz);
+  }
+}
+
+// ---------------------------------------------------------------
+// 統計情報を更新する
+// ---------------------------------------------------------------
+bool PowerManager::sample() {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&this->_mux);
+  bool due = (this->_lastSample == 0 || now - this->_lastSample >= this->_SAMPLE_INTERVAL);
+  if (due) {
+    this->_lastSample = now;
+  }
+  portEXIT_CRITICAL(&this->_mux);
+
+  if (!due) {
+    return false;
+  }
+  this->_measure();
+  return true;
+}
+
+// AXP192 から計測して現在の状態の統計情報に加える
+// - I2C の読み取りは排他の外で行い (割り込みを止めている間は待てない)、統計情報の更新だけを排他する
+// - loop() の sample() と重ならないように最後にサンプリングした時刻も進める
+void PowerManager::_measure(bool busyOnly) {
+  float batVoltage = M5.Axp.GetBatVoltage();
+  float batCurrent = M5.Axp.GetBatCurrent();
+  float vbusVoltage = M5.Axp.GetVBusVoltage();
+  float vbusCurrent = M5.Axp.GetVBusCurrent();
+  uint32_t cpuMhz = getCpuFrequencyMhz();
+
+  portENTER_CRITICAL(&this->_mux);
+  if (busyOnly && this->_busy == 0) {
+    portEXIT_CRITICAL(&this->_mux);
+    return;
+  }
+  this->_lastSample = millis();
+
+  PowerStats& s = this->_stats;
+  s.batVoltage = batVoltage;
+  s.batCurrent = batCurrent;
+  s.vbusVoltage = vbusVoltage;
+  s.vbusCurrent = vbusCurrent;
+  s.loadCurrent = s.vbusCurrent - s.batCurrent;
+  s.cpuMhz = cpuMhz;
+  s.mode = (this->_busy > 0) ? POWER_BUSY : this->_screenMode;
+
+  // 状態ごとに集計する (平均は逐次更新)
+  PowerModeStats& m = s.modes[s.mode];
+  m.samples++;
+  if (m.samples == 1) {
+    m.avgMa = m.minMa = m.maxMa = s.loadCurrent;
+  } else {
+    m.avgMa += (s.loadCurrent - m.avgMa) / m.samples;
+    if (s.loadCurrent < m.minMa) {
+      m.minMa = s.loadCurrent;
+    }
+    if (s.loadCurrent > m.maxMa) {
+      m.maxMa = s.loadCurrent;
+    }
+  }
+  portEXIT_CRITICAL(&this->_mux);
+}
+
+// ---------------------------------------------------------------
+// 最新の統計情報を取得
+// ---------------------------------------------------------------
+PowerStats PowerManager::getStats() const {
+  portENTER_CRITICAL(&this->_mux);
+  PowerStats s = this->_stats;
+  portEXIT_CRITICAL(&this->_mux);
+  return s;
+}
+
+// ---------------------------------------------------------------
+// タイマーでディープスリープから起きたかどうか
+// ---------------------------------------------------------------
+bool PowerManager::wokeByTimer() const {
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+// ---------------------------------------------------------------
+// 指定の秒数だけディープスリープする
+// - タッチパネルの割り込み (GPIO39) でも起こす (画面下のボタンもタッチパネル)
+// ---------------------------------------------------------------
+void PowerManager::deepSleep(uint32_t seconds) {
+  esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL);
+  esp_sleep_enable_ext0_wakeup(GPIO_NUM_39, 0);
+  esp_deep_sleep_start();
+}
@@ -0,0 +1,156 @@
+/* ----------------------------------------------------------------
+  PowerManager.h
+  - AXP192 からバッテリーと VBUS (USB 給電) の電圧・電流を計測する
+  - 画面の状態 (通常・減光・消灯) と BLE/Wi-Fi 通信中かどうかに応じて
+    CPU の動作周波数を切り替え、状態ごとの消費電流を集計する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef PowerManager_h
+#define PowerManager_h
+#include <Arduino.h>
+#include <M5Core2.h>
+#include <Ticker.h>
+#include <esp_sleep.h>
+
+// 電源の状態
+enum PowerMode : uint8_t {
+  POWER_ACTIVE = 0,  // 画面点灯 (操作中)
+  POWER_DIM,         // 画面減光 (しばらく操作がない)
+  POWER_OFF,         // 画面消灯 (LCD 省電力モード)
+  POWER_BUSY,        // BLE/Wi-Fi 通信中 (CPU を最高速で動作)
+  POWER_MODE_NUM
+};
+
+// 電源の状態の名前を取得
+const char* powerModeToString(PowerMode mode);
+
+// 電源の状態ごとの消費電流の統計情報の構造体
+struct PowerModeStats {
+  uint32_t samples;  // 計測回数
+  float avgMa;       // 平均 (mA)
+  float minMa;       // 最小 (mA)
+  float maxMa;       // 最大 (mA)
+};
+
+// 電源の統計情報の構造体
+struct PowerStats {
+  float batVoltage;   // バッテリー電圧 (V)
+  float batCurrent;   // バッテリー電流 (mA, 充電なら正, 放電なら負)
+  float vbusVoltage;  // VBUS 電圧 (V)
+  float vbusCurrent;  // VBUS 電流 (mA)
+  float loadCurrent;  // 本体の消費電流 (mA, VBUS 電流 - バッテリー電流)
+  uint32_t cpuMhz;    // CPU の動作周波数 (MHz)
+  PowerMode mode;     // 現在の状態
+  PowerModeStats modes[POWER_MODE_NUM];
+};
+
+// ---------------------------------------------------------------
+// PowerManager クラス
+// ---------------------------------------------------------------
+class PowerManager {
+private:
+  // サンプリング間隔 (ミリ秒)
+  const uint32_t _SAMPLE_INTERVAL = 1000;
+
+  // CPU の動作周波数 (MHz)
+  // - Wi-Fi と BLE は 80MHz 以上でないと動作しない
+  const uint32_t _CPU_MHZ_IDLE = 80;
+  const uint32_t _CPU_MHZ_BUSY = 240;
+
+  // 最後にサンプリングした時刻 (ミリ秒)
+  uint32_t _lastSample = 0;
+
+  // 画面の状態 (POWER_ACTIVE / POWER_DIM / POWER_OFF)
+  PowerMode _screenMode = POWER_ACTIVE;
+
+  // 通信中の処理の数 (入れ子に対応, loop() のタスクだけが変える)
+  volatile uint8_t _busy = 0;
+
+  // 通信中に計測するタイマーとタスク
+  // - 通信中は loop() が止まって sample() が呼ばれないので、別のタスクから計測する
+  // - タイマー (esp_timer のタスク) は計測のタスクに通知するだけにする
+  //   (I2C の読み取りで他のタイマーの処理を遅らせないように)
+  // - AXP192 の I2C (Wire1) はタスク間で排他される
+  Ticker _busyTicker;
+  TaskHandle_t _task = nullptr;
+
+  bool _started = false;
+
+  // 最新の統計情報と最後にサンプリングした時刻の排他 (loop() と計測のタスク)
+  mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+  // 最新の統計情報
+  PowerStats _stats = {};
+
+private:
+  // 現在の状態に応じて CPU の動作周波数を切り替える
+  void _applyCpuFrequency();
+
+  // AXP192 から計測して現在の状態の統計情報に加える
+  // - busyOnly なら、計測を終えたときに通信中でなくなっていれば加えない
+  void _measure(bool busyOnly = false);
+
+  // 通信中のサンプリング間隔ごとに呼ばれる (タイマーのタスク)
+  static void _onBusyTick(PowerManager* pm);
+
+  // 通信中の計測のタスク
+  static void _taskMain(void* arg);
+
+public:
+  // 開始する (以降は通信中以外は低速で動作する)
+  // - 通信中の計測のタスクを開始する
+  void begin();
+
+  // 画面の状態をセット
+  void setScreenMode(PowerMode mode);
+
+  // 画面の状態を取得
+  PowerMode getScreenMode() const;
+
+  // BLE/Wi-Fi 通信の開始 (CPU を最高速にする)
+  // - 開始時に計測し、終了するまでサンプリング間隔ごとに通信中として計測する
+  void beginBusy();
+
+  // BLE/Wi-Fi 通信の終了
+  // - 通信が終わった後の電流は通信中に含めないので、ここでは計測しない
+  void endBusy();
+
+  // 統計情報を更新する
+  // - 所定のサンプリング間隔が経過していなければ何もしない
+  // - 更新した場合は true を返す
+  bool sample();
+
+  // 最新の統計情報を取得 (計測のタスクと重ならないように複製を返す)
+  PowerStats getStats() const;
+
+  // タイマーでディープスリープから起きたかどうか (画面に触れて起きた場合は false)
+  bool wokeByTimer() const;
+
+  // 指定の秒数だけディープスリープする (戻らない)
+  // - 時間が過ぎるか画面に触れると起動し直す (RAM の内容は失われる)
+  void deepSleep(uint32_t seconds);
+};
+
+// ---------------------------------------------------------------
+// PowerBusyScope クラス
+// - スコープの間だけ BLE/Wi-Fi 通信中として CPU を最高速にする
+// ---------------------------------------------------------------
+class PowerBusyScope {
+private:
+  PowerManager& _pm;
+
+public:
+  PowerBusyScope(PowerManager& pm) : _pm(pm) {
+    this->_pm.beginBusy();
+  }
+  ~PowerBusyScope() {
+    this->_pm.endBusy();
+  }
+};
+
+#endif
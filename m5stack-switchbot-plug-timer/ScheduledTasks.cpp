@@ -0,0 +1,280 @@
+/* ----------------------------------------------------------------
+  ScheduledTasks.cpp
+  - loop() から毎回呼ぶ、時刻で実施する処理 (OFF/ON タイマー、委任の確認、NTP 時刻同期)
+  - 画面表示・ログ・CPU の速度の切り替えは TaskListener でスケッチに任せる
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "ScheduledTasks.h"
+
+// ===============================================================
+// ScheduledTasks クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+ScheduledTasks::ScheduledTasks(SwitchBotPlugMini& plug, TimerOffload& offload, TimeManager& time, TaskListener& listener)
+  : _plug(plug), _offload(offload), _time(time), _listener(listener) {
+}
+
+// ---------------------------------------------------------------
+// OFF/ON タイマーの時刻と待ち時間をセット
+// ---------------------------------------------------------------
+void ScheduledTasks::setTimer(uint32_t timerTime, uint16_t intervalMs) {
+  this->_timerTime = timerTime;
+  this->_timerInterval = intervalMs;
+  this->_timerSchedule.setTime(timerTime);
+}
+
+// ---------------------------------------------------------------
+// NTP 時刻同期の時刻をセット
+// ---------------------------------------------------------------
+void ScheduledTasks::setNtpTime(uint32_t ntpTime) {
+  this->_ntpSchedule.setTime(ntpTime);
+}
+
+// ---------------------------------------------------------------
+// プラグ本体のタイマーに委任するかどうかをセット
+// ---------------------------------------------------------------
+void ScheduledTasks::setOffloadEnabled(bool enabled) {
+  this->_offloadEnabled = enabled;
+}
+
+// ---------------------------------------------------------------
+// OFF/ON タイマーが有効かどうか
+// ---------------------------------------------------------------
+bool ScheduledTasks::isTimerEnabled() const {
+  return this->_timerSchedule.isEnabled();
+}
+
+// ---------------------------------------------------------------
+// OFF/ON タイマーをプラグ本体のタイマーに同期する
+// - 委任できたら、OFF/ON の代わりに OFF と ON を確認する時刻をスケジュールにセットする
+// - 委任できなければ本体が OFF/ON を実施する
+//   (OFF を確認した後なら、ON の確認はそのまま残す)
+// - 委任しない設定なら、以前に書き込んだタイマーを空にする
+// ---------------------------------------------------------------
+void ScheduledTasks::syncOffload() {
+  if (!this->_offloadEnabled) {
+    if (!this->_offload.clear()) {
+      this->_listener.onError(this->_offload.getError());
+    }
+    return;
+  }
+  uint32_t writes = this->_offload.getStats().writes;
+  bool wasDisabled = (this->_offload.getStats().state == OFFLOAD_DISABLED);
+
+  if (this->_offload.sync(this->_timerTime, this->_timerInterval, this->_time.getRtcEpoch())) {
+    this->_timerSchedule.setTime(this->_offload.getVerifyTime());
+    this->_onSchedule.setTime(this->_offload.getOnVerifyTime());
+    if (this->_offload.getStats().writes != writes) {
+      this->_listener.onLog(LOG_TIMER_OFFLOADED);
+    }
+    return;
+  }
+
+  this->_timerSchedule.setTime(this->_timerTime);
+  if (!this->_onPending) {
+    this->_onSchedule.setTime(DailySchedule::SECONDS_PER_DAY);
+  }
+  if (this->_offload.getError() != ERR_NONE) {
+    this->_listener.onError(this->_offload.getError());
+  }
+  if (!wasDisabled && this->_offload.getStats().state == OFFLOAD_DISABLED) {
+    this->_listener.onLog(LOG_TIMER_OFFLOAD_DISABLED);
+  }
+}
+
+// ---------------------------------------------------------------
+// 現在日時を RTC から読んで、時刻になった処理を実施する
+// ---------------------------------------------------------------
+void ScheduledTasks::run() {
+  // 現在日時を RTC から 1 回だけ取得
+  RTC_DateTypeDef rtcdate;
+  RTC_TimeTypeDef rtctime;
+  this->_time.getRtcDateTime(rtcdate, rtctime);
+
+  this->_date = (uint32_t)rtcdate.Year * 10000 + rtcdate.Month * 100 + rtcdate.Date;
+  this->_sec = (uint32_t)rtctime.Hours * 3600 + rtctime.Minutes * 60 + rtctime.Seconds;
+
+  // タイマーによる OFF/ON 実施
+  if (this->_timerSchedule.isDue(this->_date, this->_sec)) {
+    this->_listener.onTaskBegin();
+    this->_timerSchedule.markDone(this->_date);
+
+    if (this->_offload.isActive()) {
+      // プラグ本体のタイマーが OFF にしたはずなので確認する (ON は後で確認する)
+      this->_offOk = this->_verifyOff();
+      this->_onPending = true;
+    } else {
+      bool offOk = true;
+      bool onOk = this->_runTimer(offOk);
+      this->_listener.onTimerResult(offOk && onOk);
+    }
+
+    this->_listener.onTaskEnd();
+  }
+
+  // 委任中の ON の確認
+  if (this->_onSchedule.isDue(this->_date, this->_sec)) {
+    this->_listener.onTaskBegin();
+    this->_onSchedule.markDone(this->_date);
+
+    bool onOk = this->_verifyOn();
+    this->_listener.onTimerResult(this->_offOk && onOk);
+    this->_onPending = false;
+    this->_offOk = true;
+
+    this->_listener.onTaskEnd();
+  }
+
+  // NTP 時刻同期
+  if (this->_ntpSchedule.isDue(this->_date, this->_sec)) {
+    this->_listener.onTaskBegin();
+
+    // 時刻が変わる前に実施済みにしておく
+    this->_ntpSchedule.markDone(this->_date);
+    this->_syncTime();
+
+    this->_listener.onTaskEnd();
+  }
+}
+
+// ---------------------------------------------------------------
+// 最後に run() で読んだ日付と 0 時からの秒数
+// ---------------------------------------------------------------
+uint32_t ScheduledTasks::getDate() const {
+  return this->_date;
+}
+
+uint32_t ScheduledTasks::getSecOfDay() const {
+  return this->_sec;
+}
+
+// ---------------------------------------------------------------
+// 本体が OFF/ON を実施する
+// - offOk には OFF できたかどうかを返し、ON できたら true を返す
+// ---------------------------------------------------------------
+bool ScheduledTasks::_runTimer(bool& offOk) {
+  // デバイスを OFF する
+  this->_listener.onMessage("TIMER: Turning off...");
+  offOk = this->_plug.setPowerStatus(false);
+  if (offOk) {
+    this->_listener.onPowerStatus(false);
+    this->_listener.onLog(LOG_TIMER_TURNED_OFF);
+  } else {
+    this->_listener.onError(this->_plug.getError());
+  }
+
+  // 少し待つ
+  this->_listener.onMessage("TIMER: Waiting...");
+  delay(this->_timerInterval);
+
+  // デバイスを ON する
+  this->_listener.onMessage("TIMER: Turning on...");
+  bool onOk = this->_plug.setPowerStatus(true);
+  if (onOk) {
+    this->_listener.onPowerStatus(true);
+    this->_listener.onLog(LOG_TIMER_TURNED_ON);
+  } else {
+    this->_listener.onError(this->_plug.getError());
+  }
+
+  // 同期に失敗してプラグに書きかけのタイマーが残っていれば、空にし直す
+  if (this->_offload.isWritten()) {
+    this->syncOffload();
+  }
+  return onOk;
+}
+
+// ---------------------------------------------------------------
+// プラグ本体のタイマーによる OFF の実施を電源状態で確認する
+// - OFF の間 (OFF の 30 秒後) に OFF になっていることを確認する
+//   (ON の後だけでは、OFF が実施されなくても ON のままなので区別できない)
+// - OFF になっていなければ本体が OFF にする (ON は後の確認で ON にする)
+// - loop() が止まっていて ON の時刻が近ければ、OFF の間ではないので確認しない
+//   (ON になったプラグを OFF と取り違えて OFF にしないように)
+// - OFF になったかどうか (確認しなかったら true) を返す
+// ---------------------------------------------------------------
+bool ScheduledTasks::_verifyOff() {
+  const uint32_t day = DailySchedule::SECONDS_PER_DAY;
+  uint32_t verifyTime = this->_offload.getVerifyTime();
+  uint32_t elapsed = (this->_sec + day - verifyTime) % day;
+  uint32_t window = (this->_offload.getOnTime() + day - verifyTime) % day;
+  if (elapsed + this->_OFF_VERIFY_MARGIN >= window) {
+    this->_listener.onMessage("TIMER: Too late to verify off");
+    return true;
+  }
+
+  this->_listener.onMessage("TIMER: Verifying off...");
+  bool status = true;
+  if (this->_plug.getPowerStatus(status) && !status) {
+    this->_offload.recordVerify(true);
+    this->_listener.onPowerStatus(false);
+    this->_listener.onLog(LOG_TIMER_OFF_VERIFIED);
+    return true;
+  }
+
+  this->_offload.recordVerify(false);
+  ErrorCode err = this->_plug.getError();
+  this->_listener.onError((err != ERR_NONE) ? err : ERR_TIMER_NOT_EXECUTED);
+
+  this->_listener.onMessage("TIMER: Turning off...");
+  if (!this->_plug.setPowerStatus(false)) {
+    this->_listener.onError(this->_plug.getError());
+    return false;
+  }
+  this->_listener.onPowerStatus(false);
+  this->_listener.onLog(LOG_TIMER_TURNED_OFF);
+  return true;
+}
+
+// ---------------------------------------------------------------
+// プラグ本体のタイマーによる ON の実施を電源状態で確認する
+// - ON の 60 秒後に ON になっていなければ本体が ON にする
+// - 最終的に ON になっていれば true を返す
+// ---------------------------------------------------------------
+bool ScheduledTasks::_verifyOn() {
+  this->_listener.onMessage("TIMER: Verifying on...");
+  bool status = false;
+  if (this->_plug.getPowerStatus(status) && status) {
+    this->_offload.recordVerify(true);
+    this->_listener.onPowerStatus(true);
+    this->_listener.onLog(LOG_TIMER_VERIFIED);
+    return true;
+  }
+
+  this->_offload.recordVerify(false);
+  ErrorCode err = this->_plug.getError();
+  this->_listener.onError((err != ERR_NONE) ? err : ERR_TIMER_NOT_EXECUTED);
+
+  this->_listener.onMessage("TIMER: Turning on...");
+  if (!this->_plug.setPowerStatus(true)) {
+    this->_listener.onError(this->_plug.getError());
+    return false;
+  }
+  this->_listener.onPowerStatus(true);
+  this->_listener.onLog(LOG_TIMER_TURNED_ON);
+  return true;
+}
+
+// ---------------------------------------------------------------
+// NTP 時刻同期
+// - 同期できたら、プラグ本体の時計も合わせる
+// ---------------------------------------------------------------
+void ScheduledTasks::_syncTime() {
+  this->_listener.onMessage("Syncing time using NTP...");
+  if (!this->_time.sync()) {
+    this->_listener.onError(this->_time.getError());
+    return;
+  }
+  this->_listener.onLog(LOG_NTP_TIME_SYNCHRONIZED);
+
+  this->_listener.onMessage("Syncing plug timer...");
+  this->syncOffload();
+}
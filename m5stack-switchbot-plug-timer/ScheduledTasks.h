@@ -0,0 +1,122 @@
+/* ----------------------------------------------------------------
+  ScheduledTasks.h
+  - loop() から毎回呼ぶ、時刻で実施する処理 (OFF/ON タイマー、委任の確認、NTP 時刻同期)
+  - 画面表示・ログ・CPU の速度の切り替えは TaskListener でスケッチに任せる
+    (ホストのテストでも同じ処理を動かせるようにするため)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef ScheduledTasks_h
+#define ScheduledTasks_h
+#include <Arduino.h>
+#include "ErrorCode.h"
+#include "LogStore.h"
+#include "DailySchedule.h"
+#include "SwitchBotPlugMini.h"
+#include "TimeManager.h"
+#include "TimerOffload.h"
+
+// ---------------------------------------------------------------
+// TaskListener クラス (処理の経過を受け取る)
+// ---------------------------------------------------------------
+class TaskListener {
+public:
+  virtual ~TaskListener() {}
+
+  // 処理の開始と終了 (画面の復帰・消灯、ボタン表示、CPU の速度の切り替え)
+  virtual void onTaskBegin() = 0;
+  virtual void onTaskEnd() = 0;
+
+  // 処理中のメッセージ
+  virtual void onMessage(const char* message) = 0;
+
+  // 電源状態を取得またはセットできた
+  virtual void onPowerStatus(bool status) = 0;
+
+  // イベントとエラーのログ
+  virtual void onLog(LogEvent event) = 0;
+  virtual void onError(ErrorCode code) = 0;
+
+  // OFF/ON (委任中は ON の確認) を終えた (OFF と ON が両方できたら ok が true)
+  virtual void onTimerResult(bool ok) = 0;
+};
+
+// ---------------------------------------------------------------
+// ScheduledTasks クラス
+// ---------------------------------------------------------------
+class ScheduledTasks {
+private:
+  SwitchBotPlugMini& _plug;
+  TimerOffload& _offload;
+  TimeManager& _time;
+  TaskListener& _listener;
+
+  // OFF/ON タイマーの設定 (時刻は 0 時からの秒数, SECONDS_PER_DAY なら無効)
+  uint32_t _timerTime = DailySchedule::SECONDS_PER_DAY;
+  uint16_t _timerInterval = 0;
+
+  // プラグ本体のタイマーに委任するかどうか
+  bool _offloadEnabled = false;
+
+  // OFF の確認を ON の時刻の何秒前までに始めるか (BLE の接続と応答にかかる時間)
+  const uint32_t _OFF_VERIFY_MARGIN = 10;
+
+  // OFF/ON タイマー (委任中は OFF の確認)、委任中の ON の確認、NTP 時刻同期の実施判定
+  // - 委任中は OFF と ON の確認を別々の時刻に実施する (間で loop() を止めないように)
+  DailySchedule _timerSchedule;
+  DailySchedule _onSchedule;
+  DailySchedule _ntpSchedule;
+
+  // OFF を確認してから ON の確認を待っているかどうかと、OFF の確認の結果
+  bool _onPending = false;
+  bool _offOk = true;
+
+  // 最後に run() で RTC から読んだ日付 (YYYYMMDD) と 0 時からの秒数
+  uint32_t _date = 0;
+  uint32_t _sec = 0;
+
+private:
+  // 本体が OFF/ON を実施する
+  bool _runTimer(bool& offOk);
+
+  // プラグ本体のタイマーによる OFF と ON の実施を電源状態で確認する
+  bool _verifyOff();
+  bool _verifyOn();
+
+  // NTP 時刻同期
+  void _syncTime();
+
+public:
+  // コンストラクタ
+  ScheduledTasks(SwitchBotPlugMini& plug, TimerOffload& offload, TimeManager& time, TaskListener& listener);
+
+  // OFF/ON タイマーの時刻 (0 時からの秒数) と OFF から ON までの待ち時間 (ミリ秒) をセット
+  // - 委任している場合は、続けて syncOffload() を呼ぶ
+  void setTimer(uint32_t timerTime, uint16_t intervalMs);
+
+  // NTP 時刻同期の時刻をセット (0 時からの秒数)
+  void setNtpTime(uint32_t ntpTime);
+
+  // プラグ本体のタイマーに委任するかどうかをセット
+  void setOffloadEnabled(bool enabled);
+
+  // OFF/ON タイマーが有効かどうか
+  bool isTimerEnabled() const;
+
+  // OFF/ON タイマーをプラグ本体のタイマーに同期する (違うものだけを書き込む)
+  // - 委任できたら、OFF/ON の代わりに OFF と ON を確認する時刻をスケジュールにセットする
+  void syncOffload();
+
+  // 現在日時を RTC から読んで、時刻になった処理を実施する (loop() から毎回呼ぶ)
+  void run();
+
+  // 最後に run() で読んだ日付 (YYYYMMDD) と 0 時からの秒数
+  uint32_t getDate() const;
+  uint32_t getSecOfDay() const;
+};
+
+#endif
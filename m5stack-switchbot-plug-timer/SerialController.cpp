@@ -0,0 +1,235 @@
+/* ----------------------------------------------------------------
+  SerialController.cpp
+  - USB シリアル経由のバイナリ制御プロトコル (COBS + CRC-16) を処理する
+
+  フレームの形式 (COBS デコード後):
+    [種類 1][シーケンス番号 1][本体 ...][CRC-16 2 (LE)]
+  フレームは COBS でエンコードし 0x00 で区切る
+
+  要求の本体: [コマンド 1][引数長 1][引数 ...] の繰り返し (一括要求)
+  応答の本体: [コマンド 1][ステータス 1][データ長 1][データ ...] の繰り返し
+  イベントの本体: [イベント 1][データ長 1][データ ...]
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "SerialController.h"
+
+// ===============================================================
+// SerialController クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+SerialController::SerialController(Stream& stream) {
+  this->_stream = &stream;
+}
+
+// ---------------------------------------------------------------
+// コマンドの処理関数をセット
+// ---------------------------------------------------------------
+void SerialController::setHandler(SerialCommandHandler handler) {
+  this->_handler = handler;
+}
+
+// ---------------------------------------------------------------
+// 受信したフレームを処理する
+// - 先に受信済みのバイト列をすべてフレームに分割してから、古い順に処理する
+// - ホストは応答を待たずに複数の要求を送ってよい (シーケンス番号で対応付ける)
+// ---------------------------------------------------------------
+void SerialController::handle() {
+  this->_read();
+
+  while (this->_pendingCount > 0) {
+    size_t i = this->_pendingHead;
+    this->_process(this->_pending[i], this->_pendingLen[i]);
+    this->_pendingHead = (this->_pendingHead + 1) % _PENDING_MAX;
+    this->_pendingCount--;
+
+    // 処理中 (BLE 通信中など) に届いた分も取り込む
+    this->_read();
+  }
+}
+
+// 受信したバイト列を読み取ってフレームに分割する
+void SerialController::_read() {
+  while (this->_stream->available() > 0) {
+    int c = this->_stream->read();
+    if (c < 0) {
+      break;
+    }
+
+    if (c != 0x00) {
+      if (this->_rxLen < sizeof(this->_rx)) {
+        this->_rx[this->_rxLen++] = (uint8_t)c;
+      } else {
+        this->_rxOverflow = true;
+      }
+      continue;
+    }
+
+    // 区切り (0x00) を受信したのでフレームを確定する
+    if (this->_rxLen > 0) {
+      if (this->_rxOverflow || this->_pendingCount >= _PENDING_MAX || this->_rxLen > _FRAME_MAX + 1) {
+        this->_dropped++;
+      } else {
+        size_t slot = (this->_pendingHead + this->_pendingCount) % _PENDING_MAX;
+        size_t len = cobsDecode(this->_rx, this->_rxLen, this->_pending[slot]);
+
+        // 種類, シーケンス番号, CRC を含むので最低 4 バイト
+        if (len >= 4 && crc16(this->_pending[slot], len - 2) == (uint16_t)(this->_pending[slot][len - 2] | (this->_pending[slot][len - 1] << 8))) {
+          this->_pendingLen[slot] = len - 2;
+          this->_pendingCount++;
+        } else {
+          this->_dropped++;
+        }
+      }
+    }
+
+    this->_rxLen = 0;
+    this->_rxOverflow = false;
+  }
+}
+
+// 要求フレームを処理して応答を送信する
+void SerialController::_process(const uint8_t* frame, size_t len) {
+  if (frame[0] != SERIAL_FRAME_REQUEST) {
+    this->_dropped++;
+    return;
+  }
+
+  this->_frame[0] = SERIAL_FRAME_RESPONSE;
+  this->_frame[1] = frame[1];
+  size_t olen = 2;
+
+  // 応答の CRC の 2 バイト分を残す
+  const size_t omax = _FRAME_MAX - 2;
+
+  size_t pos = 2;
+  while (pos + 2 <= len) {
+    uint8_t cmd = frame[pos];
+    uint8_t alen = frame[pos + 1];
+    const uint8_t* args = frame + pos + 2;
+
+    if (pos + 2 + alen > len || olen + 3 > omax) {
+      break;
+    }
+    pos += 2 + alen;
+
+    uint8_t dlen = 0;
+    uint8_t status = SERIAL_STATUS_UNKNOWN_CMD;
+    if (this->_handler != nullptr) {
+      status = this->_handler(cmd, args, alen, this->_frame + olen + 3, omax - olen - 3, dlen);
+    }
+
+    this->_frame[olen] = cmd;
+    this->_frame[olen + 1] = status;
+    this->_frame[olen + 2] = dlen;
+    olen += 3 + dlen;
+  }
+
+  this->_send(this->_frame, olen);
+}
+
+// フレームに CRC を付けて COBS エンコードして送信する
+void SerialController::_send(uint8_t* frame, size_t len) {
+  uint16_t crc = crc16(frame, len);
+  frame[len++] = crc & 0xff;
+  frame[len++] = crc >> 8;
+
+  size_t tlen = cobsEncode(frame, len, this->_tx);
+  this->_tx[tlen++] = 0x00;
+  this->_stream->write(this->_tx, tlen);
+}
+
+// ---------------------------------------------------------------
+// イベントを通知する
+// ---------------------------------------------------------------
+void SerialController::sendEvent(uint8_t evt, const uint8_t* data, uint8_t len) {
+  if (len > _FRAME_MAX - 8) {
+    return;
+  }
+
+  this->_evtFrame[0] = SERIAL_FRAME_EVENT;
+  this->_evtFrame[1] = 0;
+  this->_evtFrame[2] = evt;
+  this->_evtFrame[3] = len;
+  memcpy(this->_evtFrame + 4, data, len);
+  this->_send(this->_evtFrame, 4 + len);
+}
+
+// ---------------------------------------------------------------
+// 捨てたフレーム数
+// ---------------------------------------------------------------
+uint32_t SerialController::getDropped() const {
+  return this->_dropped;
+}
+
+// ---------------------------------------------------------------
+// CRC-16/CCITT-FALSE を計算
+// ---------------------------------------------------------------
+uint16_t SerialController::crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xffff;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+// ---------------------------------------------------------------
+// COBS エンコード
+// ---------------------------------------------------------------
+size_t SerialController::cobsEncode(const uint8_t* src, size_t len, uint8_t* dst) {
+  size_t codePos = 0;
+  size_t out = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    if (src[i] == 0x00) {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    } else {
+      dst[out++] = src[i];
+      code++;
+      if (code == 0xff) {
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codePos] = code;
+
+  return out;
+}
+
+// ---------------------------------------------------------------
+// COBS デコード
+// ---------------------------------------------------------------
+size_t SerialController::cobsDecode(const uint8_t* src, size_t len, uint8_t* dst) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < len) {
+    uint8_t code = src[in++];
+    if (code == 0x00 || in + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      dst[out++] = src[in++];
+    }
+    if (code != 0xff && in < len) {
+      dst[out++] = 0x00;
+    }
+  }
+
+  return out;
+}
@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------
+  SerialController.h
+  - USB シリアル経由のバイナリ制御プロトコル (COBS + CRC-16) を処理する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef SerialController_h
+#define SerialController_h
+#include <Arduino.h>
+
+// フレームの種類
+const uint8_t SERIAL_FRAME_REQUEST = 0x01;   // ホスト -> 本機 (コマンドの一括要求)
+const uint8_t SERIAL_FRAME_EVENT = 0x02;     // 本機 -> ホスト (イベント通知)
+const uint8_t SERIAL_FRAME_RESPONSE = 0x81;  // 本機 -> ホスト (要求に対する応答)
+
+// コマンド
+const uint8_t SERIAL_CMD_STATUS = 0x01;        // 電源状態を取得
+const uint8_t SERIAL_CMD_SET = 0x02;           // 電源状態をセット (引数: 0x00=OFF, 0x01=ON)
+const uint8_t SERIAL_CMD_TOGGLE = 0x03;        // 電源状態を反転
+const uint8_t SERIAL_CMD_DUMP_LOG = 0x04;      // ログを取得 (引数: 開始位置 (2 バイト LE), 件数)
+const uint8_t SERIAL_CMD_DUMP_METRICS = 0x05;  // 診断情報を取得
+const uint8_t SERIAL_CMD_CONFIG = 0x06;        // 設定を反映 (引数: "key=value" の行の並び, 空なら SD カードから読み直す)
+const uint8_t SERIAL_CMD_OTA = 0x07;           // ファームウェアを更新 (引数: URL, 成功すると再起動する)
+
+// イベント
+const uint8_t SERIAL_EVT_POWER = 0x01;  // 電源状態の変化 (データ: 0x00=OFF, 0x01=ON)
+const uint8_t SERIAL_EVT_LOG = 0x02;    // ログの追加 (データ: LogRecord 8 バイト)
+
+// コマンドの結果のステータス
+// - 0x01 から 0x7f は ErrorCode の値
+const uint8_t SERIAL_STATUS_OK = 0x00;
+const uint8_t SERIAL_STATUS_BAD_ARGS = 0xfe;
+const uint8_t SERIAL_STATUS_UNKNOWN_CMD = 0xff;
+
+// コマンドの処理関数
+// - out に最大 outMax バイトの結果データを書き込み、その長さを outLen にセットする
+// - 戻り値はステータス
+typedef uint8_t (*SerialCommandHandler)(uint8_t cmd, const uint8_t* args, uint8_t argLen,
+                                        uint8_t* out, uint8_t outMax, uint8_t& outLen);
+
+// ---------------------------------------------------------------
+// SerialController クラス
+// ---------------------------------------------------------------
+class SerialController {
+private:
+  // フレーム (COBS デコード後) の最大長
+  static const size_t _FRAME_MAX = 250;
+
+  // 受信済みで未処理のフレームを貯められる数 (パイプライン)
+  static const size_t _PENDING_MAX = 4;
+
+  Stream* _stream;
+  SerialCommandHandler _handler = nullptr;
+
+  // 受信中の COBS エンコードされたバイト列
+  uint8_t _rx[_FRAME_MAX + 8];
+  size_t _rxLen = 0;
+  bool _rxOverflow = false;
+
+  // 受信済みで未処理のフレーム (デコード済み)
+  uint8_t _pending[_PENDING_MAX][_FRAME_MAX];
+  size_t _pendingLen[_PENDING_MAX];
+  size_t _pendingHead = 0;
+  size_t _pendingCount = 0;
+
+  // 送信用のバッファ
+  // - 応答を組み立てている途中 (コマンドの処理中) にイベントを通知することが
+  //   あるので、イベントは別のバッファで組み立てる
+  // - 送信 (COBS エンコード) はその場で終わるので _tx は共用する
+  uint8_t _frame[_FRAME_MAX];
+  uint8_t _evtFrame[_FRAME_MAX];
+  uint8_t _tx[_FRAME_MAX + 8];
+
+  // CRC エラーなどで捨てたフレーム数
+  uint32_t _dropped = 0;
+
+private:
+  // 受信したバイト列を読み取ってフレームに分割する
+  void _read();
+
+  // 要求フレームを処理して応答を送信する
+  void _process(const uint8_t* frame, size_t len);
+
+  // フレームに CRC を付けて COBS エンコードして送信する
+  // - frame には CRC の 2 バイト分の余裕が必要
+  void _send(uint8_t* frame, size_t len);
+
+public:
+  // コンストラクタ
+  SerialController(Stream& stream);
+
+  // コマンドの処理関数をセット
+  void setHandler(SerialCommandHandler handler);
+
+  // 受信したフレームを処理する (loop() から呼ぶ)
+  void handle();
+
+  // イベントを通知する
+  // - コマンドの処理関数の中から呼んでもよい (処理中の要求の応答より先に送信される)
+  void sendEvent(uint8_t evt, const uint8_t* data, uint8_t len);
+
+  // 捨てたフレーム数
+  uint32_t getDropped() const;
+
+  // CRC-16/CCITT-FALSE を計算
+  static uint16_t crc16(const uint8_t* data, size_t len);
+
+  // COBS エンコード (戻り値はエンコード後の長さ, 区切りの 0x00 は含まない)
+  static size_t cobsEncode(const uint8_t* src, size_t len, uint8_t* dst);
+
+  // COBS デコード (戻り値はデコード後の長さ, 不正なら 0)
+  static size_t cobsDecode(const uint8_t* src, size_t len, uint8_t* dst);
+};
+
+#endif
@@ -12,16 +12,54 @@
 
 
 // NOTIFY のコールバック関数と関連のグローバル変数
-std::vector<uint8_t> _rdata = {};
-bool _received = false;
-
-static void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-  for (size_t i = 0; i < length; i++) {
-    _rdata.push_back(pData[i]);
+// - 受信バッファは固定長 (ヒープを使わない)
+// - 1 回の NOTIFY は合意した MTU - 3 バイトまでなので、要求する MTU に合わせる
+//   (それでも収まらなければ切り詰めずに _roverflow を立てて不正な応答として扱う)
+static const size_t _RDATA_MAX = BLE_PREFERRED_MTU - 3;
+uint8_t _rdata[_RDATA_MAX];
+volatile size_t _rlen = 0;
+volatile size_t _rmax = 0;
+volatile bool _roverflow = false;
+volatile bool _received = false;
+
+static void notifyCallback(const uint8_t* pData, size_t length) {
+  if (length > _rmax) {
+    _rmax = length;
+  }
+  if (length > _RDATA_MAX - _rlen) {
+    _roverflow = true;
+    length = _RDATA_MAX - _rlen;
   }
+  memcpy(_rdata + _rlen, pData, length);
+  _rlen += length;
   _received = true;
 }
 
+// ---------------------------------------------------------------
+// RSSI の区分の名前を取得
+// ---------------------------------------------------------------
+const char* linkBucketToString(uint8_t bucket) {
+  switch (bucket) {
+    case 0: return ">=-60";
+    case 1: return "-70..-61";
+    case 2: return "-80..-71";
+    case 3: return "<-80";
+  }
+  return "UNKNOWN";
+}
+
+// RSSI の区分を取得
+static uint8_t _rssiToBucket(int rssi) {
+  if (rssi >= -60) {
+    return 0;
+  } else if (rssi >= -70) {
+    return 1;
+  } else if (rssi >= -80) {
+    return 2;
+  }
+  return 3;
+}
+
 // ===============================================================
 // SwitchBotPlugMini クラス
 // ===============================================================
@@ -29,162 +67,239 @@ static void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, ui
 // ---------------------------------------------------------------
 // コンストラクタ
 // ---------------------------------------------------------------
-SwitchBotPlugMini::SwitchBotPlugMini(char* address) {
+SwitchBotPlugMini::SwitchBotPlugMini(const char* address) {
   this->_address = address;  // BLE MAC アドレス
-  this->_pClient = BLEDevice::createClient();
+  this->_transport = createBleTransport();
+  this->_stats.backend = this->_transport->name();
 }
 
 // ---------------------------------------------------------------
-// エラーメッセージを取得
+// 初期化 (BLE スタックの初期化)
 // ---------------------------------------------------------------
-String SwitchBotPlugMini::getError() {
-  return this->_error;
+void SwitchBotPlugMini::init() {
+  // BLE スタックが使うヒープ量を計測する
+  uint32_t before = ESP.getFreeHeap();
+  this->_transport->init();
+  uint32_t after = ESP.getFreeHeap();
+  this->_stats.initHeap = (before > after) ? before - after : 0;
 }
 
 // ---------------------------------------------------------------
-// 指定の BLE MAC アドレスの SwitchBot プラグミニ（JP）を発見する
+// エラーコードを取得
 // ---------------------------------------------------------------
-bool SwitchBotPlugMini::find(BLEAdvertisedDevice& foundDevice) {
-  this->_error = "";
+ErrorCode SwitchBotPlugMini::getError() {
+  return this->_error;
+}
 
-  // BLE スキャンの準備
-  BLEDevice::init("");
-  BLEScan* pBLEScan = BLEDevice::getScan();
-  pBLEScan->setActiveScan(true);
+// ---------------------------------------------------------------
+// BLE 通信の統計情報を取得
+// ---------------------------------------------------------------
+const BleStats& SwitchBotPlugMini::getStats() const {
+  return this->_stats;
+}
 
-  // BLE スキャン開始
-  BLEScanResults foundDevices = pBLEScan->start(this->_BLE_SCAN_DUR, false);
-  int count = foundDevices.getCount();
+// ---------------------------------------------------------------
+// リンク品質の統計情報を取得
+// ---------------------------------------------------------------
+const LinkStats& SwitchBotPlugMini::getLinkStats() const {
+  return this->_link;
+}
 
-  if (count == 0) {
-    this->_error = "DEVICE_NOT_FOUNDE";
-    return false;
+// RSSI のサンプルを記録して移動平均を更新する
+void SwitchBotPlugMini::_addRssi(int rssi) {
+  // 取得できなかった場合は 0 になるので除外する
+  if (rssi >= 0) {
+    return;
+  }
+  this->_rssiSamples++;
+  if (this->_rssiSamples == 1) {
+    this->_rssiAvg = rssi;
+  } else {
+    this->_rssiAvg += (rssi - this->_rssiAvg) / this->_RSSI_EWMA_DIV;
   }
 
-  bool found = false;
-
-  for (int i = 0; i < count; i++) {
-    BLEAdvertisedDevice device = foundDevices.getDevice(i);
-
-    // Manufacturer Data を取得して Company ID をチェック
-    if (device.haveManufacturerData() == false) {
-      continue;
-    }
+  int avg = (int)lroundf(this->_rssiAvg);
+  this->_link.avgRssi = avg;
+  if (avg >= -60) {
+    this->_link.bars = 4;
+  } else if (avg >= -70) {
+    this->_link.bars = 3;
+  } else if (avg >= -80) {
+    this->_link.bars = 2;
+  } else if (avg >= -90) {
+    this->_link.bars = 1;
+  } else {
+    this->_link.bars = 0;
+  }
+}
 
-    std::string mdata = device.getManufacturerData();
+// RSSI の移動平均に応じたスキャンのパラメータを取得
+// - 電波が弱いほどアドバタイズを取りこぼしやすいので、受信の割合を上げて長くスキャンする
+// - 電波が強ければ受信の割合を下げて消費電力を抑える
+BleScanParams SwitchBotPlugMini::_scanParams() {
+  BleScanParams params = { 4, 100, 80 };
+  if (this->_rssiSamples == 0) {
+    return params;
+  }
+  if (this->_rssiAvg >= -70) {
+    params = { 3, 100, 50 };
+  } else if (this->_rssiAvg < -80) {
+    params = { 6, 100, 100 };
+  }
+  return params;
+}
 
-    if (mdata.length() < 2 || mdata[0] != 0x69 || mdata[1] != 0x09) {
-      continue;
-    }
+// ---------------------------------------------------------------
+// 指定の BLE MAC アドレスの SwitchBot プラグミニ（JP）を発見する
+// ---------------------------------------------------------------
+bool SwitchBotPlugMini::find() {
+  this->_error = ERR_NONE;
+  this->_found = false;
 
-    // Service Data を取得して SwitchBot プラグミニ（JP）かどうかをチェック
-    if (device.haveServiceData() == false) {
-      continue;
-    }
+  // BLE スキャン
+  BleScanParams params = this->_scanParams();
+  this->_link.scanSec = params.durationSec;
+  this->_transport->scan(params, _matchPlugMini, this);
 
-    std::string sdata = device.getServiceData();
+  if (this->_found == false) {
+    this->_error = ERR_DEVICE_NOT_FOUND;
+  }
 
-    if (sdata.length() == 0 || sdata[0] != 'j') {
-      continue;
-    }
+  return this->_found;
+}
 
-    // SwitchBot プラグミニ（JP）なら Manufacturer Data は 14 バイトのはず
-    if (mdata.length() != 14) {
-      continue;
-    }
+// スキャンで見つかったデバイスが対象の SwitchBot プラグミニ（JP）かどうかを判定する
+bool SwitchBotPlugMini::_matchPlugMini(const BleAdvInfo& info, void* ctx) {
+  SwitchBotPlugMini* self = (SwitchBotPlugMini*)ctx;
 
-    //Serial.println(device.toString().c_str());
+  // Manufacturer Data の Company ID をチェック
+  if (info.mfrLen < 2 || info.mfrData[0] != 0x69 || info.mfrData[1] != 0x09) {
+    return false;
+  }
 
-    // BLE アドレスを取得
-    BLEAddress addr = device.getAddress();
-    if (addr.toString() == this->_address) {
-      foundDevice = device;
-      found = true;
-      break;
-    }
+  // Service Data で SwitchBot プラグミニ（JP）かどうかをチェック
+  if (info.svcLen == 0 || info.svcData[0] != 'j') {
+    return false;
   }
 
-  pBLEScan->clearResults();
+  // SwitchBot プラグミニ（JP）なら Manufacturer Data は 14 バイトのはず
+  if (info.mfrLen != 14) {
+    return false;
+  }
 
-  if (found == true) {
-    this->_error = "";
-  } else {
-    this->_error = "DEVICE_NOT_FOUNDE";
+  // BLE アドレスをチェック
+  if (strcasecmp(info.address, self->_address) != 0) {
+    return false;
   }
 
-  return found;
+  self->_addressType = info.addressType;
+  self->_link.advRssi = info.rssi;
+  self->_addRssi(info.rssi);
+  self->_found = true;
+  return true;
 }
 
 // ---------------------------------------------------------------
 // SwitchBot プラグミニ（JP）に BLE 接続する
 // ---------------------------------------------------------------
 bool SwitchBotPlugMini::connect() {
-  this->_connected = false;
-  this->_error = "";
-
-  // BLE 接続
-  //this->_pClient = BLEDevice::createClient();
-  BLEAddress bleAddress(this->_address);
-  this->_pClient->connect(bleAddress);
-
-  if (!this->_pClient->isConnected()) {
-    this->_error = "CONNECT_FAILED";
-    return false;
+  uint32_t backoff = 0;
+  uint8_t attempts = this->_connectAttempts(backoff);
+  uint32_t stime = millis();
+
+  for (uint8_t i = 0; i < attempts; i++) {
+    if (i > 0) {
+      // 待ち時間を含めて接続全体の時間の上限を超えるなら再試行しない
+      uint32_t wait = backoff << (i - 1);
+      uint32_t elapsed = millis() - stime;
+      if (elapsed + wait >= this->_CONNECT_BUDGET) {
+        break;
+      }
+      this->_link.retries++;
+      delay(wait);
+
+      // 最後の再試行の前にスキャンし直して RSSI とアドレスの種類を更新する
+      // - スキャンの時間も上限に収まる場合だけ
+      uint32_t scanMs = (uint32_t)this->_scanParams().durationSec * 1000;
+      if (i == attempts - 1 && attempts > 2 && elapsed + wait + scanMs < this->_CONNECT_BUDGET) {
+        this->find();
+      }
+    }
+    if (this->_connectOnce()) {
+      return true;
+    }
   }
+  return false;
+}
 
-  // Service, Characteristics を準備する
-  bool prepared = this->_prepareServiceAndCharacteristics();
-
-  if (prepared == true) {
-    this->_connected = true;
-    return true;
-  } else {
-    return false;
+// RSSI の移動平均に応じた接続の試行回数と再試行の待ち時間の基準を取得
+// - 待ち時間は再試行のたびに 2 倍にする
+uint8_t SwitchBotPlugMini::_connectAttempts(uint32_t& backoffMs) {
+  if (this->_rssiSamples == 0 || this->_rssiAvg >= -70) {
+    backoffMs = 200;
+    return 2;
+  } else if (this->_rssiAvg >= -80) {
+    backoffMs = 500;
+    return 3;
   }
+  backoffMs = 1000;
+  return 4;
 }
 
-// Service, Characteristics を準備する
-bool SwitchBotPlugMini::_prepareServiceAndCharacteristics() {
-  // Service を取得
-  this->_pService = this->_pClient->getService(this->_SERVICE_UUID);
-
-  if (this->_pService == nullptr) {
-    this->_error = "SERVICE_NOT_FOUND";
-    this->disconnect();
-    return false;
-  }
+// 1 回だけ BLE 接続を試みる
+bool SwitchBotPlugMini::_connectOnce() {
+  this->_connected = false;
+  this->_error = ERR_NONE;
 
-  // データ受信用の Characteristic を取得
-  this->_pCharRx = this->_pService->getCharacteristic(this->_CHAR_RX_UUID);
+  // BLE 接続 (接続にかかった時間と、接続を準備し終えるまでに消費したヒープを計測する)
+  uint32_t heap = ESP.getFreeHeap();
+  uint32_t stime = millis();
+  bool connected = this->_transport->connect(this->_address, this->_addressType);
+  uint32_t elapsed = millis() - stime;
 
-  if (this->_pCharRx == nullptr) {
-    this->_error = "CHAR_RX_NOT_FOUND";
-    this->disconnect();
+  if (!connected) {
+    this->_stats.failures++;
+    this->_error = ERR_CONNECT_FAILED;
     return false;
   }
 
-  // データ送信用の Characteristic を取得
-  this->_pCharTx = this->_pService->getCharacteristic(this->_CHAR_TX_UUID);
-
-  if (this->_pCharTx == nullptr) {
-    this->_error = "CHAR_TX_NOT_FOUND";
-    this->disconnect();
-    return false;
+  this->_stats.connects++;
+  this->_stats.lastConnectMs = elapsed;
+  if (elapsed > this->_stats.maxConnectMs) {
+    this->_stats.maxConnectMs = elapsed;
   }
+  this->_stats.avgConnectMs += ((int32_t)elapsed - (int32_t)this->_stats.avgConnectMs) / (int32_t)this->_stats.connects;
 
-  // データ送信用の Characteristic が NOTIFY をサポートしているかをチェック
-  if (this->_pCharTx->canNotify() == false) {
-    this->_error = "CHAR_TX_NOT_SUPPORT_NOTIFY";
+  // Service, Characteristics を準備して NOTIFY を購読する
+  ErrorCode err = ERR_NONE;
+  if (!this->_transport->subscribe(this->_SERVICE_UUID, this->_CHAR_RX_UUID, this->_CHAR_TX_UUID, notifyCallback, err)) {
     this->disconnect();
+    this->_error = err;
     return false;
   }
 
-  // NOTIFY のコールバックをセット
-  this->_pCharTx->registerForNotify(notifyCallback);
+  this->_tuneLink();
+  this->_connected = true;
 
+  uint32_t used = ESP.getFreeHeap();
+  used = (heap > used) ? heap - used : 0;
+  if (used > this->_stats.connectHeap) {
+    this->_stats.connectHeap = used;
+  }
   return true;
 }
 
+// 接続後に RSSI を記録し、接続パラメータと MTU を調整する
+// - 要求が受け入れられなくても通信はできるので結果は問わない
+void SwitchBotPlugMini::_tuneLink() {
+  int rssi = this->_transport->getRssi();
+  this->_link.connRssi = rssi;
+  this->_addRssi(rssi);
+
+  this->_transport->updateConnParams(this->_CONN_MIN_INTERVAL, this->_CONN_MAX_INTERVAL, this->_CONN_LATENCY, this->_CONN_TIMEOUT);
+  this->_link.mtu = this->_transport->requestMtu(BLE_PREFERRED_MTU);
+}
+
 // ---------------------------------------------------------------
 // 電源状態を取得する
 // ---------------------------------------------------------------
@@ -204,7 +319,7 @@ bool SwitchBotPlugMini::getPowerStatus(bool& status) {
   } else if (_rdata[1] == 0x80) {
     status = true;
   } else {
-    this->_error = "INVALID_RESPONSE";
+    this->_error = ERR_INVALID_RESPONSE;
     return false;
   }
 
@@ -213,14 +328,13 @@ bool SwitchBotPlugMini::getPowerStatus(bool& status) {
 
 // SwitchBot プラグミニ（JP）からのレスポンスの妥当性をチェック
 bool SwitchBotPlugMini::_checkResponse() {
-  std::size_t len = _rdata.size();
-  if (len != 2) {
-    this->_error = "INVALID_RESPONSE";
+  if (_rlen != 2) {
+    this->_error = ERR_INVALID_RESPONSE;
     return false;
   }
 
   if (_rdata[0] != 0x01) {
-    this->_error = "INVALID_RESPONSE";
+    this->_error = ERR_INVALID_RESPONSE;
     return false;
   }
 
@@ -228,34 +342,75 @@ bool SwitchBotPlugMini::_checkResponse() {
 }
 
 // SwitchBot プラグミニ（JP）にリクエストを送ってレスポンスを得る
+// - 接続開始から応答受信までの時間を RSSI の区分ごとに集計する
 bool SwitchBotPlugMini::_request(uint8_t* reqData, uint8_t len) {
-  this->_error = "";
+  this->_error = ERR_NONE;
+  uint32_t stime = millis();
 
   // BLE 接続がなければ接続する
   bool cstatus = this->_connected;
   if (!cstatus) {
     if (!this->connect()) {
+      this->_recordCommand(false, millis() - stime);
       return false;
     }
   }
 
   _received = false;
-  _rdata.clear();
+  _rlen = 0;
+  _rmax = 0;
+  _roverflow = false;
 
-  this->_pCharRx->writeValue(reqData, len, false);
+  bool ok = this->_transport->write(reqData, len);
 
-  while (_received == false) {
+  // レスポンスを待つ (電波が途切れても止まらないようにタイムアウトする)
+  uint32_t wtime = millis();
+  while (ok && _received == false) {
+    if (millis() - wtime > this->_RESPONSE_TIMEOUT) {
+      ok = false;
+      break;
+    }
     delay(50);
   }
+  this->_recordCommand(ok, millis() - stime);
+  if (_rmax > this->_link.maxNotifyLen) {
+    this->_link.maxNotifyLen = _rmax;
+  }
 
   // もともと BLE 接続していなかったなら切断する
-  if (!cstatus) {
+  // - 応答がなかった場合は接続が壊れている可能性があるので常に切断する
+  if (!cstatus || !ok) {
     this->disconnect();
   }
 
+  if (!ok) {
+    this->_error = ERR_RESPONSE_TIMEOUT;
+    return false;
+  }
+  if (_roverflow) {
+    this->_error = ERR_INVALID_RESPONSE;
+    return false;
+  }
+
   return true;
 }
 
+// コマンドの結果を RSSI の区分ごとの統計情報に加える
+void SwitchBotPlugMini::_recordCommand(bool success, uint32_t elapsed) {
+  // 区分は直近の RSSI の移動平均で決める (未取得なら最も弱い区分)
+  uint8_t idx = (this->_rssiSamples == 0) ? LINK_RSSI_BUCKETS - 1 : _rssiToBucket(this->_link.avgRssi);
+  LinkBucket& b = this->_link.buckets[idx];
+  b.commands++;
+  if (!success) {
+    return;
+  }
+  b.successes++;
+  b.avgMs += ((int32_t)elapsed - (int32_t)b.avgMs) / (int32_t)b.successes;
+  if (elapsed > b.maxMs) {
+    b.maxMs = elapsed;
+  }
+}
+
 // ---------------------------------------------------------------
 // 電源状態をセットする
 // ---------------------------------------------------------------
@@ -280,12 +435,12 @@ bool SwitchBotPlugMini::setPowerStatus(bool status) {
   } else if (_rdata[1] == 0x80) {
     rstatus = true;
   } else {
-    this->_error = "INVALID_RESPONSE";
+    this->_error = ERR_INVALID_RESPONSE;
     return false;
   }
 
   if (rstatus != status) {
-    this->_error = "OPERATION_FAILED";
+    this->_error = ERR_OPERATION_FAILED;
     return false;
   }
 
@@ -311,19 +466,144 @@ bool SwitchBotPlugMini::togglePowerStatus(bool& status) {
   } else if (_rdata[1] == 0x80) {
     status = true;
   } else {
-    this->_error = "INVALID_RESPONSE";
+    this->_error = ERR_INVALID_RESPONSE;
     return false;
   }
 
   return true;
 }
 
+// ---------------------------------------------------------------
+// プラグ本体の時計を合わせる
+// ---------------------------------------------------------------
+bool SwitchBotPlugMini::setClock(uint32_t localEpoch) {
+  uint8_t reqData[_RDATA_MAX];
+  uint8_t len = _encodeClockCommand(localEpoch, reqData);
+
+  if (!this->_request(reqData, len)) {
+    return false;
+  }
+  return this->_checkTimerResponse(1);
+}
+
+// ---------------------------------------------------------------
+// プラグ本体のタイマーを読み出す
+// ---------------------------------------------------------------
+bool SwitchBotPlugMini::readTimer(uint8_t index, uint8_t& count, PlugTimer& timer) {
+  uint8_t reqData[_RDATA_MAX];
+  uint8_t len = _encodeTimerReadCommand(index, reqData);
+
+  if (!this->_request(reqData, len)) {
+    return false;
+  }
+  if (!this->_checkTimerResponse(1)) {
+    return false;
+  }
+  if (!_decodeTimerResponse(_rdata, _rlen, count, timer)) {
+    this->_error = ERR_INVALID_RESPONSE;
+    return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------
+// プラグ本体のタイマーを書き込む
+// ---------------------------------------------------------------
+bool SwitchBotPlugMini::writeTimer(uint8_t index, uint8_t count, const PlugTimer& timer) {
+  uint8_t reqData[_RDATA_MAX];
+  uint8_t len = _encodeTimerWriteCommand(index, count, timer, reqData);
+
+  if (!this->_request(reqData, len)) {
+    return false;
+  }
+  return this->_checkTimerResponse(1);
+}
+
+// タイマー関連のコマンドのレスポンスの状態をチェック
+// - 先頭の 1 バイトが状態 (0x01 なら成功)
+// - それ以外の状態はプラグがコマンドを受け付けなかったもの (非対応を含む) として扱う
+bool SwitchBotPlugMini::_checkTimerResponse(size_t minLen) {
+  if (_rlen < minLen) {
+    this->_error = ERR_INVALID_RESPONSE;
+    return false;
+  }
+  if (_rdata[0] != 0x01) {
+    this->_error = ERR_TIMER_REJECTED;
+    return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------
+// タイマー関連のコマンドのバイト列
+// - SwitchBot Bot の BLE API で公開されているタイマーのコマンドに従っている
+//   Plug Mini で同じ構成が使えることは公式には確認できていないため、
+//   プラグが受け付けなかった場合は呼び出し側で委任をやめる
+// - 時計合わせ : 57 09 01 [UNIX 時間 8 バイト BE]
+// - 読み出し   : 57 08 [番号 << 4 | 03]
+//   レスポンス : [状態] [件数] [繰り返し] [時] [分] [モード] [操作] ...
+// - 書き込み   : 57 09 [番号 << 4 | 03] [件数] [繰り返し] [時] [分] [モード] [操作] [間隔 3 バイト]
+// - 繰り返しは曜日のビット (0x7f で毎日)、モードは 0x00 (通常)、
+//   操作は 0x01 (ON) / 0x02 (OFF)、間隔は通常モードでは使わないので 0
+// ---------------------------------------------------------------
+uint8_t SwitchBotPlugMini::_encodeClockCommand(uint32_t localEpoch, uint8_t* buf) {
+  buf[0] = 0x57;
+  buf[1] = 0x09;
+  buf[2] = 0x01;
+  uint64_t t = localEpoch;
+  for (uint8_t i = 0; i < 8; i++) {
+    buf[3 + i] = (uint8_t)(t >> (56 - i * 8));
+  }
+  return 11;
+}
+
+uint8_t SwitchBotPlugMini::_encodeTimerReadCommand(uint8_t index, uint8_t* buf) {
+  buf[0] = 0x57;
+  buf[1] = 0x08;
+  buf[2] = (uint8_t)((index << 4) | 0x03);
+  return 3;
+}
+
+uint8_t SwitchBotPlugMini::_encodeTimerWriteCommand(uint8_t index, uint8_t count, const PlugTimer& timer, uint8_t* buf) {
+  buf[0] = 0x57;
+  buf[1] = 0x09;
+  buf[2] = (uint8_t)((index << 4) | 0x03);
+  buf[3] = count;
+  buf[4] = 0x7f;
+  buf[5] = timer.hour;
+  buf[6] = timer.minute;
+  buf[7] = 0x00;
+  buf[8] = timer.power ? 0x01 : 0x02;
+  buf[9] = 0x00;
+  buf[10] = 0x00;
+  buf[11] = 0x00;
+  return 12;
+}
+
+bool SwitchBotPlugMini::_decodeTimerResponse(const uint8_t* data, size_t len, uint8_t& count, PlugTimer& timer) {
+  if (len < 2) {
+    return false;
+  }
+  count = data[1];
+  if (count == 0) {
+    timer = {};
+    return true;
+  }
+  if (len < 7 || data[3] > 23 || data[4] > 59) {
+    return false;
+  }
+  timer.hour = data[3];
+  timer.minute = data[4];
+  timer.power = (data[6] == 0x01);
+  return true;
+}
+
 // ---------------------------------------------------------------
 // BLE 接続を切断する
 // ---------------------------------------------------------------
 bool SwitchBotPlugMini::disconnect() {
-  this->_error = "";
-  this->_pClient->disconnect();
+  this->_error = ERR_NONE;
+  this->_transport->disconnect();
   this->_connected = false;
   return true;
 }
@@ -11,18 +11,78 @@
 #ifndef SwitchBotPlugMini_h
 #define SwitchBotPlugMini_h
 #include <Arduino.h>
-#include <BLEDevice.h>
-#include <BLEUtils.h>
-#include <BLEScan.h>
-#include <BLEAdvertisedDevice.h>
+#include "ErrorCode.h"
+#include "BleTransport.h"
+
+// BLE 通信の統計情報の構造体
+struct BleStats {
+  const char* backend;     // BLE スタックの名前
+  uint32_t initHeap;       // BLE スタックの初期化で消費したヒープ (バイト)
+  uint32_t connects;       // 接続に成功した回数
+  uint32_t failures;       // 接続に失敗した回数
+  uint32_t lastConnectMs;  // 直近の接続にかかった時間 (ミリ秒)
+  uint32_t maxConnectMs;   // 接続にかかった時間の最大値 (ミリ秒)
+  uint32_t avgConnectMs;   // 接続にかかった時間の平均 (ミリ秒, 成功したもののみ)
+  uint32_t connectHeap;    // 接続中に BLE スタックが消費したヒープの最大値 (バイト)
+};
+
+// リンク品質の集計に使う RSSI の区分の数
+// - -60dBm 以上, -70dBm 以上, -80dBm 以上, -80dBm 未満
+const uint8_t LINK_RSSI_BUCKETS = 4;
+
+// RSSI の区分ごとのコマンドの統計情報の構造体
+struct LinkBucket {
+  uint32_t commands;   // コマンドの回数
+  uint32_t successes;  // 応答を受信できた回数
+  uint32_t avgMs;      // 接続開始から応答受信までの平均時間 (ミリ秒, 成功したもののみ)
+  uint32_t maxMs;      // 接続開始から応答受信までの最大時間 (ミリ秒)
+};
+
+// リンク品質の統計情報の構造体
+struct LinkStats {
+  int8_t advRssi;    // 直近のアドバタイズの RSSI (dBm, 未取得なら 0)
+  int8_t connRssi;   // 直近の接続中の RSSI (dBm, 未取得なら 0)
+  int8_t avgRssi;    // RSSI の移動平均 (dBm, 未取得なら 0)
+  uint8_t bars;      // 電波の強さ (0 - 4)
+  uint16_t mtu;      // 直近の接続で合意した MTU (バイト)
+  uint16_t maxNotifyLen;  // 受信した NOTIFY の最大の長さ (バイト)
+  uint8_t scanSec;   // 直近のスキャンの時間 (秒)
+  uint32_t retries;  // 接続を再試行した回数
+  LinkBucket buckets[LINK_RSSI_BUCKETS];
+};
+
+// RSSI の区分の名前を取得
+const char* linkBucketToString(uint8_t bucket);
+
+// プラグ本体のタイマーの 1 件分 (毎日実行)
+struct PlugTimer {
+  uint8_t hour;    // 時 (0 - 23)
+  uint8_t minute;  // 分 (0 - 59)
+  bool power;      // 実行する操作 (true: ON, false: OFF)
+};
 
 // ---------------------------------------------------------------
 // SwitchBotPlugMini クラス
 // ---------------------------------------------------------------
 class SwitchBotPlugMini {
 private:
-  // BLE スキャンの時間 (秒)
-  const uint8_t _BLE_SCAN_DUR = 3;
+  // RSSI の移動平均の係数 (新しい値の重み 1/_RSSI_EWMA_DIV)
+  const int _RSSI_EWMA_DIV = 4;
+
+  // レスポンスの受信待ちのタイムアウト (ミリ秒)
+  const uint32_t _RESPONSE_TIMEOUT = 3000;
+
+  // 接続 (再試行の待ち時間と再スキャンを含む) の時間の上限 (ミリ秒)
+  // - 超えそうなら次の試行を始めない (試行中の接続は BLE スタックのタイムアウトまで待つ)
+  const uint32_t _CONNECT_BUDGET = 10000;
+
+  // 接続後に要求する接続パラメータ
+  // - interval は 7.5 - 15ms (1.25ms 単位)、slave latency なし
+  // - supervision timeout は電波が弱くても切れにくいように 5 秒 (10ms 単位)
+  const uint16_t _CONN_MIN_INTERVAL = 6;
+  const uint16_t _CONN_MAX_INTERVAL = 12;
+  const uint16_t _CONN_LATENCY = 0;
+  const uint16_t _CONN_TIMEOUT = 500;
 
   // SwitchBot Plug Mini の BLE の Service と Characteristics の UUID
   const char* _SERVICE_UUID = "cba20d00-224d-11e6-9fb8-0002a5d5c51b";
@@ -30,19 +90,49 @@ private:
   const char* _CHAR_TX_UUID = "cba20003-224d-11e6-9fb8-0002a5d5c51b";
 
   // BLE MAC アドレス
-  char* _address;
+  const char* _address;
+
+  // BLE アドレスの種類 (スキャンで得た値)
+  uint8_t _addressType = 0;
+
+  // BLE 通信の実装
+  BleTransport* _transport;
+
+  bool _connected = false;
+  bool _found = false;
+  ErrorCode _error = ERR_NONE;
 
-  BLEClient* _pClient;
-  BLERemoteService* _pService;
-  BLERemoteCharacteristic* _pCharRx;
-  BLERemoteCharacteristic* _pCharTx;
+  // BLE 通信の統計情報
+  BleStats _stats = {};
 
-  bool _connected;
-  String _error;
+  // リンク品質の統計情報
+  LinkStats _link = {};
+
+  // RSSI の移動平均 (サンプルがなければ _rssiSamples は 0)
+  float _rssiAvg = 0;
+  uint32_t _rssiSamples = 0;
 
 private:
-  // Service, Characteristics を準備する
-  bool _prepareServiceAndCharacteristics();
+  // スキャンで見つかったデバイスが対象の SwitchBot プラグミニ（JP）かどうかを判定する
+  static bool _matchPlugMini(const BleAdvInfo& info, void* ctx);
+
+  // RSSI のサンプルを記録して移動平均を更新する
+  void _addRssi(int rssi);
+
+  // RSSI の移動平均に応じたスキャンのパラメータを取得
+  BleScanParams _scanParams();
+
+  // RSSI の移動平均に応じた接続の試行回数と再試行の待ち時間の基準 (ミリ秒) を取得
+  uint8_t _connectAttempts(uint32_t& backoffMs);
+
+  // 1 回だけ BLE 接続を試みる
+  bool _connectOnce();
+
+  // 接続後に RSSI を記録し、接続パラメータと MTU を調整する
+  void _tuneLink();
+
+  // コマンドの結果を RSSI の区分ごとの統計情報に加える
+  void _recordCommand(bool success, uint32_t elapsed);
 
   // SwitchBot プラグミニ（JP）にリクエストを送ってレスポンスを得る
   bool _request(uint8_t* reqData, uint8_t len);
@@ -50,17 +140,37 @@ private:
   // SwitchBot プラグミニ（JP）からのレスポンスの妥当性をチェック
   bool _checkResponse();
 
+  // タイマー関連のコマンドのレスポンスの状態をチェック
+  bool _checkTimerResponse(size_t minLen);
+
+  // タイマー関連のコマンドを組み立てる (バイト列の構成はここだけに置く)
+  static uint8_t _encodeClockCommand(uint32_t localEpoch, uint8_t* buf);
+  static uint8_t _encodeTimerReadCommand(uint8_t index, uint8_t* buf);
+  static uint8_t _encodeTimerWriteCommand(uint8_t index, uint8_t count, const PlugTimer& timer, uint8_t* buf);
+  static bool _decodeTimerResponse(const uint8_t* data, size_t len, uint8_t& count, PlugTimer& timer);
+
 public:
   // コンストラクタ
-  SwitchBotPlugMini(char* addr);
+  SwitchBotPlugMini(const char* addr);
+
+  // 初期化 (BLE スタックの初期化)
+  void init();
+
+  // エラーコードを取得
+  ErrorCode getError();
+
+  // BLE 通信の統計情報を取得
+  const BleStats& getStats() const;
 
-  // エラーメッセージを取得
-  String getError();
+  // リンク品質の統計情報を取得
+  const LinkStats& getLinkStats() const;
 
   // 指定の BLE MAC アドレスの SwitchBot プラグミニ（JP）を発見する
-  bool find(BLEAdvertisedDevice& foundDevice);
+  bool find();
 
   // SwitchBot プラグミニ（JP）に BLE 接続する
+  // - 失敗したら RSSI の移動平均に応じた回数だけ間隔を延ばしながら再試行する
+  // - 全体で _CONNECT_BUDGET を超えそうなら再試行をやめる
   bool connect();
 
   // 電源状態を取得する
@@ -72,6 +182,15 @@ public:
   // 電源状態を反転する
   bool togglePowerStatus(bool& status);
 
+  // プラグ本体の時計を合わせる (localEpoch は現地時刻の UNIX 時間)
+  bool setClock(uint32_t localEpoch);
+
+  // プラグ本体のタイマーを読み出す (count は登録されている件数)
+  bool readTimer(uint8_t index, uint8_t& count, PlugTimer& timer);
+
+  // プラグ本体のタイマーを書き込む (count は登録する件数, 0 なら全件無効)
+  bool writeTimer(uint8_t index, uint8_t count, const PlugTimer& timer);
+
   // BLE 接続を切断する
   bool disconnect();
 };
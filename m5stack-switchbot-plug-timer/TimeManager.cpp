@@ -17,18 +17,25 @@
 // ---------------------------------------------------------------
 // コンストラクタ
 // ---------------------------------------------------------------
-TimeManager::TimeManager(char* ssid, char* pass) {
+TimeManager::TimeManager(const char* ssid, const char* pass) {
   this->_ssid = ssid;
   this->_pass = pass;
 }
 
 // ---------------------------------------------------------------
-// エラーメッセージを取得
+// エラーコードを取得
 // ---------------------------------------------------------------
-String TimeManager::getError() {
+ErrorCode TimeManager::getError() {
   return this->_error;
 }
 
+// ---------------------------------------------------------------
+// 時刻同期後も Wi-Fi 接続を維持するかどうかをセット
+// ---------------------------------------------------------------
+void TimeManager::setKeepConnected(bool keep) {
+  this->_keepConnected = keep;
+}
+
 // ---------------------------------------------------------------
 //  初期化
 // ---------------------------------------------------------------
@@ -37,30 +44,45 @@ void TimeManager::init() {
 }
 
 // ---------------------------------------------------------------
-//  Wi-Fi 接続および時刻同期
+//  Wi-Fi 接続
 // ---------------------------------------------------------------
-bool TimeManager::sync() {
-  // Wi-Fi 接続
-  uint32_t wifi_stime = millis();
-  WiFi.begin(this->_ssid, this->_pass);
-  bool wifi_success = true;
-
-  while (WiFi.status() != WL_CONNECTED) {
-    if (millis() > wifi_stime + this->_WIFI_TIMEOUT) {
-      wifi_success = false;
-      break;
+bool TimeManager::connect() {
+  this->_error = ERR_NONE;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    uint32_t wifi_stime = millis();
+    WiFi.begin(this->_ssid, this->_pass);
+    bool wifi_success = true;
+
+    while (WiFi.status() != WL_CONNECTED) {
+      if (millis() > wifi_stime + this->_WIFI_TIMEOUT) {
+        wifi_success = false;
+        break;
+      }
+      delay(100);
     }
-    delay(100);
+
+    if (wifi_success == false) {
+      WiFi.disconnect(true);
+      this->_error = ERR_WIFI_TIMEOUT;
+      return false;
+    }
+
+    delay(1000);
   }
 
-  if (wifi_success == false) {
-    WiFi.disconnect(true);
-    this->_error = "WIFI_TIMEOUT";
+  return true;
+}
+
+// ---------------------------------------------------------------
+//  Wi-Fi 接続および時刻同期
+// ---------------------------------------------------------------
+bool TimeManager::sync() {
+  // Wi-Fi 接続 (接続を維持している場合は接続済み)
+  if (!this->connect()) {
     return false;
   }
 
-  delay(1000);
-
   // NTP サーバーと同期
   uint32_t ntp_stime = millis();
   bool ntp_success = true;
@@ -76,8 +98,10 @@ bool TimeManager::sync() {
   }
 
   if (ntp_success == false) {
-    WiFi.disconnect(true);
-    this->_error = "NTP_TIMEOUT";
+    if (this->_keepConnected == false) {
+      WiFi.disconnect(true);
+    }
+    this->_error = ERR_NTP_TIMEOUT;
     return false;
   }
 
@@ -96,11 +120,20 @@ bool TimeManager::sync() {
   M5.Rtc.SetDate(&rtcdate);
 
   // Wi-Fi 切断
-  WiFi.disconnect(true);
+  if (this->_keepConnected == false) {
+    WiFi.disconnect(true);
+  }
 
   return true;
 }
 
+// ---------------------------------------------------------------
+//  Wi-Fi を切断する
+// ---------------------------------------------------------------
+void TimeManager::disconnect() {
+  WiFi.disconnect(true);
+}
+
 // ---------------------------------------------------------------
 //  現在日時を取得 (RTC を使わない)
 // ---------------------------------------------------------------
@@ -113,38 +146,63 @@ tm TimeManager::now() {
 */
 
 // ---------------------------------------------------------------
-// 今日の日付を RTC から取得
+// 今日の日付を RTC から取得 ("YYYY/MM/DD")
+// - buf には DATE_STR_LEN バイト以上の領域を渡す
 // ---------------------------------------------------------------
-String TimeManager::getRtcDate() {
+void TimeManager::getRtcDate(char* buf, size_t len) {
   RTC_DateTypeDef rtcdate;
   M5.Rtc.GetDate(&rtcdate);
-
-  char date_str[11];
-  sprintf(date_str, "%04d/%02d/%02d", rtcdate.Year, rtcdate.Month, rtcdate.Date);
-  String date = String(date_str);
-
-  return date;
+  snprintf(buf, len, "%04d/%02d/%02d", rtcdate.Year, rtcdate.Month, rtcdate.Date);
 }
 
 // ---------------------------------------------------------------
-//  現在時刻を RTC から取得
+//  現在時刻を RTC から取得 ("hh:mm:ss")
+// - buf には TIME_STR_LEN バイト以上の領域を渡す
 // ---------------------------------------------------------------
-String TimeManager::getRtcTime() {
+void TimeManager::getRtcTime(char* buf, size_t len) {
   RTC_TimeTypeDef rtctime;
   M5.Rtc.GetTime(&rtctime);
+  snprintf(buf, len, "%02d:%02d:%02d", rtctime.Hours, rtctime.Minutes, rtctime.Seconds);
+}
 
-  char time_str[9];
-  sprintf(time_str, "%02d:%02d:%02d", rtctime.Hours, rtctime.Minutes, rtctime.Seconds);
-  String time = String(time_str);
+// ---------------------------------------------------------------
+//  現在日時を RTC から取得 ("YYYY/MM/DD hh:mm:ss")
+// - buf には DATETIME_STR_LEN バイト以上の領域を渡す
+// ---------------------------------------------------------------
+void TimeManager::getRtcDateAndTime(char* buf, size_t len) {
+  RTC_DateTypeDef rtcdate;
+  RTC_TimeTypeDef rtctime;
+  M5.Rtc.GetDate(&rtcdate);
+  M5.Rtc.GetTime(&rtctime);
+  snprintf(buf, len, "%04d/%02d/%02d %02d:%02d:%02d",
+           rtcdate.Year, rtcdate.Month, rtcdate.Date,
+           rtctime.Hours, rtctime.Minutes, rtctime.Seconds);
+}
 
-  return time;
+// ---------------------------------------------------------------
+//  現在日時を RTC から取得 (構造体)
+// ---------------------------------------------------------------
+void TimeManager::getRtcDateTime(RTC_DateTypeDef& date, RTC_TimeTypeDef& time) {
+  M5.Rtc.GetDate(&date);
+  M5.Rtc.GetTime(&time);
 }
 
 // ---------------------------------------------------------------
-//  現在日時を RTC から取得
+//  現在日時を RTC から取得 (現地時刻を UTC とみなした UNIX 時間)
+// - RTC は現地時刻を保持しているので、タイムゾーンの補正はしない
 // ---------------------------------------------------------------
-String TimeManager::getRtcDateAndTime() {
-  String date = this->getRtcDate();
-  String time = this->getRtcTime();
-  return String(date + " " + time);
+uint32_t TimeManager::getRtcEpoch() {
+  RTC_DateTypeDef d;
+  RTC_TimeTypeDef t;
+  this->getRtcDateTime(d, t);
+
+  // 1970/01/01 からの日数 (3 月始まりの年で閏日を年末に置いて計算する)
+  int32_t y = d.Year - (d.Month <= 2 ? 1 : 0);
+  int32_t era = y / 400;
+  int32_t yoe = y - era * 400;
+  int32_t doy = (153 * (d.Month + (d.Month > 2 ? -3 : 9)) + 2) / 5 + d.Date - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int32_t days = era * 146097 + doe - 719468;
+
+  return (uint32_t)days * 86400 + (uint32_t)t.Hours * 3600 + t.Minutes * 60 + t.Seconds;
 }
@@ -14,6 +14,12 @@
 #include <M5Core2.h>
 #include <WiFi.h>
 #include <time.h>
+#include "ErrorCode.h"
+
+// 日付・時刻文字列のバッファサイズ (終端文字を含む)
+const size_t DATE_STR_LEN = 11;      // "YYYY/MM/DD"
+const size_t TIME_STR_LEN = 9;       // "hh:mm:ss"
+const size_t DATETIME_STR_LEN = 20;  // "YYYY/MM/DD hh:mm:ss"
 
 // ---------------------------------------------------------------
 // TimeManager クラス
@@ -21,7 +27,7 @@
 class TimeManager {
 private:
   // Wi-Fi の SSID とパスワード
-  char* _ssid;
+  const char* _ssid;
   const char* _pass;
 
   const long _TZ_OFFSET = 9 * 3600; // タイムゾーンオフセット (秒)
@@ -32,32 +38,49 @@ private:
   const uint16_t _WIFI_TIMEOUT = 10000; // Wi-Fi 接続タイムアウト (ミリ秒)
   const uint16_t _NTP_TIMEOUT = 5000; // NTP 時刻同期タイムアウト (ミリ秒)
 
-  String _error; // 最終のエラーメッセージ
+  ErrorCode _error = ERR_NONE; // 最終のエラーコード
+
+  bool _keepConnected = false; // 時刻同期後も Wi-Fi 接続を維持するかどうか
 
 public:
   // コンストラクタ
-  TimeManager(char* ssid, char* pass);
+  TimeManager(const char* ssid, const char* pass);
 
-  // エラーメッセージを取得
-  String getError();
+  // エラーコードを取得
+  ErrorCode getError();
+
+  // 時刻同期後も Wi-Fi 接続を維持するかどうかをセット
+  void setKeepConnected(bool keep);
 
   // 初期化
   void init();
   
+  // Wi-Fi 接続 (接続済みなら何もしない)
+  bool connect();
+
   // Wi-Fi 接続および時刻同期
   bool sync();
 
+  // Wi-Fi を切断する (SSID やパスワードを変更したときに呼ぶ)
+  void disconnect();
+
   // 現在日時を取得 (RTC を使わない)
   //tm now();
 
-  // 今日の日付を RTC から取得
-  String getRtcDate();
+  // 今日の日付を RTC から取得 ("YYYY/MM/DD")
+  void getRtcDate(char* buf, size_t len);
+
+  // 現在時刻を RTC から取得 ("hh:mm:ss")
+  void getRtcTime(char* buf, size_t len);
+
+  // 現在日時を RTC から取得 ("YYYY/MM/DD hh:mm:ss")
+  void getRtcDateAndTime(char* buf, size_t len);
 
-  // 現在時刻を RTC から取得
-  String getRtcTime();
+  // 現在日時を RTC から取得 (構造体)
+  void getRtcDateTime(RTC_DateTypeDef& date, RTC_TimeTypeDef& time);
 
-  // 現在日時を RTC から取得
-  String getRtcDateAndTime();
+  // 現在日時を RTC から取得 (現地時刻を UTC とみなした UNIX 時間)
+  uint32_t getRtcEpoch();
 };
 
 #endif
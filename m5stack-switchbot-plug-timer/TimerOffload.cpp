@@ -0,0 +1,322 @@
+/* ----------------------------------------------------------------
+  TimerOffload.cpp
+  - OFF/ON タイマーを SwitchBot Plug Mini 本体のタイマーに委任する
+  - プラグのタイマーを読み出して、設定と違うものだけを書き込む
+  - 委任中は本体が止まっていてもプラグが OFF/ON を実施する
+  - 委任をやめるときや同期に失敗したときは、書き込んだタイマーを空にして確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "TimerOffload.h"
+#include <Preferences.h>
+
+// ---------------------------------------------------------------
+// 委任の状態の名前を取得
+// ---------------------------------------------------------------
+const char* offloadStateToString(OffloadState state) {
+  switch (state) {
+    case OFFLOAD_INACTIVE: return "INACTIVE";
+    case OFFLOAD_ACTIVE: return "ACTIVE";
+    case OFFLOAD_DISABLED: return "DISABLED";
+  }
+  return "UNKNOWN";
+}
+
+// ===============================================================
+// TimerOffload クラス
+// ===============================================================
+
+// ---------------------------------------------------------------
+// コンストラクタ
+// ---------------------------------------------------------------
+TimerOffload::TimerOffload(SwitchBotPlugMini& plug) : _plug(plug) {
+}
+
+// ---------------------------------------------------------------
+// エラーコードを取得
+// ---------------------------------------------------------------
+ErrorCode TimerOffload::getError() {
+  return this->_error;
+}
+
+// ---------------------------------------------------------------
+// 起動時の処理
+// ---------------------------------------------------------------
+void TimerOffload::init() {
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, true)) {
+    if (prefs.getBool(this->_NVS_KEY, false)) {
+      this->_stats.state = OFFLOAD_DISABLED;
+    }
+    this->_written = prefs.getBool(this->_NVS_KEY_WRITTEN, false);
+    prefs.end();
+  }
+}
+
+// ---------------------------------------------------------------
+// 委任をやめた記録を消す
+// ---------------------------------------------------------------
+void TimerOffload::reset() {
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, false)) {
+    prefs.remove(this->_NVS_KEY);
+    prefs.end();
+  }
+  this->_stats.state = OFFLOAD_INACTIVE;
+}
+
+// 書き込んだタイマーを空にしてから、委任をやめたことを記録する
+// - 空にできなくても委任はやめる (書き込んだ記録が残るので、次の同期で空にし直す)
+void TimerOffload::_disable() {
+  ErrorCode err = this->_error;
+  this->clear();
+  this->_error = err;
+
+  this->_stats.state = OFFLOAD_DISABLED;
+  this->_count = 0;
+  this->_verifyTime = DailySchedule::SECONDS_PER_DAY;
+  this->_onTime = DailySchedule::SECONDS_PER_DAY;
+  this->_onVerifyTime = DailySchedule::SECONDS_PER_DAY;
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, false)) {
+    prefs.putBool(this->_NVS_KEY, true);
+    prefs.end();
+  }
+}
+
+// ---------------------------------------------------------------
+// プラグの時計を合わせてタイマーを同期する
+// ---------------------------------------------------------------
+bool TimerOffload::sync(uint32_t timerTime, uint16_t intervalMs, uint32_t localEpoch) {
+  this->_error = ERR_NONE;
+  if (this->_stats.state == OFFLOAD_DISABLED) {
+    // 委任をやめるときに空にできなかったタイマーがあれば空にし直す
+    this->clear();
+    return false;
+  }
+  this->_stats.state = OFFLOAD_INACTIVE;
+
+  // 委任できない設定でも、以前に登録したタイマーが残らないように同期する
+  this->_build(timerTime, intervalMs);
+
+  // 一連のコマンドは 1 回の接続で送る
+  if (!this->_plug.connect()) {
+    this->_error = this->_plug.getError();
+    return false;
+  }
+  // - 委任しない (0 件) なら、以前に登録したタイマーを空にする
+  bool ok = this->_plug.setClock(localEpoch)
+            && ((this->_count > 0) ? this->_update() : this->_clearSlots());
+  if (!ok && this->_error == ERR_NONE) {
+    this->_error = this->_plug.getError();
+  }
+  this->_plug.disconnect();
+
+  if (!ok) {
+    // 受け付けられなかったり、書き込んだ値が読み出せなかったなら委任をやめる
+    // 通信の失敗なら、本体が OFF/ON を実施するので、書きかけのタイマーを空にして次の同期で再試行する
+    if (this->_error == ERR_TIMER_REJECTED || this->_error == ERR_TIMER_MISMATCH) {
+      this->_disable();
+    } else {
+      ErrorCode err = this->_error;
+      this->clear();
+      this->_error = err;
+    }
+    return false;
+  }
+
+  this->_stats.syncs++;
+  if (this->_count == 0) {
+    return false;
+  }
+  this->_stats.state = OFFLOAD_ACTIVE;
+  return true;
+}
+
+// OFF/ON タイマーの設定からプラグに登録するタイマーを作る
+// - プラグのタイマーは分単位なので、秒を含む時刻は委任しない
+// - ON は待ち時間を分単位に切り上げた時刻 (最短でも OFF の 1 分後)
+bool TimerOffload::_build(uint32_t timerTime, uint16_t intervalMs) {
+  this->_count = 0;
+  this->_verifyTime = DailySchedule::SECONDS_PER_DAY;
+  this->_onTime = DailySchedule::SECONDS_PER_DAY;
+  this->_onVerifyTime = DailySchedule::SECONDS_PER_DAY;
+  if (timerTime >= DailySchedule::SECONDS_PER_DAY || timerTime % 60 != 0) {
+    return false;
+  }
+
+  const uint32_t minutesPerDay = DailySchedule::SECONDS_PER_DAY / 60;
+  uint32_t offMin = timerTime / 60;
+  uint32_t waitMin = ((uint32_t)intervalMs + 59999) / 60000;
+  if (waitMin == 0) {
+    waitMin = 1;
+  }
+  uint32_t onMin = (offMin + waitMin) % minutesPerDay;
+
+  this->_timers[0] = { (uint8_t)(offMin / 60), (uint8_t)(offMin % 60), false };
+  this->_timers[1] = { (uint8_t)(onMin / 60), (uint8_t)(onMin % 60), true };
+  this->_count = 2;
+  this->_verifyTime = timerTime + this->_OFF_VERIFY_DELAY;
+  this->_onTime = onMin * 60;
+  this->_onVerifyTime = (this->_onTime + this->_VERIFY_DELAY) % DailySchedule::SECONDS_PER_DAY;
+  return true;
+}
+
+// プラグのタイマーを読み出して、違うものだけを書き込んで読み出し直す
+// - 書き込む前に書き込んだことを記録する (途中で失敗しても後で空にできるように)
+// - タイマーのコマンドは Plug Mini で確かめきれていないので、書き込んだ値が
+//   読み出せなければ ERR_TIMER_MISMATCH にする (委任をやめる)
+bool TimerOffload::_update() {
+  for (uint8_t i = 0; i < this->_count; i++) {
+    uint8_t count;
+    PlugTimer current;
+    if (!this->_plug.readTimer(i, count, current)) {
+      return false;
+    }
+
+    const PlugTimer& desired = this->_timers[i];
+    if (count == this->_count && current.hour == desired.hour
+        && current.minute == desired.minute && current.power == desired.power) {
+      continue;
+    }
+
+    this->_setWritten(true);
+    if (!this->_plug.writeTimer(i, this->_count, desired)) {
+      return false;
+    }
+    this->_stats.writes++;
+
+    if (!this->_plug.readTimer(i, count, current)) {
+      return false;
+    }
+    if (count != this->_count || current.hour != desired.hour
+        || current.minute != desired.minute || current.power != desired.power) {
+      this->_error = ERR_TIMER_MISMATCH;
+      return false;
+    }
+  }
+  return true;
+}
+
+// プラグのタイマーを全て空にして、読み出して確認する
+// - プラグに 1 件でも残っていれば、委任で使う番号を全て件数 0 で書き込む
+// - 全ての番号で件数が 0 になったことを確認できたら、書き込んだ記録を消す
+bool TimerOffload::_clearSlots() {
+  uint8_t count;
+  PlugTimer current;
+  if (!this->_plug.readTimer(0, count, current)) {
+    this->_error = this->_plug.getError();
+    return false;
+  }
+
+  if (count != 0) {
+    const PlugTimer empty = {};
+    for (uint8_t i = 0; i < _SLOTS; i++) {
+      if (!this->_plug.writeTimer(i, 0, empty)) {
+        this->_error = this->_plug.getError();
+        return false;
+      }
+      this->_stats.writes++;
+    }
+    for (uint8_t i = 0; i < _SLOTS; i++) {
+      if (!this->_plug.readTimer(i, count, current)) {
+        this->_error = this->_plug.getError();
+        return false;
+      }
+      if (count != 0) {
+        this->_error = ERR_TIMER_NOT_CLEARED;
+        return false;
+      }
+    }
+  }
+
+  this->_setWritten(false);
+  return true;
+}
+
+// プラグにタイマーを書き込んだかどうかを記録する (変わった場合だけ NVS に書き込む)
+void TimerOffload::_setWritten(bool written) {
+  if (this->_written == written) {
+    return;
+  }
+  this->_written = written;
+  Preferences prefs;
+  if (prefs.begin(this->_NVS_NAMESPACE, false)) {
+    prefs.putBool(this->_NVS_KEY_WRITTEN, written);
+    prefs.end();
+  }
+}
+
+// ---------------------------------------------------------------
+// プラグに書き込んだタイマーを空にして、読み出して確認する
+// ---------------------------------------------------------------
+bool TimerOffload::clear() {
+  this->_error = ERR_NONE;
+  if (!this->_written) {
+    return true;
+  }
+  if (!this->_plug.connect()) {
+    this->_error = this->_plug.getError();
+    return false;
+  }
+  bool ok = this->_clearSlots();
+  this->_plug.disconnect();
+  return ok;
+}
+
+// ---------------------------------------------------------------
+// プラグにタイマーを書き込んでいて、まだ空にしていないかどうか
+// ---------------------------------------------------------------
+bool TimerOffload::isWritten() const {
+  return this->_written;
+}
+
+// ---------------------------------------------------------------
+// 委任中かどうか
+// ---------------------------------------------------------------
+bool TimerOffload::isActive() const {
+  return this->_stats.state == OFFLOAD_ACTIVE;
+}
+
+// ---------------------------------------------------------------
+// OFF を確認する時刻を取得
+// ---------------------------------------------------------------
+uint32_t TimerOffload::getVerifyTime() const {
+  return this->_verifyTime;
+}
+
+// ---------------------------------------------------------------
+// プラグが ON にする時刻を取得
+// ---------------------------------------------------------------
+uint32_t TimerOffload::getOnTime() const {
+  return this->_onTime;
+}
+
+// ---------------------------------------------------------------
+// ON を確認する時刻を取得
+// ---------------------------------------------------------------
+uint32_t TimerOffload::getOnVerifyTime() const {
+  return this->_onVerifyTime;
+}
+
+// ---------------------------------------------------------------
+// OFF または ON の確認結果を記録する
+// ---------------------------------------------------------------
+void TimerOffload::recordVerify(bool executed) {
+  if (executed) {
+    this->_stats.verified++;
+  } else {
+    this->_stats.fallbacks++;
+  }
+}
+
+// ---------------------------------------------------------------
+// 統計情報を取得
+// ---------------------------------------------------------------
+const OffloadStats& TimerOffload::getStats() const {
+  return this->_stats;
+}
@@ -0,0 +1,142 @@
+/* ----------------------------------------------------------------
+  TimerOffload.h
+  - OFF/ON タイマーを SwitchBot Plug Mini 本体のタイマーに委任する
+  - プラグのタイマーを読み出して、設定と違うものだけを書き込む
+  - 委任中は本体が止まっていてもプラグが OFF/ON を実施する
+  - 委任をやめるときや同期に失敗したときは、書き込んだタイマーを空にして確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef TimerOffload_h
+#define TimerOffload_h
+#include <Arduino.h>
+#include "ErrorCode.h"
+#include "SwitchBotPlugMini.h"
+#include "DailySchedule.h"
+
+// 委任の状態
+enum OffloadState : uint8_t {
+  OFFLOAD_INACTIVE = 0,  // 委任していない (本体が OFF/ON を実施する)
+  OFFLOAD_ACTIVE,        // プラグ本体のタイマーに委任中
+  OFFLOAD_DISABLED,      // プラグがタイマーのコマンドを受け付けなかったので委任しない
+};
+
+// 委任の状態の名前を取得
+const char* offloadStateToString(OffloadState state);
+
+// 委任の統計情報の構造体
+struct OffloadStats {
+  OffloadState state;  // 現在の状態
+  uint32_t syncs;      // プラグのタイマーと同期した回数
+  uint32_t writes;     // 差分があってタイマーを書き込んだ件数
+  uint32_t verified;   // OFF の間の OFF、ON の後の ON を確認できた回数 (確認ごとに数える)
+  uint32_t fallbacks;  // OFF または ON になっていなかったので本体が実施した回数 (確認ごとに数える)
+};
+
+// ---------------------------------------------------------------
+// TimerOffload クラス
+// ---------------------------------------------------------------
+class TimerOffload {
+private:
+  // OFF の時刻から OFF になっていることを確認するまでの時間 (秒, OFF の間)
+  const uint32_t _OFF_VERIFY_DELAY = 30;
+
+  // ON の時刻から実施を確認するまでの時間 (秒)
+  const uint32_t _VERIFY_DELAY = 60;
+
+  // 委任で使うプラグのタイマーの番号の数 (0 番から)
+  static const uint8_t _SLOTS = 2;
+
+  // NVS の名前空間とキー (委任をやめたかどうか, プラグにタイマーを書き込んだかどうか)
+  const char* _NVS_NAMESPACE = "plugtimer";
+  const char* _NVS_KEY = "offload";
+  const char* _NVS_KEY_WRITTEN = "offwritten";
+
+  SwitchBotPlugMini& _plug;
+
+  // プラグに登録するタイマー (OFF と ON の 2 件, 委任しないなら 0 件)
+  PlugTimer _timers[_SLOTS];
+  uint8_t _count = 0;
+
+  // OFF を確認する時刻 (OFF の間), ON の時刻, ON を確認する時刻
+  // (0 時からの秒数, 委任しないなら SECONDS_PER_DAY)
+  uint32_t _verifyTime = DailySchedule::SECONDS_PER_DAY;
+  uint32_t _onTime = DailySchedule::SECONDS_PER_DAY;
+  uint32_t _onVerifyTime = DailySchedule::SECONDS_PER_DAY;
+
+  // プラグにタイマーを書き込んだかどうか (空にしたことを確認するまで再起動後も残す)
+  bool _written = false;
+
+  OffloadStats _stats = {};
+  ErrorCode _error = ERR_NONE;
+
+private:
+  // OFF/ON タイマーの設定からプラグに登録するタイマーを作る
+  // - プラグのタイマーで表せなければ 0 件にして false を返す
+  bool _build(uint32_t timerTime, uint16_t intervalMs);
+
+  // プラグのタイマーを読み出して、違うものだけを書き込んで読み出し直す
+  bool _update();
+
+  // プラグのタイマーを全て空にして、読み出して確認する (接続中に呼ぶ)
+  bool _clearSlots();
+
+  // プラグにタイマーを書き込んだかどうかを記録する
+  void _setWritten(bool written);
+
+  // 書き込んだタイマーを空にしてから、委任をやめたことを記録する (再起動後も委任しない)
+  void _disable();
+
+public:
+  // コンストラクタ
+  TimerOffload(SwitchBotPlugMini& plug);
+
+  // エラーコードを取得
+  ErrorCode getError();
+
+  // 起動時の処理 (委任をやめたかどうかと、タイマーを書き込んだかどうかを読み込む)
+  void init();
+
+  // 委任をやめた記録を消す (SwitchBot Plug Mini を変えたときに呼ぶ)
+  void reset();
+
+  // プラグの時計を合わせてタイマーを同期する
+  // - timerTime は OFF の時刻 (0 時からの秒数, SECONDS_PER_DAY 以上なら無効)
+  // - localEpoch は現地時刻の UNIX 時間
+  // - 委任できたら true を返す (タイマーが無効ならプラグのタイマーも消す)
+  // - プラグがコマンドを受け付けなかったり、書き込んだタイマーが読み出せなかったら委任をやめる
+  // - 通信に失敗したら、書きかけのタイマーが残らないように空にする
+  bool sync(uint32_t timerTime, uint16_t intervalMs, uint32_t localEpoch);
+
+  // プラグに書き込んだタイマーを空にして、読み出して確認する
+  // - 書き込んでいなければ何もしない (委任を使わない設定でも起動時などに呼ぶ)
+  // - 確認できなければ false を返す (書き込んだ記録が残るので、後で呼び直す)
+  bool clear();
+
+  // プラグにタイマーを書き込んでいて、まだ空にしていないかどうか
+  bool isWritten() const;
+
+  // 委任中かどうか
+  bool isActive() const;
+
+  // OFF を確認する時刻を取得 (0 時からの秒数, OFF の間)
+  uint32_t getVerifyTime() const;
+
+  // プラグが ON にする時刻を取得 (0 時からの秒数, OFF の確認はこの時刻より前に限る)
+  uint32_t getOnTime() const;
+
+  // ON を確認する時刻を取得 (0 時からの秒数)
+  uint32_t getOnVerifyTime() const;
+
+  // OFF または ON の確認結果を記録する
+  void recordVerify(bool executed);
+
+  // 統計情報を取得
+  const OffloadStats& getStats() const;
+};
+
+#endif
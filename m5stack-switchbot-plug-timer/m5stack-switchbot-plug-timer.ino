@@ -8,14 +8,25 @@
   See LICENSE file in the project root for full license information.
   -------------------------------------------------------------- */
 #include <M5Core2.h>
-#include <vector>
 
 #include "SwitchBotPlugMini.h"
 #include "LcdController.h"
 #include "TimeManager.h"
+#include "HeapMonitor.h"
+#include "LogStore.h"
+#include "InputManager.h"
+#include "ApiServer.h"
+#include "SerialController.h"
+#include "DailySchedule.h"
+#include "ConfigStore.h"
+#include "OtaUpdater.h"
+#include "PowerManager.h"
+#include "TimerOffload.h"
+#include "ScheduledTasks.h"
 
 // ================================================================
 // ユーザー設定
+// - SD カードの設定ファイルや NVS に設定がなければ、ここの値を使う
 // ----------------------------------------------------------------
 
 // SwitchBot Plug Mini の BLE MAC アドレス
@@ -35,6 +46,27 @@ uint16_t TIMER_INTERVAL = 5000;
 // NTP で時刻同期する時刻 ("hh:mm:ss")
 char* NTP_TIME = "03:00:00";
 
+// Wi-Fi 経由の HTTP API を有効にするかどうか
+// - 有効にすると Wi-Fi 接続を常時維持する
+bool API_ENABLED = false;
+
+// USB シリアル経由のバイナリ制御プロトコルを有効にするかどうか
+bool SERIAL_API_ENABLED = false;
+
+// OFF/ON タイマーを SwitchBot Plug Mini 本体のタイマーに委任するかどうか (実験的な機能)
+// - タイマーのコマンドは Plug Mini の実機で確かめきれていない。書き込むたびに読み出して
+//   確認し、違っていたら委任をやめる (ERR_TIMER_MISMATCH を記録して、本体が OFF/ON を実施する)
+// - 委任すると本体が止まっていても OFF/ON が実施され、本体は OFF の間と ON の後に電源状態を確認する
+// - 委任をやめると (false に戻すと)、プラグに書き込んだタイマーは次の起動時に空にする
+// - プラグのタイマーは分単位のため、TIMER_TIME の秒は 00 にすること
+// - OFF から ON までの待ち時間は分単位に切り上げられる (最短 1 分)
+bool TIMER_OFFLOAD_ENABLED = false;
+
+// 委任中に画面が消灯したら、次の実施の確認 (OFF または ON) の時刻までディープスリープするかどうか
+// - HTTP API と USB シリアル制御プロトコルが無効な場合のみ
+// - 画面に触れると起動し直す (起動し直すとログは消える)
+bool DEEP_SLEEP_ENABLED = false;
+
 //============================================================== */
 // 各種グローバル変数
 // ----------------------------------------------------------------
@@ -46,272 +78,873 @@ char* NAME = "SwitchBot Plug mini (JP)";
 // - 0 を指定するとスリープ無効
 uint32_t SLEEP_TIME = 60000;
 
+// loop() で入力イベントを待つ最大時間 (ミリ秒)
+const uint32_t LOOP_WAIT = 20;
+
+
+// ConfigStore インスタンスの生成 (ユーザー設定を初期値とする)
+ConfigStore configStore(BLE_MAC_ADDR, SSID, PASS, TIMER_TIME, TIMER_INTERVAL, NTP_TIME, SLEEP_TIME);
+
+// 現在の設定 (以降はユーザー設定ではなくこちらを参照する)
+const Config& config = configStore.get();
 
 // SwitchBotPlugMini インスタンスの生成
-SwitchBotPlugMini switchBotPlugMini(BLE_MAC_ADDR);
+SwitchBotPlugMini switchBotPlugMini(config.address);
 
 // LcdController インスタンスの生成
-LcdController lcdController(BLE_MAC_ADDR, NAME, TIMER_TIME);
+LcdController lcdController(config.address, NAME, config.timerStr);
 
 // TimeManager インスタンスの生成
-TimeManager timeManager(SSID, PASS);
+TimeManager timeManager(config.ssid, config.pass);
+
+// HeapMonitor インスタンスの生成
+HeapMonitor heapMonitor;
+
+// InputManager インスタンスの生成
+InputManager inputManager;
+
+// OtaUpdater インスタンスの生成
+OtaUpdater otaUpdater;
+
+// PowerManager インスタンスの生成
+PowerManager powerManager;
+
+// TimerOffload インスタンスの生成
+TimerOffload timerOffload(switchBotPlugMini);
+
+// ディープスリープから起きてから、実施の確認の時刻までの余裕 (秒)
+// - 起動処理 (時刻同期と BLE スキャン) がこの時間内に終わるようにする
+const uint32_t DEEP_SLEEP_WAKE_LEAD = 60;
+
+// ディープスリープから起きたときに、時刻同期と BLE スキャンを再試行する時間の上限 (秒)
+// - 実施の確認の時刻 (OFF の間) に間に合うように DEEP_SLEEP_WAKE_LEAD より十分短くする
+// - 時刻同期できなくても、ディープスリープ中も動いている RTC の時刻で続ける
+const uint32_t WAKE_RETRY_LIMIT = 20;
 
-// ボタンモード (0:初期状態, 1:操作待受, 2:確認, 3:処理中, 4:ログ表示)
+// ディープスリープしない最短の時間 (秒)
+const uint32_t DEEP_SLEEP_MIN = 120;
+
+// ボタンモード (0:初期状態, 1:操作待受, 2:確認, 3:処理中, 4:ログ表示, 5:診断情報表示, 6:電源情報表示, 7:リンク品質表示)
 uint8_t btnmode = 0;
 
 // LCD 省電力モードかどうかのフラグ
 bool sleeping = false;
 
 // LCD に表示した最終時刻 ("hh:mm:ss")
-String last_lcd_time = "";
+char last_lcd_time[TIME_STR_LEN] = "";
+
+// ログの保存数
+const size_t LOG_CAPACITY = 4096;
 
-// 最後にオフ・オンを実施した日付 ("YYYY/MM/DD")
-String last_timer_date = "";
+// ログの保存領域
+LogStore logStore(LOG_CAPACITY);
 
-// 最後に NTP 時刻同期した日付 ("YYYY/MM/DD")
-String last_ntp_date = "";
+// ApiServer インスタンスの生成
+ApiServer apiServer(logStore);
 
-// ログの配列
-vector<LogRecord> logs;
+// SerialController インスタンスの生成
+SerialController serialController(Serial);
 
-// ログの保存数
-const size_t LOG_LIMIT = 14;
+// ログ表示で画面の先頭に表示しているレコードの位置 (新しい順)
+size_t log_top = 0;
+
+// ログ表示中にタッチでスクロールするための画面領域 (上半分: 新しい方へ, 下半分: 古い方へ)
+Button logAreaNewer(0, 0, 320, 110, false, "LogAreaNewer");
+Button logAreaOlder(0, 110, 320, 110, false, "LogAreaOlder");
 
 //============================================================== */
 
 
 // ボタン表示モードを変更
+// - HTTP API の電源の切り替えは操作待受モードのときのみ受け付ける
 void setButtonMode(uint8_t mode) {
   btnmode = mode;
   lcdController.showButtonMenu(btnmode);
+  if (API_ENABLED) {
+    apiServer.setToggleAllowed(btnmode == 1);
+  }
+}
+
+// 電源状態を表示するメイン画面を表示中かどうか
+// - ログ表示中や診断情報・電源情報表示中は false
+bool isMainScreen() {
+  return btnmode <= 3;
+}
+
+// 電波の強さを画面表示
+// - ログ表示中や診断情報表示中は画面を書き換えない
+void showLinkQuality() {
+  if (isMainScreen()) {
+    lcdController.showLinkQuality(switchBotPlugMini.getLinkStats());
+  }
+}
+
+// 電源状態を画面表示して API の利用者に通知
+// - ログ表示中や診断情報表示中は画面を書き換えない
+void showPowerStatus(bool status) {
+  if (isMainScreen()) {
+    lcdController.showPowerStatus(status);
+  }
+  showLinkQuality();
+  if (API_ENABLED) {
+    apiServer.setPowerStatus(status);
+  }
+  if (SERIAL_API_ENABLED) {
+    uint8_t data = status ? 0x01 : 0x00;
+    serialController.sendEvent(SERIAL_EVT_POWER, &data, 1);
+  }
+}
+
+// 電源の ON/OFF を切り替えて画面表示
+void togglePowerStatus() {
+  PowerBusyScope busy(powerManager);
+  bool status;
+  if (switchBotPlugMini.togglePowerStatus(status)) {
+    showPowerStatus(status);
+  } else {
+    showLinkQuality();
+    lcdController.showError(errorCodeToString(switchBotPlugMini.getError()));
+  }
 }
 
 // BLE 接続して電源状態を取得して画面表示
-void getAndShowPowerStatus() {
+// - 電源状態を取得できたら true を返す
+bool getAndShowPowerStatus() {
+  PowerBusyScope busy(powerManager);
   setButtonMode(0);
 
   // BLE 接続
   lcdController.showMessage("Connecting BLE...");
 
   if (!switchBotPlugMini.connect()) {
-    String err = switchBotPlugMini.getError();
-    lcdController.showError(err);
+    showLinkQuality();
+    lcdController.showError(errorCodeToString(switchBotPlugMini.getError()));
     setButtonMode(1);
-    return;
+    return false;
   }
 
   lcdController.showMessage("Getting power status...");
   bool status;
 
   if (switchBotPlugMini.getPowerStatus(status)) {
-    lcdController.showPowerStatus(status);
+    showPowerStatus(status);
   } else {
     lcdController.showPowerStatus(false);
-    String err = switchBotPlugMini.getError();
-    lcdController.showError(err.c_str());
+    showLinkQuality();
+    lcdController.showError(errorCodeToString(switchBotPlugMini.getError()));
     setButtonMode(1);
-    return;
+    return false;
   }
 
   lcdController.showMessage("Disonnecting BLE...");
   switchBotPlugMini.disconnect();
   lcdController.clearMessage();
   setButtonMode(1);
+  return true;
+}
+
+// 現在日時をログのタイムスタンプとして取得
+uint32_t getLogStamp() {
+  RTC_DateTypeDef d;
+  RTC_TimeTypeDef t;
+  timeManager.getRtcDateTime(d, t);
+  return LogStore::packStamp(d.Year, d.Month, d.Date, t.Hours, t.Minutes, t.Seconds);
+}
+
+// ログを追加して API の利用者に通知
+void addLog(bool err, uint8_t code) {
+  LogRecord rec = { getLogStamp(), err, code, 0 };
+  logStore.push(rec.stamp, rec.err, rec.code);
+  if (API_ENABLED) {
+    apiServer.notifyLog(rec);
+  }
+  if (SERIAL_API_ENABLED) {
+    serialController.sendEvent(SERIAL_EVT_LOG, (const uint8_t*)&rec, sizeof(rec));
+  }
+}
+
+// イベントのログを追加
+void pushLog(LogEvent event) {
+  addLog(false, event);
+}
+
+// エラーのログを追加
+void pushErrorLog(ErrorCode code) {
+  addLog(true, code);
+}
+
+// 更新後のファームウェアの動作確認の結果を反映する
+// - 確定できたときだけ LOG_OTA_CONFIRMED を記録する
+// - 失敗ならロールバックして再起動するので、その前に記録して画面に示す
+//   (ログは再起動で消えるが、HTTP API と USB シリアルには通知される)
+void confirmFirmware(bool ok) {
+  if (!otaUpdater.isPendingVerify()) {
+    return;
+  }
+  if (!ok) {
+    pushErrorLog(ERR_OTA_VERIFY_FAILED);
+    lcdController.showError(errorCodeToString(ERR_OTA_VERIFY_FAILED));
+    delay(3000);
+    otaUpdater.confirm(false);
+    return;
+  }
+  if (otaUpdater.confirm(true)) {
+    pushLog(LOG_OTA_CONFIRMED);
+  } else {
+    pushErrorLog(otaUpdater.getError());
+  }
+}
+
+// ログ表示の絞り込み条件を切り替える (ALL -> ERROR -> EVENT -> TODAY -> ALL)
+void cycleLogFilter() {
+  LogFilter filter = logStore.getFilter();
+
+  if (filter.date != 0) {
+    filter = { LOG_TYPE_ALL, 0 };
+  } else if (filter.type == LOG_TYPE_ALL) {
+    filter.type = LOG_TYPE_ERROR;
+  } else if (filter.type == LOG_TYPE_ERROR) {
+    filter.type = LOG_TYPE_EVENT;
+  } else {
+    filter.type = LOG_TYPE_ALL;
+    filter.date = LogStore::stampToDate(getLogStamp());
+  }
+
+  logStore.setFilter(filter);
+  log_top = 0;
+}
+
+// 時刻で実施する処理 (ScheduledTasks) の経過を画面表示とログに反映する
+class SketchTaskListener : public TaskListener {
+public:
+  // 画面が消灯していれば一時的に点灯し、処理中は CPU を高速で動作させる
+  void onTaskBegin() override {
+    if (sleeping == true) {
+      lcdController.wakeup();
+    }
+    setButtonMode(0);
+    powerManager.beginBusy();
+  }
+
+  void onTaskEnd() override {
+    powerManager.endBusy();
+    setButtonMode(1);
+    if (sleeping == true) {
+      lcdController.sleep();
+    }
+  }
+
+  void onMessage(const char* message) override {
+    lcdController.showMessage(message);
+  }
+
+  void onPowerStatus(bool status) override {
+    showPowerStatus(status);
+  }
+
+  void onLog(LogEvent event) override {
+    pushLog(event);
+  }
+
+  void onError(ErrorCode code) override {
+    pushErrorLog(code);
+  }
+
+  // ファームウェア更新後の最初の OFF/ON なら、その結果で確定またはロールバックする
+  void onTimerResult(bool ok) override {
+    confirmFirmware(ok);
+    showLinkQuality();
+  }
+};
+
+SketchTaskListener taskListener;
+
+// ScheduledTasks インスタンスの生成
+ScheduledTasks scheduledTasks(switchBotPlugMini, timerOffload, timeManager, taskListener);
+
+// OFF/ON タイマーをプラグ本体のタイマーに同期する (違うものだけを書き込む)
+void syncTimerOffload() {
+  PowerBusyScope busy(powerManager);
+  scheduledTasks.syncOffload();
+}
+
+// 設定を検証して反映し、変わった項目を各部に反映する
+// - text が空なら SD カードの設定ファイルを読み直す
+// - 検証に失敗したら何も変えない
+bool reloadConfig(const char* text, size_t len) {
+  PowerBusyScope busy(powerManager);
+  if (!configStore.apply(text, len)) {
+    pushErrorLog(configStore.getError());
+    if (sleeping == false && isMainScreen()) {
+      lcdController.showError(errorCodeToString(configStore.getError()));
+    }
+    return false;
+  }
+
+  uint8_t changed = configStore.getChanged();
+  bool redraw = (sleeping == false && isMainScreen());
+
+  // スケジュール (表示は描き直す)
+  if (changed & CONFIG_CHANGED_TIMER) {
+    scheduledTasks.setTimer(config.timerTime, config.timerInterval);
+    if (redraw) {
+      lcdController.updateTimerTime();
+    }
+  }
+  if (changed & CONFIG_CHANGED_NTP) {
+    scheduledTasks.setNtpTime(config.ntpTime);
+  }
+  if (API_ENABLED) {
+    apiServer.setSchedule(config.timerStr, config.timerInterval, config.ntpStr);
+  }
+
+  // Wi-Fi の接続先 (HTTP API を使う場合はすぐに接続し直す)
+  if (changed & CONFIG_CHANGED_WIFI) {
+    timeManager.disconnect();
+    if (API_ENABLED && !timeManager.sync()) {
+      pushErrorLog(timeManager.getError());
+    }
+  }
+
+  // SwitchBot Plug Mini (アドレスの種類を得るためにスキャンし直す)
+  if (changed & CONFIG_CHANGED_ADDRESS) {
+    if (redraw) {
+      lcdController.updateTitle();
+    }
+    if (!switchBotPlugMini.find()) {
+      pushErrorLog(switchBotPlugMini.getError());
+    }
+    timerOffload.reset();
+  }
+
+  // プラグ本体のタイマーを同期し直す
+  if (changed & (CONFIG_CHANGED_TIMER | CONFIG_CHANGED_ADDRESS)) {
+    syncTimerOffload();
+  }
+
+  pushLog(LOG_CONFIG_RELOADED);
+  return true;
+}
+
+// 委任中で画面が消灯していれば、次の実施の確認 (OFF または ON) の時刻の少し前までディープスリープする
+// - 起きると setup() から起動し直す (時刻同期と電源状態の取得を含む)
+// - 動作確認待ちのファームウェアがある場合や、すぐに確認の時刻になる場合は眠らない
+void deepSleepIfIdle(uint32_t secOfDay) {
+  if (!DEEP_SLEEP_ENABLED || API_ENABLED || SERIAL_API_ENABLED) {
+    return;
+  }
+  if (sleeping == false || !timerOffload.isActive() || otaUpdater.isPendingVerify()) {
+    return;
+  }
+
+  const uint32_t day = DailySchedule::SECONDS_PER_DAY;
+  uint32_t verifyTimes[] = { timerOffload.getVerifyTime(), timerOffload.getOnVerifyTime() };
+  uint32_t until = day;
+  for (uint8_t i = 0; i < 2; i++) {
+    uint32_t t = (verifyTimes[i] + day - secOfDay) % day;
+    if (t < until) {
+      until = t;
+    }
+  }
+  // 起きてから確認の時刻までの間 (DEEP_SLEEP_WAKE_LEAD) は眠り直さない
+  if (until < DEEP_SLEEP_WAKE_LEAD + DEEP_SLEEP_MIN) {
+    return;
+  }
+  powerManager.deepSleep(until - DEEP_SLEEP_WAKE_LEAD);
 }
 
-void pushLog(String text, bool err = false) {
-  LogRecord rec = {
-    timeManager.getRtcDateAndTime(),
-    text,
-    err
-  };
+// ファームウェアを更新して再起動する
+// - sha256 は書き込み後のイメージの SHA-256 (16 進数)
+// - 失敗したら false を返す (実行中のファームウェアはそのまま)
+bool updateFirmware(const char* url, const char* sha256) {
+  PowerBusyScope busy(powerManager);
+  setButtonMode(0);
+  lcdController.showMessage("Updating firmware...");
 
-  logs.push_back(rec);
+  bool ok = timeManager.connect() && otaUpdater.update(url, sha256);
+  ErrorCode err = (timeManager.getError() != ERR_NONE) ? timeManager.getError() : otaUpdater.getError();
+  if (!API_ENABLED) {
+    timeManager.disconnect();
+  }
 
-  if (logs.size() > LOG_LIMIT) {
-    logs.erase(logs.begin());
+  if (!ok) {
+    pushErrorLog(err);
+    lcdController.showError(errorCodeToString(err));
+    setButtonMode(1);
+    return false;
   }
+
+  pushLog(LOG_OTA_UPDATED);
+  lcdController.showMessage("Rebooting...");
+  delay(1000);
+  ESP.restart();
+  return true;
+}
+
+// 32 ビット値をリトルエンディアンで書き込む
+uint8_t* putU32(uint8_t* p, uint32_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+  return p + 4;
+}
+
+// USB シリアル経由で受信したコマンドを処理
+uint8_t handleSerialCommand(uint8_t cmd, const uint8_t* args, uint8_t argLen,
+                            uint8_t* out, uint8_t outMax, uint8_t& outLen) {
+  outLen = 0;
+  bool status;
+
+  if (cmd == SERIAL_CMD_STATUS || cmd == SERIAL_CMD_SET || cmd == SERIAL_CMD_TOGGLE) {
+    if (outMax < 1) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+
+    PowerBusyScope busy(powerManager);
+    bool ok;
+    if (cmd == SERIAL_CMD_STATUS) {
+      ok = switchBotPlugMini.getPowerStatus(status);
+    } else if (cmd == SERIAL_CMD_SET) {
+      if (argLen != 1) {
+        return SERIAL_STATUS_BAD_ARGS;
+      }
+      status = (args[0] != 0x00);
+      ok = switchBotPlugMini.setPowerStatus(status);
+    } else {
+      ok = switchBotPlugMini.togglePowerStatus(status);
+    }
+
+    if (!ok) {
+      return switchBotPlugMini.getError();
+    }
+
+    showPowerStatus(status);
+    out[0] = status ? 0x01 : 0x00;
+    outLen = 1;
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_DUMP_LOG) {
+    // 新しい順に start 番目から count 件 (LogRecord をそのまま並べる)
+    if (argLen != 3) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    size_t start = args[0] | (args[1] << 8);
+    size_t count = args[2];
+    size_t n = 0;
+    LogRecord rec;
+    while (n < count && (n + 1) * sizeof(rec) <= outMax && logStore.get(start + n, rec)) {
+      memcpy(out + n * sizeof(rec), &rec, sizeof(rec));
+      n++;
+    }
+    outLen = n * sizeof(rec);
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_DUMP_METRICS) {
+    // 32 ビット値 (LE) の並び
+    if (outMax < 4 * 34) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    const HeapStats& hs = heapMonitor.getStats();
+    const InputStats& is = inputManager.getStats();
+    uint8_t* p = out;
+    p = putU32(p, millis());
+    p = putU32(p, hs.freeSize);
+    p = putU32(p, hs.minFreeSize);
+    p = putU32(p, hs.largestBlock);
+    p = putU32(p, hs.minLargestBlock);
+    p = putU32(p, hs.fragmentation);
+    p = putU32(p, is.count);
+    p = putU32(p, is.dropped);
+    p = putU32(p, is.last);
+    p = putU32(p, is.avg);
+    p = putU32(p, is.max);
+    p = putU32(p, serialController.getDropped());
+    const BleStats& bs = switchBotPlugMini.getStats();
+    p = putU32(p, bs.initHeap);
+    p = putU32(p, bs.connects);
+    p = putU32(p, bs.failures);
+    p = putU32(p, bs.lastConnectMs);
+    p = putU32(p, bs.maxConnectMs);
+    const OtaStats& os = otaUpdater.getStats();
+    p = putU32(p, os.delta);
+    p = putU32(p, os.transferBytes);
+    p = putU32(p, os.imageBytes);
+    p = putU32(p, os.applyMs);
+    // 消費電流は 0.1mA 単位の符号付き整数
+    PowerStats ps = powerManager.getStats();
+    p = putU32(p, (int32_t)(ps.loadCurrent * 10));
+    for (uint8_t i = 0; i < POWER_MODE_NUM; i++) {
+      p = putU32(p, (int32_t)(ps.modes[i].avgMa * 10));
+    }
+    // RSSI は dBm の符号付き整数
+    const LinkStats& ls = switchBotPlugMini.getLinkStats();
+    p = putU32(p, (int32_t)ls.avgRssi);
+    p = putU32(p, ls.mtu);
+    p = putU32(p, ls.retries);
+    const OffloadStats& fs = timerOffload.getStats();
+    p = putU32(p, fs.state);
+    p = putU32(p, fs.verified);
+    p = putU32(p, fs.fallbacks);
+    p = putU32(p, bs.avgConnectMs);
+    p = putU32(p, bs.connectHeap);
+    outLen = p - out;
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_CONFIG) {
+    // 引数は "key=value" の行の並び (空なら SD カードの設定ファイルを読み直す)
+    if (!reloadConfig((const char*)args, argLen)) {
+      return configStore.getError();
+    }
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_OTA) {
+    // 引数は URL と書き込み後のイメージの SHA-256 (16 進数) を改行で区切ったもの
+    // (成功すると応答を返さずに再起動する)
+    char url[256];
+    const uint8_t* sep = (const uint8_t*)memchr(args, '\n', argLen);
+    if (argLen >= sizeof(url) || sep == nullptr || sep == args) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    memcpy(url, args, argLen);
+    url[argLen] = '\0';
+    url[sep - args] = '\0';
+    if (!updateFirmware(url, url + (sep - args) + 1)) {
+      return (timeManager.getError() != ERR_NONE) ? timeManager.getError() : otaUpdater.getError();
+    }
+    return SERIAL_STATUS_OK;
+  }
+
+  return SERIAL_STATUS_UNKNOWN_CMD;
 }
 
 void setup() {
   M5.begin();
 
+  // ログの領域を事前に確保 (以降はヒープ確保が発生しない)
+  logStore.init();
+
+  // 設定を読み込む (SD カード -> NVS -> ユーザー設定 の順)
+  bool configLoaded = configStore.load();
+
+  // 前回のファームウェア更新の統計情報を読み込む
+  otaUpdater.init();
+
+  // OFF/ON タイマーの委任をやめたかどうかを読み込む
+  timerOffload.init();
+
   // 各種ライブラリの準備
   lcdController.init();
   timeManager.init();
 
+  // 設定ファイルが不正 (大きすぎる場合を含む) なら、NVS の設定で起動することを画面に示す
+  if (!configLoaded) {
+    lcdController.showError(errorCodeToString(configStore.getError()));
+    delay(3000);
+  }
+
+  // ディープスリープから起きた場合は、実施の確認の時刻に間に合うように再試行の時間を限る
+  bool timedWake = powerManager.wokeByTimer();
+  uint32_t wakeMs = millis();
+
   // Wi-Fi 接続して NTP 時刻同期
+  // - HTTP API を使う場合は Wi-Fi 接続を維持する
+  timeManager.setKeepConnected(API_ENABLED);
   lcdController.showMessage("Syncing time using NTP...");
-  while (!timeManager.sync()) {
+  bool synced = false;
+  while (!(synced = timeManager.sync())) {
+    otaUpdater.checkVerifyTimeout();
+    if (timedWake && millis() - wakeMs >= WAKE_RETRY_LIMIT * 1000) {
+      break;
+    }
     delay(5000);
   }
 
+  // 設定ファイルが不正なら記録する (時刻同期後でないと日時が正しくない)
+  if (!configLoaded) {
+    pushErrorLog(configStore.getError());
+  }
+  if (!synced) {
+    pushErrorLog(timeManager.getError());
+  }
+
+  // スケジュールの時刻をセット
+  scheduledTasks.setTimer(config.timerTime, config.timerInterval);
+  scheduledTasks.setNtpTime(config.ntpTime);
+  scheduledTasks.setOffloadEnabled(TIMER_OFFLOAD_ENABLED);
+
+  // USB シリアル経由の制御を開始
+  if (SERIAL_API_ENABLED) {
+    serialController.setHandler(handleSerialCommand);
+  }
+
+  // HTTP API を開始
+  if (API_ENABLED) {
+    apiServer.setSchedule(config.timerStr, config.timerInterval, config.ntpStr);
+    apiServer.setToken(config.token);
+    apiServer.begin();
+  }
+
   // 現在時刻を表示
-  String time = timeManager.getRtcTime();
+  char time[TIME_STR_LEN];
+  timeManager.getRtcTime(time, sizeof(time));
   lcdController.showCurrentTime(time);
 
   // BLE スキャン開始
   lcdController.showMessage("Scaning BLE devices...");
-  BLEAdvertisedDevice device;
+  switchBotPlugMini.init();
   bool found = false;
 
   while (found == false) {
-    found = switchBotPlugMini.find(device);
+    otaUpdater.checkVerifyTimeout();
+    found = switchBotPlugMini.find();
+    if (!found && timedWake && millis() - wakeMs >= WAKE_RETRY_LIMIT * 1000) {
+      pushErrorLog(switchBotPlugMini.getError());
+      break;
+    }
     delay(100);
   }
 
   // BLE 接続して電源状態を取得して画面表示
-  getAndShowPowerStatus();
+  bool healthy = getAndShowPowerStatus();
 
-  pushLog("SYSTEM_STARTED_UP");
+  pushLog(LOG_SYSTEM_STARTED_UP);
+
+  // OFF/ON タイマーをプラグ本体のタイマーに同期する
+  syncTimerOffload();
+
+  // ファームウェア更新後の最初の起動なら動作確認する
+  // - 電源状態を取得できなければロールバックして再起動する
+  // - OFF/ON タイマーが有効なら、最初の OFF/ON の結果で確定する
+  if (otaUpdater.isPendingVerify()) {
+    if (!healthy || !scheduledTasks.isTimerEnabled()) {
+      confirmFirmware(healthy);
+    }
+  } else if (otaUpdater.wasRolledBack()) {
+    pushLog(LOG_OTA_ROLLED_BACK);
+  }
+
+  // 入力の取り込みを開始
+  inputManager.begin();
+
+  // 以降は BLE/Wi-Fi 通信中以外は CPU を低速で動作させる
+  powerManager.begin();
 }
 
-void loop() {
-  M5.update();
+// 入力イベントを処理
+void handleInput(const InputEvent& ev) {
+  inputManager.markHandled(ev);
+
+  bool btnA = (ev.button == &M5.BtnA);
+  bool btnB = (ev.button == &M5.BtnB);
+  bool btnC = (ev.button == &M5.BtnC);
 
   if (sleeping == true) {
-    // ボタン操作があったら LCD 省電力モードから復帰
-    if (M5.BtnA.wasPressed() || M5.BtnB.wasPressed() || M5.BtnC.wasPressed()) {
-      lcdController.wakeup();
-      if (btnmode == 1) {
-        getAndShowPowerStatus();
-      }
-      sleeping = false;
+    // 何らかの操作があったら LCD 省電力モードから復帰
+    lcdController.wakeup();
+    powerManager.setScreenMode(POWER_ACTIVE);
+    if (btnmode == 1) {
+      getAndShowPowerStatus();
     }
+    sleeping = false;
+    return;
+  }
 
-  } else if (sleeping == false) {
-    if (btnmode == 1) {  // 操作待受モード
-      // ボタン A (LOG) が押されたときの処理
-      if (M5.BtnA.wasPressed()) {
-        setButtonMode(4);
-        lcdController.showLogs(logs);
-      }
+  if (powerManager.getScreenMode() == POWER_DIM) {
+    // 減光中は明るさを戻して、そのまま操作を受け付ける
+    lcdController.brighten();
+    powerManager.setScreenMode(POWER_ACTIVE);
+  }
 
-      // ボタン B (SWITCH) が押されたときの処理
-      if (M5.BtnB.wasPressed()) {
-        setButtonMode(2);  // ボタン確認モード表示
-      }
+  if (btnmode == 1) {  // 操作待受モード
+    // ボタン A (LOG) が押されたときの処理
+    if (btnA) {
+      setButtonMode(4);
+      M5.Lcd.clear();
+      lcdController.showButtonMenu(4);
+      log_top = 0;
+      lcdController.showLogs(logStore, log_top);
+    }
 
-    } else if (btnmode == 2) {  // ボタン確認モード
-      // ボタン A (CANCEL) が押されたときの処理
-      if (M5.BtnA.wasPressed()) {
-        setButtonMode(1);
-      }
+    // ボタン B (SWITCH) が押されたときの処理
+    if (btnB) {
+      setButtonMode(2);  // ボタン確認モード表示
+    }
 
-      // ボタン C (OK) が押されたときの処理
-      if (M5.BtnC.wasPressed()) {
-        setButtonMode(3);  // ボタン処理中 (PROCESSING..) モード表示
+    // ボタン C (INFO) が押されたときの処理
+    if (btnC) {
+      setButtonMode(5);
+      lcdController.showInfoPage();
+      lcdController.showHeapInfo(heapMonitor.getStats());
+      lcdController.showInputInfo(inputManager.getStats());
+      lcdController.showBleInfo(switchBotPlugMini.getStats());
+      lcdController.showOtaInfo(otaUpdater.getStats());
+    }
 
-        // ON/OFF を切り替え
-        bool status;
-        if (switchBotPlugMini.togglePowerStatus(status)) {
-          lcdController.showPowerStatus(status);
-        } else {
-          String msg = switchBotPlugMini.getError();
-          lcdController.showError(msg);
-        }
+  } else if (btnmode == 2) {  // ボタン確認モード
+    // ボタン A (CANCEL) が押されたときの処理
+    if (btnA) {
+      setButtonMode(1);
+    }
 
-        setButtonMode(1);  // ボタン待受モード表示
-      }
+    // ボタン C (OK) が押されたときの処理
+    if (btnC) {
+      setButtonMode(3);  // ボタン処理中 (PROCESSING..) モード表示
 
-    } else if (btnmode == 4) {  // ログ表示モード
-      // ボタン A (BACK) が押されたときの処理
-      if (M5.BtnA.wasPressed()) {
-        // BLE 接続して電源状態を取得して画面表示
-        lcdController.init();
-        getAndShowPowerStatus();
+      // ON/OFF を切り替え
+      togglePowerStatus();
 
-        setButtonMode(1);  // ボタン待受モード表示
-      }
+      setButtonMode(1);  // ボタン待受モード表示
     }
 
-    // 所定時間 (SLEEP_TIME) 以上ボタン操作がないなら LCD 省電力モードに移行
-    if (SLEEP_TIME > 0) {
-      uint32_t now = millis();
-      uint32_t ca = M5.BtnA.lastChange();
-      uint32_t cb = M5.BtnB.lastChange();
-      uint32_t cc = M5.BtnC.lastChange();
-      if (now - ca > SLEEP_TIME && now - cb > SLEEP_TIME && now - cc > SLEEP_TIME) {
-        lcdController.sleep();
-        sleeping = true;
-      }
+  } else if (btnmode == 4) {  // ログ表示モード
+    // ボタン B (FILTER) が押されたときの処理
+    if (btnB) {
+      cycleLogFilter();
+      lcdController.showLogs(logStore, log_top);
     }
-  }
 
-  // 現在日時を取得
-  String date = timeManager.getRtcDate();
-  String time = timeManager.getRtcTime();
+    // ボタン C (OLDER) または画面下半分のタッチで古い方へ 1 ページ送る (末尾なら先頭に戻る)
+    if (btnC || ev.button == &logAreaOlder) {
+      log_top = logStore.olderPage(log_top, LcdController::LOG_ROWS);
+      lcdController.showLogs(logStore, log_top);
+    }
 
-  // 現在日時を表示
-  if (sleeping == false && btnmode != 4) {
-    if (time != last_lcd_time) {
-      lcdController.showCurrentTime(time);
-      last_lcd_time = time;
+    // 画面上半分のタッチで新しい方へ 1 ページ戻る
+    if (ev.button == &logAreaNewer && log_top > 0) {
+      log_top = logStore.newerPage(log_top, LcdController::LOG_ROWS);
+      lcdController.showLogs(logStore, log_top);
     }
-  }
 
-  // タイマーによる OFF/ON 実施
-  if (date != last_timer_date) {
-    if (time == String(TIMER_TIME)) {
-      if (sleeping == true) {
-        lcdController.wakeup();
-      }
+    // ボタン A (BACK) が押されたときの処理
+    if (btnA) {
+      // BLE 接続して電源状態を取得して画面表示
+      lcdController.init();
+      getAndShowPowerStatus();
+
+      setButtonMode(1);  // ボタン待受モード表示
+    }
 
-      setButtonMode(0);
+  } else if (btnmode >= 5 && btnmode <= 7) {  // 診断情報・電源情報・リンク品質表示モード
+    // ボタン A (BACK) が押されたときの処理
+    if (btnA) {
+      // BLE 接続して電源状態を取得して画面表示
+      lcdController.init();
+      getAndShowPowerStatus();
 
-      // デバイスを OFF する
-      last_timer_date = date;
-      lcdController.showMessage("TIMER: Turning off...");
-      if (switchBotPlugMini.setPowerStatus(false)) {
-        pushLog("TIMER_TURNED_OFF");
-      } else {
-        pushLog(switchBotPlugMini.getError(), true);
-      }
+      setButtonMode(1);  // ボタン待受モード表示
+    }
 
-      // 少し待つ
-      lcdController.showMessage("TIMER: Waiting...");
-      delay(TIMER_INTERVAL);
+    // ボタン C (POWER / LINK / INFO) が押されたときの処理
+    if (btnC && btnmode == 5) {
+      setButtonMode(6);
+      lcdController.showPowerPage();
+      lcdController.showPowerInfo(powerManager.getStats());
+    } else if (btnC && btnmode == 6) {
+      setButtonMode(7);
+      lcdController.showLinkPage();
+      lcdController.showLinkInfo(switchBotPlugMini.getLinkStats());
+      lcdController.showOffloadInfo(timerOffload.getStats());
+    } else if (btnC && btnmode == 7) {
+      setButtonMode(5);
+      lcdController.showInfoPage();
+      lcdController.showHeapInfo(heapMonitor.getStats());
+      lcdController.showInputInfo(inputManager.getStats());
+      lcdController.showBleInfo(switchBotPlugMini.getStats());
+      lcdController.showOtaInfo(otaUpdater.getStats());
+    }
+  }
+}
 
-      // デバイスを ON する
-      lcdController.showMessage("TIMER: Turning on...");
-      if (switchBotPlugMini.setPowerStatus(true)) {
-        pushLog("TIMER_TURNED_ON");
-      } else {
-        pushLog(switchBotPlugMini.getError(), true);
-      }
+void loop() {
+  // 入力イベントを待って処理する
+  // - イベントが届けば待ち時間の途中でもすぐに処理する
+  InputEvent ev;
+  if (inputManager.receive(ev, LOOP_WAIT)) {
+    do {
+      handleInput(ev);
+    } while (inputManager.receive(ev, 0));
+  }
 
+  // HTTP API のリクエストを処理
+  if (API_ENABLED) {
+    apiServer.handle();
+
+    // 電源の切り替え要求があれば実施 (操作待受モード以外では受け付けていない)
+    if (apiServer.takeToggleRequest() && btnmode == 1) {
+      setButtonMode(3);
+      togglePowerStatus();
       setButtonMode(1);
+    }
 
-      if (sleeping == true) {
-        lcdController.sleep();
-      }
+    // 設定の反映要求があれば実施 (結果は config イベントで通知する)
+    const char* text;
+    size_t len;
+    if (apiServer.takeConfigRequest(text, len)) {
+      bool ok = reloadConfig(text, len);
+      apiServer.notifyConfig(ok, errorCodeToString(configStore.getError()));
+    }
+
+    // ファームウェアの更新要求があれば実施 (成功したら再起動する)
+    const char* url;
+    const char* sha256;
+    if (apiServer.takeOtaRequest(url, sha256)) {
+      updateFirmware(url, sha256);
+      ErrorCode err = (timeManager.getError() != ERR_NONE) ? timeManager.getError() : otaUpdater.getError();
+      apiServer.notifyOta(false, errorCodeToString(err));
     }
   }
 
-  // NTP 時刻同期
-  if (date != last_ntp_date) {
-    if (time == String(NTP_TIME)) {
-      if (sleeping == true) {
-        lcdController.wakeup();
-      }
+  // USB シリアル経由のコマンドを処理
+  if (SERIAL_API_ENABLED) {
+    serialController.handle();
+  }
 
-      setButtonMode(0);
+  // 操作がない時間に応じて画面を減光し、所定時間 (config.sleepTime) 以上
+  // 操作がないなら LCD 省電力モードに移行
+  if (sleeping == false && config.sleepTime > 0) {
+    uint32_t idle = millis() - inputManager.getLastActivity();
+    if (idle > config.sleepTime) {
+      lcdController.sleep();
+      powerManager.setScreenMode(POWER_OFF);
+      sleeping = true;
+    } else if (idle > config.sleepTime / 2 && powerManager.getScreenMode() == POWER_ACTIVE) {
+      lcdController.dim();
+      powerManager.setScreenMode(POWER_DIM);
+    }
+  }
 
-      // Wi-Fi 接続して NTP 時刻同期
-      lcdController.showMessage("Syncing time using NTP...");
-      if (timeManager.sync()) {
-        pushLog("NTP_TIME_SYNCHRONIZED");
-      } else {
-        pushLog(timeManager.getError(), true);
-      }
+  // 電源の計測値を更新 (電源情報表示中なら表示も更新)
+  if (powerManager.sample()) {
+    if (sleeping == false && btnmode == 6) {
+      lcdController.showPowerInfo(powerManager.getStats());
+    }
+  }
 
-      setButtonMode(1);
+  // ヒープの統計情報を更新 (診断情報表示中なら表示も更新)
+  if (heapMonitor.sample()) {
+    if (sleeping == false && btnmode == 5) {
+      lcdController.showHeapInfo(heapMonitor.getStats());
+      lcdController.showInputInfo(inputManager.getStats());
+      lcdController.showBleInfo(switchBotPlugMini.getStats());
+      lcdController.showOtaInfo(otaUpdater.getStats());
+    }
+  }
 
-      if (sleeping == true) {
-        lcdController.sleep();
-      }
+  // 時刻になった OFF/ON タイマーと NTP 時刻同期を実施
+  scheduledTasks.run();
+
+  // 現在日時を表示 (run() で RTC から読んだもの)
+  if (sleeping == false && isMainScreen()) {
+    uint32_t sec = scheduledTasks.getSecOfDay();
+    char time[TIME_STR_LEN];
+    snprintf(time, sizeof(time), "%02d:%02d:%02d", (int)(sec / 3600), (int)(sec / 60 % 60), (int)(sec % 60));
+    if (strcmp(time, last_lcd_time) != 0) {
+      lcdController.showCurrentTime(time);
+      strcpy(last_lcd_time, time);
     }
   }
 
-  delay(20);
+  // 委任中で画面が消灯していればディープスリープする
+  deepSleepIfIdle(scheduledTasks.getSecOfDay());
 }
@@ -0,0 +1,370 @@
+/* ----------------------------------------------------------------
+  ApiServerTest.cpp
+  - ApiServer のリクエストの処理と、同時接続時の性能を確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "ApiServer.h"
+#include "LogStore.h"
+
+namespace {
+
+// ループバックで接続する
+int connectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// リクエストを送って、接続が閉じられるまでのレスポンスを返す
+std::string request(uint16_t port, const std::string& req) {
+  int fd = connectTo(port);
+  if (fd < 0) {
+    return "";
+  }
+  size_t sent = 0;
+  while (sent < req.size()) {
+    ssize_t n = send(fd, req.data() + sent, req.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  std::string res;
+  char buf[1024];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    res.append(buf, n);
+  }
+  close(fd);
+  return res;
+}
+
+}  // namespace
+
+class ApiServerTest : public ::testing::Test {
+protected:
+  LogStore logStore{ 64 };
+  ApiServer apiServer{ logStore };
+  std::atomic<bool> running{ false };
+  std::thread loop;
+  uint16_t port = 0;
+
+  void SetUp() override {
+    ASSERT_TRUE(this->logStore.init());
+    for (uint8_t i = 0; i < 40; i++) {
+      this->logStore.push(LogStore::packStamp(2025, 1, 22, 5, 0, i), false, 1);
+    }
+    this->apiServer.setSchedule("05:00:00", 5000, "03:00:00");
+    this->apiServer.setPowerStatus(true);
+    this->apiServer.setToggleAllowed(true);
+    this->apiServer.begin();
+    this->port = hostWiFiPort();
+    this->startLoop();
+  }
+
+  void TearDown() override {
+    this->stopLoop();
+  }
+
+  // loop() の代わりに handle() を呼び続けるスレッドを開始する
+  void startLoop() {
+    this->running = true;
+    this->loop = std::thread([this]() {
+      while (this->running) {
+        this->apiServer.handle();
+      }
+    });
+  }
+
+  // handle() を呼ぶスレッドを止める
+  void stopLoop() {
+    this->running = false;
+    if (this->loop.joinable()) {
+      this->loop.join();
+    }
+  }
+};
+
+TEST_F(ApiServerTest, Status) {
+  std::string res = request(this->port, "GET /status HTTP/1.1\r\nHost: plug\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << res;
+  EXPECT_NE(res.find("{\"power\":true,"), std::string::npos) << res;
+}
+
+TEST_F(ApiServerTest, LogsAreLimited) {
+  std::string res = request(this->port, "GET /logs?n=100 HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << res;
+  size_t count = 0;
+  for (size_t p = res.find("\"line\""); p != std::string::npos; p = res.find("\"line\"", p + 1)) {
+    count++;
+  }
+  EXPECT_EQ(count, 30u);
+}
+
+// 件数はキー全体が "n" のものだけを使う
+TEST_F(ApiServerTest, LogsQueryMatchesWholeKey) {
+  auto count = [&](const std::string& query) {
+    std::string res = request(this->port, "GET /logs?" + query + " HTTP/1.1\r\n\r\n");
+    size_t n = 0;
+    for (size_t p = res.find("\"line\""); p != std::string::npos; p = res.find("\"line\"", p + 1)) {
+      n++;
+    }
+    return n;
+  };
+  EXPECT_EQ(count("n=3"), 3u);
+  EXPECT_EQ(count("nn=3&n=5"), 5u);
+  EXPECT_EQ(count("sn=3"), 10u);
+  EXPECT_EQ(count("a=1&n=2&b=3"), 2u);
+  EXPECT_EQ(count("n"), 10u);
+}
+
+TEST_F(ApiServerTest, UnknownPath) {
+  std::string res = request(this->port, "GET /nothing HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 404 ", 0), 0u) << res;
+}
+
+// バッファ (512 バイト) に収まらないヘッダーには 431 を返す
+TEST_F(ApiServerTest, OversizedHeaderIsRejected) {
+  std::string req = "GET /status HTTP/1.1\r\nCookie: " + std::string(600, 'x') + "\r\n\r\n";
+  std::string res = request(this->port, req);
+  EXPECT_EQ(res.rfind("HTTP/1.1 431 ", 0), 0u) << res;
+
+  // 続くリクエストは通常どおり処理する
+  res = request(this->port, "GET /status HTTP/1.1\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 200 ", 0), 0u) << res;
+}
+
+// ヘッダーの途中で途切れたら 408 を返す
+TEST_F(ApiServerTest, IncompleteHeaderTimesOut) {
+  std::string res = request(this->port, "GET /status HTTP/1.1\r\nHost: plug\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 408 ", 0), 0u) << res;
+}
+
+// handle() は受信を待たず、分かれて届いたヘッダーとボディを続きの呼び出しで読む
+TEST_F(ApiServerTest, HandleDoesNotWaitForData) {
+  this->stopLoop();
+  static char token[] = "secret";
+  this->apiServer.setToken(token);
+
+  int fd = connectTo(this->port);
+  ASSERT_GE(fd, 0);
+  const std::string body = "sleep=0\n";
+  const std::string parts[] = {
+    "POST /config HTTP/1.1\r\n",
+    "Authorization: Bearer secret\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n",
+    body.substr(0, 3),
+    body.substr(3),
+  };
+
+  // 届いている分だけ読んで、すぐに戻る
+  double longest = 0;
+  for (const std::string& part : parts) {
+    ASSERT_EQ(send(fd, part.data(), part.size(), MSG_NOSIGNAL), (ssize_t)part.size());
+    for (int i = 0; i < 5; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      auto t0 = std::chrono::steady_clock::now();
+      this->apiServer.handle();
+      auto t1 = std::chrono::steady_clock::now();
+      longest = std::max(longest, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+  }
+  EXPECT_LT(longest, 20.0);
+
+  std::string res;
+  char buf[256];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    res.append(buf, n);
+  }
+  close(fd);
+  EXPECT_EQ(res.rfind("HTTP/1.1 202 ", 0), 0u) << res;
+
+  const char* text;
+  size_t len;
+  ASSERT_TRUE(this->apiServer.takeConfigRequest(text, len));
+  EXPECT_EQ(std::string(text, len), body);
+}
+
+// ボディが Content-Length に満たないまま途切れたら 400 を返す
+TEST_F(ApiServerTest, IncompleteBodyIsRejected) {
+  static char token[] = "secret";
+  this->stopLoop();
+  this->apiServer.setToken(token);
+  this->startLoop();
+
+  std::string res = request(this->port, "POST /config HTTP/1.1\r\nAuthorization: Bearer secret\r\n"
+                                        "Content-Length: 20\r\n\r\nsleep=0\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 400 ", 0), 0u) << res;
+
+  this->stopLoop();
+  const char* text;
+  size_t len;
+  EXPECT_FALSE(this->apiServer.takeConfigRequest(text, len));
+}
+
+// 電源の切り替えは受け付けられる間だけ 202 を返し、要求を取り出せる
+TEST_F(ApiServerTest, ToggleIsRejectedWhenNotAllowed) {
+  std::string res = request(this->port, "POST /toggle HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 202 ", 0), 0u) << res;
+
+  this->stopLoop();
+  this->apiServer.setToggleAllowed(false);
+  this->startLoop();
+  res = request(this->port, "POST /toggle HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 409 ", 0), 0u) << res;
+
+  this->stopLoop();
+  EXPECT_TRUE(this->apiServer.takeToggleRequest());
+  EXPECT_FALSE(this->apiServer.takeToggleRequest());
+}
+
+// 設定の変更はトークンが一致する場合だけ受け付ける
+TEST_F(ApiServerTest, ConfigRequiresToken) {
+  const std::string body = "sleep=0\n";
+  auto post = [&](const std::string& auth) {
+    return request(this->port, "POST /config HTTP/1.1\r\n" + auth + "Content-Length: "
+                               + std::to_string(body.size()) + "\r\n\r\n" + body);
+  };
+
+  // トークンが設定されていなければ受け付けない
+  std::string res = post("Authorization: Bearer secret\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 403 ", 0), 0u) << res;
+
+  this->stopLoop();
+  static char token[] = "secret";
+  this->apiServer.setToken(token);
+  this->startLoop();
+
+  res = post("");
+  EXPECT_EQ(res.rfind("HTTP/1.1 401 ", 0), 0u) << res;
+  res = post("Authorization: Bearer secre\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 401 ", 0), 0u) << res;
+  res = post("Authorization: Bearer secrets\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 401 ", 0), 0u) << res;
+
+  this->stopLoop();
+  const char* text;
+  size_t len;
+  EXPECT_FALSE(this->apiServer.takeConfigRequest(text, len));
+  this->startLoop();
+
+  res = post("authorization: Bearer secret\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 202 ", 0), 0u) << res;
+
+  this->stopLoop();
+  ASSERT_TRUE(this->apiServer.takeConfigRequest(text, len));
+  EXPECT_EQ(std::string(text, len), body);
+}
+
+// ファームウェアの更新はトークンと書き込み後のイメージの SHA-256 が必要
+TEST_F(ApiServerTest, OtaRequiresTokenAndHash) {
+  const std::string url = "http://192.168.1.2:8000/new.delta";
+  const std::string hash(64, 'a');
+  auto post = [&](const std::string& auth, const std::string& body) {
+    return request(this->port, "POST /ota HTTP/1.1\r\n" + auth + "Content-Length: "
+                               + std::to_string(body.size()) + "\r\n\r\n" + body);
+  };
+
+  std::string res = post("Authorization: Bearer secret\r\n", url + "\n" + hash);
+  EXPECT_EQ(res.rfind("HTTP/1.1 403 ", 0), 0u) << res;
+
+  this->stopLoop();
+  static char token[] = "secret";
+  this->apiServer.setToken(token);
+  this->startLoop();
+
+  res = post("", url + "\n" + hash);
+  EXPECT_EQ(res.rfind("HTTP/1.1 401 ", 0), 0u) << res;
+
+  // SHA-256 がない、または 64 文字の 16 進数でない
+  const std::string auth = "Authorization: Bearer secret\r\n";
+  res = post(auth, url);
+  EXPECT_EQ(res.rfind("HTTP/1.1 400 ", 0), 0u) << res;
+  res = post(auth, url + "\n" + hash.substr(1));
+  EXPECT_EQ(res.rfind("HTTP/1.1 400 ", 0), 0u) << res;
+  res = post(auth, url + "\n" + std::string(64, 'g'));
+  EXPECT_EQ(res.rfind("HTTP/1.1 400 ", 0), 0u) << res;
+
+  this->stopLoop();
+  const char* u;
+  const char* h;
+  EXPECT_FALSE(this->apiServer.takeOtaRequest(u, h));
+  this->startLoop();
+
+  res = post(auth, url + "\r\n" + hash + "\r\n");
+  EXPECT_EQ(res.rfind("HTTP/1.1 202 ", 0), 0u) << res;
+
+  this->stopLoop();
+  ASSERT_TRUE(this->apiServer.takeOtaRequest(u, h));
+  EXPECT_EQ(std::string(u), url);
+  EXPECT_EQ(std::string(h), hash);
+}
+
+// 同時に接続する複数のクライアントから GET /status を繰り返し、
+// スループット (リクエスト/秒) と応答時間の 99 パーセンタイルを計測する
+TEST_F(ApiServerTest, ConcurrentClientsLoad) {
+  const size_t clients = 8;
+  const size_t perClient = 250;
+  std::vector<std::vector<double>> latencies(clients);
+  std::atomic<size_t> failures(0);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t c = 0; c < clients; c++) {
+    threads.emplace_back([&, c]() {
+      for (size_t i = 0; i < perClient; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::string res = request(this->port, "GET /status HTTP/1.1\r\nHost: plug\r\n\r\n");
+        auto t1 = std::chrono::steady_clock::now();
+        if (res.rfind("HTTP/1.1 200 ", 0) != 0) {
+          failures++;
+        }
+        latencies[c].push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<double> all;
+  for (auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  double rps = all.size() / elapsed;
+  double p50 = all[all.size() / 2];
+  double p99 = all[all.size() * 99 / 100];
+
+  printf("[ load     ] %zu clients x %zu requests: %.0f req/s, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         clients, perClient, rps, p50, p99, all.back());
+  RecordProperty("rps", (int)rps);
+  RecordProperty("p99_us", (int)(p99 * 1000));
+
+  EXPECT_EQ(failures.load(), 0u);
+  // 1 リクエストずつ処理するので、待たされても受信待ちの上限 (200ms) 程度に収まる
+  EXPECT_LT(p99, 200.0);
+}
@@ -0,0 +1,317 @@
+/* ----------------------------------------------------------------
+  ConfigStoreTest.cpp
+  - ConfigStore の設定の検証、読み込み元の順 (SD カード -> NVS -> 初期値)、
+    NVS への書き込みの省略、反映に失敗したときに現在の設定が変わらないことを確認する
+  - SD カードと NVS はメモリ上の代替 (SD, Preferences) を使う
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <Preferences.h>
+#include <SD.h>
+#include "ConfigStore.h"
+#include "DailySchedule.h"
+
+namespace {
+
+const char* SD_PATH = "/switchbot-plug-timer.cfg";
+const char* SD_TMP_PATH = "/switchbot-plug-timer.tmp";
+
+// SD カードの設定ファイル (初期値とはすべての項目が違う)
+const char* SD_TEXT =
+  "# comment\r\n"
+  "mac=11:22:33:44:55:66\r\n"
+  "\r\n"
+  "ssid=home\r\n"
+  "pass=secret\r\n"
+  "timer=04:30:00\r\n"
+  "interval=8000\r\n"
+  "ntp=02:15:00\r\n"
+  "sleep=60000\r\n"
+  "token=abc\r\n";
+
+class ConfigStoreTest : public testing::Test {
+protected:
+  void SetUp() override {
+    hostSdClear();
+    hostPreferencesClear();
+  }
+
+  // スケッチに書かれた初期値
+  static ConfigStore defaults() {
+    return ConfigStore("aa:bb:cc:dd:ee:ff", "ssid", "pass", "05:00:00", 5000, "03:00:00", 30000);
+  }
+
+  static bool apply(ConfigStore& store, const char* text) {
+    return store.apply(text, strlen(text));
+  }
+
+  // 2 つの設定が同じかどうか
+  static void expectSame(const Config& a, const Config& b) {
+    EXPECT_EQ(0, memcmp(a.mac, b.mac, sizeof(a.mac)));
+    EXPECT_STREQ(a.ssid, b.ssid);
+    EXPECT_STREQ(a.pass, b.pass);
+    EXPECT_EQ(a.timerTime, b.timerTime);
+    EXPECT_EQ(a.timerInterval, b.timerInterval);
+    EXPECT_EQ(a.ntpTime, b.ntpTime);
+    EXPECT_EQ(a.sleepTime, b.sleepTime);
+    EXPECT_STREQ(a.token, b.token);
+    EXPECT_STREQ(a.address, b.address);
+    EXPECT_STREQ(a.timerStr, b.timerStr);
+    EXPECT_STREQ(a.ntpStr, b.ntpStr);
+  }
+
+  // SD_TEXT の内容かどうか
+  static void expectSdText(const Config& c) {
+    EXPECT_STREQ("11:22:33:44:55:66", c.address);
+    EXPECT_STREQ("home", c.ssid);
+    EXPECT_STREQ("secret", c.pass);
+    EXPECT_EQ(4u * 3600 + 30 * 60, c.timerTime);
+    EXPECT_STREQ("04:30:00", c.timerStr);
+    EXPECT_EQ(8000, c.timerInterval);
+    EXPECT_EQ(2u * 3600 + 15 * 60, c.ntpTime);
+    EXPECT_STREQ("02:15:00", c.ntpStr);
+    EXPECT_EQ(60000u, c.sleepTime);
+    EXPECT_STREQ("abc", c.token);
+  }
+};
+
+}  // namespace
+
+// 初期値の変換
+TEST_F(ConfigStoreTest, DefaultsAreParsed) {
+  ConfigStore store = defaults();
+  EXPECT_EQ(ERR_NONE, store.getError());
+  EXPECT_TRUE(store.load());
+  EXPECT_EQ(CONFIG_SOURCE_DEFAULT, store.getSource());
+
+  const Config& c = store.get();
+  EXPECT_STREQ("aa:bb:cc:dd:ee:ff", c.address);
+  EXPECT_EQ(5u * 3600, c.timerTime);
+  EXPECT_EQ(5000, c.timerInterval);
+  EXPECT_EQ(3u * 3600, c.ntpTime);
+  EXPECT_EQ(30000u, c.sleepTime);
+  EXPECT_STREQ("", c.token);
+
+  // 不正な初期値はエラーにする
+  ConfigStore bad("aa:bb:cc:dd:ee", "ssid", "pass", "05:00:00", 5000, "03:00:00", 30000);
+  EXPECT_EQ(ERR_CONFIG_INVALID, bad.getError());
+}
+
+// 不正な行や範囲外の値は、1 つでもあれば何も反映しない
+TEST_F(ConfigStoreTest, MalformedValuesAreRejected) {
+  const char* texts[] = {
+    "ntp=04:00:00\nnoequal\n",
+    "ntp=04:00:00\nunknown=1\n",
+    "mac=11:22:33:44:55\n",
+    "mac=11-22-33-44-55-66\n",
+    "mac=11:22:33:44:55:6g\n",
+    "ssid=\n",
+    "ssid=123456789012345678901234567890123\n",
+    "timer=24:00:00\n",
+    "timer=05:60:00\n",
+    "timer=5:00:00\n",
+    "ntp=03:00\n",
+    "interval=65536\n",
+    "interval=-1\n",
+    "interval=\n",
+    "interval=100ms\n",
+    "sleep= 1000\n",
+    "sleep=4294967296000\n",
+    "ntp=04:00:00\nssid=0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789\n",
+  };
+
+  ConfigStore store = defaults();
+  ASSERT_TRUE(store.load());
+  Config before = store.get();
+
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    SCOPED_TRACE(texts[i]);
+    EXPECT_FALSE(apply(store, texts[i]));
+    EXPECT_EQ(ERR_CONFIG_INVALID, store.getError());
+    EXPECT_EQ(0, store.getChanged());
+    expectSame(before, store.get());
+  }
+  EXPECT_EQ(0u, hostPreferencesWrites());
+
+  // 境界の値は受け付ける (空の時刻は無効)
+  EXPECT_TRUE(apply(store, "interval=65535\ntimer=23:59:59\nntp=\nsleep=0\n"));
+  EXPECT_EQ(65535, store.get().timerInterval);
+  EXPECT_EQ(23u * 3600 + 59 * 60 + 59, store.get().timerTime);
+  const uint32_t day = DailySchedule::SECONDS_PER_DAY;
+  EXPECT_EQ(day, store.get().ntpTime);
+  EXPECT_STREQ("", store.get().ntpStr);
+  EXPECT_EQ(CONFIG_CHANGED_TIMER | CONFIG_CHANGED_NTP | CONFIG_CHANGED_SLEEP, store.getChanged());
+}
+
+// 起動時の読み込みは SD カード -> NVS -> 初期値 の順
+TEST_F(ConfigStoreTest, LoadFallsBackFromSdToNvsToDefault) {
+  // SD カードの設定ファイルは NVS にも保存する
+  hostSdWrite(SD_PATH, SD_TEXT);
+  {
+    ConfigStore store = defaults();
+    EXPECT_TRUE(store.load());
+    EXPECT_EQ(CONFIG_SOURCE_SD, store.getSource());
+    expectSdText(store.get());
+  }
+  EXPECT_EQ(1u, hostPreferencesWrites());
+
+  // 設定ファイルがなければ NVS
+  hostSdClear();
+  {
+    ConfigStore store = defaults();
+    EXPECT_TRUE(store.load());
+    EXPECT_EQ(CONFIG_SOURCE_NVS, store.getSource());
+    expectSdText(store.get());
+  }
+
+  // 不正な設定ファイルは使わずに NVS (エラーは報告する)
+  hostSdWrite(SD_PATH, "ntp=04:00:00\ntimer=25:00:00\n");
+  {
+    ConfigStore store = defaults();
+    EXPECT_FALSE(store.load());
+    EXPECT_EQ(ERR_CONFIG_INVALID, store.getError());
+    EXPECT_EQ(CONFIG_SOURCE_NVS, store.getSource());
+    expectSdText(store.get());
+  }
+
+  // バッファに収まらない設定ファイルも一部だけを使わずに NVS
+  std::string large(SD_TEXT);
+  large += "ntp=04:00:00\n";
+  large += std::string(CONFIG_TEXT_MAX, '#');
+  hostSdWrite(SD_PATH, large);
+  {
+    ConfigStore store = defaults();
+    EXPECT_FALSE(store.load());
+    EXPECT_EQ(ERR_CONFIG_INVALID, store.getError());
+    EXPECT_EQ(CONFIG_SOURCE_NVS, store.getSource());
+    expectSdText(store.get());
+  }
+
+  // NVS の設定が壊れていれば初期値
+  {
+    Preferences prefs;
+    prefs.begin("plugtimer", false);
+    uint8_t broken[16] = {};
+    prefs.putBytes("config", broken, sizeof(broken));
+    prefs.end();
+  }
+  {
+    ConfigStore store = defaults();
+    ConfigStore expected = defaults();
+    EXPECT_FALSE(store.load());
+    EXPECT_EQ(CONFIG_SOURCE_DEFAULT, store.getSource());
+    expectSame(expected.get(), store.get());
+  }
+
+  // どちらもなければ初期値 (エラーではない)
+  hostSdClear();
+  hostPreferencesClear();
+  {
+    ConfigStore store = defaults();
+    ConfigStore expected = defaults();
+    EXPECT_TRUE(store.load());
+    EXPECT_EQ(ERR_NONE, store.getError());
+    EXPECT_EQ(CONFIG_SOURCE_DEFAULT, store.getSource());
+    expectSame(expected.get(), store.get());
+  }
+}
+
+// 同じ内容なら NVS に書き込まない
+TEST_F(ConfigStoreTest, UnchangedConfigIsNotWrittenToNvs) {
+  hostSdWrite(SD_PATH, SD_TEXT);
+
+  // 起動のたびに設定ファイルを読んでも、書き込むのは最初だけ
+  for (int i = 0; i < 5; i++) {
+    ConfigStore store = defaults();
+    EXPECT_TRUE(store.load());
+    EXPECT_EQ(CONFIG_SOURCE_SD, store.getSource());
+  }
+  EXPECT_EQ(1u, hostPreferencesWrites());
+
+  // 同じ値の反映、設定ファイルの読み直しも書き込まない
+  ConfigStore store = defaults();
+  ASSERT_TRUE(store.load());
+  EXPECT_TRUE(apply(store, "ssid=home\nsleep=60000\n"));
+  EXPECT_EQ(0, store.getChanged());
+  EXPECT_TRUE(store.apply(nullptr, 0));
+  EXPECT_EQ(0, store.getChanged());
+  EXPECT_EQ(1u, hostPreferencesWrites());
+
+  // 変わったら書き込む
+  EXPECT_TRUE(apply(store, "sleep=10000\n"));
+  EXPECT_EQ(CONFIG_CHANGED_SLEEP, store.getChanged());
+  EXPECT_EQ(2u, hostPreferencesWrites());
+}
+
+// 反映した設定は SD カードの設定ファイルに書き戻し、次の起動でも使う
+TEST_F(ConfigStoreTest, AppliedConfigIsWrittenBack) {
+  hostSdWrite(SD_PATH, SD_TEXT);
+  ConfigStore store = defaults();
+  ASSERT_TRUE(store.load());
+
+  EXPECT_TRUE(apply(store, "ntp=04:00:00\nmac=66:55:44:33:22:11\ntoken=xyz\n"));
+  EXPECT_EQ(CONFIG_SOURCE_NVS, store.getSource());
+  EXPECT_EQ(CONFIG_CHANGED_NTP | CONFIG_CHANGED_ADDRESS | CONFIG_CHANGED_TOKEN, store.getChanged());
+  EXPECT_FALSE(SD.exists(SD_TMP_PATH));
+
+  std::string text = hostSdRead(SD_PATH);
+  EXPECT_NE(std::string::npos, text.find("ntp=04:00:00\n"));
+  EXPECT_NE(std::string::npos, text.find("mac=66:55:44:33:22:11\n"));
+  EXPECT_NE(std::string::npos, text.find("token=xyz\n"));
+
+  ConfigStore next = defaults();
+  EXPECT_TRUE(next.load());
+  EXPECT_EQ(CONFIG_SOURCE_SD, next.getSource());
+  expectSame(store.get(), next.get());
+}
+
+// 読み直しや反映に失敗しても、現在の設定と保存されている設定は変わらない
+TEST_F(ConfigStoreTest, FailedReloadKeepsActiveConfig) {
+  hostSdWrite(SD_PATH, SD_TEXT);
+  ConfigStore store = defaults();
+  ASSERT_TRUE(store.load());
+  Config before = store.get();
+  uint32_t writes = hostPreferencesWrites();
+
+  // 不正な設定ファイル (前半の行は正しい)
+  hostSdWrite(SD_PATH, "ntp=04:00:00\nsleep=1000\ninterval=99999\n");
+  EXPECT_FALSE(store.apply(nullptr, 0));
+  EXPECT_EQ(ERR_CONFIG_INVALID, store.getError());
+  EXPECT_EQ(0, store.getChanged());
+  expectSame(before, store.get());
+
+  // バッファに収まらない設定ファイル
+  hostSdWrite(SD_PATH, std::string(CONFIG_TEXT_MAX + 1, '#'));
+  EXPECT_FALSE(store.apply(nullptr, 0));
+  EXPECT_EQ(ERR_CONFIG_INVALID, store.getError());
+  expectSame(before, store.get());
+
+  // 設定ファイルがない
+  hostSdClear();
+  EXPECT_FALSE(store.apply(nullptr, 0));
+  EXPECT_EQ(ERR_CONFIG_NOT_FOUND, store.getError());
+  expectSame(before, store.get());
+  EXPECT_EQ(writes, hostPreferencesWrites());
+
+  // 設定ファイルに書き戻せなければ反映しない (元のファイルは残り、一時ファイルは残らない)
+  hostSdWrite(SD_PATH, SD_TEXT);
+  hostSdFailWrites(true);
+  EXPECT_FALSE(apply(store, "ntp=04:00:00\n"));
+  EXPECT_EQ(ERR_CONFIG_SAVE_FAILED, store.getError());
+  EXPECT_EQ(0, store.getChanged());
+  expectSame(before, store.get());
+  EXPECT_EQ(SD_TEXT, hostSdRead(SD_PATH));
+  EXPECT_FALSE(SD.exists(SD_TMP_PATH));
+  EXPECT_EQ(writes, hostPreferencesWrites());
+
+  // 次の起動でも元の設定
+  hostSdFailWrites(false);
+  ConfigStore next = defaults();
+  EXPECT_TRUE(next.load());
+  expectSame(before, next.get());
+}
@@ -0,0 +1,293 @@
+/* ----------------------------------------------------------------
+  DailyScheduleTest.cpp
+  - DailySchedule を模擬時計 (SimClock) で動かして実施判定を確認する
+  - 日付の変わり目、夏時間の切り替え、RTC の補正、loop() の停滞による
+    猶予 (60 秒) の取りこぼしを含む
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <vector>
+#include "SimClock.h"
+#include "DailySchedule.h"
+
+namespace {
+
+// 実施した日時
+struct Execution {
+  uint32_t date;
+  uint32_t sec;
+};
+
+// ScheduledTasks::run() と同じく、RTC を読んで実施すべきなら実施済みにする
+// - 実際の処理と故障を含めた確認は ScheduledTasksTest で行う
+bool tick(const SimClock& clock, DailySchedule& schedule, std::vector<Execution>& runs) {
+  uint32_t date = clock.date();
+  uint32_t sec = clock.secOfDay();
+  if (schedule.isDue(date, sec)) {
+    schedule.markDone(date);
+    runs.push_back({ date, sec });
+    return true;
+  }
+  return false;
+}
+
+// period 秒ごとに loop() を回しながら duration 秒進める
+std::vector<Execution> run(SimClock& clock, DailySchedule& schedule, int64_t duration, uint32_t period = 1) {
+  std::vector<Execution> runs;
+  for (int64_t t = 0; t < duration; t += period) {
+    tick(clock, schedule, runs);
+    clock.advance(period);
+  }
+  return runs;
+}
+
+const uint32_t HOUR = 3600;
+const uint32_t DAY = DailySchedule::SECONDS_PER_DAY;
+
+}  // namespace
+
+// ---------------------------------------------------------------
+// 時刻の解釈
+// ---------------------------------------------------------------
+
+TEST(DailyScheduleParseTest, ValidAndInvalid) {
+  uint32_t sec = 0;
+  EXPECT_TRUE(DailySchedule::parseTime("00:00:00", sec));
+  EXPECT_EQ(sec, 0u);
+  EXPECT_TRUE(DailySchedule::parseTime("23:59:59", sec));
+  EXPECT_EQ(sec, DAY - 1);
+  EXPECT_FALSE(DailySchedule::parseTime("24:00:00", sec));
+  EXPECT_FALSE(DailySchedule::parseTime("12:60:00", sec));
+  EXPECT_FALSE(DailySchedule::parseTime("5:00:00", sec));
+  EXPECT_FALSE(DailySchedule::parseTime("05-00-00", sec));
+  EXPECT_FALSE(DailySchedule::parseTime("05:00:0a", sec));
+}
+
+TEST(DailyScheduleParseTest, SetTimeDisables) {
+  DailySchedule s;
+  EXPECT_FALSE(s.isEnabled());
+  EXPECT_TRUE(s.setTime("05:00:00"));
+  EXPECT_TRUE(s.isEnabled());
+  EXPECT_TRUE(s.setTime(""));
+  EXPECT_FALSE(s.isEnabled());
+  EXPECT_FALSE(s.setTime("bad"));
+  EXPECT_FALSE(s.isEnabled());
+  s.setTime(DAY);
+  EXPECT_FALSE(s.isEnabled());
+}
+
+// ---------------------------------------------------------------
+// 猶予
+// ---------------------------------------------------------------
+
+// 指定時刻から 59 秒後までは実施し、60 秒後からは実施しない
+TEST(DailyScheduleTest, GraceWindowBoundaries) {
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  EXPECT_FALSE(s.isDue(20250122, 5 * HOUR - 1));
+  EXPECT_TRUE(s.isDue(20250122, 5 * HOUR));
+  EXPECT_TRUE(s.isDue(20250122, 5 * HOUR + 59));
+  EXPECT_FALSE(s.isDue(20250122, 5 * HOUR + 60));
+}
+
+// loop() が 59 秒止まっても実施し、61 秒止まると取りこぼす
+TEST(DailyScheduleTest, LoopStallWithinGrace) {
+  for (uint32_t stall : { 10u, 30u, 59u }) {
+    SimClock clock(2025, 1, 22, 5 * HOUR - 1);
+    DailySchedule s;
+    s.setTime(5 * HOUR);
+    std::vector<Execution> runs;
+    tick(clock, s, runs);
+    clock.advance(stall);
+    tick(clock, s, runs);
+    ASSERT_EQ(runs.size(), 1u) << stall;
+    EXPECT_EQ(runs[0].sec, 5 * HOUR - 1 + stall);
+  }
+
+  SimClock clock(2025, 1, 22, 5 * HOUR - 1);
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  std::vector<Execution> runs;
+  tick(clock, s, runs);
+  clock.advance(62);
+  tick(clock, s, runs);
+  EXPECT_TRUE(runs.empty());
+
+  // 翌日は実施する
+  clock.advance(DAY - 62);
+  EXPECT_EQ(run(clock, s, 120).size(), 1u);
+}
+
+// ---------------------------------------------------------------
+// 日付の変わり目
+// ---------------------------------------------------------------
+
+// 1 日 1 回、指定時刻ちょうどに実施する (月末・年末・うるう年をまたぐ)
+TEST(DailyScheduleTest, OncePerDayAcrossMonthAndYear) {
+  SimClock clock(2023, 12, 30, 0);
+  DailySchedule s;
+  s.setTime("05:00:00");
+  // 2023-12-30 から 2024-03-02 まで (2024-02-29 を含む)
+  std::vector<Execution> runs = run(clock, s, (int64_t)64 * DAY, 5);
+  ASSERT_EQ(runs.size(), 64u);
+  for (const Execution& r : runs) {
+    EXPECT_EQ(r.sec, 5 * HOUR);
+  }
+  EXPECT_EQ(runs[0].date, 20231230u);
+  EXPECT_EQ(runs[2].date, 20240101u);
+  EXPECT_EQ(runs[61].date, 20240229u);
+  EXPECT_EQ(runs[62].date, 20240301u);
+}
+
+// 猶予が日付をまたぐ時刻 (23:59:30) は 23:59:59 までに実施する
+TEST(DailyScheduleTest, WindowClippedAtMidnight) {
+  DailySchedule s;
+  s.setTime("23:59:30");
+
+  // 23:59:50 から 1 秒ごと: 当日に実施し、翌日の 0 時台には実施しない
+  SimClock clock(2025, 1, 31, DAY - 10);
+  std::vector<Execution> runs = run(clock, s, 60);
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].date, 20250131u);
+
+  // 23:59:20 から 0:00:30 まで止まった場合は取りこぼす
+  SimClock late(2025, 2, 1, DAY - 40);
+  std::vector<Execution> none;
+  tick(late, s, none);
+  late.advance(70);
+  tick(late, s, none);
+  EXPECT_TRUE(none.empty());
+}
+
+// 0 時ちょうどの予定は、日付が変わった直後に実施する
+TEST(DailyScheduleTest, MidnightSchedule) {
+  SimClock clock(2025, 2, 28, DAY - 5);
+  DailySchedule s;
+  s.setTime("00:00:00");
+  std::vector<Execution> runs = run(clock, s, 2 * DAY);
+  ASSERT_EQ(runs.size(), 2u);
+  EXPECT_EQ(runs[0].date, 20250301u);
+  EXPECT_EQ(runs[0].sec, 0u);
+  EXPECT_EQ(runs[1].date, 20250302u);
+}
+
+// ---------------------------------------------------------------
+// RTC の補正
+// ---------------------------------------------------------------
+
+// 実施後に RTC が戻されて再び猶予の中に入っても、同じ日には実施しない
+TEST(DailyScheduleTest, StepBackDoesNotRepeat) {
+  SimClock clock(2025, 1, 22, 5 * HOUR - 3);
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  std::vector<Execution> runs = run(clock, s, 10);
+  ASSERT_EQ(runs.size(), 1u);
+
+  clock.step(-30);
+  std::vector<Execution> again = run(clock, s, 120);
+  EXPECT_TRUE(again.empty());
+}
+
+// 指定時刻の直前に RTC が戻されても、1 回だけ実施する
+TEST(DailyScheduleTest, StepBackBeforeWindow) {
+  SimClock clock(2025, 1, 22, 5 * HOUR - 10);
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  run(clock, s, 5);
+  clock.step(-(int64_t)HOUR);
+  std::vector<Execution> runs = run(clock, s, 2 * HOUR);
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].sec, 5 * HOUR);
+}
+
+// RTC が猶予を飛び越えて進められた日は実施しない (翌日は実施する)
+TEST(DailyScheduleTest, StepForwardSkipsWindow) {
+  SimClock clock(2025, 1, 22, 5 * HOUR - 10);
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  run(clock, s, 5);
+  clock.step(120);
+  std::vector<Execution> runs = run(clock, s, DAY - 200);
+  EXPECT_TRUE(runs.empty());
+  runs = run(clock, s, 400);
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].date, 20250123u);
+}
+
+// RTC が猶予の途中に進められた場合は実施する
+TEST(DailyScheduleTest, StepForwardIntoWindow) {
+  SimClock clock(2025, 1, 22, 5 * HOUR - 10);
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  run(clock, s, 5);
+  clock.step(35);
+  std::vector<Execution> runs = run(clock, s, 10);
+  ASSERT_EQ(runs.size(), 1u);
+  EXPECT_EQ(runs[0].sec, 5 * HOUR + 30);
+}
+
+// ---------------------------------------------------------------
+// 夏時間
+// ---------------------------------------------------------------
+
+// 時計が 1 時間進む日は、飛ばされた時間帯の予定を実施しない
+TEST(DailyScheduleTest, DstSpringForwardSkipsGap) {
+  SimClock clock(2025, 3, 29, 0, 0);
+  clock.setDst(2025, 3, 30, 2 * HOUR, 10, 26, 2 * HOUR);
+  DailySchedule s;
+  s.setTime("02:30:00");
+  std::vector<Execution> runs = run(clock, s, 3 * DAY, 10);
+  ASSERT_EQ(runs.size(), 2u);
+  EXPECT_EQ(runs[0].date, 20250329u);
+  EXPECT_EQ(runs[1].date, 20250331u);
+}
+
+// 時計が 1 時間戻る日は、繰り返される時間帯の予定を 1 回だけ実施する
+TEST(DailyScheduleTest, DstFallBackRunsOnce) {
+  SimClock clock(2025, 10, 25, 0, 0);
+  clock.setDst(2025, 3, 30, 2 * HOUR, 10, 26, 2 * HOUR);
+  DailySchedule s;
+  s.setTime("02:30:00");
+  std::vector<Execution> runs = run(clock, s, 3 * DAY, 10);
+  ASSERT_EQ(runs.size(), 3u);
+  EXPECT_EQ(runs[0].date, 20251025u);
+  EXPECT_EQ(runs[1].date, 20251026u);
+  EXPECT_EQ(runs[2].date, 20251027u);
+}
+
+// ---------------------------------------------------------------
+// markDone() の日付
+// ---------------------------------------------------------------
+
+// 実施済みは日付で判定する (同じ日に時刻を変えても実施しない)
+TEST(DailyScheduleTest, MarkDoneIsKeyedOnDate) {
+  DailySchedule s;
+  s.setTime(5 * HOUR);
+  s.markDone(20250122);
+  EXPECT_FALSE(s.isDue(20250122, 5 * HOUR));
+
+  s.setTime(6 * HOUR);
+  EXPECT_FALSE(s.isDue(20250122, 6 * HOUR));
+  EXPECT_TRUE(s.isDue(20250123, 6 * HOUR));
+
+  // 実施前に別の日付を記録しても当日の実施は妨げない
+  s.markDone(20250121);
+  EXPECT_TRUE(s.isDue(20250122, 6 * HOUR));
+}
+
+// NTP 時刻同期のように実施前に markDone() して RTC が変わっても、
+// 同じ日付なら再び実施しない
+TEST(DailyScheduleTest, MarkDoneBeforeClockChange) {
+  SimClock clock(2025, 1, 22, 3 * HOUR);
+  DailySchedule s;
+  s.setTime(3 * HOUR);
+  std::vector<Execution> runs;
+  ASSERT_TRUE(tick(clock, s, runs));
+  clock.step(-20);
+  EXPECT_TRUE(run(clock, s, 60).empty());
+}
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------
+  LogStoreTest.cpp
+  - LogStore のリングバッファと絞り込みのインデックスを、保存できる数より
+    多くのレコードを追加して確認する
+  - 絞り込み後のページ送りは、最初と最後のページの境界を確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include "LogStore.h"
+
+namespace {
+
+// 保存できるレコード数と 1 ページの行数
+const size_t CAPACITY = 16;
+const size_t ROWS = 5;
+
+// n 番目に追加するレコードのタイムスタンプ (2025/01/day の 0 時から n 秒)
+uint32_t stamp(uint8_t day, uint32_t n) {
+  return LogStore::packStamp(2025, 1, day, n / 3600, n / 60 % 60, n % 60);
+}
+
+// タイムスタンプから n を取り出す
+uint32_t seqOf(const LogRecord& rec) {
+  return ((rec.stamp >> 12) & 0x1f) * 3600 + ((rec.stamp >> 6) & 0x3f) * 60 + (rec.stamp & 0x3f);
+}
+
+class LogStoreTest : public testing::Test {
+protected:
+  LogStore store{ CAPACITY };
+
+  void SetUp() override {
+    ASSERT_TRUE(this->store.init());
+  }
+
+  // count 件を追加する (n が奇数ならエラー)
+  void pushRecords(uint32_t from, uint32_t count, uint8_t day = 22) {
+    for (uint32_t n = from; n < from + count; n++) {
+      bool err = (n % 2 == 1);
+      this->store.push(stamp(day, n), err, err ? (uint8_t)ERR_CONNECT_FAILED : (uint8_t)LOG_TIMER_TURNED_OFF);
+    }
+  }
+};
+
+}  // namespace
+
+// 保存できる数を超えたら古いものから上書きする
+TEST_F(LogStoreTest, WrapAroundKeepsNewestRecords) {
+  LogRecord rec;
+  EXPECT_EQ(0u, this->store.size());
+  EXPECT_FALSE(this->store.get(0, rec));
+
+  pushRecords(0, CAPACITY * 3 + 5);
+  EXPECT_EQ(CAPACITY, this->store.size());
+
+  // 新しい順に、残っている最も古いレコードまで
+  for (size_t pos = 0; pos < CAPACITY; pos++) {
+    ASSERT_TRUE(this->store.get(pos, rec));
+    EXPECT_EQ(CAPACITY * 3 + 4 - pos, seqOf(rec));
+  }
+  EXPECT_FALSE(this->store.get(CAPACITY, rec));
+
+  // 絞り込んだインデックスも上書きされたレコードを含まない
+  this->store.setFilter({ LOG_TYPE_ERROR, 0 });
+  EXPECT_EQ(CAPACITY / 2, this->store.filteredSize());
+  pushRecords(CAPACITY * 3 + 5, CAPACITY * 2 + 3);
+  EXPECT_EQ(CAPACITY / 2, this->store.filteredSize());
+
+  uint32_t newest = CAPACITY * 5 + 7;
+  for (size_t pos = 0; pos < this->store.filteredSize(); pos++) {
+    ASSERT_TRUE(this->store.getFiltered(pos, rec));
+    EXPECT_TRUE(rec.err);
+    EXPECT_EQ(newest - pos * 2, seqOf(rec));
+  }
+  EXPECT_FALSE(this->store.getFiltered(CAPACITY / 2, rec));
+}
+
+// 何にも合致しない絞り込み
+TEST_F(LogStoreTest, FilterMatchingNothing) {
+  LogRecord rec;
+
+  // イベントだけのときのエラー、ない日付
+  for (uint32_t n = 0; n < CAPACITY * 2; n++) {
+    this->store.push(stamp(22, n), false, LOG_TIMER_TURNED_ON);
+  }
+  this->store.setFilter({ LOG_TYPE_ERROR, 0 });
+  EXPECT_EQ(0u, this->store.filteredSize());
+  EXPECT_FALSE(this->store.getFiltered(0, rec));
+  EXPECT_EQ(0u, this->store.olderPage(0, ROWS));
+  EXPECT_EQ(0u, this->store.newerPage(0, ROWS));
+
+  this->store.setFilter({ LOG_TYPE_ALL, LogStore::stampToDate(stamp(23, 0)) });
+  EXPECT_EQ(0u, this->store.filteredSize());
+  EXPECT_FALSE(this->store.getFiltered(0, rec));
+
+  // 合致するレコードが追加されたら 1 件目として取得できる
+  this->store.push(stamp(23, 100), true, ERR_NTP_TIMEOUT);
+  EXPECT_EQ(1u, this->store.filteredSize());
+  ASSERT_TRUE(this->store.getFiltered(0, rec));
+  EXPECT_EQ(100u, seqOf(rec));
+
+  // 合致するレコードがすべて上書きされたら、また何も合致しない
+  for (uint32_t n = 0; n < CAPACITY; n++) {
+    this->store.push(stamp(24, n), false, LOG_TIMER_TURNED_ON);
+  }
+  EXPECT_EQ(0u, this->store.filteredSize());
+  EXPECT_FALSE(this->store.getFiltered(0, rec));
+}
+
+// 保存できる数より多く追加したときの最初と最後のページ
+TEST_F(LogStoreTest, PagingAtBothEnds) {
+  pushRecords(0, CAPACITY * 4 + 3);
+  LogRecord rec;
+
+  // 古い方へ送ると 0, 5, 10, 15 の後に最初のページに戻る
+  size_t top = 0;
+  size_t tops[] = { ROWS, ROWS * 2, ROWS * 3, 0 };
+  for (size_t i = 0; i < sizeof(tops) / sizeof(tops[0]); i++) {
+    top = this->store.olderPage(top, ROWS);
+    EXPECT_EQ(tops[i], top);
+  }
+
+  // 最後のページは残っている最も古いレコードで終わる
+  top = ROWS * 3;
+  size_t rows = 0;
+  for (size_t i = 0; i < ROWS; i++) {
+    if (this->store.getFiltered(top + i, rec)) {
+      rows++;
+    }
+  }
+  EXPECT_EQ(CAPACITY - top, rows);
+  ASSERT_TRUE(this->store.getFiltered(CAPACITY - 1, rec));
+  EXPECT_EQ(CAPACITY * 3 + 3, seqOf(rec));
+
+  // 新しい方へ戻ると最初のページで止まる
+  size_t back[] = { ROWS * 2, ROWS, 0, 0 };
+  for (size_t i = 0; i < sizeof(back) / sizeof(back[0]); i++) {
+    top = this->store.newerPage(top, ROWS);
+    EXPECT_EQ(back[i], top);
+  }
+  ASSERT_TRUE(this->store.getFiltered(top, rec));
+  EXPECT_EQ(CAPACITY * 4 + 2, seqOf(rec));
+
+  // 最後のページを表示中に、合致するレコードが上書きされて減った場合
+  for (uint32_t n = 0; n < CAPACITY; n++) {
+    this->store.push(stamp(23, n), true, ERR_CONNECT_FAILED);
+  }
+  this->store.setFilter({ LOG_TYPE_ERROR, 0 });
+  EXPECT_EQ(CAPACITY, this->store.filteredSize());
+  top = ROWS * 3;
+  for (uint32_t n = 0; n < 6; n++) {
+    this->store.push(stamp(24, n), false, LOG_TIMER_TURNED_OFF);
+  }
+  EXPECT_EQ(CAPACITY - 6, this->store.filteredSize());
+  EXPECT_FALSE(this->store.getFiltered(top, rec));
+
+  // 範囲外のページからは、古い方は最初のページ、新しい方は最後のページ
+  EXPECT_EQ(0u, this->store.olderPage(top, ROWS));
+  EXPECT_EQ(ROWS, this->store.newerPage(top, ROWS));
+  EXPECT_EQ(0u, this->store.newerPage(ROWS, ROWS));
+}
@@ -0,0 +1,478 @@
+/* ----------------------------------------------------------------
+  OtaUpdaterTest.cpp
+  - ループバックで待ち受ける代わりの HTTP サーバーからファームウェアを
+    ダウンロードして、通常のイメージ・差分形式・圧縮した差分形式の更新と、
+    更新後の起動時のロールバックを確認する
+  - パーティションは test/host/esp_ota_ops.cpp がメモリ上に置く
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <Preferences.h>
+#include "OtaUpdater.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+// 代わりの HTTP サーバーのレスポンス
+struct Response {
+  std::string headers;  // Content-Length 以外のヘッダー (CRLF で終わる行の並び)
+  Bytes body;
+  bool chunked;         // Transfer-Encoding: chunked で送る
+};
+
+// ---------------------------------------------------------------
+// 代わりの HTTP サーバー
+// - パスごとに登録したレスポンスを返し、接続を閉じる
+// ---------------------------------------------------------------
+class StandInServer {
+private:
+  int _fd = -1;
+  uint16_t _port = 0;
+  std::atomic<bool> _running{ false };
+  std::thread _thread;
+  std::mutex _mutex;
+  std::map<std::string, Response> _routes;
+  std::atomic<uint32_t> _hits{ 0 };
+
+  void _serve(int fd) {
+    std::string req;
+    char c;
+    while (req.find("\r\n\r\n") == std::string::npos && recv(fd, &c, 1, 0) == 1) {
+      req.push_back(c);
+    }
+    size_t sp = req.find(' ');
+    std::string path = req.substr(sp + 1, req.find(' ', sp + 1) - sp - 1);
+    this->_hits++;
+
+    Response res;
+    bool found;
+    {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      auto it = this->_routes.find(path);
+      found = (it != this->_routes.end());
+      if (found) {
+        res = it->second;
+      }
+    }
+
+    std::string out;
+    if (!found) {
+      out = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    } else if (res.chunked) {
+      out = "HTTP/1.1 200 OK\r\n" + res.headers + "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n";
+      char size[16];
+      snprintf(size, sizeof(size), "%zx\r\n", res.body.size());
+      out += size + std::string(res.body.begin(), res.body.end()) + "\r\n0\r\n\r\n";
+    } else {
+      out = "HTTP/1.1 200 OK\r\n" + res.headers + "Content-Length: " + std::to_string(res.body.size())
+            + "\r\nConnection: close\r\n\r\n" + std::string(res.body.begin(), res.body.end());
+    }
+    size_t sent = 0;
+    while (sent < out.size()) {
+      ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+    close(fd);
+  }
+
+public:
+  void start() {
+    this->_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(this->_fd, (sockaddr*)&addr, sizeof(addr));
+    listen(this->_fd, 8);
+    socklen_t alen = sizeof(addr);
+    getsockname(this->_fd, (sockaddr*)&addr, &alen);
+    this->_port = ntohs(addr.sin_port);
+
+    this->_running = true;
+    this->_thread = std::thread([this]() {
+      while (this->_running) {
+        int fd = accept(this->_fd, nullptr, nullptr);
+        if (fd >= 0) {
+          this->_serve(fd);
+        }
+      }
+    });
+  }
+
+  void stop() {
+    this->_running = false;
+    shutdown(this->_fd, SHUT_RDWR);
+    close(this->_fd);
+    if (this->_thread.joinable()) {
+      this->_thread.join();
+    }
+  }
+
+  void route(const std::string& path, const Response& res) {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_routes[path] = res;
+  }
+
+  std::string url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(this->_port) + path;
+  }
+
+  uint32_t hits() const {
+    return this->_hits;
+  }
+};
+
+// 先頭がイメージのマジックナンバー (0xE9) の疑似乱数のイメージ
+Bytes makeImage(size_t size, uint32_t seed) {
+  Bytes image(size);
+  uint32_t x = seed;
+  for (size_t i = 0; i < size; i++) {
+    x = x * 1103515245 + 12345;
+    image[i] = (uint8_t)(x >> 16);
+  }
+  image[0] = 0xe9;
+  return image;
+}
+
+Bytes sha256(const Bytes& data) {
+  Bytes hash(32);
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, data.data(), data.size());
+  mbedtls_sha256_finish(&ctx, hash.data());
+  mbedtls_sha256_free(&ctx);
+  return hash;
+}
+
+std::string hex(const Bytes& data) {
+  static const char* digits = "0123456789abcdef";
+  std::string s;
+  for (uint8_t b : data) {
+    s.push_back(digits[b >> 4]);
+    s.push_back(digits[b & 0x0f]);
+  }
+  return s;
+}
+
+void putU32(Bytes& out, uint32_t v) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back((uint8_t)(v >> (i * 8)));
+  }
+}
+
+// 差分形式を作る (new の先頭 copyLen バイトは old の同じ位置からコピーし、残りは挿入する)
+Bytes makeDelta(const Bytes& oldImage, const Bytes& newImage, size_t copyLen) {
+  Bytes out = { 'S', 'B', 'D', '1' };
+  putU32(out, (uint32_t)newImage.size());
+  Bytes source = sha256(oldImage);
+  Bytes target = sha256(newImage);
+  out.insert(out.end(), source.begin(), source.end());
+  out.insert(out.end(), target.begin(), target.end());
+  out.push_back(0x01);
+  putU32(out, (uint32_t)copyLen);
+  putU32(out, 0);
+  out.push_back(0x02);
+  putU32(out, (uint32_t)(newImage.size() - copyLen));
+  out.insert(out.end(), newImage.begin() + copyLen, newImage.end());
+  out.push_back(0x00);
+  return out;
+}
+
+// 差分形式を zlib で圧縮する (tools/ota_delta.py と同じ形式)
+Bytes compressDelta(const Bytes& delta) {
+  uLongf len = compressBound(delta.size());
+  Bytes out = { 'S', 'B', 'Z', '1' };
+  out.resize(4 + len);
+  compress2(out.data() + 4, &len, delta.data(), delta.size(), 9);
+  out.resize(4 + len);
+  return out;
+}
+
+Bytes readFile(const std::string& path) {
+  std::ifstream f(path, std::ios::binary);
+  return Bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const Bytes& data) {
+  std::ofstream f(path, std::ios::binary);
+  f.write((const char*)data.data(), data.size());
+}
+
+}  // namespace
+
+class OtaUpdaterTest : public ::testing::Test {
+protected:
+  StandInServer server;
+  OtaUpdater ota;
+  Bytes oldImage = makeImage(200000, 1);
+  Bytes newImage;
+
+  void SetUp() override {
+    hostPreferencesClear();
+    hostOtaReset(this->oldImage);
+    ESP.restarts = 0;
+
+    // 先頭の 3/4 は変わらず、残りが変わったイメージ
+    this->newImage = this->oldImage;
+    Bytes tail = makeImage(60000, 2);
+    this->newImage.resize(150000);
+    this->newImage.insert(this->newImage.end(), tail.begin() + 1, tail.end());
+    this->server.start();
+  }
+
+  void TearDown() override {
+    this->server.stop();
+  }
+
+  bool update(const std::string& path, const Bytes& image) {
+    return this->ota.update(this->server.url(path).c_str(), hex(sha256(image)).c_str());
+  }
+
+  // 起動パーティションが切り替わっていない
+  void expectNotSwitched() {
+    EXPECT_EQ(hostOtaCounts().ends, 0u);
+    EXPECT_EQ(hostOtaCounts().bootSets, 0u);
+    EXPECT_EQ(hostOtaBootPartition(), esp_ota_get_running_partition());
+  }
+};
+
+TEST_F(OtaUpdaterTest, FullImage) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  ASSERT_TRUE(this->update("/new.bin", this->newImage)) << errorCodeToString(this->ota.getError());
+
+  const esp_partition_t* boot = hostOtaBootPartition();
+  EXPECT_NE(boot, esp_ota_get_running_partition());
+  EXPECT_EQ(hostOtaImage(boot), this->newImage);
+  EXPECT_FALSE(this->ota.getStats().delta);
+  EXPECT_EQ(this->ota.getStats().transferBytes, this->newImage.size());
+  EXPECT_EQ(this->ota.getStats().imageBytes, this->newImage.size());
+
+  // 統計情報は再起動後も読める
+  OtaUpdater after;
+  after.init();
+  EXPECT_EQ(after.getStats().imageBytes, this->newImage.size());
+}
+
+// 書き込み後のイメージの SHA-256 が指定されていなければダウンロードしない
+TEST_F(OtaUpdaterTest, HashIsRequired) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  std::string url = this->server.url("/new.bin");
+  EXPECT_FALSE(this->ota.update(url.c_str(), ""));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_HASH_REQUIRED);
+  EXPECT_FALSE(this->ota.update(url.c_str(), "0123"));
+  EXPECT_FALSE(this->ota.update(url.c_str(), nullptr));
+  EXPECT_EQ(this->server.hits(), 0u);
+  EXPECT_EQ(hostOtaCounts().begins, 0u);
+}
+
+// ダウンロード元が返すハッシュではなく、指定された SHA-256 と比べる
+TEST_F(OtaUpdaterTest, FullImageHashMismatch) {
+  Bytes tampered = this->newImage;
+  tampered[100] ^= 0xff;
+  std::string header = "X-Image-Sha256: " + hex(sha256(tampered)) + "\r\n";
+  this->server.route("/new.bin", { header, tampered, false });
+  EXPECT_FALSE(this->update("/new.bin", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_HASH_MISMATCH);
+  EXPECT_EQ(hostOtaCounts().aborts, 1u);
+  this->expectNotSwitched();
+}
+
+// 転送エンコーディングがあればストリームを読まない
+TEST_F(OtaUpdaterTest, ChunkedIsRejected) {
+  this->server.route("/new.bin", { "", this->newImage, true });
+  EXPECT_FALSE(this->update("/new.bin", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_TRANSFER_ENCODING);
+  EXPECT_EQ(hostOtaCounts().begins, 0u);
+  this->expectNotSwitched();
+}
+
+TEST_F(OtaUpdaterTest, NotFound) {
+  EXPECT_FALSE(this->update("/missing.bin", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_DOWNLOAD_FAILED);
+  this->expectNotSwitched();
+}
+
+TEST_F(OtaUpdaterTest, Delta) {
+  Bytes delta = makeDelta(this->oldImage, this->newImage, 150000);
+  this->server.route("/new.delta", { "", delta, false });
+  ASSERT_TRUE(this->update("/new.delta", this->newImage)) << errorCodeToString(this->ota.getError());
+  EXPECT_EQ(hostOtaImage(hostOtaBootPartition()), this->newImage);
+  EXPECT_TRUE(this->ota.getStats().delta);
+  EXPECT_EQ(this->ota.getStats().transferBytes, delta.size());
+  EXPECT_EQ(this->ota.getStats().imageBytes, this->newImage.size());
+}
+
+// 圧縮した差分形式は展開しながら適用する (ダウンロードするサイズが小さくなる)
+TEST_F(OtaUpdaterTest, CompressedDelta) {
+  // 挿入する部分に繰り返しを含める (疑似乱数だけでは圧縮されない)
+  std::fill(this->newImage.begin() + 160000, this->newImage.begin() + 200000, 0xff);
+  Bytes delta = makeDelta(this->oldImage, this->newImage, 150000);
+  Bytes compressed = compressDelta(delta);
+  ASSERT_LT(compressed.size(), delta.size());
+  this->server.route("/new.delta", { "", compressed, false });
+  ASSERT_TRUE(this->update("/new.delta", this->newImage)) << errorCodeToString(this->ota.getError());
+  EXPECT_EQ(hostOtaImage(hostOtaBootPartition()), this->newImage);
+  EXPECT_TRUE(this->ota.getStats().delta);
+  EXPECT_EQ(this->ota.getStats().transferBytes, compressed.size());
+}
+
+// 圧縮データ (zlib のヘッダー) が壊れていれば書き込まない
+TEST_F(OtaUpdaterTest, CorruptCompressedDelta) {
+  Bytes compressed = compressDelta(makeDelta(this->oldImage, this->newImage, 150000));
+  compressed[4] ^= 0x5a;
+  this->server.route("/new.delta", { "", compressed, false });
+  EXPECT_FALSE(this->update("/new.delta", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_BAD_FORMAT);
+  this->expectNotSwitched();
+}
+
+// 途中で終わった圧縮データ
+TEST_F(OtaUpdaterTest, TruncatedCompressedDelta) {
+  Bytes compressed = compressDelta(makeDelta(this->oldImage, this->newImage, 150000));
+  compressed.resize(compressed.size() / 2);
+  this->server.route("/new.delta", { "", compressed, false });
+  EXPECT_FALSE(this->update("/new.delta", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_DOWNLOAD_FAILED);
+  this->expectNotSwitched();
+}
+
+// 指定されたイメージへの差分でなければ書き込まずに失敗する
+TEST_F(OtaUpdaterTest, DeltaForAnotherImage) {
+  Bytes delta = makeDelta(this->oldImage, this->newImage, 150000);
+  this->server.route("/new.delta", { "", delta, false });
+  EXPECT_FALSE(this->update("/new.delta", this->oldImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_HASH_MISMATCH);
+  EXPECT_EQ(hostOtaImage(esp_ota_get_next_update_partition(nullptr)).size(), 0u);
+  this->expectNotSwitched();
+}
+
+TEST_F(OtaUpdaterTest, DeltaSourceMismatch) {
+  Bytes other = makeImage(200000, 3);
+  Bytes delta = makeDelta(other, this->newImage, 150000);
+  this->server.route("/new.delta", { "", delta, false });
+  EXPECT_FALSE(this->update("/new.delta", this->newImage));
+  EXPECT_EQ(this->ota.getError(), ERR_OTA_SOURCE_MISMATCH);
+  this->expectNotSwitched();
+}
+
+// tools/ota_delta.py で作成した差分ファイルを適用できる
+TEST_F(OtaUpdaterTest, ToolDelta) {
+  if (std::string(PYTHON_EXECUTABLE).empty()) {
+    GTEST_SKIP() << "Python 3 not found";
+  }
+  std::string dir = testing::TempDir();
+  writeFile(dir + "ota_old.bin", this->oldImage);
+  writeFile(dir + "ota_new.bin", this->newImage);
+  std::string cmd = std::string(PYTHON_EXECUTABLE) + " " + OTA_DELTA_TOOL + " " + dir + "ota_old.bin "
+                    + dir + "ota_new.bin " + dir + "ota_new.delta > /dev/null";
+  ASSERT_EQ(std::system(cmd.c_str()), 0);
+  Bytes delta = readFile(dir + "ota_new.delta");
+  ASSERT_EQ(std::string(delta.begin(), delta.begin() + 4), "SBZ1");
+
+  this->server.route("/new.delta", { "", delta, false });
+  ASSERT_TRUE(this->update("/new.delta", this->newImage)) << errorCodeToString(this->ota.getError());
+  EXPECT_EQ(hostOtaImage(hostOtaBootPartition()), this->newImage);
+  EXPECT_LT(this->ota.getStats().transferBytes, this->newImage.size() / 2);
+}
+
+// 更新後の最初の起動で動作確認に失敗したら、更新前のイメージに戻して再起動する
+TEST_F(OtaUpdaterTest, RollbackOnFailedVerify) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  ASSERT_TRUE(this->update("/new.bin", this->newImage));
+  const esp_partition_t* oldPart = esp_ota_get_running_partition();
+
+  hostOtaReboot();
+  EXPECT_EQ(hostOtaImage(esp_ota_get_running_partition()), this->newImage);
+  EXPECT_TRUE(this->ota.isPendingVerify());
+
+  this->ota.confirm(false);
+  EXPECT_EQ(ESP.restarts, 1u);
+  hostOtaReboot();
+  EXPECT_EQ(esp_ota_get_running_partition(), oldPart);
+  EXPECT_FALSE(this->ota.isPendingVerify());
+  EXPECT_TRUE(this->ota.wasRolledBack());
+
+  // ロールバックは 1 回だけ報告する (以降の起動では報告しない)
+  EXPECT_FALSE(this->ota.wasRolledBack());
+  hostOtaReboot();
+  EXPECT_FALSE(this->ota.wasRolledBack());
+}
+
+// 同じパーティションへの次の更新が再びロールバックされたら、もう一度報告する
+TEST_F(OtaUpdaterTest, RollbackIsReportedPerUpdate) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(this->update("/new.bin", this->newImage));
+    hostOtaReboot();
+    hostOtaReboot();
+    EXPECT_EQ(hostOtaImage(esp_ota_get_running_partition()), this->oldImage);
+    EXPECT_TRUE(this->ota.wasRolledBack()) << i;
+    EXPECT_FALSE(this->ota.wasRolledBack()) << i;
+  }
+}
+
+TEST_F(OtaUpdaterTest, ConfirmKeepsNewImage) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  ASSERT_TRUE(this->update("/new.bin", this->newImage));
+  hostOtaReboot();
+  EXPECT_TRUE(this->ota.confirm(true));
+  EXPECT_FALSE(this->ota.isPendingVerify());
+  EXPECT_EQ(ESP.restarts, 0u);
+
+  // 確定済みなら何もしない
+  EXPECT_FALSE(this->ota.confirm(true));
+
+  hostOtaReboot();
+  EXPECT_EQ(hostOtaImage(esp_ota_get_running_partition()), this->newImage);
+  EXPECT_FALSE(this->ota.wasRolledBack());
+}
+
+// 動作確認を待つ時間が過ぎたらロールバックする
+TEST_F(OtaUpdaterTest, RollbackOnVerifyTimeout) {
+  this->server.route("/new.delta", { "", compressDelta(makeDelta(this->oldImage, this->newImage, 150000)), false });
+  ASSERT_TRUE(this->update("/new.delta", this->newImage));
+  hostOtaReboot();
+
+  hostUseVirtualTime(true);
+  this->ota.checkVerifyTimeout();
+  EXPECT_EQ(ESP.restarts, 0u);
+  hostAdvance(600000);
+  this->ota.checkVerifyTimeout();
+  hostUseVirtualTime(false);
+  EXPECT_EQ(ESP.restarts, 1u);
+
+  hostOtaReboot();
+  EXPECT_EQ(hostOtaImage(esp_ota_get_running_partition()), this->oldImage);
+  EXPECT_TRUE(this->ota.wasRolledBack());
+}
+
+// 確定せずに電源が切れたら、次の起動でブートローダーが戻す
+TEST_F(OtaUpdaterTest, RollbackOnUnconfirmedReboot) {
+  this->server.route("/new.bin", { "", this->newImage, false });
+  ASSERT_TRUE(this->update("/new.bin", this->newImage));
+  hostOtaReboot();
+  hostOtaReboot();
+  EXPECT_EQ(hostOtaImage(esp_ota_get_running_partition()), this->oldImage);
+  EXPECT_FALSE(this->ota.isPendingVerify());
+  EXPECT_TRUE(this->ota.wasRolledBack());
+}
@@ -0,0 +1,487 @@
+/* ----------------------------------------------------------------
+  ScheduledTasksTest.cpp
+  - loop() の時刻で実施する処理 (ScheduledTasks) を TaskHarness で動かし、
+    LogStore に残ったログで OFF/ON タイマー、委任の確認、NTP 時刻同期を確認する
+  - 処理の時刻の前後で NTP 時刻同期・Wi-Fi 接続・BLE 通信を失敗させ、
+    RTC の進み、loop() の間隔と停滞を無作為に変える
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "TaskHarness.h"
+
+namespace {
+
+const uint32_t HOUR = 3600;
+const uint32_t DAY = TaskHarness::DAY;
+
+// OFF/ON タイマーの時刻に注入する BLE の故障
+enum BleFault : uint8_t {
+  BLE_OK = 0,
+  BLE_OUTAGE,  // 全ての送受信が失われる
+  BLE_FLAKY,   // 30% の送受信が失われる
+  BLE_FAULT_NUM,
+};
+
+// NTP 時刻同期の時刻に注入する故障
+enum NetFault : uint8_t {
+  NET_OK = 0,
+  NET_NTP_FAIL,   // NTP サーバーから応答がない
+  NET_WIFI_FAIL,  // Wi-Fi に接続できない
+  NET_FAULT_NUM,
+};
+
+// 処理の時刻 1 回分の記録
+struct Occurrence {
+  uint16_t date;   // RTC の日付 (LogStore::stampToDate() の値)
+  bool timer;      // OFF/ON タイマー (false なら NTP 時刻同期)
+  bool offloaded;  // 委任中だったかどうか
+  uint8_t fault;   // 注入した故障 (BleFault または NetFault)
+  bool entered;    // 処理の時刻より十分前から区間に入ったかどうか
+  bool left;       // 区間を出たかどうか
+};
+
+// 処理の時刻の前後の区間で故障を注入しながら loop() を回す
+// - 区間の外は次の区間の少し前まで早送りする
+class Replay {
+public:
+  // 故障を注入する区間 (処理の時刻の BEFORE 秒前から AFTER 秒後まで)
+  static const uint32_t BEFORE = 120;
+  static const uint32_t AFTER = 600;
+
+  TaskHarness& h;
+  std::mt19937& rng;
+  uint32_t timerTime;
+  uint32_t ntpTime;
+
+  // 故障を注入する確率 (%) と、固定する故障 (負なら無作為)
+  uint32_t faultPercent = 0;
+  int bleFault = -1;
+  int netFault = -1;
+
+  // loop() が停滞する確率 (%)
+  uint32_t stallPercent = 2;
+
+  std::vector<Occurrence> occurrences;
+
+private:
+  int _active[2] = { -1, -1 };
+
+  // 区間の先頭からの秒数 (区間の外なら BEFORE + AFTER 以上)
+  static uint32_t _offset(uint32_t sec, uint32_t t) {
+    return (sec + DAY + BEFORE - t) % DAY;
+  }
+
+  uint8_t _roll(int fixed, uint8_t num) {
+    if (fixed >= 0) {
+      return (uint8_t)fixed;
+    }
+    if (this->rng() % 100 >= this->faultPercent) {
+      return 0;
+    }
+    return (uint8_t)(1 + this->rng() % (num - 1));
+  }
+
+  void _apply(bool timer, uint8_t fault) {
+    if (timer) {
+      this->h.fake->getConfig().lossPercent = (fault == BLE_OUTAGE) ? 100 : (fault == BLE_FLAKY) ? 30 : 0;
+    } else {
+      hostNtpFail(fault == NET_NTP_FAIL);
+      WiFi.state = (fault == NET_WIFI_FAIL) ? WL_DISCONNECTED : WL_CONNECTED;
+    }
+  }
+
+public:
+  Replay(TaskHarness& harness, std::mt19937& random, uint32_t timer, uint32_t ntp)
+    : h(harness), rng(random), timerTime(timer), ntpTime(ntp) {
+  }
+
+  // 実際の時刻で duration 秒の間 loop() を回す
+  void run(int64_t duration) {
+    int64_t end = this->h.world.utc() + duration;
+    while (this->h.world.utc() < end) {
+      uint32_t sec = TaskHarness::rtcSecOfDay();
+      uint32_t gap = DAY;
+
+      for (int kind = 0; kind < 2; kind++) {
+        bool timer = (kind == 0);
+        uint32_t offset = _offset(sec, timer ? this->timerTime : this->ntpTime);
+        bool in = offset < BEFORE + AFTER;
+
+        if (in && this->_active[kind] < 0) {
+          Occurrence o;
+          o.date = this->h.rtcDate();
+          o.timer = timer;
+          o.offloaded = this->h.offload.isActive();
+          o.fault = timer ? this->_roll(this->bleFault, BLE_FAULT_NUM) : this->_roll(this->netFault, NET_FAULT_NUM);
+          o.entered = offset < BEFORE - 60;
+          o.left = false;
+          this->_apply(timer, o.fault);
+          this->_active[kind] = (int)this->occurrences.size();
+          this->occurrences.push_back(o);
+        } else if (!in && this->_active[kind] >= 0) {
+          this->occurrences[this->_active[kind]].left = true;
+          this->_apply(timer, 0);
+          this->_active[kind] = -1;
+        }
+
+        if (!in) {
+          uint32_t toWindow = DAY - offset;
+          gap = (toWindow < gap) ? toWindow : gap;
+        }
+      }
+
+      // 区間の外は次の区間の 30 秒前まで早送りする
+      if (this->_active[0] < 0 && this->_active[1] < 0 && gap > 60) {
+        int64_t left = end - this->h.world.utc();
+        int64_t skip = ((int64_t)(gap - 30) < left) ? gap - 30 : left;
+        this->h.loopOnce((uint32_t)skip * 1000);
+        continue;
+      }
+
+      // 通常は 1 - 3 秒 (入力や画面の処理)、ときどき 5 - 50 秒停滞する
+      // - 委任の OFF の確認 (OFF の 30 秒後) が ON の時刻を過ぎる場合を含む
+      uint32_t period = 1000 + this->rng() % 2000;
+      if (this->rng() % 100 < this->stallPercent) {
+        period = 5000 + this->rng() % 45000;
+      }
+      this->h.loopOnce(period);
+    }
+  }
+
+  // 区間を最初から最後まで通った処理の時刻ごとに、ログを確認する
+  void check(const char* label) {
+    for (const Occurrence& o : this->occurrences) {
+      if (!o.entered || !o.left) {
+        continue;
+      }
+      uint32_t t = o.timer ? this->timerTime : this->ntpTime;
+      uint32_t from = t - BEFORE;
+      uint32_t to = t + AFTER;
+      size_t errors = this->h.count(o.date, from, to, true, -1);
+      std::string where = std::string(label) + " date " + std::to_string(o.date)
+                          + " fault " + std::to_string(o.fault) + (o.offloaded ? " offloaded" : "");
+
+      if (!o.timer) {
+        size_t synced = this->h.count(o.date, from, to, false, LOG_NTP_TIME_SYNCHRONIZED);
+        if (o.fault == NET_OK) {
+          EXPECT_EQ(synced, 1u) << where;
+          EXPECT_EQ(errors, 0u) << where;
+        } else {
+          ErrorCode err = (o.fault == NET_NTP_FAIL) ? ERR_NTP_TIMEOUT : ERR_WIFI_TIMEOUT;
+          EXPECT_EQ(synced, 0u) << where;
+          EXPECT_EQ(this->h.count(o.date, from, to, true, err), 1u) << where;
+        }
+        continue;
+      }
+
+      size_t off = this->h.count(o.date, from, to, false, LOG_TIMER_TURNED_OFF);
+      size_t on = this->h.count(o.date, from, to, false, LOG_TIMER_TURNED_ON);
+      size_t offVerified = this->h.count(o.date, from, to, false, LOG_TIMER_OFF_VERIFIED);
+      size_t verified = this->h.count(o.date, from, to, false, LOG_TIMER_VERIFIED);
+      EXPECT_LE(off, 1u) << where;
+      EXPECT_LE(on, 1u) << where;
+      EXPECT_LE(offVerified, 1u) << where;
+      EXPECT_LE(verified, 1u) << where;
+
+      if (o.fault == BLE_OK) {
+        EXPECT_EQ(errors, 0u) << where;
+        if (o.offloaded) {
+          // OFF の確認は、停滞して ON の時刻に近づいていたら実施しない
+          EXPECT_EQ(verified, 1u) << where;
+          EXPECT_EQ(off + on, 0u) << where;
+        } else {
+          // 本体の OFF は指定時刻から猶予 (と BLE 通信の時間) の間に記録される
+          EXPECT_EQ(off, 1u) << where;
+          EXPECT_EQ(on, 1u) << where;
+          EXPECT_EQ(this->h.count(o.date, t, t + 75, false, LOG_TIMER_TURNED_OFF), 1u) << where;
+        }
+      } else if (o.fault == BLE_OUTAGE) {
+        EXPECT_EQ(off + on + offVerified + verified, 0u) << where;
+        EXPECT_GE(errors, 2u) << where;
+      } else {
+        // 失敗した操作はエラーとして記録される
+        if (o.offloaded) {
+          EXPECT_GE(offVerified + verified + errors, 1u) << where;
+        } else {
+          EXPECT_GE(off + on + errors, 2u) << where;
+        }
+      }
+    }
+    EXPECT_EQ(this->h.begins, this->h.ends) << label;
+  }
+
+  // 区間を最初から最後まで通った処理の時刻の数
+  size_t completed(bool timer) const {
+    size_t n = 0;
+    for (const Occurrence& o : this->occurrences) {
+      n += (o.timer == timer && o.entered && o.left) ? 1 : 0;
+    }
+    return n;
+  }
+};
+
+// 0 時付近を避けて、互いに 2 時間以上離れた OFF/ON タイマーと NTP 時刻同期の時刻
+void pickTimes(std::mt19937& rng, bool wholeMinute, uint32_t& timerTime, uint32_t& ntpTime) {
+  do {
+    timerTime = HOUR + rng() % (DAY - 2 * HOUR);
+    ntpTime = HOUR + rng() % (DAY - 2 * HOUR);
+    if (wholeMinute) {
+      timerTime -= timerTime % 60;
+    }
+  } while ((timerTime + DAY - ntpTime) % DAY < 2 * HOUR || (ntpTime + DAY - timerTime) % DAY < 2 * HOUR);
+}
+
+FakePlugConfig plugConfig() {
+  FakePlugConfig config = FakeBleTransport::defaultConfig();
+  config.address = "aa:bb:cc:dd:ee:ff";
+  return config;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------
+// 故障のない長期間の動作
+// ---------------------------------------------------------------
+
+// 4 か月 (millis() の桁あふれを含む) の間、毎日 1 回ずつ OFF/ON と NTP 時刻同期を実施する
+// - RTC は 1 日に数秒ずれ、毎日の NTP 時刻同期で補正される
+TEST(ScheduledTasksTest, OwnTimerForMonths) {
+  std::mt19937 rng(1);
+  TaskHarness h(2025, 1, 22, 0);
+  h.start(plugConfig(), 1, 5 * HOUR, 5000, 3 * HOUR, false, 40, 50);
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.run((int64_t)120 * DAY);
+  replay.check("own");
+
+  EXPECT_GE(replay.completed(true), 119u);
+  EXPECT_GE(replay.completed(false), 119u);
+  EXPECT_EQ(h.timerFailed, 0u);
+  EXPECT_TRUE(h.fake->getState().power);
+}
+
+// 委任中は、プラグ本体が実施した OFF/ON を毎日確認する
+TEST(ScheduledTasksTest, OffloadedTimerForMonths) {
+  std::mt19937 rng(2);
+  TaskHarness h(2025, 3, 1, 0);
+  h.start(plugConfig(), 2, 5 * HOUR, 5000, 3 * HOUR, true, -20, -50);
+  ASSERT_TRUE(h.offload.isActive());
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.run((int64_t)60 * DAY);
+  replay.check("offloaded");
+
+  // ON は毎日確認する (OFF は停滞して ON の時刻に近づいた日は確認しない)
+  EXPECT_GE(replay.completed(true), 59u);
+  EXPECT_EQ(h.offload.getStats().fallbacks, 0u);
+  EXPECT_GE(h.offload.getStats().verified, replay.completed(true));
+  EXPECT_LE(h.offload.getStats().verified, 2 * replay.completed(true) + 2);
+  EXPECT_EQ(h.timerFailed, 0u);
+}
+
+// ---------------------------------------------------------------
+// 故障の注入
+// ---------------------------------------------------------------
+
+// NTP サーバーから応答がなければ ERR_NTP_TIMEOUT を記録し、RTC はそのまま
+TEST(ScheduledTasksTest, NtpFailureIsLogged) {
+  std::mt19937 rng(3);
+  TaskHarness h(2025, 1, 22, 0);
+  h.start(plugConfig(), 3, 5 * HOUR, 5000, 3 * HOUR, false);
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.netFault = NET_NTP_FAIL;
+  hostRtcDrift(0);
+  hostRtcSet(hostRtcNow() + 7);
+  replay.run(2 * DAY);
+  replay.check("ntp");
+
+  ASSERT_GE(replay.completed(false), 1u);
+  EXPECT_NEAR(hostRtcNow() - h.world.local(), 7, 1);
+}
+
+// Wi-Fi に接続できなければ ERR_WIFI_TIMEOUT を記録する
+TEST(ScheduledTasksTest, WifiFailureIsLogged) {
+  std::mt19937 rng(4);
+  TaskHarness h(2025, 1, 22, 0);
+  h.start(plugConfig(), 4, 5 * HOUR, 5000, 3 * HOUR, false);
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.netFault = NET_WIFI_FAIL;
+  replay.run(2 * DAY);
+  replay.check("wifi");
+  ASSERT_GE(replay.completed(false), 1u);
+}
+
+// OFF/ON の時刻に BLE が使えなければ、OFF と ON の失敗を記録する
+TEST(ScheduledTasksTest, BleOutageDuringTimerIsLogged) {
+  std::mt19937 rng(5);
+  TaskHarness h(2025, 1, 22, 0);
+  h.start(plugConfig(), 5, 5 * HOUR, 5000, 3 * HOUR, false);
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.bleFault = BLE_OUTAGE;
+  replay.run(2 * DAY);
+  replay.check("outage");
+
+  ASSERT_GE(replay.completed(true), 1u);
+  EXPECT_EQ(h.timerOk, 0u);
+  EXPECT_EQ(h.timerFailed, replay.completed(true));
+}
+
+// 委任中に BLE が使えなければ、確認できなかったことを記録する
+TEST(ScheduledTasksTest, BleOutageDuringVerifyIsLogged) {
+  std::mt19937 rng(6);
+  TaskHarness h(2025, 1, 22, 0);
+  h.start(plugConfig(), 6, 5 * HOUR, 5000, 3 * HOUR, true);
+  ASSERT_TRUE(h.offload.isActive());
+
+  // OFF と ON の両方を確認するように停滞させない
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.bleFault = BLE_OUTAGE;
+  replay.stallPercent = 0;
+  replay.run(2 * DAY);
+  replay.check("verify outage");
+
+  ASSERT_GE(replay.completed(true), 1u);
+  EXPECT_EQ(h.offload.getStats().verified, 0u);
+  EXPECT_EQ(h.offload.getStats().fallbacks, 2 * replay.completed(true));
+  EXPECT_EQ(h.timerFailed, replay.completed(true));
+}
+
+// 委任したタイマーがプラグから消えていたら、本体が OFF/ON を実施する
+// - 次の NTP 時刻同期で書き込み直すまでの間
+TEST(ScheduledTasksTest, MissingOffloadedTimerFallsBack) {
+  std::mt19937 rng(7);
+  TaskHarness h(2025, 1, 22, 4 * HOUR);
+  h.start(plugConfig(), 7, 5 * HOUR, 5000, 3 * HOUR, true);
+  ASSERT_TRUE(h.offload.isActive());
+  h.fake->getState().timerCount = 0;
+  uint16_t date = h.rtcDate();
+
+  Replay replay(h, rng, 5 * HOUR, 3 * HOUR);
+  replay.stallPercent = 0;
+  replay.run(DAY);
+
+  EXPECT_EQ(h.count(date, true, ERR_TIMER_NOT_EXECUTED), 2u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_TURNED_OFF), 1u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_TURNED_ON), 1u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_OFF_VERIFIED), 0u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_VERIFIED), 0u);
+  EXPECT_EQ(h.offload.getStats().fallbacks, 2u);
+  EXPECT_TRUE(h.fake->getState().power);
+}
+
+// 委任中は OFF と ON を別々の時刻に確認し、その間は loop() を止めない
+TEST(ScheduledTasksTest, OffloadedChecksDoNotBlock) {
+  TaskHarness h(2025, 1, 22, 4 * HOUR + 59 * 60);
+  h.start(plugConfig(), 8, 5 * HOUR, 65000, 3 * HOUR, true);
+  ASSERT_TRUE(h.offload.isActive());
+  uint16_t date = h.rtcDate();
+
+  // OFF は 05:00、ON は 05:02 (待ち時間を分単位に切り上げ)、ON の確認は 05:03
+  uint32_t longest = 0;
+  while (TaskHarness::rtcSecOfDay() < 5 * HOUR + 4 * 60) {
+    uint32_t start = millis();
+    h.tasks.run();
+    uint32_t took = millis() - start;
+    longest = (took > longest) ? took : longest;
+    uint32_t sec = TaskHarness::rtcSecOfDay();
+    if (sec > 5 * HOUR && sec < 5 * HOUR + 2 * 60) {
+      EXPECT_FALSE(h.fake->getState().power);
+      EXPECT_EQ(h.timerOk, 0u);
+    }
+    hostAdvance(1000);
+  }
+
+  EXPECT_LT(longest, 10000u);
+  EXPECT_EQ(h.count(date, 5 * HOUR + 30, 5 * HOUR + 60, false, LOG_TIMER_OFF_VERIFIED), 1u);
+  EXPECT_EQ(h.count(date, 5 * HOUR + 3 * 60, 5 * HOUR + 4 * 60, false, LOG_TIMER_VERIFIED), 1u);
+  EXPECT_EQ(h.count(date, true, -1), 0u);
+  EXPECT_EQ(h.timerOk, 1u);
+  EXPECT_EQ(h.begins, h.ends);
+}
+
+// loop() が停滞して OFF の確認が ON の時刻を過ぎたら、OFF の確認は実施しない
+// - ON になったプラグを OFF と取り違えて OFF にしない
+TEST(ScheduledTasksTest, LateOffCheckIsSkipped) {
+  TaskHarness h(2025, 1, 22, 4 * HOUR + 59 * 60);
+  h.start(plugConfig(), 9, 5 * HOUR, 5000, 3 * HOUR, true);
+  ASSERT_TRUE(h.offload.isActive());
+  uint16_t date = h.rtcDate();
+
+  // OFF の確認 (05:00:30) の直前から 40 秒停滞して、ON (05:01) の後に戻る
+  while (TaskHarness::rtcSecOfDay() < 5 * HOUR + 25) {
+    h.loopOnce(1000);
+  }
+  h.loopOnce(40000);
+  while (TaskHarness::rtcSecOfDay() < 5 * HOUR + 3 * 60) {
+    h.loopOnce(1000);
+  }
+
+  EXPECT_EQ(h.count(date, true, -1), 0u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_TURNED_OFF), 0u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_OFF_VERIFIED), 0u);
+  EXPECT_EQ(h.count(date, false, LOG_TIMER_VERIFIED), 1u);
+  EXPECT_TRUE(h.fake->getState().power);
+  EXPECT_EQ(h.timerOk, 1u);
+}
+
+// ---------------------------------------------------------------
+// 無作為な状況
+// ---------------------------------------------------------------
+
+// 時刻、待ち時間、委任の有無、RTC のずれと進み、loop() の間隔と停滞、
+// 故障の注入を無作為に変えても
+// - 処理の時刻ごとに、実施するか、失敗をエラーとして記録する
+// - 1 日に 2 回以上実施しない
+TEST(ScheduledTasksTest, RandomizedScenarios) {
+  std::mt19937 rng(20250122);
+
+  // 確認できた処理の時刻の数 ([OFF/ON タイマーか][委任中か][故障])
+  uint32_t covered[2][2][3] = {};
+
+  for (int scenario = 0; scenario < 5000; scenario++) {
+    bool offload = (scenario % 2 == 1);
+    uint32_t timerTime;
+    uint32_t ntpTime;
+    pickTimes(rng, offload, timerTime, ntpTime);
+    uint16_t interval = 1000 + rng() % 60000;
+    int32_t rtcError = (int32_t)(rng() % 241) - 120;
+    int32_t drift = (int32_t)(rng() % 101) - 50;
+
+    TaskHarness h(2025, 1 + rng() % 12, 1 + rng() % 28, rng() % DAY);
+    h.start(plugConfig(), 1 + scenario, timerTime, interval, ntpTime, offload, rtcError, drift);
+
+    Replay replay(h, rng, timerTime, ntpTime);
+    replay.faultPercent = 40;
+    replay.run(3 * DAY);
+
+    for (const Occurrence& o : replay.occurrences) {
+      if (o.entered && o.left) {
+        covered[o.timer][o.offloaded][o.fault]++;
+      }
+    }
+    std::string label = "scenario " + std::to_string(scenario);
+    replay.check(label.c_str());
+    if (testing::Test::HasFailure()) {
+      break;
+    }
+  }
+
+  // 全ての組み合わせを確認している (NTP 時刻同期は委任の有無によらない)
+  for (int timer = 0; timer < 2; timer++) {
+    for (int offloaded = 0; offloaded < 2; offloaded++) {
+      for (int fault = 0; fault < 3; fault++) {
+        EXPECT_GE(covered[timer][offloaded][fault], 500u) << timer << offloaded << fault;
+      }
+    }
+  }
+}
@@ -0,0 +1,272 @@
+/* ----------------------------------------------------------------
+  SerialControllerTest.cpp
+  - COBS / CRC-16 とフレームの処理を確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "MemoryStream.h"
+#include "SerialFrame.h"
+#include "SerialController.h"
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+Bytes encode(const Bytes& src) {
+  Bytes dst(src.size() + src.size() / 254 + 2);
+  dst.resize(SerialController::cobsEncode(src.data(), src.size(), dst.data()));
+  return dst;
+}
+
+Bytes decode(const Bytes& src) {
+  Bytes dst(src.size() + 1);
+  dst.resize(SerialController::cobsDecode(src.data(), src.size(), dst.data()));
+  return dst;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------
+// CRC-16/CCITT-FALSE
+// ---------------------------------------------------------------
+
+TEST(Crc16Test, CheckValue) {
+  const char* s = "123456789";
+  EXPECT_EQ(SerialController::crc16((const uint8_t*)s, 9), 0x29b1);
+}
+
+TEST(Crc16Test, Empty) {
+  EXPECT_EQ(SerialController::crc16(nullptr, 0), 0xffff);
+}
+
+TEST(Crc16Test, DetectsSingleBitErrors) {
+  uint8_t data[32];
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 7 + 3);
+  }
+  uint16_t crc = SerialController::crc16(data, sizeof(data));
+  for (size_t bit = 0; bit < sizeof(data) * 8; bit++) {
+    data[bit / 8] ^= (1 << (bit % 8));
+    EXPECT_NE(SerialController::crc16(data, sizeof(data)), crc) << bit;
+    data[bit / 8] ^= (1 << (bit % 8));
+  }
+}
+
+// ---------------------------------------------------------------
+// COBS
+// ---------------------------------------------------------------
+
+TEST(CobsTest, KnownVectors) {
+  EXPECT_EQ(encode({ 0x00 }), (Bytes{ 0x01, 0x01 }));
+  EXPECT_EQ(encode({ 0x00, 0x00 }), (Bytes{ 0x01, 0x01, 0x01 }));
+  EXPECT_EQ(encode({ 0x11, 0x22, 0x00, 0x33 }), (Bytes{ 0x03, 0x11, 0x22, 0x02, 0x33 }));
+  EXPECT_EQ(encode({ 0x11, 0x22, 0x33, 0x44 }), (Bytes{ 0x05, 0x11, 0x22, 0x33, 0x44 }));
+  EXPECT_EQ(encode({ 0x11, 0x00, 0x00, 0x00 }), (Bytes{ 0x02, 0x11, 0x01, 0x01, 0x01 }));
+}
+
+TEST(CobsTest, LongRuns) {
+  // 0x00 を含まない 254 バイトは 0xff のブロック 1 つ (最後に空のブロックが付く)
+  Bytes src(254);
+  for (size_t i = 0; i < src.size(); i++) {
+    src[i] = (uint8_t)(i + 1);
+  }
+  Bytes enc = encode(src);
+  ASSERT_EQ(enc.size(), 256u);
+  EXPECT_EQ(enc[0], 0xff);
+  EXPECT_EQ(enc[255], 0x01);
+  EXPECT_EQ(decode(enc), src);
+
+  // 255 バイトなら 2 ブロックに分かれる
+  src.push_back(0xff);
+  enc = encode(src);
+  ASSERT_EQ(enc.size(), 257u);
+  EXPECT_EQ(enc[0], 0xff);
+  EXPECT_EQ(enc[255], 0x02);
+  EXPECT_EQ(decode(enc), src);
+}
+
+TEST(CobsTest, RoundTripRandom) {
+  std::mt19937 rng(1);
+  for (int n = 0; n < 2000; n++) {
+    Bytes src(rng() % 300);
+    for (auto& b : src) {
+      // 0x00 が多めに出るようにする
+      b = (rng() % 4 == 0) ? 0x00 : (uint8_t)rng();
+    }
+    Bytes enc = encode(src);
+    for (uint8_t b : enc) {
+      ASSERT_NE(b, 0x00);
+    }
+    ASSERT_EQ(decode(enc), src);
+  }
+}
+
+TEST(CobsTest, RejectsInvalid) {
+  // ブロックの長さがデータより長い
+  EXPECT_TRUE(decode({ 0x05, 0x11, 0x22 }).empty());
+  // 0x00 を含む
+  EXPECT_TRUE(decode({ 0x02, 0x11, 0x00, 0x22 }).empty());
+}
+
+// ---------------------------------------------------------------
+// フレームの処理
+// ---------------------------------------------------------------
+
+namespace {
+
+SerialController* gController = nullptr;
+bool gPower = false;
+
+// 電源状態を変えるコマンドは、本体と同じく処理中に電源イベントを通知する
+uint8_t handleCommand(uint8_t cmd, const uint8_t* args, uint8_t argLen,
+                      uint8_t* out, uint8_t outMax, uint8_t& outLen) {
+  outLen = 0;
+  if (cmd == SERIAL_CMD_STATUS || cmd == SERIAL_CMD_TOGGLE) {
+    if (cmd == SERIAL_CMD_TOGGLE) {
+      gPower = !gPower;
+    }
+    uint8_t data = gPower ? 0x01 : 0x00;
+    gController->sendEvent(SERIAL_EVT_POWER, &data, 1);
+    out[0] = data;
+    outLen = 1;
+    return SERIAL_STATUS_OK;
+  }
+  if (cmd == SERIAL_CMD_DUMP_METRICS) {
+    if (outMax < 200) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    for (uint8_t i = 0; i < 200; i++) {
+      out[i] = i;
+    }
+    outLen = 200;
+    return SERIAL_STATUS_OK;
+  }
+  (void)args;
+  (void)argLen;
+  return SERIAL_STATUS_UNKNOWN_CMD;
+}
+
+// 受信したフレームを順に取り出す
+struct Frame {
+  uint8_t type;
+  uint8_t seq;
+  Bytes body;
+};
+
+std::vector<Frame> takeFrames(MemoryStream& stream) {
+  uint8_t buf[4096];
+  size_t len = stream.take(buf, sizeof(buf));
+  std::vector<Frame> frames;
+  size_t pos = 0;
+  while (pos < len) {
+    uint8_t frame[300];
+    size_t used;
+    size_t n = parseSerialFrame(buf + pos, len - pos, frame, used);
+    if (used == 0) {
+      break;
+    }
+    pos += used;
+    EXPECT_GE(n, 2u) << "CRC error";
+    if (n >= 2) {
+      frames.push_back({ frame[0], frame[1], Bytes(frame + 2, frame + n) });
+    }
+  }
+  return frames;
+}
+
+}  // namespace
+
+class SerialControllerTest : public ::testing::Test {
+protected:
+  MemoryStream stream;
+  SerialController controller{ stream };
+
+  void SetUp() override {
+    gController = &this->controller;
+    gPower = false;
+    this->controller.setHandler(handleCommand);
+  }
+
+  void sendRequest(uint8_t seq, const Bytes& body) {
+    uint8_t buf[300];
+    size_t n = buildSerialFrame(SERIAL_FRAME_REQUEST, seq, body.data(), body.size(), buf);
+    this->stream.feed(buf, n);
+  }
+};
+
+// 処理中に通知したイベントで応答が壊れない (イベントが先に届く)
+TEST_F(SerialControllerTest, EventDuringCommandKeepsResponseIntact) {
+  this->sendRequest(0x42, { SERIAL_CMD_TOGGLE, 0, SERIAL_CMD_STATUS, 0 });
+  this->controller.handle();
+
+  std::vector<Frame> frames = takeFrames(this->stream);
+  ASSERT_EQ(frames.size(), 3u);
+
+  EXPECT_EQ(frames[0].type, SERIAL_FRAME_EVENT);
+  EXPECT_EQ(frames[0].body, (Bytes{ SERIAL_EVT_POWER, 1, 0x01 }));
+  EXPECT_EQ(frames[1].type, SERIAL_FRAME_EVENT);
+
+  EXPECT_EQ(frames[2].type, SERIAL_FRAME_RESPONSE);
+  EXPECT_EQ(frames[2].seq, 0x42);
+  EXPECT_EQ(frames[2].body, (Bytes{ SERIAL_CMD_TOGGLE, SERIAL_STATUS_OK, 1, 0x01,
+                                    SERIAL_CMD_STATUS, SERIAL_STATUS_OK, 1, 0x01 }));
+  EXPECT_EQ(this->controller.getDropped(), 0u);
+}
+
+// 応答を待たずに送った要求は順に処理され、シーケンス番号で対応付けられる
+TEST_F(SerialControllerTest, PipelinedRequests) {
+  for (uint8_t seq = 1; seq <= 4; seq++) {
+    this->sendRequest(seq, { SERIAL_CMD_TOGGLE, 0 });
+  }
+  this->controller.handle();
+
+  std::vector<Frame> frames = takeFrames(this->stream);
+  std::vector<uint8_t> seqs;
+  for (const Frame& f : frames) {
+    if (f.type == SERIAL_FRAME_RESPONSE) {
+      seqs.push_back(f.seq);
+    }
+  }
+  EXPECT_EQ(seqs, (std::vector<uint8_t>{ 1, 2, 3, 4 }));
+  EXPECT_FALSE(gPower);
+}
+
+// 貯められる数 (4) を超えた要求と CRC が不正な要求は捨てる
+TEST_F(SerialControllerTest, DropsOverflowAndCorruptFrames) {
+  for (uint8_t seq = 1; seq <= 5; seq++) {
+    this->sendRequest(seq, { SERIAL_CMD_STATUS, 0 });
+  }
+  uint8_t buf[32];
+  uint8_t body[] = { SERIAL_CMD_STATUS, 0 };
+  size_t n = buildSerialFrame(SERIAL_FRAME_REQUEST, 6, body, sizeof(body), buf);
+  buf[2] ^= 0x10;
+  this->controller.handle();
+  this->stream.feed(buf, n);
+  this->controller.handle();
+
+  size_t responses = 0;
+  for (const Frame& f : takeFrames(this->stream)) {
+    responses += (f.type == SERIAL_FRAME_RESPONSE);
+  }
+  EXPECT_EQ(responses, 4u);
+  EXPECT_EQ(this->controller.getDropped(), 2u);
+}
+
+// 応答が最大長に収まらないコマンドは打ち切る
+TEST_F(SerialControllerTest, ResponseIsTruncatedToFrameSize) {
+  this->sendRequest(7, { SERIAL_CMD_DUMP_METRICS, 0, SERIAL_CMD_DUMP_METRICS, 0 });
+  this->controller.handle();
+
+  std::vector<Frame> frames = takeFrames(this->stream);
+  ASSERT_EQ(frames.size(), 1u);
+  ASSERT_EQ(frames[0].body.size(), 3u + 200 + 3);
+  EXPECT_EQ(frames[0].body[1], SERIAL_STATUS_OK);
+  EXPECT_EQ(frames[0].body[203 + 1], SERIAL_STATUS_BAD_ARGS);
+}
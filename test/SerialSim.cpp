@@ -0,0 +1,251 @@
+/* ----------------------------------------------------------------
+  SerialSim.cpp
+  - 疑似端末 (pty) 上で SerialController を動かすシミュレーター
+  - 本体の handleSerialCommand() と同じように、電源状態を変えるコマンドの
+    処理中に電源イベントを通知する
+  - SwitchBot Plug Mini は SwitchBotPlugMini を模擬の BLE (FakeBleTransport) で
+    動かすので、診断情報の BLE の統計情報も本体と同じように集計される
+  - 起動すると疑似端末のパスを 1 行出力する。標準入力が閉じられると終了する
+
+  使い方: SerialSim [--baud 115200] [--ble-ms 0] [--connect-ms 0]
+    --baud        送信を指定したボーレート相当に遅らせる (0 なら遅らせない)
+    --ble-ms      電源状態のコマンドごとの BLE の応答の時間 (ミリ秒)
+    --connect-ms  BLE の接続にかかる時間 (ミリ秒)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "FakeBleTransport.h"
+#include "LogStore.h"
+#include "SerialController.h"
+#include "SwitchBotPlugMini.h"
+
+namespace {
+
+// 疑似端末のマスター側を読み書きする Stream
+// - 送信はボーレート相当の時間だけ遅らせる
+class PtyStream : public Stream {
+private:
+  int _fd;
+  uint32_t _baud;
+
+public:
+  PtyStream(int fd, uint32_t baud) : _fd(fd), _baud(baud) {}
+
+  int available() override {
+    int n = 0;
+    if (ioctl(this->_fd, FIONREAD, &n) < 0) {
+      return 0;
+    }
+    return n;
+  }
+
+  int read() override {
+    uint8_t c;
+    if (this->available() <= 0 || ::read(this->_fd, &c, 1) != 1) {
+      return -1;
+    }
+    return c;
+  }
+
+  size_t write(uint8_t c) override {
+    return this->write(&c, 1);
+  }
+
+  size_t write(const uint8_t* buf, size_t len) override {
+    size_t n = 0;
+    while (n < len) {
+      ssize_t r = ::write(this->_fd, buf + n, len - n);
+      if (r < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        break;
+      }
+      n += r;
+    }
+    // 1 バイト = スタートビット + 8 ビット + ストップビット
+    if (this->_baud > 0) {
+      usleep((useconds_t)((uint64_t)len * 10 * 1000000 / this->_baud));
+    }
+    return n;
+  }
+};
+
+const char* PLUG_ADDRESS = "aa:bb:cc:dd:ee:ff";
+
+SerialController* gController = nullptr;
+SwitchBotPlugMini gPlug(PLUG_ADDRESS);
+LogStore gLogStore(256);
+
+// 電源状態の変化を通知する (本体の showPowerStatus() と同じ)
+void notifyPower(bool status) {
+  uint8_t data = status ? 0x01 : 0x00;
+  gController->sendEvent(SERIAL_EVT_POWER, &data, 1);
+}
+
+// 32 ビット値をリトルエンディアンで書き込む (本体の putU32() と同じ)
+void putU32(uint8_t* p, uint32_t v) {
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+// ログを追加して通知する (本体の addLog() と同じ)
+void addLog(uint8_t code) {
+  LogRecord rec = { LogStore::packStamp(2025, 1, 22, 5, 0, 0), false, code, 0 };
+  gLogStore.push(rec.stamp, rec.err, rec.code);
+  gController->sendEvent(SERIAL_EVT_LOG, (const uint8_t*)&rec, sizeof(rec));
+}
+
+uint8_t handleCommand(uint8_t cmd, const uint8_t* args, uint8_t argLen,
+                      uint8_t* out, uint8_t outMax, uint8_t& outLen) {
+  outLen = 0;
+
+  if (cmd == SERIAL_CMD_STATUS || cmd == SERIAL_CMD_SET || cmd == SERIAL_CMD_TOGGLE) {
+    if (outMax < 1) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    bool status;
+    bool ok;
+    if (cmd == SERIAL_CMD_STATUS) {
+      ok = gPlug.getPowerStatus(status);
+    } else if (cmd == SERIAL_CMD_SET) {
+      if (argLen != 1) {
+        return SERIAL_STATUS_BAD_ARGS;
+      }
+      status = (args[0] != 0x00);
+      ok = gPlug.setPowerStatus(status);
+    } else {
+      ok = gPlug.togglePowerStatus(status);
+    }
+    if (!ok) {
+      return gPlug.getError();
+    }
+    notifyPower(status);
+    out[0] = status ? 0x01 : 0x00;
+    outLen = 1;
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_DUMP_LOG) {
+    if (argLen != 3) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    size_t start = args[0] | (args[1] << 8);
+    size_t n = 0;
+    LogRecord rec;
+    while (n < args[2] && (n + 1) * sizeof(rec) <= outMax && gLogStore.get(start + n, rec)) {
+      memcpy(out + n * sizeof(rec), &rec, sizeof(rec));
+      n++;
+    }
+    outLen = n * sizeof(rec);
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_DUMP_METRICS) {
+    // 本体と同じ並び (模擬していない値は 0)
+    if (outMax < 4 * 34) {
+      return SERIAL_STATUS_BAD_ARGS;
+    }
+    const BleStats& bs = gPlug.getStats();
+    const LinkStats& ls = gPlug.getLinkStats();
+    uint32_t values[34] = { millis(), ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap() };
+    values[11] = gController->getDropped();
+    values[12] = bs.initHeap;
+    values[13] = bs.connects;
+    values[14] = bs.failures;
+    values[15] = bs.lastConnectMs;
+    values[16] = bs.maxConnectMs;
+    values[26] = (uint32_t)(int32_t)ls.avgRssi;
+    values[27] = ls.mtu;
+    values[28] = ls.retries;
+    values[32] = bs.avgConnectMs;
+    values[33] = bs.connectHeap;
+    for (size_t i = 0; i < 34; i++) {
+      putU32(out + i * 4, values[i]);
+    }
+    outLen = sizeof(values);
+    return SERIAL_STATUS_OK;
+
+  } else if (cmd == SERIAL_CMD_CONFIG) {
+    addLog(LOG_CONFIG_RELOADED);
+    return SERIAL_STATUS_OK;
+  }
+
+  return SERIAL_STATUS_UNKNOWN_CMD;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t baud = 0;
+  FakePlugConfig config = FakeBleTransport::defaultConfig();
+  config.address = PLUG_ADDRESS;
+  config.connectMs = 0;
+  config.responseMs = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--baud") == 0) {
+      baud = strtoul(argv[i + 1], nullptr, 10);
+    } else if (strcmp(argv[i], "--ble-ms") == 0) {
+      config.responseMs = strtoul(argv[i + 1], nullptr, 10);
+    } else if (strcmp(argv[i], "--connect-ms") == 0) {
+      config.connectMs = strtoul(argv[i + 1], nullptr, 10);
+    }
+  }
+  static_cast<FakeBleTransport*>(createBleTransport())->configure(config);
+  gPlug.init();
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  // スレーブ側を開いたままにして、クライアントが閉じても切断されないようにする
+  const char* path = ptsname(master);
+  int slave = open(path, O_RDWR | O_NOCTTY);
+  struct termios attr;
+  tcgetattr(slave, &attr);
+  cfmakeraw(&attr);
+  tcsetattr(slave, TCSANOW, &attr);
+
+  gLogStore.init();
+  PtyStream stream(master, baud);
+  SerialController controller(stream);
+  gController = &controller;
+  controller.setHandler(handleCommand);
+  addLog(LOG_SYSTEM_STARTED_UP);
+
+  printf("%s\n", path);
+  fflush(stdout);
+
+  // loop() と同じく、受信を待って処理する
+  struct pollfd fds[2] = { { master, POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+  while (true) {
+    if (poll(fds, 2, 20) < 0 && errno != EINTR) {
+      break;
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP)) {
+      char c;
+      if (read(STDIN_FILENO, &c, 1) <= 0) {
+        break;
+      }
+    }
+    controller.handle();
+  }
+
+  close(slave);
+  close(master);
+  return 0;
+}
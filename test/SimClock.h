@@ -0,0 +1,129 @@
+/* ----------------------------------------------------------------
+  SimClock.h
+  - テスト用の模擬時計 (RTC の代わり)
+  - UTC の経過秒と現地時間のオフセットから、loop() が RTC から読む
+    日付 (YYYYMMDD) と 0 時からの秒数を作る
+  - 夏時間の切り替えと、NTP 時刻同期による RTC の補正 (前後への飛び) を
+    再現できる
+  - 仮想時間に合わせて進めれば、NTP サーバーの時計 (実際の時刻) としても使える
+    (delay() で進んだ分も含めて進む)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef SimClock_h
+#define SimClock_h
+#include <Arduino.h>
+
+class SimClock {
+private:
+  // UTC の 1970-01-01 00:00:00 からの秒数 (仮想時間に合わせる場合は _baseUs の時点)
+  int64_t _utc;
+
+  // 仮想時間に合わせて進めるかどうかと、合わせ始めた時点の起動からの時間 (マイクロ秒)
+  bool _follow = false;
+  uint64_t _baseUs = 0;
+
+  // 標準時のオフセット (秒)
+  int32_t _offset;
+
+  // 夏時間 (この期間は _dstShift 秒進める, UTC で [_dstStart, _dstEnd))
+  int64_t _dstStart = 0;
+  int64_t _dstEnd = 0;
+  int32_t _dstShift = 0;
+
+  // 年月日から 1970-01-01 からの日数
+  static int64_t _daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+  }
+
+  // 1970-01-01 からの日数から YYYYMMDD
+  static uint32_t _civilFromDays(int64_t z) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t y = (int64_t)yoe + era * 400;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp + (mp < 10 ? 3 : -9);
+    return (uint32_t)((y + (m <= 2)) * 10000 + m * 100 + d);
+  }
+
+public:
+  // 現地時間の日時から開始する (夏時間なし)
+  SimClock(int year, unsigned month, unsigned day, uint32_t secOfDay, int32_t offset = 9 * 3600)
+    : _offset(offset) {
+    this->_utc = _daysFromCivil(year, month, day) * 86400 + secOfDay - offset;
+  }
+
+  // 夏時間を設定する (切り替えの日時は現地の標準時で指定する)
+  void setDst(int year, unsigned m1, unsigned d1, uint32_t s1, unsigned m2, unsigned d2, uint32_t s2, int32_t shift = 3600) {
+    this->_dstStart = _daysFromCivil(year, m1, d1) * 86400 + s1 - this->_offset;
+    this->_dstEnd = _daysFromCivil(year, m2, d2) * 86400 + s2 - this->_offset;
+    this->_dstShift = shift;
+  }
+
+  // 仮想時間に合わせて進める (以降は advance() で仮想時間を進める)
+  void followVirtualTime() {
+    this->_follow = true;
+    this->_baseUs = hostMicros64();
+  }
+
+  // 時間を進める (秒)
+  void advance(int64_t sec) {
+    if (this->_follow) {
+      hostAdvance((uint32_t)(sec * 1000));
+    } else {
+      this->_utc += sec;
+    }
+  }
+
+  // RTC を補正する (負の値なら戻す)
+  void step(int64_t sec) {
+    this->_utc += sec;
+  }
+
+  // 現地時間の 1970-01-01 00:00:00 からの秒数
+  int64_t local() const {
+    int64_t utc = this->utc();
+    int64_t local = utc + this->_offset;
+    if (utc >= this->_dstStart && utc < this->_dstEnd) {
+      local += this->_dstShift;
+    }
+    return local;
+  }
+
+  // 現地時間の日付 (YYYYMMDD)
+  uint32_t date() const {
+    int64_t local = this->local();
+    int64_t days = (local >= 0) ? local / 86400 : (local - 86399) / 86400;
+    return _civilFromDays(days);
+  }
+
+  // 現地時間の 0 時からの秒数
+  uint32_t secOfDay() const {
+    int64_t local = this->local();
+    int64_t s = local % 86400;
+    return (uint32_t)((s < 0) ? s + 86400 : s);
+  }
+
+  // UTC の経過秒
+  int64_t utc() const {
+    if (this->_follow) {
+      return this->_utc + (int64_t)((hostMicros64() - this->_baseUs) / 1000000);
+    }
+    return this->_utc;
+  }
+};
+
+#endif
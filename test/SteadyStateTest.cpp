@@ -0,0 +1,227 @@
+/* ----------------------------------------------------------------
+  SteadyStateTest.cpp
+  - loop() の定常状態でヒープ確保が発生しないことを確認する
+  - 時刻で実施する処理は、loop() と同じ ScheduledTasks::run() を TaskHarness
+    (模擬のプラグと RTC) で動かす
+  - HTTP API と USB シリアルは、loop() から呼ぶ handle() と通知を確認する
+  - 起動時の確保 (LogStore::init() など) と、リクエストの受け付け・
+    ファームウェア更新 (ESP32 の WiFiClient / HTTPClient が確保する) は
+    定常状態に含めない
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "AllocCounter.h"
+#include "MemoryStream.h"
+#include "SerialFrame.h"
+#include "TaskHarness.h"
+#include "ApiServer.h"
+#include "HeapMonitor.h"
+#include "LogStore.h"
+#include "SerialController.h"
+
+namespace {
+
+LogStore* gLogStore = nullptr;
+bool gPower = false;
+
+// loop() から呼ばれるシリアルコマンドの処理関数の代わり
+uint8_t handleCommand(uint8_t cmd, const uint8_t* args, uint8_t argLen,
+                      uint8_t* out, uint8_t outMax, uint8_t& outLen) {
+  outLen = 0;
+  if (cmd == SERIAL_CMD_TOGGLE) {
+    gPower = !gPower;
+    out[0] = gPower ? 0x01 : 0x00;
+    outLen = 1;
+    return SERIAL_STATUS_OK;
+  }
+  if (cmd == SERIAL_CMD_DUMP_LOG && argLen == 3) {
+    size_t n = 0;
+    LogRecord rec;
+    while (n < args[2] && (n + 1) * sizeof(rec) <= outMax && gLogStore->get(args[0] + n, rec)) {
+      memcpy(out + n * sizeof(rec), &rec, sizeof(rec));
+      n++;
+    }
+    outLen = n * sizeof(rec);
+    return SERIAL_STATUS_OK;
+  }
+  return SERIAL_STATUS_UNKNOWN_CMD;
+}
+
+// ループバックで ApiServer に接続する
+int connectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+}  // namespace
+
+class SteadyStateTest : public ::testing::Test {
+protected:
+  LogStore logStore{ 256 };
+  ApiServer apiServer{ logStore };
+  MemoryStream stream;
+  SerialController serial{ stream };
+  int sseFd = -1;
+
+  void SetUp() override {
+    hostUseVirtualTime(true);
+    ASSERT_TRUE(this->logStore.init());
+    gLogStore = &this->logStore;
+    this->serial.setHandler(handleCommand);
+
+    // SSE の接続を 1 つ張っておく (通知の送信も定常状態に含める)
+    this->apiServer.begin();
+    this->sseFd = connectTo(hostWiFiPort());
+    ASSERT_GE(this->sseFd, 0);
+    const char* req = "GET /events HTTP/1.1\r\n\r\n";
+    ASSERT_EQ(write(this->sseFd, req, strlen(req)), (ssize_t)strlen(req));
+    hostUseVirtualTime(false);
+    this->apiServer.handle();
+    hostUseVirtualTime(true);
+  }
+
+  void TearDown() override {
+    if (this->sseFd >= 0) {
+      close(this->sseFd);
+    }
+    hostUseVirtualTime(false);
+  }
+};
+
+// 時刻で実施する処理 (OFF/ON タイマー、NTP 時刻同期、委任の同期と確認) を含めて、
+// loop() の時刻の処理とヒープの統計情報の更新は確保しない
+TEST(SteadyStateLoopTest, ScheduledTasksDoNotAllocate) {
+  for (bool offload : { false, true }) {
+    TaskHarness h(2025, 1, 22, 0);
+    FakePlugConfig config = FakeBleTransport::defaultConfig();
+    config.address = "aa:bb:cc:dd:ee:ff";
+    h.start(config, 1, 5 * 3600, 5000, 3 * 3600, offload, 30, 40);
+    ASSERT_EQ(h.offload.isActive(), offload);
+    HeapMonitor heapMonitor;
+
+    // 1 日目は除く (各部の初回の処理)
+    h.run(TaskHarness::DAY, 1000);
+    size_t before = h.logs.size();
+
+    allocCountStart();
+    for (int day = 0; day < 3; day++) {
+      h.run(TaskHarness::DAY - 3600, 1000);
+      for (int i = 0; i < 3600; i++) {
+        h.loopOnce(1000);
+        heapMonitor.sample();
+      }
+    }
+    size_t allocs = allocCountStop();
+
+    EXPECT_EQ(allocs, 0u) << (offload ? "offloaded" : "own");
+
+    // 3 日分の OFF/ON (委任中は確認) と NTP 時刻同期を実施している
+    EXPECT_EQ(h.timerOk, 4u);
+    EXPECT_GE(h.logs.size() - before, offload ? 6u : 9u);
+  }
+}
+
+// USB シリアルの要求の処理と、HTTP API・USB シリアルへのログと電源状態の通知は確保しない
+TEST_F(SteadyStateTest, ServicesDoNotAllocate) {
+  // 1 周目は除く (各部の初回の処理)
+  this->apiServer.handle();
+  this->serial.handle();
+
+  uint8_t req[64];
+  uint8_t body[] = { SERIAL_CMD_TOGGLE, 0, SERIAL_CMD_DUMP_LOG, 3, 0, 0, 4 };
+  uint8_t sink[4096];
+
+  allocCountStart();
+  for (uint32_t i = 1; i < 5000; i++) {
+    // ときどきシリアルの要求を受信する
+    if (i % 10 == 0) {
+      size_t n = buildSerialFrame(SERIAL_FRAME_REQUEST, (uint8_t)i, body, sizeof(body), req);
+      this->stream.feed(req, n);
+    }
+    this->apiServer.handle();
+    this->serial.handle();
+
+    // ログの追加と通知
+    LogRecord rec = { LogStore::packStamp(2025, 1, 22, 5, 0, i % 60), (i % 3) == 0, (uint8_t)(1 + i % 8), 0 };
+    this->logStore.push(rec.stamp, rec.err, rec.code);
+    this->apiServer.notifyLog(rec);
+    this->serial.sendEvent(SERIAL_EVT_LOG, (const uint8_t*)&rec, sizeof(rec));
+    this->apiServer.setPowerStatus((i & 1) != 0);
+    this->stream.take(sink, sizeof(sink));
+
+    // ログ表示 (LcdController::showLogs() と同じ読み出し)
+    char line[LOG_LINE_LEN];
+    for (size_t pos = 0; pos < 8; pos++) {
+      if (this->logStore.getFiltered(pos, rec)) {
+        LogStore::formatRecord(rec, line, sizeof(line));
+      }
+    }
+
+    // ログの絞り込みを切り替える
+    if (i % 500 == 0) {
+      LogFilter filter = { (LogType)((i / 500) % 3), 0 };
+      this->logStore.setFilter(filter);
+    }
+    hostAdvance(20);
+  }
+  size_t allocs = allocCountStop();
+
+  EXPECT_EQ(allocs, 0u);
+  EXPECT_EQ(this->serial.getDropped(), 0u);
+}
+
+// ESP32 では WiFiClient の受け付けで確保が発生するが、
+// ApiServer のリクエストの処理自体は確保しないことを確認する
+TEST_F(SteadyStateTest, RequestHandlingDoesNotAllocate) {
+  const char* paths[] = { "/status", "/schedule", "/logs?n=30", "/nothing" };
+  char res[4096];
+
+  for (const char* path : paths) {
+    int fd = connectTo(hostWiFiPort());
+    ASSERT_GE(fd, 0);
+    char req[128];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: test\r\n\r\n", path);
+    ASSERT_EQ(write(fd, req, len), len);
+
+    hostUseVirtualTime(false);
+    allocCountStart();
+    this->apiServer.handle();
+    size_t allocs = allocCountStop();
+    hostUseVirtualTime(true);
+
+    EXPECT_EQ(allocs, 0u) << path;
+    ssize_t n = read(fd, res, sizeof(res) - 1);
+    ASSERT_GT(n, 0) << path;
+    close(fd);
+  }
+}
+
+// 確保を数えられていることを確認する
+// - 最適化で確保が省かれないように volatile なポインタに入れる
+TEST(AllocCounterTest, CountsAllocations) {
+  static char* volatile p;
+  static void* volatile q;
+  allocCountStart();
+  p = new char[64];
+  q = malloc(16);
+  size_t allocs = allocCountStop();
+  delete[] p;
+  free(q);
+  EXPECT_EQ(allocs, 2u);
+}
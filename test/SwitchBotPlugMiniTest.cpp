@@ -0,0 +1,242 @@
+/* ----------------------------------------------------------------
+  SwitchBotPlugMiniTest.cpp
+  - 模擬した BLE (FakeBleTransport) で SwitchBotPlugMini を確認する
+  - 接続・応答の待ち時間は仮想時間で進める
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include "FakeBleTransport.h"
+#include "SwitchBotPlugMini.h"
+
+namespace {
+
+const char* ADDRESS = "aa:bb:cc:dd:ee:ff";
+
+class SwitchBotPlugMiniTest : public testing::Test {
+protected:
+  FakeBleTransport* fake = static_cast<FakeBleTransport*>(createBleTransport());
+  FakePlugConfig config = FakeBleTransport::defaultConfig();
+
+  void SetUp() override {
+    hostUseVirtualTime(true);
+    this->config.address = ADDRESS;
+    this->fake->configure(this->config);
+  }
+
+  void TearDown() override {
+    hostUseVirtualTime(false);
+  }
+
+  void reconfigure() {
+    this->fake->configure(this->config);
+  }
+};
+
+}  // namespace
+
+TEST_F(SwitchBotPlugMiniTest, BackendIsSelectedAtBuildTime) {
+  SwitchBotPlugMini plug(ADDRESS);
+  EXPECT_STREQ(plug.getStats().backend, "Fake");
+}
+
+TEST_F(SwitchBotPlugMiniTest, FindsOnlyTheConfiguredAddress) {
+  SwitchBotPlugMini plug(ADDRESS);
+  plug.init();
+  EXPECT_TRUE(plug.find());
+  EXPECT_EQ(plug.getLinkStats().advRssi, -55);
+
+  SwitchBotPlugMini other("11:22:33:44:55:66");
+  EXPECT_FALSE(other.find());
+  EXPECT_EQ(other.getError(), ERR_DEVICE_NOT_FOUND);
+}
+
+TEST_F(SwitchBotPlugMiniTest, PowerCommands) {
+  SwitchBotPlugMini plug(ADDRESS);
+  bool status = true;
+  ASSERT_TRUE(plug.getPowerStatus(status));
+  EXPECT_FALSE(status);
+
+  ASSERT_TRUE(plug.setPowerStatus(true));
+  EXPECT_TRUE(this->fake->getState().power);
+
+  ASSERT_TRUE(plug.togglePowerStatus(status));
+  EXPECT_FALSE(status);
+  EXPECT_FALSE(this->fake->getState().power);
+
+  // コマンドごとに接続して切断する
+  EXPECT_EQ(plug.getStats().connects, 3u);
+  EXPECT_FALSE(this->fake->isConnected());
+}
+
+TEST_F(SwitchBotPlugMiniTest, ConnectLatencyIsRecorded) {
+  this->config.connectMs = 400;
+  this->reconfigure();
+  SwitchBotPlugMini plug(ADDRESS);
+  bool status;
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(plug.getPowerStatus(status));
+  }
+  const BleStats& stats = plug.getStats();
+  EXPECT_EQ(stats.connects, 5u);
+  EXPECT_EQ(stats.failures, 0u);
+  EXPECT_EQ(stats.lastConnectMs, 400u);
+  EXPECT_EQ(stats.avgConnectMs, 400u);
+  EXPECT_EQ(stats.maxConnectMs, 400u);
+}
+
+TEST_F(SwitchBotPlugMiniTest, MtuIsNegotiated) {
+  // プラグの最大値の方が大きければ要求した値
+  SwitchBotPlugMini plug(ADDRESS);
+  bool status;
+  ASSERT_TRUE(plug.getPowerStatus(status));
+  EXPECT_EQ(this->fake->getState().requestedMtu, BLE_PREFERRED_MTU);
+  EXPECT_EQ(plug.getLinkStats().mtu, BLE_PREFERRED_MTU);
+
+  // 要求した値ではなく合意した値を記録する
+  this->config.mtu = 100;
+  this->reconfigure();
+  ASSERT_TRUE(plug.getPowerStatus(status));
+  EXPECT_EQ(plug.getLinkStats().mtu, 100);
+}
+
+TEST_F(SwitchBotPlugMiniTest, TimerCommands) {
+  SwitchBotPlugMini plug(ADDRESS);
+  ASSERT_TRUE(plug.connect());
+  ASSERT_TRUE(plug.setClock(1737500000));
+  ASSERT_TRUE(plug.writeTimer(0, 2, { 22, 30, false }));
+  ASSERT_TRUE(plug.writeTimer(1, 2, { 22, 35, true }));
+
+  uint8_t count;
+  PlugTimer timer;
+  ASSERT_TRUE(plug.readTimer(1, count, timer));
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(timer.hour, 22);
+  EXPECT_EQ(timer.minute, 35);
+  EXPECT_TRUE(timer.power);
+  plug.disconnect();
+
+  const FakePlugState& s = this->fake->getState();
+  EXPECT_EQ(s.clock, 1737500000u);
+  EXPECT_EQ(s.timerCount, 2);
+  EXPECT_FALSE(s.timers[0].power);
+  // 一連のコマンドは 1 回の接続で送る
+  EXPECT_EQ(s.connects, 1u);
+}
+
+TEST_F(SwitchBotPlugMiniTest, TimerRejected) {
+  this->config.timerSupported = false;
+  this->reconfigure();
+  SwitchBotPlugMini plug(ADDRESS);
+  EXPECT_FALSE(plug.setClock(1737500000));
+  EXPECT_EQ(plug.getError(), ERR_TIMER_REJECTED);
+}
+
+TEST_F(SwitchBotPlugMiniTest, ConnectFailureIsRetried) {
+  this->config.lossPercent = 100;
+  this->reconfigure();
+  SwitchBotPlugMini plug(ADDRESS);
+  bool status;
+  EXPECT_FALSE(plug.getPowerStatus(status));
+  EXPECT_EQ(plug.getError(), ERR_CONNECT_FAILED);
+  EXPECT_GT(plug.getStats().failures, 1u);
+  EXPECT_EQ(plug.getStats().failures, plug.getLinkStats().retries + 1);
+}
+
+// MTU まで長い NOTIFY も切り詰めずに受信する
+TEST_F(SwitchBotPlugMiniTest, LongNotifyIsReceived) {
+  this->config.responsePadding = 100;
+  this->reconfigure();
+  SwitchBotPlugMini plug(ADDRESS);
+  ASSERT_TRUE(plug.connect());
+  ASSERT_TRUE(plug.writeTimer(0, 1, { 22, 30, false }));
+
+  uint8_t count;
+  PlugTimer timer;
+  ASSERT_TRUE(plug.readTimer(0, count, timer));
+  EXPECT_EQ(timer.hour, 22);
+  EXPECT_EQ(timer.minute, 30);
+  EXPECT_EQ(plug.getLinkStats().maxNotifyLen, 107);
+  plug.disconnect();
+}
+
+// 再試行の待ち時間が接続全体の上限を超えるなら、残りの再試行をやめる
+TEST_F(SwitchBotPlugMiniTest, ConnectRetriesAreBounded) {
+  // 電波が弱いと試行回数 4 回、待ち時間 1 秒から倍々で再試行する
+  this->config.rssi = -90;
+  this->reconfigure();
+  SwitchBotPlugMini plug(ADDRESS);
+  ASSERT_TRUE(plug.find());
+
+  this->config.lossPercent = 100;
+  this->reconfigure();
+  uint32_t stime = millis();
+  EXPECT_FALSE(plug.connect());
+  uint32_t elapsed = millis() - stime;
+
+  // 上限 (10 秒) を超えてから始まる試行はなく、始まった試行の失敗 (failMs) までで終わる
+  EXPECT_LE(elapsed, 10000u + this->config.failMs);
+  EXPECT_EQ(plug.getLinkStats().retries, 2u);
+  EXPECT_EQ(this->fake->getState().scans, 0u);
+}
+
+// 距離による電波の減衰を模擬して、RSSI の区分ごとの成功率と応答時間を集計する
+TEST_F(SwitchBotPlugMiniTest, PathLossReport) {
+  const float distances[] = { 1, 3, 6, 10, 15, 20, 30 };
+  const int commands = 50;
+  LinkBucket total[LINK_RSSI_BUCKETS] = {};
+  uint64_t sumMs[LINK_RSSI_BUCKETS] = {};
+
+  uint32_t seed = 1;
+  for (float d : distances) {
+    this->config.distanceM = d;
+    this->config.pathLossExp = 2.5f;
+    this->config.shadowDb = 4.0f;
+    this->fake->configure(this->config, seed++);
+
+    SwitchBotPlugMini plug(ADDRESS);
+    plug.find();
+    bool status;
+    for (int i = 0; i < commands; i++) {
+      plug.getPowerStatus(status);
+    }
+
+    const LinkStats& link = plug.getLinkStats();
+    for (uint8_t b = 0; b < LINK_RSSI_BUCKETS; b++) {
+      total[b].commands += link.buckets[b].commands;
+      total[b].successes += link.buckets[b].successes;
+      sumMs[b] += (uint64_t)link.buckets[b].avgMs * link.buckets[b].successes;
+      if (link.buckets[b].maxMs > total[b].maxMs) {
+        total[b].maxMs = link.buckets[b].maxMs;
+      }
+    }
+  }
+
+  printf("[ pathloss ] %-9s %6s %8s %8s %8s\n", "RSSI", "cmds", "ok %", "avg ms", "max ms");
+  for (uint8_t b = 0; b < LINK_RSSI_BUCKETS; b++) {
+    const LinkBucket& t = total[b];
+    if (t.commands == 0) {
+      printf("[ pathloss ] %-9s %6u %8s %8s %8s\n", linkBucketToString(b), 0u, "-", "-", "-");
+      continue;
+    }
+    printf("[ pathloss ] %-9s %6u %8.1f %8u %8u\n", linkBucketToString(b), t.commands,
+           100.0 * t.successes / t.commands, t.successes ? (unsigned)(sumMs[b] / t.successes) : 0u, t.maxMs);
+  }
+
+  // 電波が強ければほぼ成功し、弱い区分より成功率が高い
+  const LinkBucket& strong = total[0];
+  const LinkBucket& weak = total[LINK_RSSI_BUCKETS - 1];
+  ASSERT_GT(strong.commands, 0u);
+  ASSERT_GT(weak.commands, 0u);
+  EXPECT_GE(100 * strong.successes, 95 * strong.commands);
+  EXPECT_LT((double)weak.successes / weak.commands, (double)strong.successes / strong.commands);
+
+  // 1 回のコマンドは、接続の上限 (10 秒) + 始まった試行の失敗 + 応答のタイムアウト (3 秒) に収まる
+  for (uint8_t b = 0; b < LINK_RSSI_BUCKETS; b++) {
+    EXPECT_LE(total[b].maxMs, 10000u + this->config.failMs + 3000u + 100u) << linkBucketToString(b);
+  }
+}
@@ -0,0 +1,203 @@
+/* ----------------------------------------------------------------
+  TaskHarness.h
+  - loop() の時刻で実施する処理 (ScheduledTasks) をホストで動かすための環境
+  - 実際の時刻 (NTP サーバーの時計) は SimClock、RTC は進みやずれを持つ代替、
+    SwitchBot Plug Mini は FakeBleTransport で模擬する
+  - Wi-Fi 接続、NTP 時刻同期、BLE 通信はテストから失敗させられる
+  - 経過はスケッチと同じく RTC の日時で LogStore に記録する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef TaskHarness_h
+#define TaskHarness_h
+#include <M5Core2.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include "SimClock.h"
+#include "FakeBleTransport.h"
+#include "ScheduledTasks.h"
+
+class TaskHarness : public TaskListener {
+public:
+  // 1 日の秒数
+  static const uint32_t DAY = DailySchedule::SECONDS_PER_DAY;
+
+  FakeBleTransport* fake = static_cast<FakeBleTransport*>(createBleTransport());
+  SwitchBotPlugMini plug{ "aa:bb:cc:dd:ee:ff" };
+  TimerOffload offload{ plug };
+  TimeManager time{ "ssid", "pass" };
+  LogStore logs{ 4096 };
+  ScheduledTasks tasks{ plug, offload, time, *this };
+
+  // 実際の時刻 (NTP サーバーの時計)
+  SimClock world;
+
+  // 処理の開始と終了の回数、OFF/ON の結果の回数
+  uint32_t begins = 0;
+  uint32_t ends = 0;
+  uint32_t timerOk = 0;
+  uint32_t timerFailed = 0;
+
+  // start() でセットした OFF/ON タイマーと NTP 時刻同期の時刻 (0 時からの秒数)
+  uint32_t timerTime = DAY;
+  uint32_t ntpTime = DAY;
+
+private:
+  static int64_t _ntpClock(void* ctx) {
+    return static_cast<SimClock*>(ctx)->utc();
+  }
+
+  void _push(bool err, uint8_t code) {
+    RTC_DateTypeDef d;
+    RTC_TimeTypeDef t;
+    this->time.getRtcDateTime(d, t);
+    this->logs.push(LogStore::packStamp(d.Year, d.Month, d.Date, t.Hours, t.Minutes, t.Seconds), err, code);
+  }
+
+public:
+  // 実際の時刻を現地時間の日時で指定する
+  TaskHarness(int year, unsigned month, unsigned day, uint32_t secOfDay) : world(year, month, day, secOfDay) {
+  }
+
+  ~TaskHarness() {
+    hostSetNtpClock(nullptr, nullptr);
+    hostNtpFail(false);
+    WiFi.state = WL_CONNECTED;
+    hostUseVirtualTime(false);
+  }
+
+  // setup() と同じ順に起動する (時刻同期、プラグの検出、タイマーの同期)
+  // - rtcError は起動時の RTC のずれ (秒), driftPpm は RTC の進み (ppm)
+  // - 起動時は失敗させない
+  void start(const FakePlugConfig& config, uint32_t seed, uint32_t timerTime, uint16_t intervalMs,
+             uint32_t ntpTime, bool offloadEnabled, int32_t rtcError = 0, int32_t driftPpm = 0) {
+    hostUseVirtualTime(true);
+    hostPreferencesClear();
+    hostNtpFail(false);
+    WiFi.state = WL_CONNECTED;
+    this->world.followVirtualTime();
+    hostSetNtpClock(_ntpClock, &this->world);
+    hostRtcSet(this->world.local() + rtcError);
+    hostRtcDrift(driftPpm);
+    this->fake->configure(config, seed);
+    this->fake->getState().power = true;
+
+    this->logs.init();
+    this->offload.init();
+    this->time.init();
+    this->time.sync();
+    this->plug.init();
+    this->plug.find();
+    this->timerTime = timerTime;
+    this->ntpTime = ntpTime;
+    this->tasks.setTimer(timerTime, intervalMs);
+    this->tasks.setNtpTime(ntpTime);
+    this->tasks.setOffloadEnabled(offloadEnabled);
+    this->tasks.syncOffload();
+  }
+
+  // loop() の 1 回分 (periodMs はその後に入力などで過ごす時間)
+  void loopOnce(uint32_t periodMs) {
+    this->tasks.run();
+    hostAdvance(periodMs);
+  }
+
+  // 実際の時刻で duration 秒の間、periodMs ごとに loop() を回す
+  // - 処理の時刻の 2 分前から 10 分後までの間以外は、次の処理の時刻の 2 分前まで早送りする
+  void run(int64_t duration, uint32_t periodMs) {
+    int64_t end = this->world.utc() + duration;
+    while (this->world.utc() < end) {
+      uint32_t sec = rtcSecOfDay();
+      uint32_t gap = DAY;
+      for (uint32_t t : { this->timerTime, this->ntpTime }) {
+        uint32_t offset = (sec + DAY + 120 - t) % DAY;
+        uint32_t toWindow = (offset < 720) ? 0 : DAY - offset;
+        gap = (toWindow < gap) ? toWindow : gap;
+      }
+      int64_t left = end - this->world.utc();
+      if (gap > 0 && left > 0) {
+        this->loopOnce((uint32_t)((gap < left) ? gap : left) * 1000);
+      } else {
+        this->loopOnce(periodMs);
+      }
+    }
+  }
+
+  // RTC の 0 時からの秒数
+  static uint32_t rtcSecOfDay() {
+    int64_t s = hostRtcNow() % DAY;
+    return (uint32_t)((s < 0) ? s + DAY : s);
+  }
+
+  // RTC の日付 (LogStore::stampToDate() の値)
+  uint16_t rtcDate() {
+    RTC_DateTypeDef d;
+    RTC_TimeTypeDef t;
+    this->time.getRtcDateTime(d, t);
+    return LogStore::stampToDate(LogStore::packStamp(d.Year, d.Month, d.Date, 0, 0, 0));
+  }
+
+  // タイムスタンプの 0 時からの秒数
+  static uint32_t stampSec(uint32_t stamp) {
+    return ((stamp >> 12) & 0x1f) * 3600 + ((stamp >> 6) & 0x3f) * 60 + (stamp & 0x3f);
+  }
+
+  // 日付 date の [from, to) 秒に記録されたログのうち、err と code が一致するものの数
+  // - code が負ならエラー (またはイベント) の全て
+  size_t count(uint16_t date, uint32_t from, uint32_t to, bool err, int code) const {
+    size_t n = 0;
+    LogRecord rec;
+    for (size_t pos = 0; this->logs.get(pos, rec); pos++) {
+      uint32_t sec = stampSec(rec.stamp);
+      if (LogStore::stampToDate(rec.stamp) == date && sec >= from && sec < to
+          && rec.err == err && (code < 0 || rec.code == code)) {
+        n++;
+      }
+    }
+    return n;
+  }
+
+  // 日付 date に記録されたログのうち、err と code が一致するものの数
+  size_t count(uint16_t date, bool err, int code) const {
+    return this->count(date, 0, DAY, err, code);
+  }
+
+  // TaskListener
+  void onTaskBegin() override {
+    this->begins++;
+  }
+
+  void onTaskEnd() override {
+    this->ends++;
+  }
+
+  void onMessage(const char* message) override {
+    (void)message;
+  }
+
+  void onPowerStatus(bool status) override {
+    (void)status;
+  }
+
+  void onLog(LogEvent event) override {
+    this->_push(false, event);
+  }
+
+  void onError(ErrorCode code) override {
+    this->_push(true, code);
+  }
+
+  void onTimerResult(bool ok) override {
+    if (ok) {
+      this->timerOk++;
+    } else {
+      this->timerFailed++;
+    }
+  }
+};
+
+#endif
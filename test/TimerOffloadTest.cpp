@@ -0,0 +1,198 @@
+/* ----------------------------------------------------------------
+  TimerOffloadTest.cpp
+  - 模擬した BLE (FakeBleTransport) で TimerOffload を確認する
+  - 同期の途中で失敗したり委任をやめたりしても、プラグにタイマーが残らないこと
+  - NVS はメモリ上の代替 (Preferences) を使う
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include <gtest/gtest.h>
+#include <Preferences.h>
+#include "FakeBleTransport.h"
+#include "TimerOffload.h"
+
+namespace {
+
+const char* ADDRESS = "aa:bb:cc:dd:ee:ff";
+
+// 2025/01/22 05:00:00 (現地時刻)
+const uint32_t EPOCH = 1737522000;
+
+// OFF は 05:00:00、ON は 1 分後
+const uint32_t OFF_TIME = 5 * 3600;
+const uint16_t INTERVAL_MS = 5000;
+
+class TimerOffloadTest : public testing::Test {
+protected:
+  FakeBleTransport* fake = static_cast<FakeBleTransport*>(createBleTransport());
+  FakePlugConfig config = FakeBleTransport::defaultConfig();
+  SwitchBotPlugMini plug{ ADDRESS };
+  TimerOffload offload{ plug };
+
+  void SetUp() override {
+    hostUseVirtualTime(true);
+    hostPreferencesClear();
+    this->config.address = ADDRESS;
+    this->fake->configure(this->config);
+    this->offload.init();
+  }
+
+  void TearDown() override {
+    hostUseVirtualTime(false);
+  }
+
+  // プラグに以前のタイマー (04:00 OFF / 04:01 ON) を残し、書き込んだ記録も残す
+  void leaveTimers() {
+    FakePlugState& s = this->fake->getState();
+    s.timerCount = 2;
+    s.timers[0] = { 4, 0, false };
+    s.timers[1] = { 4, 1, true };
+    Preferences prefs;
+    prefs.begin("plugtimer", false);
+    prefs.putBool("offwritten", true);
+    prefs.end();
+    this->offload.init();
+  }
+};
+
+}  // namespace
+
+TEST_F(TimerOffloadTest, SyncRegistersOffAndOn) {
+  ASSERT_TRUE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_TRUE(this->offload.isActive());
+  EXPECT_TRUE(this->offload.isWritten());
+
+  const FakePlugState& s = this->fake->getState();
+  EXPECT_EQ(s.clock, EPOCH);
+  EXPECT_EQ(s.timerCount, 2);
+  EXPECT_EQ(s.timers[0].hour, 5);
+  EXPECT_EQ(s.timers[0].minute, 0);
+  EXPECT_FALSE(s.timers[0].power);
+  EXPECT_EQ(s.timers[1].minute, 1);
+  EXPECT_TRUE(s.timers[1].power);
+
+  // OFF の間 (OFF の 30 秒後) に確認し、ON の 60 秒後にもう一度確認する
+  EXPECT_EQ(this->offload.getVerifyTime(), OFF_TIME + 30);
+  EXPECT_EQ(this->offload.getOnTime(), OFF_TIME + 60);
+  EXPECT_EQ(this->offload.getOnVerifyTime(), OFF_TIME + 60 + 60);
+
+  // 同じ設定なら書き込まない
+  uint32_t writes = this->offload.getStats().writes;
+  ASSERT_TRUE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getStats().writes, writes);
+
+  // 書き込んだ記録は再起動後も残る
+  TimerOffload rebooted(this->plug);
+  rebooted.init();
+  EXPECT_TRUE(rebooted.isWritten());
+}
+
+// 同期の途中で応答が途切れたら、書きかけのタイマーを空にして本体が OFF/ON を実施する
+TEST_F(TimerOffloadTest, FailedSyncClearsPartialWrites) {
+  // 書き込みの順: 時計, 0 番の読み出し, 0 番の書き込み, 0 番の読み出し直し,
+  //               1 番の読み出し, 1 番の書き込み
+  this->config.dropFromWrite = 6;
+  this->config.dropWrites = 1;
+  this->fake->configure(this->config);
+
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getError(), ERR_RESPONSE_TIMEOUT);
+  EXPECT_FALSE(this->offload.isActive());
+
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(this->offload.isWritten());
+}
+
+// 空にできなかったら書き込んだ記録を残し、後で空にし直す
+TEST_F(TimerOffloadTest, ClearIsRetriedUntilVerified) {
+  // 1 番の書き込みと、続けて空にするための 0 番の読み出しが途切れる
+  this->config.dropFromWrite = 6;
+  this->config.dropWrites = 2;
+  this->fake->configure(this->config);
+
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->fake->getState().timerCount, 2);
+  EXPECT_TRUE(this->offload.isWritten());
+
+  TimerOffload rebooted(this->plug);
+  rebooted.init();
+  ASSERT_TRUE(rebooted.isWritten());
+  ASSERT_TRUE(rebooted.clear());
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(rebooted.isWritten());
+}
+
+// プラグが受け付けなかったら、以前のタイマーを空にしてから委任をやめる
+TEST_F(TimerOffloadTest, DisableClearsTimers) {
+  this->config.timerCapacity = 1;
+  this->fake->configure(this->config);
+  this->leaveTimers();
+
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getError(), ERR_TIMER_REJECTED);
+  EXPECT_EQ(this->offload.getStats().state, OFFLOAD_DISABLED);
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(this->offload.isWritten());
+}
+
+// 書き込みを受け付けても読み出した値が違えば (コマンドの解釈が違うプラグ)、委任をやめる
+TEST_F(TimerOffloadTest, MismatchDisablesOffload) {
+  this->config.timerWriteIgnored = true;
+  this->fake->configure(this->config);
+
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getError(), ERR_TIMER_MISMATCH);
+  EXPECT_EQ(this->offload.getStats().state, OFFLOAD_DISABLED);
+  const uint32_t disabled = DailySchedule::SECONDS_PER_DAY;
+  EXPECT_EQ(this->offload.getVerifyTime(), disabled);
+  EXPECT_EQ(this->offload.getOnVerifyTime(), disabled);
+
+  // 再起動後も委任しない
+  TimerOffload rebooted(this->plug);
+  rebooted.init();
+  EXPECT_EQ(rebooted.getStats().state, OFFLOAD_DISABLED);
+}
+
+// 委任をやめた後でも、空にできなかったタイマーは次の同期で空にする
+TEST_F(TimerOffloadTest, DisabledSyncRetriesClear) {
+  this->config.timerCapacity = 1;
+  this->config.dropFromWrite = 4;
+  this->config.dropWrites = 1;
+  this->fake->configure(this->config);
+  this->leaveTimers();
+
+  // 受け付けられずに委任をやめるが、空にする途中で途切れる
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getStats().state, OFFLOAD_DISABLED);
+  EXPECT_TRUE(this->offload.isWritten());
+
+  EXPECT_FALSE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(this->offload.isWritten());
+}
+
+// 委任しない設定では、書き込んだタイマーだけを空にする
+TEST_F(TimerOffloadTest, ClearWithoutOffload) {
+  // 書き込んでいなければ接続もしない
+  ASSERT_TRUE(this->offload.clear());
+  EXPECT_EQ(this->fake->getState().connects, 0u);
+
+  this->leaveTimers();
+  ASSERT_TRUE(this->offload.clear());
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(this->offload.isWritten());
+}
+
+// タイマーを無効にしたら (秒を含む時刻も) プラグのタイマーを空にする
+TEST_F(TimerOffloadTest, DisabledTimerClearsSlots) {
+  ASSERT_TRUE(this->offload.sync(OFF_TIME, INTERVAL_MS, EPOCH));
+  EXPECT_FALSE(this->offload.sync(OFF_TIME + 30, INTERVAL_MS, EPOCH));
+  EXPECT_EQ(this->offload.getError(), ERR_NONE);
+  EXPECT_FALSE(this->offload.isActive());
+  EXPECT_EQ(this->fake->getState().timerCount, 0);
+  EXPECT_FALSE(this->offload.isWritten());
+}
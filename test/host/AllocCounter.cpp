@@ -0,0 +1,54 @@
+/* ----------------------------------------------------------------
+  AllocCounter.cpp (ホスト用)
+  - glibc の malloc 系の関数を置き換えて数える (確保自体は glibc に任せる)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "AllocCounter.h"
+#include <pthread.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+}
+
+static volatile bool _counting = false;
+static pthread_t _thread;
+static volatile size_t _count = 0;
+
+static inline void _countOne() {
+  if (_counting && pthread_equal(pthread_self(), _thread)) {
+    _count = _count + 1;
+  }
+}
+
+extern "C" void* malloc(size_t size) {
+  _countOne();
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+  _countOne();
+  return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+  _countOne();
+  return __libc_realloc(ptr, size);
+}
+
+void allocCountStart() {
+  _thread = pthread_self();
+  _count = 0;
+  _counting = true;
+}
+
+size_t allocCountStop() {
+  _counting = false;
+  return _count;
+}
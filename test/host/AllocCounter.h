@@ -0,0 +1,22 @@
+/* ----------------------------------------------------------------
+  AllocCounter.h (ホスト用)
+  - malloc / calloc / realloc (operator new を含む) の呼び出しを数える
+  - 数えるのは開始したスレッドの呼び出しのみ
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef AllocCounter_h
+#define AllocCounter_h
+#include <stddef.h>
+
+// 数え始める (これまでの数は 0 に戻す)
+void allocCountStart();
+
+// 数えるのをやめて、その間の確保の回数を返す
+size_t allocCountStop();
+
+#endif
@@ -0,0 +1,201 @@
+/* ----------------------------------------------------------------
+  Arduino.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "Arduino.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+EspClass ESP;
+HardwareSerial Serial;
+
+static const auto _start = std::chrono::steady_clock::now();
+static std::atomic<bool> _virtual(false);
+static std::atomic<uint64_t> _virtualUs(0);
+
+// 起動からの時間 (マイクロ秒)
+static uint64_t _nowUs() {
+  if (_virtual) {
+    return _virtualUs;
+  }
+  auto d = std::chrono::steady_clock::now() - _start;
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+uint32_t millis() {
+  return (uint32_t)(_nowUs() / 1000);
+}
+
+uint32_t micros() {
+  return (uint32_t)_nowUs();
+}
+
+void delay(uint32_t ms) {
+  if (_virtual) {
+    _virtualUs += (uint64_t)ms * 1000;
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+void yield() {
+  if (!_virtual) {
+    std::this_thread::yield();
+  }
+}
+
+void hostUseVirtualTime(bool enabled) {
+  if (enabled && !_virtual) {
+    _virtualUs = _nowUs();
+  }
+  _virtual = enabled;
+}
+
+void hostAdvance(uint32_t ms) {
+  _virtualUs += (uint64_t)ms * 1000;
+}
+
+uint64_t hostMicros64() {
+  return _nowUs();
+}
+
+void* ps_malloc(size_t size) {
+  (void)size;
+  return nullptr;
+}
+
+// ===============================================================
+// NTP 時刻同期
+// ===============================================================
+
+static long _gmtOffset = 0;
+static int _daylightOffset = 0;
+static int64_t (*_ntpClock)(void*) = nullptr;
+static void* _ntpClockCtx = nullptr;
+static bool _ntpFail = false;
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2, const char* server3) {
+  (void)server1;
+  (void)server2;
+  (void)server3;
+  _gmtOffset = gmtOffset_sec;
+  _daylightOffset = daylightOffset_sec;
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+  if (_ntpClock == nullptr || _ntpFail) {
+    delay(ms);
+    return false;
+  }
+  time_t t = (time_t)(_ntpClock(_ntpClockCtx) + _gmtOffset + _daylightOffset);
+  gmtime_r(&t, info);
+  return true;
+}
+
+void hostSetNtpClock(int64_t (*utc)(void* ctx), void* ctx) {
+  _ntpClock = utc;
+  _ntpClockCtx = ctx;
+}
+
+void hostNtpFail(bool fail) {
+  _ntpFail = fail;
+}
+
+// ===============================================================
+// Print / Stream
+// ===============================================================
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+  size_t n = 0;
+  while (n < len && this->write(buf[n]) == 1) {
+    n++;
+  }
+  return n;
+}
+
+size_t Print::print(const char* s) {
+  return this->write((const uint8_t*)s, strlen(s));
+}
+
+size_t Print::println(const char* s) {
+  size_t n = this->print(s);
+  return n + this->write((const uint8_t*)"\r\n", 2);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, format);
+  int len = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  if (len < 0) {
+    return 0;
+  }
+  return this->write((const uint8_t*)buf, ((size_t)len < sizeof(buf)) ? len : sizeof(buf) - 1);
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t len) {
+  size_t n = 0;
+  uint32_t stime = millis();
+  while (n < len && millis() - stime < this->_timeout) {
+    int c = this->read();
+    if (c < 0) {
+      delay(1);
+      continue;
+    }
+    buf[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
+// ===============================================================
+// HardwareSerial
+// ===============================================================
+
+int HardwareSerial::available() {
+  int n = 0;
+  if (this->_fd < 0 || ioctl(this->_fd, FIONREAD, &n) < 0) {
+    return 0;
+  }
+  return n;
+}
+
+int HardwareSerial::read() {
+  uint8_t c;
+  if (this->available() <= 0 || ::read(this->_fd, &c, 1) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return this->write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+  if (this->_fd < 0) {
+    return len;
+  }
+  size_t n = 0;
+  while (n < len) {
+    ssize_t r = ::write(this->_fd, buf + n, len - n);
+    if (r < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      break;
+    }
+    n += r;
+  }
+  return n;
+}
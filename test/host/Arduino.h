@@ -0,0 +1,138 @@
+/* ----------------------------------------------------------------
+  Arduino.h (ホスト用)
+  - スケッチのソースをホスト (Linux) でビルドするための最小限の代替
+  - 時計は実時間と仮想時間を切り替えられる
+  - NTP 時刻同期はテストからセットした時計の時刻を返す (失敗させることもできる)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef Arduino_h
+#define Arduino_h
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <string>
+
+typedef bool boolean;
+
+// ---------------------------------------------------------------
+// 時計
+// - 仮想時間では delay() は待たずに時計を進める
+// ---------------------------------------------------------------
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+
+// 仮想時間を使うかどうか (既定は実時間)
+void hostUseVirtualTime(bool enabled);
+
+// 仮想時間を進める
+void hostAdvance(uint32_t ms);
+
+// 起動からの時間 (マイクロ秒, micros() と違って桁あふれしない)
+uint64_t hostMicros64();
+
+// ---------------------------------------------------------------
+// NTP 時刻同期
+// - getLocalTime() は hostSetNtpClock() でセットした時計の UTC に
+//   configTime() のオフセットを足した時刻を返す
+// - 同期できない間は ms だけ待って false を返す
+// ---------------------------------------------------------------
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// NTP サーバーの時計 (UTC の UNIX 時間を返す関数, nullptr なら同期できない)
+void hostSetNtpClock(int64_t (*utc)(void* ctx), void* ctx);
+
+// NTP 時刻同期を失敗させるかどうか
+void hostNtpFail(bool fail);
+
+// ---------------------------------------------------------------
+// ESP
+// - ヒープの値はテストからセットする
+// ---------------------------------------------------------------
+class EspClass {
+public:
+  uint32_t freeHeap = 200000;
+  uint32_t minFreeHeap = 180000;
+  uint32_t maxAllocHeap = 110000;
+  uint32_t restarts = 0;
+
+  uint32_t getFreeHeap() { return this->freeHeap; }
+  uint32_t getMinFreeHeap() { return this->minFreeHeap; }
+  uint32_t getMaxAllocHeap() { return this->maxAllocHeap; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  void restart() { this->restarts++; }
+};
+extern EspClass ESP;
+
+// PSRAM はない (常に nullptr)
+void* ps_malloc(size_t size);
+
+// ---------------------------------------------------------------
+// Print / Stream
+// ---------------------------------------------------------------
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len);
+  size_t print(const char* s);
+  size_t println(const char* s);
+  size_t printf(const char* format, ...);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  size_t readBytes(uint8_t* buf, size_t len);
+  void setTimeout(uint32_t ms) { this->_timeout = ms; }
+
+protected:
+  uint32_t _timeout = 1000;
+};
+
+// ファイルディスクリプタを読み書きするシリアル (未接続なら捨てる)
+class HardwareSerial : public Stream {
+private:
+  int _fd = -1;
+
+public:
+  void begin(uint32_t baud) { (void)baud; }
+  void attach(int fd) { this->_fd = fd; }
+  int available() override;
+  int read() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+};
+extern HardwareSerial Serial;
+
+// ---------------------------------------------------------------
+// String (HTTPClient のヘッダー用)
+// ---------------------------------------------------------------
+class String {
+private:
+  std::string _s;
+
+public:
+  String(const char* s = "") : _s(s) {}
+  String(const std::string& s) : _s(s) {}
+  const char* c_str() const { return this->_s.c_str(); }
+  size_t length() const { return this->_s.size(); }
+  bool operator==(const char* s) const { return this->_s == s; }
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* ----------------------------------------------------------------
+  HTTPClient.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "HTTPClient.h"
+
+// ヘッダーを受信する時間の上限 (ミリ秒)
+static const uint32_t _HEADER_TIMEOUT = 5000;
+
+bool HTTPClient::begin(const char* url) {
+  const char* scheme = "http://";
+  if (strncmp(url, scheme, strlen(scheme)) != 0) {
+    return false;
+  }
+  std::string rest(url + strlen(scheme));
+  size_t slash = rest.find('/');
+  std::string authority = rest.substr(0, slash);
+  this->_path = (slash == std::string::npos) ? "/" : rest.substr(slash);
+  size_t colon = authority.find(':');
+  this->_host = authority.substr(0, colon);
+  this->_port = (colon == std::string::npos) ? 80 : (uint16_t)atoi(authority.c_str() + colon + 1);
+  return !this->_host.empty();
+}
+
+bool HTTPClient::_readLine(std::string& line) {
+  line.clear();
+  uint32_t stime = millis();
+  while (millis() - stime < _HEADER_TIMEOUT) {
+    int c = this->_client.read();
+    if (c < 0) {
+      if (!this->_client.connected()) {
+        return false;
+      }
+      delay(1);
+      continue;
+    }
+    if (c == '\n') {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      return true;
+    }
+    line.push_back((char)c);
+  }
+  return false;
+}
+
+int HTTPClient::GET() {
+  if (!this->_client.connect(this->_host.c_str(), this->_port)) {
+    return -1;
+  }
+  std::string req = "GET " + this->_path + " HTTP/1.1\r\nHost: " + this->_host + "\r\nConnection: close\r\n\r\n";
+  this->_client.write((const uint8_t*)req.data(), req.size());
+
+  std::string line;
+  if (!this->_readLine(line) || line.compare(0, 5, "HTTP/") != 0) {
+    return -1;
+  }
+  int code = atoi(line.c_str() + line.find(' ') + 1);
+
+  bool chunked = false;
+  this->_size = -1;
+  while (this->_readLine(line) && !line.empty()) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string name = line.substr(0, colon);
+    size_t start = line.find_first_not_of(' ', colon + 1);
+    std::string value = (start == std::string::npos) ? "" : line.substr(start);
+    if (strcasecmp(name.c_str(), "Content-Length") == 0) {
+      this->_size = atoi(value.c_str());
+    } else if (strcasecmp(name.c_str(), "Transfer-Encoding") == 0) {
+      chunked = (strcasecmp(value.c_str(), "chunked") == 0);
+    }
+    for (size_t i = 0; i < this->_keyCount; i++) {
+      if (strcasecmp(name.c_str(), this->_keys[i]) == 0) {
+        this->_values[i] = value;
+      }
+    }
+  }
+  if (chunked) {
+    this->_size = -1;
+  }
+  return code;
+}
+
+void HTTPClient::collectHeaders(const char* keys[], size_t count) {
+  this->_keyCount = (count < _HEADERS_MAX) ? count : _HEADERS_MAX;
+  for (size_t i = 0; i < this->_keyCount; i++) {
+    this->_keys[i] = keys[i];
+    this->_values[i].clear();
+  }
+}
+
+String HTTPClient::header(const char* name) {
+  for (size_t i = 0; i < this->_keyCount; i++) {
+    if (strcasecmp(name, this->_keys[i]) == 0) {
+      return String(this->_values[i]);
+    }
+  }
+  return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+  return this->header(name).length() > 0;
+}
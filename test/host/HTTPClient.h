@@ -0,0 +1,49 @@
+/* ----------------------------------------------------------------
+  HTTPClient.h (ホスト用)
+  - OtaUpdater が使う HTTP GET だけを WiFiClient (TCP ソケット) で代替する
+  - URL は "http://<IPv4 アドレス>[:ポート]/パス" だけを受け付ける
+  - ESP32 の実装と同じく、Transfer-Encoding: chunked なら getSize() は -1 で、
+    getStreamPtr() のストリームはチャンクの区切りを含んだまま読める
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef HTTPClient_h
+#define HTTPClient_h
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+
+class HTTPClient {
+private:
+  static const size_t _HEADERS_MAX = 4;
+
+  WiFiClient _client;
+  std::string _host;
+  uint16_t _port = 80;
+  std::string _path;
+  int _size = -1;
+
+  const char* _keys[_HEADERS_MAX] = {};
+  std::string _values[_HEADERS_MAX];
+  size_t _keyCount = 0;
+
+  // ヘッダーの 1 行を読む (CRLF は含まない)
+  bool _readLine(std::string& line);
+
+public:
+  bool begin(const char* url);
+  int GET();
+  int getSize() { return this->_size; }
+  WiFiClient* getStreamPtr() { return &this->_client; }
+  void end() { this->_client.stop(); }
+  void collectHeaders(const char* keys[], size_t count);
+  String header(const char* name);
+  bool hasHeader(const char* name);
+};
+
+#endif
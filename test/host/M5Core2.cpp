@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------
+  M5Core2.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "M5Core2.h"
+
+M5Core2 M5;
+
+// 最後にセットした日時 (現地時刻の秒数) と、そのときの起動からの時間 (マイクロ秒)
+static int64_t _base = 0;
+static uint64_t _baseUs = 0;
+
+// RTC の進み (ppm)
+static int32_t _driftPpm = 0;
+
+// 年月日から 1970-01-01 からの日数
+static int64_t _daysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+// 1970-01-01 からの日数から年月日と曜日
+static void _civilFromDays(int64_t z, RTC_DateTypeDef* date) {
+  date->WeekDay = (uint8_t)(((z % 7) + 11) % 7);
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  const unsigned m = mp + (mp < 10 ? 3 : -9);
+  date->Date = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  date->Month = (uint8_t)m;
+  date->Year = (uint16_t)((int64_t)yoe + era * 400 + (m <= 2));
+}
+
+void hostRtcSet(int64_t local) {
+  _base = local;
+  _baseUs = hostMicros64();
+}
+
+int64_t hostRtcNow() {
+  int64_t us = (int64_t)(hostMicros64() - _baseUs);
+  us += us / 1000000 * _driftPpm;
+  return _base + us / 1000000;
+}
+
+void hostRtcDrift(int32_t ppm) {
+  hostRtcSet(hostRtcNow());
+  _driftPpm = ppm;
+}
+
+// ===============================================================
+// RTC
+// ===============================================================
+
+void RTC::GetTime(RTC_TimeTypeDef* time) {
+  int64_t s = hostRtcNow() % 86400;
+  if (s < 0) {
+    s += 86400;
+  }
+  time->Hours = (uint8_t)(s / 3600);
+  time->Minutes = (uint8_t)(s / 60 % 60);
+  time->Seconds = (uint8_t)(s % 60);
+}
+
+void RTC::GetDate(RTC_DateTypeDef* date) {
+  int64_t now = hostRtcNow();
+  _civilFromDays((now >= 0) ? now / 86400 : (now - 86399) / 86400, date);
+}
+
+// 時刻だけを置き換える (日付はそのまま)
+void RTC::SetTime(RTC_TimeTypeDef* time) {
+  int64_t now = hostRtcNow();
+  int64_t day = ((now >= 0) ? now / 86400 : (now - 86399) / 86400) * 86400;
+  hostRtcSet(day + time->Hours * 3600 + time->Minutes * 60 + time->Seconds);
+}
+
+// 日付だけを置き換える (時刻はそのまま)
+void RTC::SetDate(RTC_DateTypeDef* date) {
+  int64_t now = hostRtcNow();
+  int64_t sec = now % 86400;
+  if (sec < 0) {
+    sec += 86400;
+  }
+  hostRtcSet(_daysFromCivil(date->Year, date->Month, date->Date) * 86400 + sec);
+}
@@ -0,0 +1,53 @@
+/* ----------------------------------------------------------------
+  M5Core2.h (ホスト用)
+  - RTC (M5.Rtc) だけの代替
+  - RTC は起動からの時間 (仮想時間) で進み、テストから日時とずれ (ppm) をセットする
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef M5Core2_h
+#define M5Core2_h
+#include <Arduino.h>
+
+typedef struct {
+  uint8_t Hours;
+  uint8_t Minutes;
+  uint8_t Seconds;
+} RTC_TimeTypeDef;
+
+typedef struct {
+  uint8_t WeekDay;
+  uint8_t Month;
+  uint8_t Date;
+  uint16_t Year;
+} RTC_DateTypeDef;
+
+class RTC {
+public:
+  void begin() {}
+  void GetTime(RTC_TimeTypeDef* time);
+  void GetDate(RTC_DateTypeDef* date);
+  void SetTime(RTC_TimeTypeDef* time);
+  void SetDate(RTC_DateTypeDef* date);
+};
+
+class M5Core2 {
+public:
+  RTC Rtc;
+};
+extern M5Core2 M5;
+
+// RTC の日時をセットする (現地時刻の 1970-01-01 00:00:00 からの秒数)
+void hostRtcSet(int64_t local);
+
+// RTC の日時を取得する (現地時刻の 1970-01-01 00:00:00 からの秒数)
+int64_t hostRtcNow();
+
+// RTC の進み (ppm, 負なら遅れ)
+void hostRtcDrift(int32_t ppm);
+
+#endif
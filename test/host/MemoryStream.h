@@ -0,0 +1,80 @@
+/* ----------------------------------------------------------------
+  MemoryStream.h (ホスト用)
+  - 固定長のバッファで読み書きする Stream (ヒープを使わない)
+  - feed() したバイト列を read() で読み、write() したバイト列を take() で取り出す
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef MemoryStream_h
+#define MemoryStream_h
+#include <Arduino.h>
+
+class MemoryStream : public Stream {
+private:
+  static const size_t _SIZE = 4096;
+
+  uint8_t _rx[_SIZE];
+  size_t _rxHead = 0;
+  size_t _rxLen = 0;
+
+  uint8_t _tx[_SIZE];
+  size_t _txLen = 0;
+
+public:
+  // read() で読まれるバイト列を追加する
+  bool feed(const uint8_t* data, size_t len) {
+    if (this->_rxLen + len > _SIZE) {
+      return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+      this->_rx[(this->_rxHead + this->_rxLen + i) % _SIZE] = data[i];
+    }
+    this->_rxLen += len;
+    return true;
+  }
+
+  // write() されたバイト列を取り出す (戻り値は取り出した長さ)
+  size_t take(uint8_t* buf, size_t max) {
+    size_t n = (this->_txLen < max) ? this->_txLen : max;
+    memcpy(buf, this->_tx, n);
+    memmove(this->_tx, this->_tx + n, this->_txLen - n);
+    this->_txLen -= n;
+    return n;
+  }
+
+  int available() override {
+    return (int)this->_rxLen;
+  }
+
+  int read() override {
+    if (this->_rxLen == 0) {
+      return -1;
+    }
+    uint8_t c = this->_rx[this->_rxHead];
+    this->_rxHead = (this->_rxHead + 1) % _SIZE;
+    this->_rxLen--;
+    return c;
+  }
+
+  size_t write(uint8_t c) override {
+    if (this->_txLen >= _SIZE) {
+      return 0;
+    }
+    this->_tx[this->_txLen++] = c;
+    return 1;
+  }
+
+  size_t write(const uint8_t* buf, size_t len) override {
+    size_t n = 0;
+    while (n < len && this->write(buf[n]) == 1) {
+      n++;
+    }
+    return n;
+  }
+};
+
+#endif
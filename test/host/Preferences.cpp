@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------
+  Preferences.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "Preferences.h"
+#include <map>
+#include <vector>
+
+static std::map<std::string, std::vector<uint8_t>> _store;
+static uint32_t _writes = 0;
+
+void hostPreferencesClear() {
+  _store.clear();
+  _writes = 0;
+}
+
+uint32_t hostPreferencesWrites() {
+  return _writes;
+}
+
+std::string Preferences::_key(const char* key) const {
+  return this->_namespace + "/" + key;
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  this->_namespace = name;
+  this->_readOnly = readOnly;
+  this->_started = true;
+  return true;
+}
+
+void Preferences::end() {
+  this->_started = false;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  if (!this->_started || this->_readOnly) {
+    return 0;
+  }
+  _store[this->_key(key)] = std::vector<uint8_t>((const uint8_t*)value, (const uint8_t*)value + len);
+  _writes++;
+  return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  auto it = _store.find(this->_key(key));
+  if (!this->_started || it == _store.end() || it->second.size() > maxLen) {
+    return 0;
+  }
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  auto it = _store.find(this->_key(key));
+  return (!this->_started || it == _store.end()) ? 0 : it->second.size();
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+  uint8_t v = value ? 1 : 0;
+  return this->putBytes(key, &v, 1);
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+  uint8_t v;
+  return (this->getBytes(key, &v, 1) == 1) ? (v != 0) : defaultValue;
+}
+
+bool Preferences::remove(const char* key) {
+  if (!this->_started || this->_readOnly) {
+    return false;
+  }
+  return _store.erase(this->_key(key)) > 0;
+}
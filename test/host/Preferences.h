@@ -0,0 +1,41 @@
+/* ----------------------------------------------------------------
+  Preferences.h (ホスト用)
+  - NVS をメモリ上の名前空間とキーの表で代替する
+  - 内容はプロセスが終わるまで残る (hostPreferencesClear() で消す)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef Preferences_h
+#define Preferences_h
+#include <Arduino.h>
+
+class Preferences {
+private:
+  std::string _namespace;
+  bool _readOnly = true;
+  bool _started = false;
+
+  std::string _key(const char* key) const;
+
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end();
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+  size_t putBool(const char* key, bool value);
+  bool getBool(const char* key, bool defaultValue = false);
+  bool remove(const char* key);
+};
+
+// 保存されている内容をすべて消す
+void hostPreferencesClear();
+
+// putBytes() / putBool() で書き込んだ回数
+uint32_t hostPreferencesWrites();
+
+#endif
@@ -0,0 +1,96 @@
+/* ----------------------------------------------------------------
+  SD.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "SD.h"
+#include <map>
+
+SDClass SD;
+
+static std::map<std::string, std::string> _files;
+static bool _failWrites = false;
+
+void hostSdClear() {
+  _files.clear();
+  _failWrites = false;
+}
+
+void hostSdWrite(const char* path, const std::string& data) {
+  _files[path] = data;
+}
+
+std::string hostSdRead(const char* path) {
+  auto it = _files.find(path);
+  return (it == _files.end()) ? std::string() : it->second;
+}
+
+void hostSdFailWrites(bool fail) {
+  _failWrites = fail;
+}
+
+File::File(const char* path, const std::string& data, bool write)
+  : _path(path), _data(data), _open(true), _write(write) {
+}
+
+size_t File::size() const {
+  return this->_data.size();
+}
+
+int File::available() const {
+  return (this->_open && !this->_write) ? (int)(this->_data.size() - this->_pos) : 0;
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+  size_t n = (size_t)this->available();
+  n = (n < len) ? n : len;
+  memcpy(buf, this->_data.data() + this->_pos, n);
+  this->_pos += n;
+  return n;
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!this->_open || !this->_write || _failWrites) {
+    return 0;
+  }
+  this->_data.append((const char*)buf, len);
+  return len;
+}
+
+void File::close() {
+  if (this->_open && this->_write) {
+    _files[this->_path] = this->_data;
+  }
+  this->_open = false;
+}
+
+File SDClass::open(const char* path, const char* mode) {
+  bool write = (strcmp(mode, FILE_WRITE) == 0);
+  auto it = _files.find(path);
+  if (!write && it == _files.end()) {
+    return File();
+  }
+  return File(path, write ? std::string() : it->second, write);
+}
+
+bool SDClass::exists(const char* path) {
+  return _files.count(path) > 0;
+}
+
+bool SDClass::remove(const char* path) {
+  return _files.erase(path) > 0;
+}
+
+bool SDClass::rename(const char* from, const char* to) {
+  auto it = _files.find(from);
+  if (it == _files.end()) {
+    return false;
+  }
+  _files[to] = it->second;
+  _files.erase(from);
+  return true;
+}
@@ -0,0 +1,62 @@
+/* ----------------------------------------------------------------
+  SD.h (ホスト用)
+  - SD カードをメモリ上のパスと内容の表で代替する
+  - 内容はプロセスが終わるまで残る (hostSdClear() で消す)
+  - ファイルの内容は close() したときに書き込む
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef SD_h
+#define SD_h
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+
+class File {
+private:
+  std::string _path;
+  std::string _data;
+  size_t _pos = 0;
+  bool _open = false;
+  bool _write = false;
+
+public:
+  File() {}
+  File(const char* path, const std::string& data, bool write);
+
+  size_t size() const;
+  int available() const;
+  size_t read(uint8_t* buf, size_t len);
+  size_t write(const uint8_t* buf, size_t len);
+  void close();
+  operator bool() const { return this->_open; }
+};
+
+class SDClass {
+public:
+  bool begin() { return true; }
+  File open(const char* path, const char* mode = FILE_READ);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+};
+extern SDClass SD;
+
+// すべてのファイルを消す (書き込みの失敗の指定も戻す)
+void hostSdClear();
+
+// ファイルの内容をセットする
+void hostSdWrite(const char* path, const std::string& data);
+
+// ファイルの内容 (なければ空文字列)
+std::string hostSdRead(const char* path);
+
+// 書き込みを失敗させるかどうか (write() が 0 を返す)
+void hostSdFailWrites(bool fail);
+
+#endif
@@ -0,0 +1,52 @@
+/* ----------------------------------------------------------------
+  SerialFrame.h (ホスト用)
+  - テストでシリアル制御プロトコルのフレームを組み立て・分解する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef SerialFrame_h
+#define SerialFrame_h
+#include <Arduino.h>
+#include "SerialController.h"
+
+// [種類][シーケンス番号][本体][CRC] を COBS エンコードして区切りを付ける
+// - 戻り値は out に書き込んだ長さ (out は len + 8 バイト以上)
+inline size_t buildSerialFrame(uint8_t type, uint8_t seq, const uint8_t* body, size_t len, uint8_t* out) {
+  uint8_t frame[260];
+  frame[0] = type;
+  frame[1] = seq;
+  memcpy(frame + 2, body, len);
+  uint16_t crc = SerialController::crc16(frame, len + 2);
+  frame[len + 2] = crc & 0xff;
+  frame[len + 3] = crc >> 8;
+  size_t n = SerialController::cobsEncode(frame, len + 4, out);
+  out[n++] = 0x00;
+  return n;
+}
+
+// 区切りまでの 1 フレームを COBS デコードして CRC を検証する
+// - 戻り値は CRC を除いたフレームの長さ (不正なら 0)
+// - used に消費したバイト数 (区切りを含む) をセットする
+inline size_t parseSerialFrame(const uint8_t* data, size_t len, uint8_t* frame, size_t& used) {
+  const uint8_t* end = (const uint8_t*)memchr(data, 0x00, len);
+  if (end == nullptr) {
+    used = 0;
+    return 0;
+  }
+  used = end - data + 1;
+  size_t n = SerialController::cobsDecode(data, end - data, frame);
+  if (n < 4) {
+    return 0;
+  }
+  uint16_t crc = frame[n - 2] | (frame[n - 1] << 8);
+  if (SerialController::crc16(frame, n - 2) != crc) {
+    return 0;
+  }
+  return n - 2;
+}
+
+#endif
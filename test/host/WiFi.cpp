@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------
+  WiFi.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "WiFi.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+static std::atomic<uint16_t> _lastPort(0);
+
+// ソケットごとの WiFiClient のコピーの数 (ヒープを使わない)
+static const int _FD_MAX = 4096;
+static std::atomic<int> _refs[_FD_MAX];
+
+uint16_t hostWiFiPort() {
+  return _lastPort;
+}
+
+// ===============================================================
+// WiFiClient
+// ===============================================================
+
+WiFiClient::WiFiClient(int fd) {
+  if (fd >= 0 && fd < _FD_MAX) {
+    this->_fd = fd;
+    _refs[fd] = 1;
+  } else if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+WiFiClient::WiFiClient(const WiFiClient& other) {
+  this->_fd = other._fd;
+  if (this->_fd >= 0) {
+    _refs[this->_fd]++;
+  }
+}
+
+WiFiClient& WiFiClient::operator=(const WiFiClient& other) {
+  if (this != &other) {
+    if (other._fd >= 0) {
+      _refs[other._fd]++;
+    }
+    this->_release();
+    this->_fd = other._fd;
+  }
+  return *this;
+}
+
+WiFiClient::~WiFiClient() {
+  this->_release();
+}
+
+void WiFiClient::_release() {
+  if (this->_fd >= 0 && --_refs[this->_fd] == 0) {
+    ::close(this->_fd);
+  }
+  this->_fd = -1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  this->_release();
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+    return 0;
+  }
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return 0;
+  }
+  if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    ::close(fd);
+    return 0;
+  }
+  *this = WiFiClient(fd);
+  return 1;
+}
+
+bool WiFiClient::connected() {
+  if (this->_fd < 0) {
+    return false;
+  }
+  uint8_t c;
+  ssize_t r = ::recv(this->_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (r == 0) {
+    return false;
+  }
+  return r > 0 || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void WiFiClient::stop() {
+  if (this->_fd >= 0) {
+    ::shutdown(this->_fd, SHUT_RDWR);
+  }
+  this->_release();
+}
+
+void WiFiClient::setNoDelay(bool enabled) {
+  int v = enabled ? 1 : 0;
+  if (this->_fd >= 0) {
+    setsockopt(this->_fd, IPPROTO_TCP, TCP_NODELAY, &v, sizeof(v));
+  }
+}
+
+int WiFiClient::available() {
+  int n = 0;
+  if (this->_fd < 0 || ioctl(this->_fd, FIONREAD, &n) < 0) {
+    return 0;
+  }
+  return n;
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  if (this->_fd < 0 || ::recv(this->_fd, &c, 1, MSG_DONTWAIT) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+  return this->write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t len) {
+  size_t n = 0;
+  while (this->_fd >= 0 && n < len) {
+    ssize_t r = ::send(this->_fd, buf + n, len - n, MSG_NOSIGNAL);
+    if (r < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      break;
+    }
+    n += r;
+  }
+  return n;
+}
+
+// ===============================================================
+// WiFiServer
+// ===============================================================
+
+WiFiServer::~WiFiServer() {
+  if (this->_fd >= 0) {
+    ::close(this->_fd);
+  }
+}
+
+// 指定されたポートではなく空いているポートで待ち受ける
+void WiFiServer::begin() {
+  this->_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int v = 1;
+  setsockopt(this->_fd, SOL_SOCKET, SO_REUSEADDR, &v, sizeof(v));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  ::bind(this->_fd, (sockaddr*)&addr, sizeof(addr));
+  ::listen(this->_fd, 64);
+
+  socklen_t alen = sizeof(addr);
+  getsockname(this->_fd, (sockaddr*)&addr, &alen);
+  _lastPort = ntohs(addr.sin_port);
+}
+
+WiFiClient WiFiServer::available() {
+  if (this->_fd < 0) {
+    return WiFiClient();
+  }
+  int fd = ::accept4(this->_fd, nullptr, nullptr, 0);
+  if (fd < 0) {
+    return WiFiClient();
+  }
+  return WiFiClient(fd);
+}
@@ -0,0 +1,81 @@
+/* ----------------------------------------------------------------
+  WiFi.h (ホスト用)
+  - WiFiServer / WiFiClient を TCP ソケットで代替する
+  - WiFiClient::connect() は IPv4 アドレスの文字列だけを受け付ける (名前解決はしない)
+  - WiFiServer は空いているポートで待ち受ける (hostWiFiPort() で取得)
+  - WiFiClient のコピーはソケットを共有し、最後のコピーが破棄されると閉じる
+    (ESP32 の実装と同じ。ただし参照カウントのためのヒープ確保はしない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef WiFi_h
+#define WiFi_h
+#include <Arduino.h>
+#include <time.h>
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class IPAddress {
+public:
+  String toString() { return String("127.0.0.1"); }
+};
+
+class WiFiClass {
+public:
+  int state = WL_CONNECTED;
+
+  void begin(const char* ssid, const char* pass) { (void)ssid; (void)pass; }
+  int status() { return this->state; }
+  void disconnect(bool wifiOff = false) { (void)wifiOff; }
+  void setSleep(bool enabled) { (void)enabled; }
+  IPAddress localIP() { return IPAddress(); }
+};
+extern WiFiClass WiFi;
+
+// 最後に begin() した WiFiServer のポート
+uint16_t hostWiFiPort();
+
+class WiFiClient : public Stream {
+private:
+  int _fd = -1;
+
+  void _release();
+
+public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd);
+  WiFiClient(const WiFiClient& other);
+  WiFiClient& operator=(const WiFiClient& other);
+  ~WiFiClient();
+
+  operator bool() const { return this->_fd >= 0; }
+  int connect(const char* host, uint16_t port);
+  bool connected();
+  void stop();
+  void setNoDelay(bool enabled);
+
+  int available() override;
+  int read() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+};
+
+class WiFiServer {
+private:
+  uint16_t _port;
+  int _fd = -1;
+
+public:
+  WiFiServer(uint16_t port) : _port(port) {}
+  ~WiFiServer();
+  void begin();
+  WiFiClient available();
+  void setNoDelay(bool enabled) { (void)enabled; }
+};
+
+#endif
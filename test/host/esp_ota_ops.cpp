@@ -0,0 +1,216 @@
+/* ----------------------------------------------------------------
+  esp_ota_ops.cpp (ホスト用)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "esp_ota_ops.h"
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+
+// アプリのパーティションの大きさ (既定のパーティションテーブルと同じ)
+static const uint32_t _PART_SIZE = 0x140000;
+
+struct HostPartition {
+  esp_partition_t part;
+  std::vector<uint8_t> image;
+  esp_ota_img_states_t state;
+};
+
+static HostPartition _parts[2] = {
+  { { 0x10000, _PART_SIZE, "app0" }, {}, ESP_OTA_IMG_UNDEFINED },
+  { { 0x150000, _PART_SIZE, "app1" }, {}, ESP_OTA_IMG_UNDEFINED },
+};
+static int _running = 0;
+static int _boot = 0;
+static int _writing = -1;
+static HostOtaCounts _counts = {};
+
+static int _indexOf(const esp_partition_t* partition) {
+  for (int i = 0; i < 2; i++) {
+    if (partition == &_parts[i].part) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void hostOtaReset(const std::vector<uint8_t>& image) {
+  _parts[0].image = image;
+  _parts[0].state = ESP_OTA_IMG_VALID;
+  _parts[1].image.clear();
+  _parts[1].state = ESP_OTA_IMG_UNDEFINED;
+  _running = 0;
+  _boot = 0;
+  _writing = -1;
+  _counts = {};
+}
+
+void hostOtaReboot() {
+  HostPartition& boot = _parts[_boot];
+  if (boot.state == ESP_OTA_IMG_PENDING_VERIFY) {
+    boot.state = ESP_OTA_IMG_ABORTED;
+    _boot = 1 - _boot;
+  } else if (boot.state == ESP_OTA_IMG_NEW) {
+    boot.state = ESP_OTA_IMG_PENDING_VERIFY;
+  }
+  _running = _boot;
+  _writing = -1;
+}
+
+const esp_partition_t* hostOtaBootPartition() {
+  return &_parts[_boot].part;
+}
+
+const std::vector<uint8_t>& hostOtaImage(const esp_partition_t* partition) {
+  return _parts[_indexOf(partition)].image;
+}
+
+const HostOtaCounts& hostOtaCounts() {
+  return _counts;
+}
+
+extern "C" {
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+  int i = _indexOf(partition);
+  if (i < 0 || offset > partition->size || size > partition->size - offset) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  // 書き込まれていない部分は消去済み (0xFF)
+  const std::vector<uint8_t>& image = _parts[i].image;
+  for (size_t n = 0; n < size; n++) {
+    ((uint8_t*)dst)[n] = (offset + n < image.size()) ? image[offset + n] : 0xff;
+  }
+  return ESP_OK;
+}
+
+// イメージの SHA-256 (イメージの長さは書き込んだ長さ)
+esp_err_t esp_partition_get_sha256(const esp_partition_t* partition, uint8_t* sha256) {
+  int i = _indexOf(partition);
+  if (i < 0 || _parts[i].image.empty()) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, _parts[i].image.data(), _parts[i].image.size());
+  mbedtls_sha256_finish(&ctx, sha256);
+  mbedtls_sha256_free(&ctx);
+  return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition(void) {
+  return &_parts[_running].part;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start) {
+  (void)start;
+  return &_parts[1 - _running].part;
+}
+
+const esp_partition_t* esp_ota_get_last_invalid_partition(void) {
+  for (HostPartition& p : _parts) {
+    if (p.state == ESP_OTA_IMG_INVALID || p.state == ESP_OTA_IMG_ABORTED) {
+      return &p.part;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t size, esp_ota_handle_t* handle) {
+  (void)size;
+  int i = _indexOf(partition);
+  if (i < 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (i == _running) {
+    return ESP_ERR_OTA_PARTITION_CONFLICT;
+  }
+  _counts.begins++;
+  _parts[i].image.clear();
+  _parts[i].state = ESP_OTA_IMG_UNDEFINED;
+  _writing = i;
+  *handle = (esp_ota_handle_t)(i + 1);
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+  int i = (int)handle - 1;
+  if (i != _writing) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::vector<uint8_t>& image = _parts[i].image;
+  if (image.size() + size > _parts[i].part.size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  image.insert(image.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+  int i = (int)handle - 1;
+  if (i != _writing) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  _counts.ends++;
+  _writing = -1;
+  if (_parts[i].image.empty() || _parts[i].image[0] != 0xe9) {
+    return ESP_ERR_OTA_VALIDATE_FAILED;
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+  int i = (int)handle - 1;
+  if (i != _writing) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  _counts.aborts++;
+  _writing = -1;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+  int i = _indexOf(partition);
+  if (i < 0 || i == _writing || _parts[i].image.empty()) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  _counts.bootSets++;
+  if (i != _running) {
+    _parts[i].state = ESP_OTA_IMG_NEW;
+  }
+  _boot = i;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state) {
+  int i = _indexOf(partition);
+  if (i < 0 || _parts[i].state == ESP_OTA_IMG_UNDEFINED) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  *state = _parts[i].state;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) {
+  _parts[_running].state = ESP_OTA_IMG_VALID;
+  return ESP_OK;
+}
+
+// 実行中のイメージを無効にして、もう一方のパーティションから再起動する
+// - 実機は戻らないが、ここでは ESP.restart() を数えて戻る
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot(void) {
+  HostPartition& other = _parts[1 - _running];
+  if (other.state != ESP_OTA_IMG_VALID) {
+    return ESP_FAIL;
+  }
+  _parts[_running].state = ESP_OTA_IMG_INVALID;
+  _boot = 1 - _running;
+  ESP.restart();
+  return ESP_OK;
+}
+}
@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------
+  esp_ota_ops.h (ホスト用)
+  - ota_0 / ota_1 の 2 つのパーティションと起動時のロールバックを模擬する
+  - 再起動はテストから hostOtaReboot() で行う (ブートローダーの動作を含む)
+  - esp_ota_end() はイメージの先頭のマジックナンバー (0xE9) だけを確認する
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef esp_ota_ops_h
+#define esp_ota_ops_h
+#include <vector>
+#include "esp_partition.h"
+
+#define ESP_ERR_OTA_PARTITION_CONFLICT 0x1501
+#define ESP_ERR_OTA_VALIDATE_FAILED 0x1503
+
+typedef uint32_t esp_ota_handle_t;
+#define OTA_SIZE_UNKNOWN 0xffffffff
+
+typedef enum {
+  ESP_OTA_IMG_NEW = 0x0,
+  ESP_OTA_IMG_PENDING_VERIFY = 0x1,
+  ESP_OTA_IMG_VALID = 0x2,
+  ESP_OTA_IMG_INVALID = 0x3,
+  ESP_OTA_IMG_ABORTED = 0x4,
+  ESP_OTA_IMG_UNDEFINED = 0xFFFFFFFF,
+} esp_ota_img_states_t;
+
+extern "C" {
+const esp_partition_t* esp_ota_get_running_partition(void);
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start);
+const esp_partition_t* esp_ota_get_last_invalid_partition(void);
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t size, esp_ota_handle_t* handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void);
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot(void);
+}
+
+// 呼び出しの回数
+struct HostOtaCounts {
+  uint32_t begins;
+  uint32_t aborts;
+  uint32_t ends;
+  uint32_t bootSets;
+};
+
+// ota_0 に image を書き込んだ状態から起動したことにする (ota_1 は空)
+void hostOtaReset(const std::vector<uint8_t>& image);
+
+// 再起動する (ブートローダーの動作)
+// - 起動パーティションのイメージが NEW なら PENDING_VERIFY にして起動する
+// - PENDING_VERIFY のまま (確定されずに) 再起動したら ABORTED にして、もう一方から起動する
+void hostOtaReboot();
+
+// 次回起動するパーティション
+const esp_partition_t* hostOtaBootPartition();
+
+// パーティションに書き込まれているイメージ
+const std::vector<uint8_t>& hostOtaImage(const esp_partition_t* partition);
+
+// 呼び出しの回数
+const HostOtaCounts& hostOtaCounts();
+
+#endif
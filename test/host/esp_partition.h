@@ -0,0 +1,34 @@
+/* ----------------------------------------------------------------
+  esp_partition.h (ホスト用)
+  - OTA 用の 2 つのアプリのパーティションをメモリ上に置く (esp_ota_ops.cpp)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef esp_partition_h
+#define esp_partition_h
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+extern "C" {
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size);
+esp_err_t esp_partition_get_sha256(const esp_partition_t* partition, uint8_t* sha256);
+}
+
+#endif
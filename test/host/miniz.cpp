@@ -0,0 +1,56 @@
+/* ----------------------------------------------------------------
+  miniz.cpp (ホスト用)
+  - 展開が終わるか失敗したら zlib の作業領域を解放する
+    (途中でやめた場合は解放されないが、テストでしか使わない)
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#include "rom/miniz.h"
+#include <string.h>
+
+extern "C" tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                                         uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                                         const uint32_t decomp_flags) {
+  (void)pOut_buf_start;
+  // 2: 展開済み, 3: 失敗
+  if (r->m_state >= 2) {
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    return (r->m_state == 2) ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+  }
+  if (r->m_state == 0) {
+    memset(&r->zs, 0, sizeof(r->zs));
+    int bits = (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS;
+    if (inflateInit2(&r->zs, bits) != Z_OK) {
+      return TINFL_STATUS_FAILED;
+    }
+    r->m_state = 1;
+  }
+
+  r->zs.next_in = (Bytef*)pIn_buf_next;
+  r->zs.avail_in = (uInt)*pIn_buf_size;
+  r->zs.next_out = pOut_buf_next;
+  r->zs.avail_out = (uInt)*pOut_buf_size;
+  int ret = inflate(&r->zs, Z_NO_FLUSH);
+  *pIn_buf_size -= r->zs.avail_in;
+  *pOut_buf_size -= r->zs.avail_out;
+
+  if (ret == Z_STREAM_END) {
+    inflateEnd(&r->zs);
+    r->m_state = 2;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) {
+    inflateEnd(&r->zs);
+    r->m_state = 3;
+    return TINFL_STATUS_FAILED;
+  }
+  if (r->zs.avail_out == 0) {
+    return TINFL_STATUS_HAS_MORE_OUTPUT;
+  }
+  return (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------
+  rom/miniz.h (ホスト用)
+  - ESP32 の ROM の tinfl_decompress() を zlib の inflate() で代替する (miniz.cpp)
+  - 出力先の範囲と戻り値は tinfl と同じ。辞書は zlib が持つので、
+    出力の輪状のバッファを辞書として参照しなくても展開できる
+
+  Copyright (c) 2025 Futomi Hatano. All right reserved.
+  https://github.com/futomi
+
+  Licensed under the MIT license.
+  See LICENSE file in the project root for full license information.
+  -------------------------------------------------------------- */
+#ifndef rom_miniz_h
+#define rom_miniz_h
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+};
+
+typedef enum {
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+  uint32_t m_state;  // 0 なら初期化前
+  z_stream zs;
+} tinfl_decompressor;
+
+#define tinfl_init(r) \
+  do { \
+    (r)->m_state = 0; \
+  } while (0)
+
+extern "C" tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                                         uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                                         const uint32_t decomp_flags);
+
+#endif
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------
+#  ble_compare.py
+#  - BLE スタック (Bluedroid / NimBLE) ごとのヒープの消費と接続時間を比べる
+#  - USB シリアル経由で電源状態の取得 (コマンド 0x01) を count 回実行し、
+#    前後の診断情報 (コマンド 0x05) から BLE の統計情報を取り出して保存する
+#  - Bluedroid と NimBLE でそれぞれ書き込んだ本体で capture を実行してから、
+#    diff で 2 つの結果を並べて差を表示する
+#
+#  使い方:
+#    python3 ble_compare.py capture --port /dev/ttyUSB0 --label bluedroid --out bluedroid.json [--count 20]
+#    python3 ble_compare.py capture --sim build/SerialSim --label fake --out fake.json
+#    python3 ble_compare.py diff bluedroid.json nimble.json
+#
+#  Copyright (c) 2025 Futomi Hatano. All right reserved.
+#  https://github.com/futomi
+#
+#  Licensed under the MIT license.
+#  See LICENSE file in the project root for full license information.
+# ----------------------------------------------------------------
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import plugserial  # noqa: E402
+
+# 診断情報 (コマンド 0x05) の並びの位置
+M_FREE_HEAP = 1
+M_MIN_FREE_HEAP = 2
+M_LARGEST_BLOCK = 3
+M_INIT_HEAP = 12
+M_CONNECTS = 13
+M_FAILURES = 14
+M_MAX_CONNECT_MS = 16
+M_MTU = 27
+M_AVG_CONNECT_MS = 32
+M_CONNECT_HEAP = 33
+
+# diff で表示する項目 (キー, 表示名, 単位)
+ROWS = [
+    ("init_heap", "stack heap (init)", "bytes"),
+    ("connect_heap", "stack heap (connection)", "bytes"),
+    ("free_heap", "free heap", "bytes"),
+    ("min_free_heap", "min free heap", "bytes"),
+    ("largest_block", "largest free block", "bytes"),
+    ("avg_connect_ms", "connect avg", "ms"),
+    ("max_connect_ms", "connect max", "ms"),
+    ("command_p50_ms", "command p50", "ms"),
+    ("command_p99_ms", "command p99", "ms"),
+    ("failures", "connect failures", ""),
+    ("mtu", "MTU", "bytes"),
+]
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, len(values) * p // 100)]
+
+
+def capture(plug, label, count):
+    before = plug.metrics()
+    if len(before) <= M_CONNECT_HEAP:
+        raise plugserial.ProtocolError("firmware does not report BLE connection metrics")
+
+    # コマンドごとに接続・切断するので、接続時間が含まれる
+    latencies = []
+    for _ in range(count):
+        t0 = time.monotonic()
+        plug.status()
+        latencies.append((time.monotonic() - t0) * 1000)
+
+    after = plug.metrics()
+    return {
+        "label": label,
+        "count": count,
+        "init_heap": after[M_INIT_HEAP],
+        "connect_heap": after[M_CONNECT_HEAP],
+        "free_heap": after[M_FREE_HEAP],
+        "min_free_heap": after[M_MIN_FREE_HEAP],
+        "largest_block": after[M_LARGEST_BLOCK],
+        "avg_connect_ms": after[M_AVG_CONNECT_MS],
+        "max_connect_ms": after[M_MAX_CONNECT_MS],
+        "command_p50_ms": round(percentile(latencies, 50), 1),
+        "command_p99_ms": round(percentile(latencies, 99), 1),
+        "connects": after[M_CONNECTS] - before[M_CONNECTS],
+        "failures": after[M_FAILURES] - before[M_FAILURES],
+        "mtu": after[M_MTU],
+    }
+
+
+def diff(a, b):
+    print("%-24s %14s %14s %12s" % ("", a["label"], b["label"], "diff"))
+    for key, name, unit in ROWS:
+        va, vb = a[key], b[key]
+        print("%-24s %14s %14s %+12g %s" % (name, va, vb, vb - va, unit))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    sub = parser.add_subparsers(dest="op", required=True)
+    cap = sub.add_parser("capture", help="measure the running firmware")
+    cap.add_argument("--port", help="serial port of the device")
+    cap.add_argument("--sim", help="path to the SerialSim executable")
+    cap.add_argument("--baud", type=int, default=115200)
+    cap.add_argument("--label", required=True)
+    cap.add_argument("--count", type=int, default=20)
+    cap.add_argument("--out", required=True)
+    dif = sub.add_parser("diff", help="compare two captures")
+    dif.add_argument("a")
+    dif.add_argument("b")
+    args = parser.parse_args()
+
+    if args.op == "diff":
+        with open(args.a) as fa, open(args.b) as fb:
+            diff(json.load(fa), json.load(fb))
+        return 0
+
+    sim = None
+    port = args.port
+    if args.sim:
+        sim = subprocess.Popen([args.sim, "--connect-ms", "100", "--ble-ms", "20"],
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+        port = sim.stdout.readline().strip()
+    if not port:
+        parser.error("--port or --sim is required")
+
+    try:
+        with plugserial.PlugSerial(port, args.baud, timeout=60.0) as plug:
+            result = capture(plug, args.label, args.count)
+    except (plugserial.ProtocolError, plugserial.CommandError, TimeoutError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        if sim:
+            sim.stdin.close()
+            sim.wait(5)
+
+    with open(args.out, "w") as f:
+        json.dump(result, f, indent=2)
+    for key, name, unit in ROWS:
+        print("%-24s %10s %s" % (name, result[key], unit))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
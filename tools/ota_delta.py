@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------
+#  ota_delta.py
+#  - 実行中のファームウェア (old.bin) から新しいファームウェア (new.bin) への
+#    差分ファイルを作成する (OtaUpdater の差分形式を zlib で圧縮したもの)
+#  - 作成した差分を old.bin に適用して new.bin と一致することを確認する
+#  - 更新の要求で指定する new.bin の SHA-256 を表示する
+#
+#  使い方: python3 ota_delta.py [--no-compress] old.bin new.bin out.delta
+#
+#  Copyright (c) 2025 Futomi Hatano. All right reserved.
+#  https://github.com/futomi
+#
+#  Licensed under the MIT license.
+#  See LICENSE file in the project root for full license information.
+# ----------------------------------------------------------------
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = b"SBD1"
+MAGIC_Z = b"SBZ1"
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+# 一致を探すブロックの大きさ (バイト)
+BLOCK = 32
+
+# これより短い一致はコピーにせずそのまま挿入する
+MIN_COPY = 64
+
+
+# 実行中のイメージの SHA-256 (本機の esp_partition_get_sha256() と同じ値)
+# - イメージ末尾にハッシュが付加されている場合はその値
+def source_hash(image):
+    if len(image) > 24 and image[23] == 1:
+        return image[-32:]
+    return hashlib.sha256(image).digest()
+
+
+def make_delta(old, new):
+    # old のブロックの位置の索引
+    index = {}
+    for pos in range(0, len(old) - BLOCK + 1, 4):
+        index.setdefault(old[pos:pos + BLOCK], pos)
+
+    ops = []
+    pending = bytearray()
+    i = 0
+    while i < len(new):
+        src = index.get(new[i:i + BLOCK])
+        if src is not None:
+            # 一致を前方に伸ばす
+            n = BLOCK
+            while i + n < len(new) and src + n < len(old) and new[i + n] == old[src + n]:
+                n += 1
+            if n >= MIN_COPY:
+                if pending:
+                    ops.append((OP_INSERT, bytes(pending)))
+                    pending = bytearray()
+                ops.append((OP_COPY, src, n))
+                i += n
+                continue
+        pending.append(new[i])
+        i += 1
+    if pending:
+        ops.append((OP_INSERT, bytes(pending)))
+
+    out = bytearray(MAGIC)
+    out += struct.pack("<I", len(new))
+    out += source_hash(old)
+    out += hashlib.sha256(new).digest()
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[2], op[1])
+        else:
+            out += struct.pack("<BI", OP_INSERT, len(op[1])) + op[1]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def compress(delta):
+    return MAGIC_Z + zlib.compress(delta, 9)
+
+
+# 差分を適用する (OtaUpdater と同じ手順)
+def apply_delta(old, data):
+    if data[:4] == MAGIC_Z:
+        data = zlib.decompress(data[4:])
+    if data[:4] != MAGIC:
+        raise ValueError("bad magic")
+    size, = struct.unpack_from("<I", data, 4)
+    if data[8:40] != source_hash(old):
+        raise ValueError("source mismatch")
+    pos = 72
+    out = bytearray()
+    while data[pos] != OP_END:
+        op, n = struct.unpack_from("<BI", data, pos)
+        pos += 5
+        if op == OP_COPY:
+            src, = struct.unpack_from("<I", data, pos)
+            pos += 4
+            out += old[src:src + n]
+        else:
+            out += data[pos:pos + n]
+            pos += n
+    if len(out) != size or hashlib.sha256(out).digest() != data[40:72]:
+        raise ValueError("target mismatch")
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--no-compress", action="store_true", help="write the uncompressed SBD1 format")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("out")
+    args = parser.parse_args()
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+    delta = make_delta(old, new)
+    if not args.no_compress:
+        delta = compress(delta)
+    if apply_delta(old, delta) != new:
+        print("error: delta does not reproduce %s" % args.new, file=sys.stderr)
+        return 1
+    with open(args.out, "wb") as f:
+        f.write(delta)
+    print("image: %d bytes, delta: %d bytes (%.1f%%)" % (len(new), len(delta), 100.0 * len(delta) / len(new)))
+    print("sha256: %s" % hashlib.sha256(new).hexdigest())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
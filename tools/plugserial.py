@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------
+#  plugserial.py
+#  - USB シリアル制御プロトコル (COBS + CRC-16) の Linux 用クライアント
+#  - 標準ライブラリのみを使う (pyserial は不要)
+#
+#  使い方: python3 plugserial.py /dev/ttyUSB0 status|on|off|toggle|logs [件数]|metrics
+#
+#  ライブラリとして使う場合:
+#    with PlugSerial("/dev/ttyUSB0") as plug:
+#        print(plug.status())
+#
+#  Copyright (c) 2025 Futomi Hatano. All right reserved.
+#  https://github.com/futomi
+#
+#  Licensed under the MIT license.
+#  See LICENSE file in the project root for full license information.
+# ----------------------------------------------------------------
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+# フレームの種類
+FRAME_REQUEST = 0x01
+FRAME_EVENT = 0x02
+FRAME_RESPONSE = 0x81
+
+# コマンド
+CMD_STATUS = 0x01
+CMD_SET = 0x02
+CMD_TOGGLE = 0x03
+CMD_DUMP_LOG = 0x04
+CMD_DUMP_METRICS = 0x05
+CMD_CONFIG = 0x06
+CMD_OTA = 0x07
+
+# イベント
+EVT_POWER = 0x01
+EVT_LOG = 0x02
+
+# ステータス
+STATUS_OK = 0x00
+STATUS_BAD_ARGS = 0xFE
+STATUS_UNKNOWN_CMD = 0xFF
+
+# 1 件のログのバイト数 (LogRecord)
+LOG_RECORD_LEN = 8
+
+# 本機が貯められる未処理の要求フレームの数
+PIPELINE_MAX = 4
+
+BAUD_RATES = {
+    9600: termios.B9600,
+    57600: termios.B57600,
+    115200: termios.B115200,
+    230400: termios.B230400,
+}
+
+
+class ProtocolError(Exception):
+    pass
+
+
+class CommandError(Exception):
+    def __init__(self, cmd, status):
+        super().__init__("command 0x%02x failed with status 0x%02x" % (cmd, status))
+        self.cmd = cmd
+        self.status = status
+
+
+# CRC-16/CCITT-FALSE (SerialController::crc16() と同じ)
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+# COBS エンコード (区切りの 0x00 は含まない)
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+# COBS デコード (不正なら ProtocolError)
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ProtocolError("invalid COBS data")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+# 要求フレームを組み立てる (commands は (コマンド, 引数) の並び)
+def build_request(seq, commands):
+    body = bytearray([FRAME_REQUEST, seq & 0xFF])
+    for cmd, args in commands:
+        body += bytes([cmd, len(args)]) + bytes(args)
+    crc = crc16(body)
+    body += struct.pack("<H", crc)
+    return cobs_encode(bytes(body)) + b"\x00"
+
+
+# フレームを分解する (戻り値は (種類, シーケンス番号, 本体))
+def parse_frame(encoded):
+    frame = cobs_decode(encoded)
+    if len(frame) < 4:
+        raise ProtocolError("frame too short")
+    (crc,) = struct.unpack("<H", frame[-2:])
+    if crc16(frame[:-2]) != crc:
+        raise ProtocolError("CRC mismatch")
+    return frame[0], frame[1], frame[2:-2]
+
+
+# 応答の本体を (コマンド, ステータス, データ) の並びにする
+def parse_response_body(body):
+    items = []
+    pos = 0
+    while pos + 3 <= len(body):
+        cmd, status, dlen = body[pos], body[pos + 1], body[pos + 2]
+        data = body[pos + 3:pos + 3 + dlen]
+        if len(data) != dlen:
+            raise ProtocolError("truncated response")
+        items.append((cmd, status, bytes(data)))
+        pos += 3 + dlen
+    return items
+
+
+# ログのレコードを (タイムスタンプ文字列, エラーかどうか, コード) にする
+def parse_log_record(rec):
+    stamp, err, code, _ = struct.unpack("<IBBH", rec)
+    text = "%04u/%02u/%02u %02u:%02u:%02u" % (
+        2000 + ((stamp >> 26) & 0x3F), (stamp >> 22) & 0x0F, (stamp >> 17) & 0x1F,
+        (stamp >> 12) & 0x1F, (stamp >> 6) & 0x3F, stamp & 0x3F)
+    return text, bool(err), code
+
+
+class PlugSerial:
+    def __init__(self, path, baud=115200, timeout=5.0):
+        self.timeout = timeout
+        self.events = []
+        self._seq = 0
+        self._rx = bytearray()
+        self._fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self._fd)
+        attr = termios.tcgetattr(self._fd)
+        speed = BAUD_RATES.get(baud, termios.B115200)
+        attr[4] = speed
+        attr[5] = speed
+        termios.tcsetattr(self._fd, termios.TCSANOW, attr)
+
+    def close(self):
+        if self._fd is not None:
+            os.close(self._fd)
+            self._fd = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    # 要求フレームを送信してシーケンス番号を返す (応答は待たない)
+    def send(self, commands):
+        self._seq = (self._seq + 1) & 0xFF
+        data = build_request(self._seq, commands)
+        while data:
+            n = os.write(self._fd, data)
+            data = data[n:]
+        return self._seq
+
+    # フレームを 1 つ受信する (戻り値は (種類, シーケンス番号, 本体))
+    # - CRC が不正なフレームは ProtocolError
+    def receive(self, timeout=None):
+        deadline = time.monotonic() + (self.timeout if timeout is None else timeout)
+        while True:
+            end = self._rx.find(b"\x00")
+            if end >= 0:
+                encoded = bytes(self._rx[:end])
+                del self._rx[:end + 1]
+                if encoded:
+                    return parse_frame(encoded)
+                continue
+            wait = deadline - time.monotonic()
+            if wait <= 0:
+                raise TimeoutError("no frame received")
+            ready, _, _ = select.select([self._fd], [], [], wait)
+            if ready:
+                self._rx += os.read(self._fd, 4096)
+
+    # seq の応答を待つ (途中で届いたイベントは events に貯める)
+    def wait_response(self, seq):
+        while True:
+            ftype, fseq, body = self.receive()
+            if ftype == FRAME_EVENT:
+                self.events.append((body[0], bytes(body[2:2 + body[1]])))
+            elif ftype == FRAME_RESPONSE and fseq == seq:
+                return parse_response_body(body)
+            elif ftype == FRAME_RESPONSE:
+                raise ProtocolError("unexpected sequence number %d (expected %d)" % (fseq, seq))
+
+    # コマンドを一括実行して (コマンド, ステータス, データ) の並びを返す
+    def call(self, commands):
+        return self.wait_response(self.send(commands))
+
+    # コマンドを 1 つ実行してデータを返す (失敗したら CommandError)
+    def command(self, cmd, args=b""):
+        items = self.call([(cmd, args)])
+        if not items:
+            raise ProtocolError("empty response")
+        rcmd, status, data = items[0]
+        if status != STATUS_OK:
+            raise CommandError(rcmd, status)
+        return data
+
+    def status(self):
+        return self.command(CMD_STATUS)[0] == 0x01
+
+    def set_power(self, on):
+        return self.command(CMD_SET, bytes([0x01 if on else 0x00]))[0] == 0x01
+
+    def toggle(self):
+        return self.command(CMD_TOGGLE)[0] == 0x01
+
+    def logs(self, start=0, count=10):
+        data = self.command(CMD_DUMP_LOG, struct.pack("<HB", start, count))
+        return [parse_log_record(data[i:i + LOG_RECORD_LEN]) for i in range(0, len(data), LOG_RECORD_LEN)]
+
+    def metrics(self):
+        data = self.command(CMD_DUMP_METRICS)
+        return list(struct.unpack("<%dI" % (len(data) // 4), data))
+
+    def config(self, text=""):
+        self.command(CMD_CONFIG, text.encode())
+
+
+def main(argv):
+    if len(argv) < 3:
+        print("usage: plugserial.py PORT status|on|off|toggle|logs [N]|metrics", file=sys.stderr)
+        return 2
+    with PlugSerial(argv[1]) as plug:
+        op = argv[2]
+        if op == "status":
+            print("ON" if plug.status() else "OFF")
+        elif op in ("on", "off"):
+            print("ON" if plug.set_power(op == "on") else "OFF")
+        elif op == "toggle":
+            print("ON" if plug.toggle() else "OFF")
+        elif op == "logs":
+            n = int(argv[3]) if len(argv) > 3 else 10
+            for text, err, code in plug.logs(0, n):
+                print("%s %s %d" % (text, "ERROR" if err else "EVENT", code))
+        elif op == "metrics":
+            print(" ".join(str(v) for v in plug.metrics()))
+        else:
+            print("unknown operation: " + op, file=sys.stderr)
+            return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------
+#  serial_bench.py
+#  - USB シリアル制御プロトコルの往復時間とスループットを計測する
+#  - 実機のシリアルポート、またはシミュレーター (test/SerialSim) の
+#    疑似端末に対して実行できる
+#
+#  使い方:
+#    python3 serial_bench.py --port /dev/ttyUSB0 [--count 200]
+#    python3 serial_bench.py --sim build/SerialSim [--baud 115200] [--count 200]
+#
+#  次の 3 通りで電源状態の取得 (コマンド 0x01) を count 回実行する
+#    single:    1 要求 1 コマンドで応答を待ってから次を送る
+#    pipelined: 応答を待たずに 4 要求まで送る
+#    batched:   1 要求に 4 コマンドを入れる
+#  CRC やシーケンス番号の不一致があれば終了コード 1 で終わる
+#
+#  Copyright (c) 2025 Futomi Hatano. All right reserved.
+#  https://github.com/futomi
+#
+#  Licensed under the MIT license.
+#  See LICENSE file in the project root for full license information.
+# ----------------------------------------------------------------
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import plugserial  # noqa: E402
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, len(values) * p // 100)]
+
+
+def report(name, count, elapsed, latencies):
+    print("%-9s %5d cmds  %7.1f cmd/s  p50 %7.2f ms  p99 %7.2f ms" % (
+        name, count, count / elapsed, percentile(latencies, 50) * 1000, percentile(latencies, 99) * 1000))
+
+
+def check(items, n):
+    if len(items) != n:
+        raise plugserial.ProtocolError("expected %d results, got %d" % (n, len(items)))
+    for cmd, status, data in items:
+        if cmd != plugserial.CMD_STATUS or status != plugserial.STATUS_OK or len(data) != 1:
+            raise plugserial.ProtocolError("unexpected result %r" % ((cmd, status, data),))
+
+
+def bench_single(plug, count):
+    latencies = []
+    start = time.monotonic()
+    for _ in range(count):
+        t0 = time.monotonic()
+        check(plug.call([(plugserial.CMD_STATUS, b"")]), 1)
+        latencies.append(time.monotonic() - t0)
+    report("single", count, time.monotonic() - start, latencies)
+
+
+def bench_pipelined(plug, count):
+    latencies = []
+    inflight = []
+    sent = 0
+    start = time.monotonic()
+    while sent < count or inflight:
+        while sent < count and len(inflight) < plugserial.PIPELINE_MAX:
+            inflight.append((plug.send([(plugserial.CMD_STATUS, b"")]), time.monotonic()))
+            sent += 1
+        seq, t0 = inflight.pop(0)
+        check(plug.wait_response(seq), 1)
+        latencies.append(time.monotonic() - t0)
+    report("pipelined", count, time.monotonic() - start, latencies)
+
+
+def bench_batched(plug, count, batch=4):
+    latencies = []
+    start = time.monotonic()
+    for _ in range(count // batch):
+        t0 = time.monotonic()
+        check(plug.call([(plugserial.CMD_STATUS, b"")] * batch), batch)
+        latencies.append(time.monotonic() - t0)
+    report("batched", count // batch * batch, time.monotonic() - start, latencies)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", help="serial port of the device")
+    parser.add_argument("--sim", help="path to the SerialSim executable")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--ble-ms", type=int, default=0, help="simulated BLE time per command (SerialSim)")
+    parser.add_argument("--count", type=int, default=200)
+    args = parser.parse_args()
+
+    sim = None
+    port = args.port
+    if args.sim:
+        sim = subprocess.Popen([args.sim, "--baud", str(args.baud), "--ble-ms", str(args.ble_ms)],
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+        port = sim.stdout.readline().strip()
+    if not port:
+        parser.error("--port or --sim is required")
+
+    try:
+        with plugserial.PlugSerial(port, args.baud) as plug:
+            print("port %s, %d baud" % (port, args.baud))
+            bench_single(plug, args.count)
+            bench_pipelined(plug, args.count)
+            bench_batched(plug, args.count)
+
+            # 処理中に通知されたイベントが応答と別のフレームで届いていること
+            power = [e for e in plug.events if e[0] == plugserial.EVT_POWER]
+            print("events    %5d power events" % len(power))
+            if len(power) < args.count:
+                raise plugserial.ProtocolError("missing power events")
+
+            metrics = plug.metrics()
+            print("dropped   %5d frames" % metrics[11])
+            if metrics[11] != 0:
+                raise plugserial.ProtocolError("device dropped frames")
+    except (plugserial.ProtocolError, TimeoutError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        if sim:
+            sim.stdin.close()
+            sim.wait(5)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())